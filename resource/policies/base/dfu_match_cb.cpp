@@ -42,12 +42,16 @@ dfu_match_cb_t::dfu_match_cb_t (const dfu_match_cb_t &o)
     : matcher_data_t (o)
 {
     m_trav_level = o.m_trav_level;
+    m_window_at = o.m_window_at;
+    m_window_duration = o.m_window_duration;
 }
 
 dfu_match_cb_t &dfu_match_cb_t::operator= (const dfu_match_cb_t &o)
 {
     matcher_data_t::operator= (o);
     m_trav_level = o.m_trav_level;
+    m_window_at = o.m_window_at;
+    m_window_duration = o.m_window_duration;
     return *this;
 }
 
@@ -111,6 +115,8 @@ int dfu_match_cb_t::aux_finish_vtx (
     const f_resource_graph_t &g,
     scoring_api_t &dfu)
 {
+    // an auxiliary vertex reached by the up-walk qualifies by default
+    dfu.set_overall_score (MATCH_MET);
     m_trav_level--;
     return 0;
 }
@@ -134,6 +140,22 @@ std::string dfu_match_cb_t::level ()
     return prefix;
 }
 
+void dfu_match_cb_t::set_window (int64_t at, uint64_t duration)
+{
+    m_window_at = at;
+    m_window_duration = duration;
+}
+
+int64_t dfu_match_cb_t::window_at () const
+{
+    return m_window_at;
+}
+
+uint64_t dfu_match_cb_t::window_duration () const
+{
+    return m_window_duration;
+}
+
 } // resource_model
 } // Flux
 
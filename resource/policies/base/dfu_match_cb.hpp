@@ -162,8 +162,21 @@ public:
     void decr ();
     std::string level ();
 
+    /*! Set the time window of the match attempt in progress. Called back
+     *  by the traverser before each walk so that a match policy can query
+     *  the planners of the visiting vertices over the same window.
+     *
+     *  \param at        start time of the window.
+     *  \param duration  duration of the window.
+     */
+    void set_window (int64_t at, uint64_t duration);
+    int64_t window_at () const;
+    uint64_t window_duration () const;
+
 private:
     int m_trav_level;
+    int64_t m_window_at = 0;
+    uint64_t m_window_duration = 1;
 };
 
 } // namespace resource_model
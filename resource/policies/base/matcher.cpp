@@ -187,6 +187,15 @@ bool matcher_util_api_t::is_pruning_type (const std::string &subsystem,
     return rc;
 }
 
+bool matcher_util_api_t::is_pruning_type (const std::string &prune_type)
+{
+    for (auto &kv : m_total_set) {
+        if (kv.second.find (prune_type) != kv.second.end ())
+            return true;
+    }
+    return false;
+}
+
 } // resource_model
 } // Flux
 /*
@@ -124,6 +124,10 @@ public:
     bool is_pruning_type (const std::string &subsystem,
                           const std::string &prune_type);
 
+    /*! Is prune_type tracked by the subtree plans of any subsystem?
+     */
+    bool is_pruning_type (const std::string &prune_type);
+
 private:
     // resource types that will be used for scheduler driven aggregate updates
     // Examples:
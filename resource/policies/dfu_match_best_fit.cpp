@@ -0,0 +1,163 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#include <limits>
+#include "policies/dfu_match_best_fit.hpp"
+
+namespace Flux {
+namespace resource_model {
+
+// Occupancy of each subtree-tracked resource type is measured in
+// 1/OCCUPANCY_UNIT of its total.
+static const int64_t OCCUPANCY_UNIT = 1000;
+
+// The occupancy takes the upper 32 bits of the score and the ID-based
+// tie-breaker the lower 31 bits, keeping the score a positive int64_t.
+static const int OCCUPANCY_SHIFT = 32;
+
+best_fit_t::best_fit_t ()
+{
+
+}
+
+best_fit_t::best_fit_t (const std::string &name) : dfu_match_cb_t (name)
+{
+
+}
+
+best_fit_t::best_fit_t (const best_fit_t &o) : dfu_match_cb_t (o)
+{
+
+}
+
+best_fit_t &best_fit_t::operator= (const best_fit_t &o)
+{
+    dfu_match_cb_t::operator= (o);
+    return *this;
+}
+
+best_fit_t::~best_fit_t ()
+{
+
+}
+
+int64_t best_fit_t::occupancy (vtx_t u, const subsystem_t &subsystem,
+                               const f_resource_graph_t &g) const
+{
+    int64_t occ = 0;
+    auto iter = g[u].idata.subplans.find (subsystem);
+    if (iter == g[u].idata.subplans.end () || !iter->second)
+        return 0;
+
+    planner_multi_t *p = iter->second;
+    size_t len = planner_multi_resources_len (p);
+    for (unsigned int i = 0; i < len; ++i) {
+        planner_t *plan = planner_multi_planner_at (p, i);
+        int64_t total = planner_resource_total (plan);
+        int64_t avail = planner_avail_resources_during (plan, window_at (),
+                                                        window_duration ());
+        if (total <= 0 || avail < 0 || avail > total)
+            continue;
+        occ += ((total - avail) * OCCUPANCY_UNIT) / total;
+    }
+    return occ;
+}
+
+int best_fit_t::dom_finish_graph (
+    const subsystem_t &subsystem,
+    const std::vector<Flux::Jobspec::Resource> &resources,
+    const f_resource_graph_t &g, scoring_api_t &dfu)
+{
+    int64_t score = MATCH_MET;
+    for (auto &resource : resources) {
+        const std::string &type = resource.type;
+        unsigned int qc = dfu.qualified_count (subsystem, type);
+        unsigned int count = calc_count (resource, qc);
+        if (count == 0) {
+            score = MATCH_UNMET;
+            break;
+        }
+        dfu.choose_accum_best_k (subsystem, type, count);
+    }
+    dfu.set_overall_score (score);
+    return (score == MATCH_MET)? 0 : -1;
+}
+
+int best_fit_t::dom_finish_slot (const subsystem_t &subsystem,
+                                 scoring_api_t &dfu)
+{
+    std::vector<std::string> types;
+    dfu.resrc_types (subsystem, types);
+    for (auto &type : types)
+        dfu.choose_accum_all (subsystem, type);
+    return 0;
+}
+
+int best_fit_t::dom_finish_vtx (
+    vtx_t u,
+    const subsystem_t &subsystem,
+    const std::vector<Flux::Jobspec::Resource> &resources,
+    const f_resource_graph_t &g, scoring_api_t &dfu)
+{
+    int64_t score = MATCH_MET;
+    int64_t overall;
+
+    for (auto &resource : resources) {
+        if (resource.type != g[u].type)
+            continue;
+
+        // jobspec resource type matches with the visiting vertex
+        for (auto &c_resource : resource.with) {
+            // test children resource count requirements
+            const std::string &c_type = c_resource.type;
+            unsigned int qc = dfu.qualified_count (subsystem, c_type);
+            unsigned int count = calc_count (c_resource, qc);
+            if (count == 0) {
+                score = MATCH_UNMET;
+                break;
+            }
+            dfu.choose_accum_best_k (subsystem, c_type, count);
+        }
+    }
+
+    if (score == MATCH_MET) {
+        // more occupied first; among equally occupied, lower id first
+        int64_t id_max = std::numeric_limits<int32_t>::max ();
+        int64_t id = (g[u].id < 0)? 0 : std::min (g[u].id, id_max - 1);
+        overall = score + (occupancy (u, subsystem, g) << OCCUPANCY_SHIFT)
+                  + (id_max - id);
+    } else {
+        overall = score;
+    }
+    dfu.set_overall_score (overall);
+    decr ();
+    return (score == MATCH_MET)? 0 : -1;
+}
+
+} // resource_model
+} // Flux
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
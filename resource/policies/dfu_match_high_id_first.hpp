@@ -37,7 +37,7 @@ namespace resource_model {
 /* High ID first policy: select resources of each type
  * with higher numeric IDs.
  */
-struct high_first_t : public dfu_match_cb_t
+struct high_first_t final : public dfu_match_cb_t
 {
     high_first_t ();
     high_first_t (const std::string &name);
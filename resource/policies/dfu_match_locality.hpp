@@ -39,7 +39,7 @@ namespace resource_model {
 /*! Locality-aware policy: select resources of each type
  *  where you have more qualified.
  */
-struct greater_interval_first_t : public dfu_match_cb_t
+struct greater_interval_first_t final : public dfu_match_cb_t
 {
     greater_interval_first_t ();
     greater_interval_first_t (const std::string &name);
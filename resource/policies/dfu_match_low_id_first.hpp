@@ -37,7 +37,7 @@ namespace resource_model {
 /*! Low ID first policy: select resources of each type
  *  with lower numeric IDs.
  */
-struct low_first_t : public dfu_match_cb_t
+struct low_first_t final : public dfu_match_cb_t
 {
     low_first_t ();
     low_first_t (const std::string &name);
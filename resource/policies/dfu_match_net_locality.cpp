@@ -0,0 +1,284 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#include <limits>
+#include <algorithm>
+#include "policies/dfu_match_net_locality.hpp"
+
+namespace Flux {
+namespace resource_model {
+
+namespace {
+
+const int64_t RANK_MAX = std::numeric_limits<int64_t>::max ();
+
+/*! Order egroups by the rank of their target vertices; egroups without
+ *  a rank (e.g., unqualified ones) are ordered last.
+ */
+struct rank_less {
+    bool operator() (const eval_egroup_t &a, const eval_egroup_t &b) const
+    {
+        return rank (a) < rank (b);
+    }
+    net_locality_t::rank_t rank (const eval_egroup_t &e) const
+    {
+        if (e.score > MATCH_UNMET && !e.edges.empty ()) {
+            auto iter = ranks->find (boost::target (e.edges[0].edge, *g));
+            if (iter != ranks->end ())
+                return iter->second;
+        }
+        return std::make_tuple (RANK_MAX, RANK_MAX, RANK_MAX, RANK_MAX,
+                                RANK_MAX, RANK_MAX, RANK_MAX);
+    }
+    const f_resource_graph_t *g;
+    const std::unordered_map<vtx_t, net_locality_t::rank_t> *ranks;
+};
+
+} // namespace
+
+net_locality_t::net_locality_t ()
+{
+
+}
+
+net_locality_t::net_locality_t (const std::string &name)
+    : dfu_match_cb_t (name)
+{
+
+}
+
+net_locality_t::net_locality_t (const net_locality_t &o)
+    : dfu_match_cb_t (o)
+{
+    m_uplinks = o.m_uplinks;
+    m_graph_vertices = o.m_graph_vertices;
+    m_graph_edges = o.m_graph_edges;
+}
+
+net_locality_t &net_locality_t::operator= (const net_locality_t &o)
+{
+    dfu_match_cb_t::operator= (o);
+    m_uplinks = o.m_uplinks;
+    m_graph_vertices = o.m_graph_vertices;
+    m_graph_edges = o.m_graph_edges;
+    return *this;
+}
+
+net_locality_t::~net_locality_t ()
+{
+
+}
+
+const net_locality_t::uplink_t &net_locality_t::uplink (
+    vtx_t u, const f_resource_graph_t &g)
+{
+    // The uplinks walked so far are stale once the graph has changed
+    if (num_vertices (g) != m_graph_vertices
+        || num_edges (g) != m_graph_edges) {
+        m_uplinks.clear ();
+        m_graph_vertices = num_vertices (g);
+        m_graph_edges = num_edges (g);
+    }
+
+    auto iter = m_uplinks.find (u);
+    if (iter != m_uplinks.end ())
+        return iter->second;
+
+    // The network graph of a node is a short chain of connected_up edges
+    // (e.g., node->nic->edgeswitch->coreswitch); remember where it leads.
+    uplink_t up;
+    vtx_t v = u;
+    bool next = true;
+    while (next && !up.has_pod) {
+        next = false;
+        f_out_edg_iterator_t ei, ei_end;
+        for (tie (ei, ei_end) = out_edges (v, g); ei != ei_end; ++ei) {
+            auto m = g[*ei].idata.member_of.find (m_net);
+            if (m == g[*ei].idata.member_of.end ()
+                || m->second != "connected_up")
+                continue;
+            v = target (*ei, g);
+            if (!up.has_sw && g[v].type == m_sw_type) {
+                up.sw = v;
+                up.has_sw = true;
+            } else if (g[v].type == m_pod_type) {
+                up.pod = v;
+                up.has_pod = true;
+            }
+            next = true;
+            break;
+        }
+    }
+    return m_uplinks[u] = up;
+}
+
+int net_locality_t::choose_nodes (const subsystem_t &subsystem,
+                                  const std::string &type, unsigned int count,
+                                  const f_resource_graph_t &g,
+                                  scoring_api_t &dfu)
+{
+    struct cand_t {
+        vtx_t v;
+        int64_t score;
+        unsigned int count;
+    };
+    std::vector<cand_t> cands;
+    std::unordered_map<vtx_t, int64_t> avail;
+    std::unordered_map<vtx_t, rank_t> ranks;
+
+    dfu.transform (subsystem, type, std::back_inserter (cands),
+                   [&g] (const eval_egroup_t &e) {
+                       cand_t c;
+                       c.v = e.edges.empty ()? 0 : target (e.edges[0].edge, g);
+                       c.score = e.edges.empty ()?
+                                     static_cast<int64_t> (MATCH_UNMET)
+                                     : e.score;
+                       c.count = e.count;
+                       return c;
+                   });
+
+    // Available node counts under each switch and pod, tallied from the
+    // qualified nodes under it. The qualified nodes have already been
+    // matched against the dominant subsystem's plans, so these counts
+    // follow every allocation and removal.
+    for (auto &c : cands) {
+        if (c.score <= MATCH_UNMET)
+            continue;
+        const uplink_t &up = uplink (c.v, g);
+        avail[up.has_sw? up.sw : c.v] += c.count;
+        if (up.has_pod)
+            avail[up.pod] += c.count;
+    }
+
+    for (auto &c : cands) {
+        if (c.score <= MATCH_UNMET)
+            continue;
+        const uplink_t &up = uplink (c.v, g);
+        int64_t sw_id = up.has_sw? (int64_t)up.sw : -1;
+        int64_t pod_id = up.has_pod? (int64_t)up.pod : -1;
+        int64_t sw_n = avail[up.has_sw? up.sw : c.v];
+        int64_t pod_n = up.has_pod? avail[up.pod] : sw_n;
+        if (sw_n >= (int64_t)count) {
+            // best fit: the smallest switch that can hold the request
+            ranks[c.v] = std::make_tuple (0, sw_n, 0, 0, sw_id,
+                                          g[c.v].id, (int64_t)c.v);
+        } else if (pod_n >= (int64_t)count) {
+            // the smallest pod that can hold the request, fullest switch first
+            ranks[c.v] = std::make_tuple (1, pod_n, pod_id, -sw_n, sw_id,
+                                          g[c.v].id, (int64_t)c.v);
+        } else {
+            // spread across the fewest, largest pods and switches
+            ranks[c.v] = std::make_tuple (2, -pod_n, pod_id, -sw_n, sw_id,
+                                          g[c.v].id, (int64_t)c.v);
+        }
+    }
+
+    rank_less comp;
+    comp.g = &g;
+    comp.ranks = &ranks;
+    return (dfu.choose_accum_best_k (subsystem, type, count, comp) == -1)?
+               -1 : 0;
+}
+
+int net_locality_t::choose (const subsystem_t &subsystem,
+                            const std::string &type, unsigned int count,
+                            const f_resource_graph_t &g, scoring_api_t &dfu)
+{
+    if (type == m_node_type)
+        return choose_nodes (subsystem, type, count, g, dfu);
+    return (dfu.choose_accum_best_k (subsystem, type, count) == -1)? -1 : 0;
+}
+
+int net_locality_t::dom_finish_graph (
+    const subsystem_t &subsystem,
+    const std::vector<Flux::Jobspec::Resource> &resources,
+    const f_resource_graph_t &g, scoring_api_t &dfu)
+{
+    int64_t score = MATCH_MET;
+    for (auto &resource : resources) {
+        const std::string &type = resource.type;
+        unsigned int qc = dfu.qualified_count (subsystem, type);
+        unsigned int count = calc_count (resource, qc);
+        if (count == 0) {
+            score = MATCH_UNMET;
+            break;
+        }
+        choose (subsystem, type, count, g, dfu);
+    }
+    dfu.set_overall_score (score);
+    return (score == MATCH_MET)? 0 : -1;
+}
+
+int net_locality_t::dom_finish_slot (const subsystem_t &subsystem,
+                                     scoring_api_t &dfu)
+{
+    std::vector<std::string> types;
+    dfu.resrc_types (subsystem, types);
+    for (auto &type : types)
+        dfu.choose_accum_all (subsystem, type);
+    return 0;
+}
+
+int net_locality_t::dom_finish_vtx (
+    vtx_t u,
+    const subsystem_t &subsystem,
+    const std::vector<Flux::Jobspec::Resource> &resources,
+    const f_resource_graph_t &g, scoring_api_t &dfu)
+{
+    int64_t score = MATCH_MET;
+    int64_t overall;
+
+    for (auto &resource : resources) {
+        if (resource.type != g[u].type)
+            continue;
+
+        // jobspec resource type matches with the visiting vertex
+        for (auto &c_resource : resource.with) {
+            // test children resource count requirements
+            const std::string &c_type = c_resource.type;
+            unsigned int qc = dfu.qualified_count (subsystem, c_type);
+            unsigned int count = calc_count (c_resource, qc);
+            if (count == 0) {
+                score = MATCH_UNMET;
+                break;
+            }
+            choose (subsystem, c_type, count, g, dfu);
+        }
+    }
+
+    // lower id first among the resources not ranked by the network
+    int64_t id_max = std::numeric_limits<int32_t>::max ();
+    int64_t id = (g[u].id < 0)? 0 : std::min (g[u].id, id_max - 1);
+    overall = (score == MATCH_MET)? (score + id_max - id) : score;
+    dfu.set_overall_score (overall);
+    decr ();
+    return (score == MATCH_MET)? 0 : -1;
+}
+
+} // resource_model
+} // Flux
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,103 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#ifndef DFU_MATCH_NET_LOCALITY_HPP
+#define DFU_MATCH_NET_LOCALITY_HPP
+
+#include <iostream>
+#include <vector>
+#include <tuple>
+#include <unordered_map>
+#include "policies/base/dfu_match_cb.hpp"
+
+namespace Flux {
+namespace resource_model {
+
+/*! Network-locality policy: select compute nodes so that a job spans
+ *  the fewest network switches and pods. Each node is mapped to its edge
+ *  switch and pod (core switch) by walking the connected_up edges of the
+ *  network subsystem (e.g., C+IBA). Among the qualified nodes, the
+ *  smallest switch that can hold the whole request is preferred
+ *  (best fit); otherwise nodes are taken from the pod and then the
+ *  switches with the most available nodes first. Other resources are
+ *  selected lower ID first.
+ *
+ *  The available nodes under a switch or a pod are tallied from the
+ *  qualified nodes under it, not from its subtree plan in the network
+ *  subsystem: only the dominant subsystem's plans are updated on
+ *  allocation.
+ */
+struct net_locality_t final : public dfu_match_cb_t
+{
+    net_locality_t ();
+    net_locality_t (const std::string &name);
+    net_locality_t (const net_locality_t &o);
+    net_locality_t &operator= (const net_locality_t &o);
+    ~net_locality_t ();
+
+    int dom_finish_graph (const subsystem_t &subsystem,
+                          const std::vector<Flux::Jobspec::Resource> &resources,
+                          const f_resource_graph_t &g, scoring_api_t &dfu);
+    int dom_finish_slot (const subsystem_t &subsystem, scoring_api_t &dfu);
+    int dom_finish_vtx (vtx_t u, const subsystem_t &subsystem,
+                        const std::vector<Flux::Jobspec::Resource> &resources,
+                        const f_resource_graph_t &g, scoring_api_t &dfu);
+
+    //! Ordering key of a node: lower is preferred
+    typedef std::tuple<int64_t, int64_t, int64_t, int64_t,
+                       int64_t, int64_t, int64_t> rank_t;
+
+private:
+    struct uplink_t {
+        vtx_t sw;
+        vtx_t pod;
+        bool has_sw = false;
+        bool has_pod = false;
+    };
+
+    const uplink_t &uplink (vtx_t u, const f_resource_graph_t &g);
+    int choose_nodes (const subsystem_t &subsystem, const std::string &type,
+                      unsigned int count, const f_resource_graph_t &g,
+                      scoring_api_t &dfu);
+    int choose (const subsystem_t &subsystem, const std::string &type,
+                unsigned int count, const f_resource_graph_t &g,
+                scoring_api_t &dfu);
+
+    subsystem_t m_net = "ibnet";
+    std::string m_node_type = "node";
+    std::string m_sw_type = "edgeswitch";
+    std::string m_pod_type = "coreswitch";
+    std::unordered_map<vtx_t, uplink_t> m_uplinks;
+    size_t m_graph_vertices = 0;
+    size_t m_graph_edges = 0;
+};
+
+} // resource_model
+} // Flux
+
+#endif // DFU_MATCH_NET_LOCALITY_HPP
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,62 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#include "policies/dfu_match_policy_factory.hpp"
+
+extern "C" {
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+}
+
+namespace Flux {
+namespace resource_model {
+
+dfu_match_cb_t *create_match_cb (const std::string &policy)
+{
+#define CREATE_MATCH_CB(type, name, desc)                                     \
+    if (policy == name)                                                       \
+        return new type ();
+    DFU_MATCH_POLICIES (CREATE_MATCH_CB)
+#undef CREATE_MATCH_CB
+    return NULL;
+}
+
+const std::vector<match_policy_info_t> &known_match_policies ()
+{
+#define MATCH_POLICY_INFO(type, name, desc)                                   \
+    { name, desc },
+    static const std::vector<match_policy_info_t> policies = {
+        DFU_MATCH_POLICIES (MATCH_POLICY_INFO)
+    };
+#undef MATCH_POLICY_INFO
+    return policies;
+}
+
+} // namespace resource_model
+} // namespace Flux
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,83 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#ifndef DFU_MATCH_POLICY_FACTORY_HPP
+#define DFU_MATCH_POLICY_FACTORY_HPP
+
+#include <string>
+#include <vector>
+#include "policies/base/dfu_match_cb.hpp"
+#include "policies/dfu_match_high_id_first.hpp"
+#include "policies/dfu_match_low_id_first.hpp"
+#include "policies/dfu_match_locality.hpp"
+#include "policies/dfu_match_best_fit.hpp"
+#include "policies/dfu_match_net_locality.hpp"
+
+/*! Registry of the match policies: POLICY (type, name, description).
+ *  Each type must be a final class derived from dfu_match_cb_t. Besides
+ *  being creatable by name, each registered policy gets a DFU traverser
+ *  implementation specialized to its type so that the match callbacks
+ *  are bound statically (see traversers/dfu_impl.hpp).
+ */
+#define DFU_MATCH_POLICIES(POLICY)                                            \
+    POLICY (high_first_t, "high", "Select resources with high ID first")      \
+    POLICY (low_first_t, "low", "Select resources with low ID first")         \
+    POLICY (greater_interval_first_t, "locality",                             \
+            "Select contiguous resources first in their ID space")            \
+    POLICY (best_fit_t, "bestfit",                                            \
+            "Select resources in the most occupied subtrees first")           \
+    POLICY (net_locality_t, "network",                                        \
+            "Select nodes under the fewest network switches and pods first "  \
+            "(use with an ibnet subsystem, e.g., C+IBA)")
+
+namespace Flux {
+namespace resource_model {
+
+/*! Name and description of a policy create_match_cb () knows.
+ */
+struct match_policy_info_t {
+    const char *name;
+    const char *desc;
+};
+
+/*! Create a match callback object of the registered policy.
+ *
+ *  \param policy    name of the match policy (e.g., "high").
+ *  \return          new match callback object; NULL if policy is unknown.
+ */
+dfu_match_cb_t *create_match_cb (const std::string &policy);
+
+/*! Return the policies create_match_cb () knows in the order
+ *  DFU_MATCH_POLICIES lists them, e.g., to print them in a usage message.
+ */
+const std::vector<match_policy_info_t> &known_match_policies ();
+
+} // namespace resource_model
+} // namespace Flux
+
+#endif // DFU_MATCH_POLICY_FACTORY_HPP
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
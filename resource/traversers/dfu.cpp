@@ -52,22 +52,27 @@ int dfu_traverser_t::schedule (Jobspec::Jobspec &jobspec,
     const subsystem_t &dom = get_match_cb ()->dom_subsystem ();
 
     /* Allocate */
-    rc = detail::dfu_impl_t::select (jobspec, root, meta, x, needs);
+    rc = m_impl->select (jobspec, root, meta, x, needs);
     if ((rc != 0) && (op == match_op_t::MATCH_ALLOCATE_ORELSE_RESERVE)) {
         /* Or else reserve */
         meta.allocate = false;
         int64_t t = meta.at + 1;
         vector<uint64_t> agg;
-        planner_multi_t *p = (*get_graph ())[root].idata.subplans.at (dom);
+        auto &subplans = (*get_graph ())[root].idata.subplans;
+        auto iter = subplans.find (dom);
+        // Without aggregates at the root, there is no time to retry at
+        if (iter == subplans.end () || !iter->second)
+            return rc;
+        planner_multi_t *p = iter->second;
         size_t len = planner_multi_resources_len (p);
         uint64_t duration = meta.duration;
-        detail::dfu_impl_t::count (p, dfv, agg);
+        m_impl->count (p, dfv, agg);
         // TODO: examine correctness when a jobspec doesn't include
         // the subtree plan resource type
         for (t = planner_multi_avail_time_first (p, t, duration, &agg[0], len);
              (t != -1 && rc != 0); t = planner_multi_avail_time_next (p)) {
             meta.at = t;
-            rc = detail::dfu_impl_t::select (jobspec, root, meta, x, needs);
+            rc = m_impl->select (jobspec, root, meta, x, needs);
         }
     }
     return rc;
@@ -81,72 +86,82 @@ int dfu_traverser_t::schedule (Jobspec::Jobspec &jobspec,
  ****************************************************************************/
 
 dfu_traverser_t::dfu_traverser_t ()
+    : m_impl (new detail::dfu_impl_t<> ())
 {
 
 }
 
 dfu_traverser_t::dfu_traverser_t (f_resource_graph_t *g, dfu_match_cb_t *m,
                                   map<subsystem_t, vtx_t> *roots)
-    : detail::dfu_impl_t (g, m, roots)
+    : m_impl (detail::create_dfu_impl (m))
 {
-
+    m_impl->set_graph (g);
+    m_impl->set_roots (roots);
 }
 
 dfu_traverser_t::dfu_traverser_t (const dfu_traverser_t &o)
-    : detail::dfu_impl_t (o)
+    : m_impl (o.m_impl->clone ())
 {
 
 }
 
 dfu_traverser_t &dfu_traverser_t::operator= (const dfu_traverser_t &o)
 {
-    detail::dfu_impl_t::operator= (o);
+    if (this != &o) {
+        delete m_impl;
+        m_impl = o.m_impl->clone ();
+    }
     return *this;
 }
 
 dfu_traverser_t::~dfu_traverser_t ()
 {
-
+    delete m_impl;
 }
 
 const f_resource_graph_t *dfu_traverser_t::get_graph () const
 {
-   return detail::dfu_impl_t::get_graph ();
+   return m_impl->get_graph ();
 }
 
 const map<subsystem_t, vtx_t> *dfu_traverser_t::get_roots () const
 {
-    return detail::dfu_impl_t::get_roots ();
+    return m_impl->get_roots ();
 }
 
 const dfu_match_cb_t *dfu_traverser_t::get_match_cb () const
 {
-    return detail::dfu_impl_t::get_match_cb ();
+    return m_impl->get_match_cb ();
 }
 
 const string &dfu_traverser_t::err_message () const
 {
-    return detail::dfu_impl_t::err_message ();
+    return m_impl->err_message ();
 }
 
 void dfu_traverser_t::set_graph (f_resource_graph_t *g)
 {
-    detail::dfu_impl_t::set_graph (g);
+    m_impl->set_graph (g);
 }
 
 void dfu_traverser_t::set_roots (map<subsystem_t, vtx_t> *roots)
 {
-    detail::dfu_impl_t::set_roots (roots);
+    m_impl->set_roots (roots);
 }
 
 void dfu_traverser_t::set_match_cb (dfu_match_cb_t *m)
 {
-    detail::dfu_impl_t::set_match_cb (m);
+    // Re-specialize the implementation to the type of the new match
+    // callback object while retaining the rest of the traversal state.
+    detail::dfu_impl_base_t *impl = detail::create_dfu_impl (m);
+    impl->dfu_impl_base_t::operator= (*m_impl);
+    delete m_impl;
+    m_impl = impl;
 }
 
 void dfu_traverser_t::clear_err_message ()
 {
-    detail::dfu_impl_t::clear_err_message ();
+    m_impl->clear_err_message ();
 }
 
 int dfu_traverser_t::initialize ()
@@ -166,7 +181,7 @@ int dfu_traverser_t::initialize ()
             break;
         }
         root = get_roots ()->at(subsystem);
-        rc += detail::dfu_impl_t::prime (subsystem, root, from_dfv);
+        rc += m_impl->prime (subsystem, root, from_dfv);
     }
     return rc;
 }
@@ -182,7 +197,8 @@ int dfu_traverser_t::initialize (f_resource_graph_t *g,
 }
 
 int dfu_traverser_t::run (Jobspec::Jobspec &jobspec, match_op_t op,
-                          int64_t jobid, int64_t *at, stringstream &ss)
+                          int64_t jobid, int64_t *at,
+                          match_writers_t *writers)
 {
     const subsystem_t &dom = get_match_cb ()->dom_subsystem ();
     if (!get_graph () || !get_roots ()
@@ -196,13 +212,13 @@ int dfu_traverser_t::run (Jobspec::Jobspec &jobspec, match_op_t op,
     detail::jobmeta_t meta;
     unsigned int needs = 0;
     vtx_t root = get_roots ()->at(dom);
-    bool x = detail::dfu_impl_t::exclusivity (jobspec.resources, root);
+    bool x = m_impl->exclusivity (jobspec.resources, root);
     std::unordered_map<string, int64_t> dfv;
-    detail::dfu_impl_t::prime (jobspec.resources, dfv);
+    m_impl->prime (jobspec.resources, dfv);
     meta.build (jobspec, true, jobid, *at);
     if ( (rc = schedule (jobspec, meta, x, op, root, &needs, dfv)) ==  0) {
         *at = meta.at;
-        rc = detail::dfu_impl_t::update (root, meta, needs, x, ss);
+        rc = m_impl->update (root, meta, needs, x, writers);
     }
     return rc;
 }
@@ -218,7 +234,7 @@ int dfu_traverser_t::remove (int64_t jobid)
     }
 
     vtx_t root = get_roots ()->at(dom);
-    return detail::dfu_impl_t::remove (root, jobid);
+    return m_impl->remove (root, jobid);
 }
 
 /*
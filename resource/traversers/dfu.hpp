@@ -36,8 +36,10 @@ namespace resource_model {
  *  subsystem and upwalk on each and all of the auxiliary subsystems selected
  *  by the matcher callback object (dfu_match_cb_t). Corresponding match
  *  callback methods are invoked at various well-defined graph visit events.
+ *  The traversal itself is delegated to an implementation object specialized
+ *  to the concrete type of the match callback object (see create_dfu_impl).
  */
-class dfu_traverser_t : protected detail::dfu_impl_t
+class dfu_traverser_t
 {
 public:
     dfu_traverser_t ();
@@ -104,14 +106,15 @@ public:
      *                       allocate or allocate_orelse_reserve.
      *  \param id        job ID to use for the schedule operation.
      *  \param at[out]   when the job is scheduled if reserved.
-     *  \param ss        stringstream into which emitted R infor is stored.
+     *  \param writers   match writers object into which emitted R info is
+     *                   accumulated. Pass NULL to skip emission entirely.
      *  \return          0 on success; -1 on error.
      *                       EINVAL: graph, roots or match callback not set.
      *                       ENOTSUP: roots does not contain a subsystem the
      *                                match callback uses.
      */
     int run (Jobspec::Jobspec &jobspec, match_op_t op, int64_t id, int64_t *at,
-             std::stringstream &ss);
+             match_writers_t *writers);
 
     /*! Remove the allocation/reservation referred to by jobid and update
      *  the resource state.
@@ -127,6 +130,8 @@ private:
                   detail::jobmeta_t &meta, bool x, match_op_t op,
                   vtx_t root, unsigned int *needs,
                   std::unordered_map<std::string, int64_t> &dfv);
+
+    detail::dfu_impl_base_t *m_impl = NULL;
 };
 
 } // namespace resource_model
@@ -22,7 +22,9 @@
  *  See also:  http://www.gnu.org/licenses/
 \*****************************************************************************/
 
+#include <typeinfo>
 #include "traversers/dfu_impl.hpp"
+#include "policies/dfu_match_policy_factory.hpp"
 
 extern "C" {
 #if HAVE_CONFIG_H
@@ -41,7 +43,7 @@ using namespace Flux::resource_model::detail;
  *                                                                          *
  ****************************************************************************/
 
-const std::string dfu_impl_t::level () const
+const std::string dfu_impl_base_t::level () const
 {
     unsigned int i;
     std::string prefix = "";
@@ -50,19 +52,19 @@ const std::string dfu_impl_t::level () const
     return prefix;
 }
 
-void dfu_impl_t::tick ()
+void dfu_impl_base_t::tick ()
 {
     m_best_k_cnt++;
     m_color.reset ();
 }
 
-bool dfu_impl_t::in_subsystem (edg_t e, const subsystem_t &subsystem) const
+bool dfu_impl_base_t::in_subsystem (edg_t e, const subsystem_t &subsystem) const
 {
     return ((*m_graph)[e].idata.member_of.find (subsystem)
                 != (*m_graph)[e].idata.member_of.end ());
 }
 
-bool dfu_impl_t::stop_explore (edg_t e, const subsystem_t &subsystem) const
+bool dfu_impl_base_t::stop_explore (edg_t e, const subsystem_t &subsystem) const
 {
     // Return true if the target vertex has been visited (forward: black)
     // or being visited (cycle: gray).
@@ -71,7 +73,7 @@ bool dfu_impl_t::stop_explore (edg_t e, const subsystem_t &subsystem) const
             || m_color.is_black ((*m_graph)[u].idata.colors[subsystem]));
 }
 
-bool dfu_impl_t::exclusivity (const vector<Jobspec::Resource> &resources,
+bool dfu_impl_base_t::exclusivity (const vector<Jobspec::Resource> &resources,
                               vtx_t u)
 {
     // If one of the resources matches with the visiting vertex, u
@@ -85,8 +87,10 @@ bool dfu_impl_t::exclusivity (const vector<Jobspec::Resource> &resources,
     return exclusive;
 }
 
-int dfu_impl_t::by_avail (const jobmeta_t &meta, const std::string &s, vtx_t u,
-                          const std::vector<Jobspec::Resource> &resources)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::by_avail (
+    const jobmeta_t &meta, const std::string &s, vtx_t u,
+    const std::vector<Jobspec::Resource> &resources)
 {
     int rc = -1;
     int64_t avail = -1;
@@ -114,8 +118,10 @@ done:
     return rc;
 }
 
-int dfu_impl_t::by_excl (const jobmeta_t &meta, const std::string &s, vtx_t u,
-                         const Jobspec::Resource &resource)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::by_excl (const jobmeta_t &meta,
+                                     const std::string &s, vtx_t u,
+                                     const Jobspec::Resource &resource)
 {
     int rc = -1;
     planner_t *p = NULL;
@@ -143,16 +149,24 @@ done:
     return rc;
 }
 
-int dfu_impl_t::by_subplan (const jobmeta_t &meta, const std::string &s, vtx_t u,
-                            const Jobspec::Resource &resource)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::by_subplan (const jobmeta_t &meta,
+                                        const std::string &s, vtx_t u,
+                                        const Jobspec::Resource &resource)
 {
     int rc = -1;
     size_t len = 0;
     int64_t at = meta.at;
     uint64_t d = meta.duration;
     vector<uint64_t> aggs;
-    planner_multi_t *p = (*m_graph)[u].idata.subplans[s];
+    planner_multi_t *p = NULL;
+    auto iter = (*m_graph)[u].idata.subplans.find (s);
 
+    if (iter == (*m_graph)[u].idata.subplans.end () || !iter->second) {
+        rc = 0;
+        goto done;
+    }
+    p = iter->second;
     count (p, resource.user_data, aggs);
     if (aggs.empty ()) {
         rc = 0;
@@ -174,9 +188,10 @@ done:
     return rc;
 }
 
-int dfu_impl_t::prune (const jobmeta_t &meta, bool exclusive,
-                       const std::string &s, vtx_t u,
-                       const std::vector<Jobspec::Resource> &resources)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::prune (
+    const jobmeta_t &meta, bool exclusive, const std::string &s, vtx_t u,
+    const std::vector<Jobspec::Resource> &resources)
 {
     int rc = 0;
     // Prune by the visiting resource vertex's availability
@@ -198,8 +213,10 @@ done:
     return rc;
 }
 
-planner_multi_t *dfu_impl_t::subtree_plan (vtx_t u, vector<uint64_t> &av,
-                                           vector<const char *> &tp)
+template <class match_cb_t>
+planner_multi_t *dfu_impl_t<match_cb_t>::subtree_plan (vtx_t u,
+                                                       vector<uint64_t> &av,
+                                                       vector<const char *> &tp)
 {
     size_t len = av.size ();
     int64_t base_time = planner_base_time ((*m_graph)[u].schedule.plans);
@@ -207,9 +224,10 @@ planner_multi_t *dfu_impl_t::subtree_plan (vtx_t u, vector<uint64_t> &av,
     return planner_multi_new (base_time, duration, &av[0], &tp[0], len);
 }
 
-void dfu_impl_t::match (vtx_t u, const vector<Resource> &resources,
-                       const Resource **slot_resource,
-                       const Resource **match_resource)
+template <class match_cb_t>
+void dfu_impl_t<match_cb_t>::match (vtx_t u, const vector<Resource> &resources,
+                                    const Resource **slot_resource,
+                                    const Resource **match_resource)
 {
     for (auto &resource : resources) {
         if ((*m_graph)[u].type == resource.type) {
@@ -229,7 +247,9 @@ void dfu_impl_t::match (vtx_t u, const vector<Resource> &resources,
     }
 }
 
-bool dfu_impl_t::slot_match (vtx_t u, const Resource *slot_resources)
+template <class match_cb_t>
+bool dfu_impl_t<match_cb_t>::slot_match (vtx_t u,
+                                         const Resource *slot_resources)
 {
     bool slot_match = true;
     f_out_edg_iterator_t ei, eie;
@@ -251,9 +271,9 @@ bool dfu_impl_t::slot_match (vtx_t u, const Resource *slot_resources)
     return slot_match;
 }
 
-const vector<Resource> &dfu_impl_t::test (vtx_t u,
-                                          const vector<Resource> &resources,
-                                          match_kind_t *spec)
+template <class match_cb_t>
+const vector<Resource> &dfu_impl_t<match_cb_t>::test (
+    vtx_t u, const vector<Resource> &resources, match_kind_t *spec)
 {
     bool slot = true;
     const vector<Resource> *ret = &resources;
@@ -272,8 +292,10 @@ const vector<Resource> &dfu_impl_t::test (vtx_t u,
     return *ret;
 }
 
-int dfu_impl_t::accum_if (const subsystem_t &subsystem, const string &type,
-                          unsigned int counts, map<string, int64_t> &accum)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::accum_if (const subsystem_t &subsystem,
+                                      const string &type, unsigned int counts,
+                                      map<string, int64_t> &accum)
 {
     int rc = -1;
     if (m_match->is_pruning_type (subsystem, type)) {
@@ -286,12 +308,13 @@ int dfu_impl_t::accum_if (const subsystem_t &subsystem, const string &type,
     return rc;
 }
 
-int dfu_impl_t::accum_if (const subsystem_t &subsystem, const string &type,
-                          unsigned int counts,
-                          std::unordered_map<string, int64_t> &accum)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::accum_if (
+    const string &type, unsigned int counts,
+    std::unordered_map<string, int64_t> &accum)
 {
     int rc = -1;
-    if (m_match->is_pruning_type (subsystem, type)) {
+    if (m_match->is_pruning_type (type)) {
         if (accum.find (type) == accum.end ())
             accum[type] = counts;
         else
@@ -301,8 +324,9 @@ int dfu_impl_t::accum_if (const subsystem_t &subsystem, const string &type,
     return rc;
 }
 
-int dfu_impl_t::prime_exp (const subsystem_t &subsystem, vtx_t u,
-                           map<string, int64_t> &dfv)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::prime_exp (const subsystem_t &subsystem, vtx_t u,
+                                       map<string, int64_t> &dfv)
 {
     int rc = 0;
     f_out_edg_iterator_t ei, ei_end;
@@ -315,10 +339,12 @@ int dfu_impl_t::prime_exp (const subsystem_t &subsystem, vtx_t u,
     return rc;
 }
 
-int dfu_impl_t::explore (const jobmeta_t &meta, vtx_t u,
-                         const subsystem_t &subsystem,
-                         const vector<Resource> &resources, bool *excl,
-                         visit_t direction, scoring_api_t &dfu)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::explore (const jobmeta_t &meta, vtx_t u,
+                                     const subsystem_t &subsystem,
+                                     const vector<Resource> &resources,
+                                     bool *excl, visit_t direction,
+                                     scoring_api_t &dfu)
 {
     int rc = -1;
     int rc2 = -1;
@@ -350,9 +376,11 @@ int dfu_impl_t::explore (const jobmeta_t &meta, vtx_t u,
     return rc2;
 }
 
-int dfu_impl_t::aux_upv (const jobmeta_t &meta, vtx_t u, const subsystem_t &aux,
-                         const vector<Resource> &resources, bool *excl,
-                         scoring_api_t &to_parent)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::aux_upv (const jobmeta_t &meta, vtx_t u,
+                                     const subsystem_t &aux,
+                                     const vector<Resource> &resources,
+                                     bool *excl, scoring_api_t &to_parent)
 {
     int rc = -1;
     scoring_api_t upv;
@@ -381,13 +409,16 @@ int dfu_impl_t::aux_upv (const jobmeta_t &meta, vtx_t u, const subsystem_t &aux,
         goto done;
     if ((rc = resolve (upv, to_parent)) != 0)
         goto done;
+    to_parent.set_avail (avail);
+    to_parent.set_overall_score (upv.overall_score ());
 done:
     return rc;
 }
 
-int dfu_impl_t::dom_exp (const jobmeta_t &meta, vtx_t u,
-                         const vector<Resource> &resources,
-                         bool *excl, scoring_api_t &dfu)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::dom_exp (const jobmeta_t &meta, vtx_t u,
+                                     const vector<Resource> &resources,
+                                     bool *excl, scoring_api_t &dfu)
 {
     int rc = -1;
     const subsystem_t &dom = m_match->dom_subsystem ();
@@ -400,8 +431,9 @@ int dfu_impl_t::dom_exp (const jobmeta_t &meta, vtx_t u,
     return rc;
 }
 
-int dfu_impl_t::cnt_slot (const vector<Resource> &slot_shape,
-                          scoring_api_t &dfu_slot)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::cnt_slot (const vector<Resource> &slot_shape,
+                                      scoring_api_t &dfu_slot)
 {
     unsigned int qc = 0;
     unsigned int fit = 0;
@@ -421,9 +453,10 @@ int dfu_impl_t::cnt_slot (const vector<Resource> &slot_shape,
     return qual_num_slots;
 }
 
-int dfu_impl_t::dom_slot (const jobmeta_t &meta, vtx_t u,
-                          const vector<Resource> &slot_shape,
-                          bool *excl, scoring_api_t &dfu)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::dom_slot (const jobmeta_t &meta, vtx_t u,
+                                      const vector<Resource> &slot_shape,
+                                      bool *excl, scoring_api_t &dfu)
 {
     int rc;
     bool x_inout = true;
@@ -440,7 +473,7 @@ int dfu_impl_t::dom_slot (const jobmeta_t &meta, vtx_t u,
     qual_num_slots = cnt_slot (slot_shape, dfu_slot);
     for (unsigned int i = 0; i < qual_num_slots; ++i) {
         eval_egroup_t edg_group;
-        int score = MATCH_MET;
+        int64_t score = MATCH_MET;
         for (auto &slot_elem : slot_shape) {
             unsigned int j = 0;
             unsigned int qc = dfu_slot.qualified_count (dom, slot_elem.type);
@@ -465,9 +498,10 @@ done:
     return (qual_num_slots)? 0 : -1;
 }
 
-int dfu_impl_t::dom_dfv (const jobmeta_t &meta, vtx_t u,
-                         const vector<Resource> &resources, bool *excl,
-                         scoring_api_t &to_parent)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::dom_dfv (const jobmeta_t &meta, vtx_t u,
+                                     const vector<Resource> &resources,
+                                     bool *excl, scoring_api_t &to_parent)
 {
     int rc = -1;
     match_kind_t sm;
@@ -511,8 +545,10 @@ done:
     return rc;
 }
 
-int dfu_impl_t::resolve (vtx_t root, vector<Resource> &resources,
-                         scoring_api_t &dfu, bool excl, unsigned int *needs)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::resolve (vtx_t root, vector<Resource> &resources,
+                                     scoring_api_t &dfu, bool excl,
+                                     unsigned int *needs)
 {
     int rc = -1;
     unsigned int qc;
@@ -549,7 +585,9 @@ done:
     return rc;
 }
 
-int dfu_impl_t::resolve (scoring_api_t &dfu, scoring_api_t &to_parent)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::resolve (scoring_api_t &dfu,
+                                     scoring_api_t &to_parent)
 {
     int rc = 0;
     if (dfu.overall_score () > MATCH_UNMET) {
@@ -564,7 +602,9 @@ int dfu_impl_t::resolve (scoring_api_t &dfu, scoring_api_t &to_parent)
     return rc;
 }
 
-int dfu_impl_t::enforce (const subsystem_t &subsystem, scoring_api_t &dfu)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::enforce (const subsystem_t &subsystem,
+                                     scoring_api_t &dfu)
 {
     int rc = 0;
     try {
@@ -590,25 +630,24 @@ int dfu_impl_t::enforce (const subsystem_t &subsystem, scoring_api_t &dfu)
     return rc;
 }
 
-int dfu_impl_t::emit_edge (edg_t e)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::emit_edge (edg_t e, match_writers_t *w)
 {
-    // NYI: We will ultimately need to emit edge info for nested instance
-    // with complex scheduler, pending a discussion on R.
-    return 0;
+    return (w)? w->emit_edg (m_trav_level, *m_graph, e) : 0;
 }
 
-int dfu_impl_t::emit_vertex (vtx_t u, unsigned int needs, bool exclusive,
-                             stringstream &ss)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::emit_vertex (vtx_t u, unsigned int needs,
+                                         bool exclusive, match_writers_t *w)
 {
-    string mode = (exclusive)? "x" : "s";
-    ss << "      " << level () << (*m_graph)[u].name << "["
-       << needs << ":" << mode  << "]" << endl;
-    return 0;
+    return (w)? w->emit_vtx (m_trav_level, *m_graph, u, needs, exclusive) : 0;
 }
 
-int dfu_impl_t::upd_plan (vtx_t u, const subsystem_t &s, unsigned int needs,
-                           bool excl, const jobmeta_t &meta, int &n,
-                           map<string, int64_t> &to_parent)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::upd_plan (vtx_t u, const subsystem_t &s,
+                                      unsigned int needs, bool excl,
+                                      const jobmeta_t &meta, int &n,
+                                      map<string, int64_t> &to_parent)
 {
     int64_t span = 0;
     if (!excl) {
@@ -636,10 +675,13 @@ done:
     return (span == -1)? -1 : 0;
 }
 
-int dfu_impl_t::upd_sched (vtx_t u, const subsystem_t &s, unsigned int needs,
-                           bool excl, int n, const jobmeta_t &meta,
-                           map<string, int64_t> &dfu,
-                           map<string, int64_t> &to_parent, stringstream &ss)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::upd_sched (vtx_t u, const subsystem_t &s,
+                                       unsigned int needs, bool excl, int n,
+                                       const jobmeta_t &meta,
+                                       map<string, int64_t> &dfu,
+                                       map<string, int64_t> &to_parent,
+                                       match_writers_t *w)
 {
     if (upd_plan (u, s, needs, excl, meta, n, to_parent) == -1)
         goto done;
@@ -672,24 +714,28 @@ int dfu_impl_t::upd_sched (vtx_t u, const subsystem_t &s, unsigned int needs,
 
         for (auto &kv : dfu)
             accum_if (s, kv.first, kv.second, to_parent);
-        emit_vertex (u, needs, excl, ss);
+        emit_vertex (u, needs, excl, w);
     }
     m_trav_level--;
 done:
     return n;
 }
 
-int dfu_impl_t::upd_upv (vtx_t u, const subsystem_t &subsystem,
-                         unsigned int needs, bool excl, const jobmeta_t &meta,
-                         map<string, int64_t> &to_parent)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::upd_upv (vtx_t u, const subsystem_t &subsystem,
+                                     unsigned int needs, bool excl,
+                                     const jobmeta_t &meta,
+                                     map<string, int64_t> &to_parent)
 {
     //NYI: update resources on the UPV direction
     return 0;
 }
 
-int dfu_impl_t::upd_dfv (vtx_t u, unsigned int needs, bool excl,
-                         const jobmeta_t &meta, map<string, int64_t> &to_parent,
-                         stringstream &ss)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::upd_dfv (vtx_t u, unsigned int needs, bool excl,
+                                     const jobmeta_t &meta,
+                                     map<string, int64_t> &to_parent,
+                                     match_writers_t *w)
 {
     int n_plans = 0;
     map<string, int64_t> dfu;
@@ -707,25 +753,27 @@ int dfu_impl_t::upd_dfv (vtx_t u, unsigned int needs, bool excl,
             unsigned int needs = (*m_graph)[*ei].idata.needs;
             vtx_t tgt = target (*ei, *m_graph);
             if (subsystem == dom)
-                n_plans += upd_dfv (tgt, needs, x, meta, dfu, ss);
+                n_plans += upd_dfv (tgt, needs, x, meta, dfu, w);
             else
                 n_plans += upd_upv (tgt, subsystem, needs, x, meta, dfu);
 
             if (n_plans > 0)
-                emit_edge (*ei);
+                emit_edge (*ei, w);
         }
     }
     (*m_graph)[u].idata.colors[dom] = m_color.black ();
-    return upd_sched (u, dom, needs, excl, n_plans, meta, dfu, to_parent, ss);
+    return upd_sched (u, dom, needs, excl, n_plans, meta, dfu, to_parent, w);
 }
 
-int dfu_impl_t::rem_upv (vtx_t u, int64_t jobid)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::rem_upv (vtx_t u, int64_t jobid)
 {
     // NYI: remove schedule data for upwalk
     return 0;
 }
 
-int dfu_impl_t::rem_plan (vtx_t u, int64_t jobid)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::rem_plan (vtx_t u, int64_t jobid)
 {
     int rc = 0;
     int64_t span = -1;
@@ -758,7 +806,8 @@ int dfu_impl_t::rem_plan (vtx_t u, int64_t jobid)
     return rc;
 }
 
-int dfu_impl_t::rem_x_checker (vtx_t u, int64_t jobid)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::rem_x_checker (vtx_t u, int64_t jobid)
 {
     int rc = 0;
     int64_t span = -1;
@@ -787,8 +836,9 @@ int dfu_impl_t::rem_x_checker (vtx_t u, int64_t jobid)
     return rc;
 }
 
-int dfu_impl_t::rem_subtree_plan (vtx_t u, int64_t jobid,
-                                  const string &subsystem)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::rem_subtree_plan (vtx_t u, int64_t jobid,
+                                              const string &subsystem)
 {
     int rc = 0;
     int span = -1;
@@ -813,7 +863,8 @@ done:
     return rc;
 }
 
-int dfu_impl_t::rem_dfv (vtx_t u, int64_t jobid)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::rem_dfv (vtx_t u, int64_t jobid)
 {
     int rc = 0;
     const string &dom = m_match->dom_subsystem ();
@@ -852,88 +903,137 @@ done:
  *                                                                          *
  ****************************************************************************/
 
-dfu_impl_t::dfu_impl_t ()
+dfu_impl_base_t::dfu_impl_base_t ()
 {
 
 }
 
-dfu_impl_t::dfu_impl_t (f_resource_graph_t *g, dfu_match_cb_t *m,
-                        map<subsystem_t, vtx_t> *roots)
-    : m_roots (roots), m_graph (g), m_match (m)
+dfu_impl_base_t::dfu_impl_base_t (f_resource_graph_t *g,
+                                  map<subsystem_t, vtx_t> *roots)
+    : m_roots (roots), m_graph (g)
 {
 
 }
 
-dfu_impl_t::dfu_impl_t (const dfu_impl_t &o)
+dfu_impl_base_t::dfu_impl_base_t (const dfu_impl_base_t &o)
 {
     m_color = o.m_color;
     m_best_k_cnt = o.m_best_k_cnt;
     m_trav_level = o.m_trav_level;
     m_roots = o.m_roots;
     m_graph = o.m_graph;
-    m_match = o.m_match;
     m_err_msg = o.m_err_msg;
 }
 
-dfu_impl_t &dfu_impl_t::operator= (const dfu_impl_t &o)
+dfu_impl_base_t &dfu_impl_base_t::operator= (const dfu_impl_base_t &o)
 {
     m_color = o.m_color;
     m_best_k_cnt = o.m_best_k_cnt;
     m_trav_level = o.m_trav_level;
     m_roots = o.m_roots;
     m_graph = o.m_graph;
-    m_match = o.m_match;
     m_err_msg = o.m_err_msg;
     return *this;
 }
 
-dfu_impl_t::~dfu_impl_t ()
+dfu_impl_base_t::~dfu_impl_base_t ()
 {
 
 }
 
-const f_resource_graph_t *dfu_impl_t::get_graph () const
+const f_resource_graph_t *dfu_impl_base_t::get_graph () const
 {
     return m_graph;
 }
 
-const map<subsystem_t, vtx_t> *dfu_impl_t::get_roots () const
+const map<subsystem_t, vtx_t> *dfu_impl_base_t::get_roots () const
 {
     return m_roots;
 }
 
-const dfu_match_cb_t *dfu_impl_t::get_match_cb () const
-{
-    return m_match;
-}
-
-const string &dfu_impl_t::err_message () const
+const string &dfu_impl_base_t::err_message () const
 {
     return m_err_msg;
 }
 
-void dfu_impl_t::set_graph (f_resource_graph_t *g)
+void dfu_impl_base_t::set_graph (f_resource_graph_t *g)
 {
     m_graph = g;
 }
 
-void dfu_impl_t::set_roots (map<subsystem_t, vtx_t> *roots)
+void dfu_impl_base_t::set_roots (map<subsystem_t, vtx_t> *roots)
 {
     m_roots = roots;
 }
 
-void dfu_impl_t::set_match_cb (dfu_match_cb_t *m)
+void dfu_impl_base_t::clear_err_message ()
 {
-    m_match = m;
+    m_err_msg = "";
 }
 
-void dfu_impl_t::clear_err_message ()
+template <class match_cb_t>
+dfu_impl_t<match_cb_t>::dfu_impl_t ()
 {
-    m_err_msg = "";
+
+}
+
+template <class match_cb_t>
+dfu_impl_t<match_cb_t>::dfu_impl_t (f_resource_graph_t *g, dfu_match_cb_t *m,
+                                    map<subsystem_t, vtx_t> *roots)
+    : dfu_impl_base_t (g, roots), m_match (dynamic_cast<match_cb_t *> (m))
+{
+
+}
+
+template <class match_cb_t>
+dfu_impl_t<match_cb_t>::dfu_impl_t (const dfu_impl_t &o)
+    : dfu_impl_base_t (o)
+{
+    m_match = o.m_match;
+}
+
+template <class match_cb_t>
+dfu_impl_t<match_cb_t> &dfu_impl_t<match_cb_t>::operator= (
+    const dfu_impl_t &o)
+{
+    dfu_impl_base_t::operator= (o);
+    m_match = o.m_match;
+    return *this;
 }
 
-int dfu_impl_t::prime (const subsystem_t &s, vtx_t u,
-                       map<string, int64_t> &to_parent)
+template <class match_cb_t>
+dfu_impl_t<match_cb_t>::~dfu_impl_t ()
+{
+
+}
+
+template <class match_cb_t>
+dfu_impl_base_t *dfu_impl_t<match_cb_t>::clone () const
+{
+    return new dfu_impl_t<match_cb_t> (*this);
+}
+
+template <class match_cb_t>
+const dfu_match_cb_t *dfu_impl_t<match_cb_t>::get_match_cb () const
+{
+    return m_match;
+}
+
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::set_match_cb (dfu_match_cb_t *m)
+{
+    match_cb_t *match = NULL;
+    if (m && !(match = dynamic_cast<match_cb_t *> (m))) {
+        errno = EINVAL;
+        return -1;
+    }
+    m_match = match;
+    return 0;
+}
+
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::prime (const subsystem_t &s, vtx_t u,
+                                   map<string, int64_t> &to_parent)
 {
     int rc = -1;
     vector<uint64_t> avail;
@@ -948,6 +1048,11 @@ int dfu_impl_t::prime (const subsystem_t &s, vtx_t u,
 
     for (auto &aggregate : dfv) {
         accum_if (s, aggregate.first, aggregate.second, to_parent);
+        // Only index the aggregates anchored at this type of resource
+        if (!m_match->is_my_pruning_type (s, type, aggregate.first)
+            && !m_match->is_my_pruning_type (s, ANY_RESOURCE_TYPE,
+                                             aggregate.first))
+            continue;
         types.push_back (strdup (aggregate.first.c_str ()));
         avail.push_back (aggregate.second);
     }
@@ -970,24 +1075,26 @@ done:
     return rc;
 }
 
-void dfu_impl_t::prime (vector<Resource> &resources,
-                        std::unordered_map<string, int64_t> &to_parent)
+template <class match_cb_t>
+void dfu_impl_t<match_cb_t>::prime (
+    vector<Resource> &resources, std::unordered_map<string, int64_t> &to_parent)
 {
-    const subsystem_t &subsystem = m_match->dom_subsystem ();
     for (auto &resource : resources) {
         // Use minimum requirement because you don't want to prune search
         // as far as a subtree satisfies the minimum requirement
-        accum_if (subsystem, resource.type, resource.count.min, to_parent);
+        accum_if (resource.type, resource.count.min, to_parent);
         prime (resource.with, resource.user_data);
         for (auto &aggregate : resource.user_data) {
-            accum_if (subsystem, aggregate.first,
+            accum_if (aggregate.first,
                       resource.count.min * aggregate.second, to_parent);
         }
     }
 }
 
-int dfu_impl_t::select (Jobspec::Jobspec &j, vtx_t root, jobmeta_t &meta,
-                        bool excl, unsigned int *needs)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::select (Jobspec::Jobspec &j, vtx_t root,
+                                    jobmeta_t &meta, bool excl,
+                                    unsigned int *needs)
 {
     int rc = -1;
     scoring_api_t dfu;
@@ -995,6 +1102,7 @@ int dfu_impl_t::select (Jobspec::Jobspec &j, vtx_t root, jobmeta_t &meta,
     const string &dom = m_match->dom_subsystem ();
 
     tick ();
+    m_match->set_window (meta.at, meta.duration);
     rc = dom_dfv (meta, root, j.resources, &x_in, dfu);
     if (rc == 0) {
         eval_edg_t ev_edg (dfu.avail (), dfu.avail (), excl);
@@ -1006,20 +1114,58 @@ int dfu_impl_t::select (Jobspec::Jobspec &j, vtx_t root, jobmeta_t &meta,
     return rc;
 }
 
-int dfu_impl_t::update (vtx_t root, jobmeta_t &meta, unsigned int needs,
-                        bool exclusive, stringstream &ss)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::update (vtx_t root, jobmeta_t &meta,
+                                    unsigned int needs, bool exclusive,
+                                    match_writers_t *writers)
 {
     map<string, int64_t> dfu;
     m_color.reset ();
-    return (upd_dfv (root, needs, exclusive, meta, dfu, ss) > 0)? 0 : -1;
+    return (upd_dfv (root, needs, exclusive, meta, dfu, writers) > 0)? 0 : -1;
 }
 
-int dfu_impl_t::remove (vtx_t root, int64_t jobid)
+template <class match_cb_t>
+int dfu_impl_t<match_cb_t>::remove (vtx_t root, int64_t jobid)
 {
     m_color.reset ();
     return rem_dfv (root, jobid);
 }
 
+dfu_impl_base_t *Flux::resource_model::detail::create_dfu_impl (
+    dfu_match_cb_t *m)
+{
+    dfu_impl_base_t *impl = NULL;
+#define CREATE_DFU_IMPL(type, name, desc)                                     \
+    if (!impl && m && typeid (*m) == typeid (type))                           \
+        impl = new dfu_impl_t<type> ();
+    DFU_MATCH_POLICIES (CREATE_DFU_IMPL)
+#undef CREATE_DFU_IMPL
+    if (!impl)
+        impl = new dfu_impl_t<dfu_match_cb_t> ();
+    impl->set_match_cb (m);
+    return impl;
+}
+
+
+/****************************************************************************
+ *                                                                          *
+ *             DFU Traverser Implementation Explicit Instantiations         *
+ *                                                                          *
+ ****************************************************************************/
+
+namespace Flux {
+namespace resource_model {
+namespace detail {
+
+template class dfu_impl_t<dfu_match_cb_t>;
+#define INSTANTIATE_DFU_IMPL(type, name, desc) template class dfu_impl_t<type>;
+DFU_MATCH_POLICIES (INSTANTIATE_DFU_IMPL)
+#undef INSTANTIATE_DFU_IMPL
+
+} // namespace detail
+} // namespace resource_model
+} // namespace Flux
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
@@ -34,6 +34,7 @@
 #include "schema/resource_graph.hpp"
 #include "policies/base/dfu_match_cb.hpp"
 #include "evaluators/scoring_api.hpp"
+#include "writers/match_writers.hpp"
 #include "planner/planner.h"
 
 namespace Flux {
@@ -65,26 +66,30 @@ struct jobmeta_t {
     }
 };
 
-/*! implementation class of dfu_traverser_t
+/*! Policy-independent base of dfu_impl_t: graph, roots and traversal
+ *  state as well as the interface that dfu_traverser_t drives.
  */
-class dfu_impl_t {
+class dfu_impl_base_t {
 public:
-    dfu_impl_t ();
-    dfu_impl_t (f_resource_graph_t *g, dfu_match_cb_t *m,
-                std::map<subsystem_t, vtx_t> *roots);
-    dfu_impl_t (const dfu_impl_t &o);
-    dfu_impl_t &operator= (const dfu_impl_t &o);
-    ~dfu_impl_t ();
+    dfu_impl_base_t ();
+    dfu_impl_base_t (f_resource_graph_t *g,
+                     std::map<subsystem_t, vtx_t> *roots);
+    dfu_impl_base_t (const dfu_impl_base_t &o);
+    dfu_impl_base_t &operator= (const dfu_impl_base_t &o);
+    virtual ~dfu_impl_base_t ();
+
+    //! Return a copy of the concrete implementation object
+    virtual dfu_impl_base_t *clone () const = 0;
 
     //! Accessors
     const f_resource_graph_t *get_graph () const;
     const std::map<subsystem_t, vtx_t> *get_roots () const;
-    const dfu_match_cb_t *get_match_cb () const;
+    virtual const dfu_match_cb_t *get_match_cb () const = 0;
     const std::string &err_message () const;
 
     void set_graph (f_resource_graph_t *g);
     void set_roots (std::map<subsystem_t, vtx_t> *roots);
-    void set_match_cb (dfu_match_cb_t *m);
+    virtual int set_match_cb (dfu_match_cb_t *m) = 0;
     void clear_err_message ();
 
     /*! Exclusive request? Return true if a resource in resources vector
@@ -112,8 +117,8 @@ public:
      *  \return          0 on success; -1 on error -- call err_message ()
      *                   for detail.
      */
-    int prime (const subsystem_t &subsystem, vtx_t u,
-               std::map<std::string, int64_t> &to_parent);
+    virtual int prime (const subsystem_t &subsystem, vtx_t u,
+                       std::map<std::string, int64_t> &to_parent) = 0;
 
     /*! Prime the resource section of the jobspec. Aggregate configured
      *  subtree resources into jobspec's user_data.  For example,
@@ -131,8 +136,8 @@ public:
      *                   output aggregates on the subtree.
      *  \return          none.
      */
-    void prime (std::vector<Jobspec::Resource> &resources,
-                std::unordered_map<std::string, int64_t> &to_parent);
+    virtual void prime (std::vector<Jobspec::Resource> &resources,
+                        std::unordered_map<std::string, int64_t> &to_parent) = 0;
 
     /*! Extract the aggregate info in the lookup object as pertaining to the
      *  planner-tracking resource types into resource_counts array, a form that
@@ -169,8 +174,8 @@ public:
      *  \return          0 on success; -1 on error -- call err_message ()
      *                   for detail.
      */
-    int select (Jobspec::Jobspec &jobspec, vtx_t root, jobmeta_t &meta,
-                bool exclusive, unsigned int *needs);
+    virtual int select (Jobspec::Jobspec &jobspec, vtx_t root, jobmeta_t &meta,
+                        bool exclusive, unsigned int *needs) = 0;
 
     /*! Update the resource state based on the previous select invocation
      *  and emit the allocation/reservation information.
@@ -179,13 +184,13 @@ public:
      *  \param meta      metadata on the job.
      *  \param needs     the number of root resources requested.
      *  \param excl      exclusive access requested.
-     *  \param ss        stringstream into which allocation/reservation
-     *                   information is printed.
+     *  \param writers   match writers object into which allocation/reservation
+     *                   information is emitted. NULL skips emission.
      *  \return          0 on success; -1 on error -- call err_message ()
      *                   for detail.
      */
-    int update (vtx_t root, jobmeta_t &meta, unsigned int needs, bool excl,
-                std::stringstream &ss);
+    virtual int update (vtx_t root, jobmeta_t &meta, unsigned int needs,
+                        bool excl, match_writers_t *writers) = 0;
 
     /*! Remove the allocation/reservation referred to by jobid and update
      *  the resource state.
@@ -194,15 +199,62 @@ public:
      *  \param jobid     job id.
      *  \return          0 on success; -1 on error.
      */
-    int remove (vtx_t root, int64_t jobid);
+    virtual int remove (vtx_t root, int64_t jobid) = 0;
 
-private:
+protected:
     const std::string level () const;
 
     void tick ();
     bool in_subsystem (edg_t e, const subsystem_t &subsystem) const;
     bool stop_explore (edg_t e, const subsystem_t &subsystem) const;
 
+    // member data
+    color_t m_color;
+    uint64_t m_best_k_cnt = 0;
+    unsigned int m_trav_level = 0;
+    std::map<subsystem_t, vtx_t> *m_roots = NULL;
+    f_resource_graph_t *m_graph = NULL;
+    std::string m_err_msg = "";
+}; // the end of class dfu_impl_base_t
+
+/*! Implementation class of dfu_traverser_t, specialized to the type
+ *  of the match callback object. When match_cb_t is a final policy class,
+ *  the match callbacks invoked at every visited vertex are bound statically
+ *  instead of being dispatched through the virtual table of dfu_match_cb_t.
+ */
+template <class match_cb_t = dfu_match_cb_t>
+class dfu_impl_t : public dfu_impl_base_t {
+public:
+    dfu_impl_t ();
+    dfu_impl_t (f_resource_graph_t *g, dfu_match_cb_t *m,
+                std::map<subsystem_t, vtx_t> *roots);
+    dfu_impl_t (const dfu_impl_t &o);
+    dfu_impl_t &operator= (const dfu_impl_t &o);
+    virtual ~dfu_impl_t ();
+
+    virtual dfu_impl_base_t *clone () const;
+    virtual const dfu_match_cb_t *get_match_cb () const;
+
+    /*! Set the match callback object.
+     *
+     *  \param m         match callback object. Its type must be match_cb_t
+     *                   or a type derived from it.
+     *  \return          0 on success; -1 on error.
+     *                       EINVAL: m is not of match_cb_t type.
+     */
+    virtual int set_match_cb (dfu_match_cb_t *m);
+
+    virtual int prime (const subsystem_t &subsystem, vtx_t u,
+                       std::map<std::string, int64_t> &to_parent);
+    virtual void prime (std::vector<Jobspec::Resource> &resources,
+                        std::unordered_map<std::string, int64_t> &to_parent);
+    virtual int select (Jobspec::Jobspec &jobspec, vtx_t root, jobmeta_t &meta,
+                        bool exclusive, unsigned int *needs);
+    virtual int update (vtx_t root, jobmeta_t &meta, unsigned int needs,
+                        bool excl, match_writers_t *writers);
+    virtual int remove (vtx_t root, int64_t jobid);
+
+private:
     /*! Various pruning methods
      */
     int by_avail (const jobmeta_t &meta, const std::string &s, vtx_t u,
@@ -230,12 +282,12 @@ private:
     /*! Accumulate count into accum if type matches with one of the resource
      *  types used in the scheduler-driven aggregate update (SDAU) scheme.
      *  dfu_match_cb_t provides an interface to configure what types are used
-     *  for SDAU scheme.
+     *  for SDAU scheme. The jobspec variant accumulates the types tracked
+     *  by any of the subsystems, as a request is not partitioned by them.
      */
     int accum_if (const subsystem_t &subsystem, const std::string &type,
                   unsigned int count, std::map<std::string, int64_t> &accum);
-    int accum_if (const subsystem_t &subsystem, const std::string &type,
-                  unsigned int count,
+    int accum_if (const std::string &type, unsigned int count,
                   std::unordered_map<std::string, int64_t> &accum);
 
     // Explore out-edges for priming the subtree plans
@@ -262,9 +314,9 @@ private:
                  scoring_api_t &to_parent);
 
     // Emit R
-    int emit_edge (edg_t e);
+    int emit_edge (edg_t e, match_writers_t *w);
     int emit_vertex (vtx_t u, unsigned int needs, bool exclusive,
-                     std::stringstream &ss);
+                     match_writers_t *w);
 
     // Update resource graph data store
     int upd_plan (vtx_t u, const subsystem_t &s, unsigned int needs,
@@ -274,14 +326,14 @@ private:
                    bool excl, int n, const jobmeta_t &meta,
                    std::map<std::string, int64_t> &dfu,
                    std::map<std::string, int64_t> &to_parent,
-                   std::stringstream &ss);
+                   match_writers_t *w);
     int upd_upv (vtx_t u, const subsystem_t &subsystem, unsigned int needs,
                  bool excl, const jobmeta_t &meta,
                  std::map<std::string, int64_t> &to_parent);
     int upd_dfv (vtx_t u, unsigned int needs,
                  bool excl, const jobmeta_t &meta,
                  std::map<std::string, int64_t> &to_parent,
-                 std::stringstream &ss);
+                 match_writers_t *w);
 
     // Remove allocation or reservations
     int rem_subtree_plan (vtx_t u, int64_t jobid, const std::string &subsystem);
@@ -297,18 +349,24 @@ private:
     int enforce (const subsystem_t &subsystem, scoring_api_t &dfu);
 
     // member data
-    color_t m_color;
-    uint64_t m_best_k_cnt = 0;
-    unsigned int m_trav_level = 0;
-    std::map<subsystem_t, vtx_t> *m_roots = NULL;
-    f_resource_graph_t *m_graph = NULL;
-    dfu_match_cb_t *m_match = NULL;
-    std::string m_err_msg = "";
+    match_cb_t *m_match = NULL;
 }; // the end of class dfu_impl_t
 
+
+/*! Create a DFU traverser implementation object for the match callback
+ *  object. If the type of m is one of the registered match policies
+ *  (see policies/dfu_match_policy_factory.hpp), the object is specialized
+ *  to that type; otherwise the match callbacks are dispatched virtually
+ *  through dfu_impl_t<dfu_match_cb_t>.
+ *
+ *  \param m         match callback object.
+ *  \return          new implementation object.
+ */
+dfu_impl_base_t *create_dfu_impl (dfu_match_cb_t *m);
+
 template <class lookup_t>
-int dfu_impl_t::count (planner_multi_t *plan, const lookup_t &lookup,
-                       std::vector<uint64_t> &resource_counts)
+int dfu_impl_base_t::count (planner_multi_t *plan, const lookup_t &lookup,
+                            std::vector<uint64_t> &resource_counts)
 {
     int rc = 0;
     size_t len = planner_multi_resources_len (plan);
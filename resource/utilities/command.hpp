@@ -28,6 +28,7 @@
 #include "resource/schema/resource_graph.hpp"
 #include "resource/generators/gen.hpp"
 #include "resource/traversers/dfu.hpp"
+#include "resource/writers/match_writers.hpp"
 #include <cerrno>
 #include <vector>
 #include <map>
@@ -56,6 +57,8 @@ struct test_params_t {
     std::ofstream r_out;        /* Output file stream for emitted R */
     std::string r_fname;        /* Output file to dump the emitted R */
     std::string o_fext;         /* File extension */
+    std::string match_format;   /* Format to emit a matched resources */
+    std::string prune_filters;  /* Raw prune-filter specification */
     emit_format_t o_format;
     bool elapse_time;           /* Print elapse time */
 };
@@ -66,6 +69,7 @@ struct resource_context_t {
     resource_graph_db_t db;      /* Resource graph data store */
     dfu_match_cb_t *matcher;     /* Match callback object */
     dfu_traverser_t traverser;   /* Graph traverser object */
+    match_writers_t *writers;    /* Vertex/Edge writers for a match */
     std::map<uint64_t, job_info_t *> jobs;     /* Jobs table */
     std::map<uint64_t, uint64_t> allocations;  /* Allocation table */
     std::map<uint64_t, uint64_t> reservations; /* Reservation table */
@@ -34,9 +34,7 @@
 #include <readline/history.h>
 #include <boost/algorithm/string.hpp>
 #include "resource/utilities/command.hpp"
-#include "resource/policies/dfu_match_high_id_first.hpp"
-#include "resource/policies/dfu_match_low_id_first.hpp"
-#include "resource/policies/dfu_match_locality.hpp"
+#include "resource/policies/dfu_match_policy_factory.hpp"
 
 extern "C" {
 #if HAVE_CONFIG_H
@@ -47,11 +45,12 @@ extern "C" {
 using namespace std;
 using namespace Flux::resource_model;
 
-#define OPTIONS "G:S:P:g:o:p:t:e:h"
+#define OPTIONS "G:S:P:F:g:o:p:t:e:h"
 static const struct option longopts[] = {
     {"grug",             required_argument,  0, 'G'},
     {"match-subsystems", required_argument,  0, 'S'},
     {"match-policy",     required_argument,  0, 'P'},
+    {"match-format",     required_argument,  0, 'F'},
     {"graph-format",     required_argument,  0, 'g'},
     {"graph-output",     required_argument,  0, 'o'},
     {"prune-filters",    required_argument,  0, 'p'},
@@ -61,6 +60,52 @@ static const struct option longopts[] = {
     { 0, 0, 0, 0 },
 };
 
+/* Print s word-wrapped to fit 80 columns, indenting the lines after
+ * the first by indent spaces.
+ */
+static void print_wrapped (ostream &out, const string &s, size_t col,
+                           size_t indent)
+{
+    istringstream iss (s);
+    string word;
+    bool first = true;
+
+    while (iss >> word) {
+        if (!first && col + 1 + word.size () > 79) {
+            out << "\n" << string (indent, ' ');
+            col = indent;
+        } else if (!first) {
+            out << " ";
+            col++;
+        }
+        out << word;
+        col += word.size ();
+        first = false;
+    }
+    out << "\n";
+}
+
+/* The --match-policy usage lists the policies the factory knows */
+static void policy_usage (ostream &out)
+{
+    const vector<match_policy_info_t> &policies = known_match_policies ();
+    string names;
+    string prefix;
+
+    for (const auto &p : policies)
+        names += (names.empty ()? "" : "|") + string (p.name);
+    out << "    -P, --match-policy=<" << names << ">\n"
+        << "            Set the resource match selection policy. "
+           "Available policies are:\n";
+    for (const auto &p : policies) {
+        prefix = "                " + string (p.name) + ": ";
+        out << prefix;
+        print_wrapped (out, p.desc, prefix.size (), 20);
+    }
+    out << "            (default=high).\n"
+        << "\n";
+}
+
 static void usage (int code)
 {
     cerr <<
@@ -124,24 +169,37 @@ static void usage (int code)
 "                V+PFS1BA: Virtual Hierarchy and PFS1 Bandwidth-Aware \n"
 "                ALL: Aware of everything.\n"
 "            (default=CA).\n"
+"\n";
+    policy_usage (cerr);
+    cerr <<
+"    -F, --match-format=<simple|rlite|binary|none>\n"
+"            Specify the emit format of the matched resource set.\n"
+"                simple: Human-readable text, one resource per line\n"
+"                rlite: Compact JSON grouped by node with range-compressed\n"
+"                    resource IDs (e.g., core 0-35 on node12)\n"
+"                binary: Fixed-size records of vertex, count and\n"
+"                    exclusivity preceded by the record count\n"
+"                none: Do not emit the matched resource set\n"
+"            (default=simple).\n"
 "\n"
-"    -P, --match-policy=<low|high|locality>\n"
-"            Set the resource match selection policy. Available policies are:\n"
-"                high: Select resources with high ID first\n"
-"                low: Select resources with low ID first\n"
-"                locality: Select contiguous resources first in their ID space\n"
-"            (default=high).\n"
-"\n"
-"    -C, --prune-filters=<[HL-resource1|]:LL-resource1[,[HL-resource2|]:LL-resource2...]...]>\n"
+"    -p, --prune-filters=<[SS@][HL-resource1]:LL-resource1[,...]>\n"
 "            Install a planner-based cache at each HL(High-Level)-resource,\n"
 "                vertex which maintains the state of LL(Low-Level)-resources\n"
 "                in aggregate residing under its subtree. If a spec requests\n"
 "                1 node with 4 cores, and the visiting node vertex has\n"
 "                only a total of 2 available cores in aggreate at its\n"
 "                subtree, traverse will prune the further descent from\n"
-"                this node vertex to speep up the search. Example:\n"
+"                this node vertex to speep up the search. If HL-resource\n"
+"                is omitted, the cache is installed at every resource.\n"
+"                The cache is built in the SS subsystem, which must be one\n"
+"                of the match subsystems (default: the dominant subsystem).\n"
+"                The root of the dominant subsystem always keeps the\n"
+"                aggregates of its filtered types (or of cores) so that\n"
+"                allocate_orelse_reserve can find when to reserve.\n"
+"                Examples:\n"
 "                    rack:node,node:core\n"
 "                    :core,cluster:node,rack:node\n"
+"                    :core,zone:bandwidth\n"
 "                (default=:core).\n"
 "\n"
 "    -g, --graph-format=<dot|graphml>\n"
@@ -163,18 +221,6 @@ static void usage (int code)
     exit (code);
 }
 
-static dfu_match_cb_t *create_match_cb (const string &policy)
-{
-    dfu_match_cb_t *matcher = NULL;
-    if (policy == "high")
-        matcher = (dfu_match_cb_t *)new high_first_t ();
-    else if (policy == "low")
-        matcher = (dfu_match_cb_t *)new low_first_t ();
-    else if (policy == "locality")
-        matcher = (dfu_match_cb_t *)new greater_interval_first_t ();
-    return matcher;
-}
-
 static void set_default_params (resource_context_t *ctx)
 {
     ctx->params.grug = "conf/default";
@@ -183,6 +229,8 @@ static void set_default_params (resource_context_t *ctx)
     ctx->params.o_fname = "";
     ctx->params.r_fname = "";
     ctx->params.o_fext = "dot";
+    ctx->params.match_format = "simple";
+    ctx->params.prune_filters = ":core";
     ctx->params.o_format = emit_format_t::GRAPHVIZ_DOT;
     ctx->params.elapse_time = false;
 }
@@ -297,6 +345,52 @@ static int set_subsystems_use (resource_context_t *ctx, string n)
     return rc;
 }
 
+static int set_prune_filters (resource_context_t *ctx, const string &filters)
+{
+    // Each filter is [subsystem@][HL-resource]:LL-resource
+    vector<string> specs;
+    set<string> dom_types;
+    dfu_match_cb_t &matcher = *(ctx->matcher);
+    const subsystem_t &dom = matcher.dom_subsystem ();
+    const vector<subsystem_t> &subsystems = matcher.subsystems ();
+    boost::split (specs, filters, boost::is_any_of (","));
+    for (auto &spec : specs) {
+        subsystem_t subsystem = dom;
+        string anchor = ANY_RESOURCE_TYPE;
+        size_t at = spec.find ('@');
+        size_t colon = spec.rfind (':');
+        if (colon == string::npos || colon + 1 == spec.size ())
+            return -1;
+        if (at != string::npos) {
+            if (at > colon)
+                return -1;
+            subsystem = spec.substr (0, at);
+            if (find (subsystems.begin (), subsystems.end (), subsystem)
+                    == subsystems.end ())
+                return -1;
+        }
+        size_t hl = (at == string::npos)? 0 : at + 1;
+        if (colon > hl)
+            anchor = spec.substr (hl, colon - hl);
+        matcher.set_pruning_type (subsystem, anchor, spec.substr (colon + 1));
+        if (subsystem == dom)
+            dom_types.insert (spec.substr (colon + 1));
+    }
+
+    // allocate_orelse_reserve finds the times at which to retry from the
+    // aggregates at the root of the dominant subsystem: always keep them
+    // there for the filtered types, or for cores if none is filtered.
+    auto root = ctx->db.roots.find (dom);
+    if (root != ctx->db.roots.end ()) {
+        const string &root_type = ctx->db.resource_graph[root->second].type;
+        if (dom_types.empty ())
+            dom_types.insert ("core");
+        for (auto &type : dom_types)
+            matcher.set_pruning_type (dom, root_type, type);
+    }
+    return 0;
+}
+
 static void write_to_graphviz (f_resource_graph_t &fg, subsystem_t ss,
                                fstream &o)
 {
@@ -439,6 +533,12 @@ int main (int argc, char *argv[])
             case 'P': /* --match-policy */
                 ctx->params.matcher_policy = optarg;
                 break;
+            case 'F': /* --match-format */
+                ctx->params.match_format = optarg;
+                break;
+            case 'p': /* --prune-filters */
+                ctx->params.prune_filters = optarg;
+                break;
             case 'g': /* --graph-format */
                 rc = string_to_graph_format (optarg, ctx->params.o_format);
                 if ( rc != 0) {
@@ -473,6 +573,19 @@ int main (int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    // Create a match writers object unless emission is turned off
+    ctx->writers = NULL;
+    if (ctx->params.match_format != "none") {
+        match_format_t format;
+        if (match_writers_factory_t::get_writers_type (
+                ctx->params.match_format, format) != 0
+            || !(ctx->writers = match_writers_factory_t::create (format))) {
+            cerr << "ERROR: unknown match format " << endl;
+            cerr << "ERROR: " << ctx->params.match_format << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
     // Generate a resource graph data store
     resource_generator_t rgen;
     if ( (rc = rgen.read_graphml (ctx->params.grug, ctx->db)) != 0) {
@@ -497,8 +610,11 @@ int main (int argc, char *argv[])
     f_resource_graph_t *fg = new f_resource_graph_t (g, edgsel, vtxsel);
     ctx->resource_graph_views[ctx->params.matcher_name] = fg;
     ctx->jobid_counter = 1;
-    const string &dom = ctx->matcher->dom_subsystem ();
-    ctx->matcher->set_pruning_type (dom, ANY_RESOURCE_TYPE, "core");
+    if (set_prune_filters (ctx, ctx->params.prune_filters) != 0) {
+        cerr << "ERROR: invalid prune filters " << endl;
+        cerr << "ERROR: " << ctx->params.prune_filters << endl;
+        return EXIT_FAILURE;
+    }
 
     if (ctx->params.r_fname != "") {
         ctx->params.r_out.exceptions (std::ofstream::failbit
@@ -513,6 +629,7 @@ int main (int argc, char *argv[])
 
     if (ctx->params.r_fname != "")
         ctx->params.r_out.close ();
+    delete ctx->writers;
 
     // Output the filtered resource graph
     if (ctx->params.o_fname != "")
@@ -0,0 +1,275 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#include "writers/match_writers.hpp"
+
+extern "C" {
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+}
+
+namespace Flux {
+namespace resource_model {
+
+/****************************************************************************
+ *                                                                          *
+ *                  Base Match Writers Class Public Definitions             *
+ *                                                                          *
+ ****************************************************************************/
+
+int match_writers_t::emit_edg (unsigned int level, const f_resource_graph_t &g,
+                               const edg_t &e)
+{
+    // NYI: We will ultimately need to emit edge info for nested instance
+    // with complex scheduler, pending a discussion on R.
+    return 0;
+}
+
+
+/****************************************************************************
+ *                                                                          *
+ *                Simple Match Writers Class Public Definitions             *
+ *                                                                          *
+ ****************************************************************************/
+
+simple_match_writers_t::~simple_match_writers_t ()
+{
+
+}
+
+bool simple_match_writers_t::empty ()
+{
+    return m_out.empty ();
+}
+
+int simple_match_writers_t::emit_vtx (unsigned int level,
+                                      const f_resource_graph_t &g,
+                                      const vtx_t &u, unsigned int needs,
+                                      bool exclusive)
+{
+    m_out.append ("      ");
+    for (unsigned int i = 0; i < level; ++i)
+        m_out.append ("---");
+    m_out.append (g[u].name);
+    m_out.append ("[");
+    m_out.append (std::to_string (needs));
+    m_out.append ((exclusive)? ":x]\n" : ":s]\n");
+    return 0;
+}
+
+int simple_match_writers_t::emit (std::ostream &out)
+{
+    out.write (m_out.data (), m_out.size ());
+    return out.bad ()? -1 : 0;
+}
+
+void simple_match_writers_t::reset ()
+{
+    // clear () retains the capacity of the buffer for the next match
+    m_out.clear ();
+}
+
+
+/****************************************************************************
+ *                                                                          *
+ *                 R-lite Match Writers Class Public Definitions            *
+ *                                                                          *
+ ****************************************************************************/
+
+rlite_match_writers_t::~rlite_match_writers_t ()
+{
+
+}
+
+bool rlite_match_writers_t::empty ()
+{
+    return m_out.empty () && m_children.empty ();
+}
+
+void rlite_match_writers_t::compress_ids (const std::set<int64_t> &ids,
+                                          std::string &out)
+{
+    int64_t base = INT64_MIN;
+    int64_t prev = INT64_MIN;
+    for (auto &id : ids) {
+        if (prev != INT64_MIN && id == prev + 1) {
+            prev = id;
+            continue;
+        }
+        if (prev != INT64_MIN) {
+            out.append (std::to_string (base));
+            if (prev != base)
+                out.append ("-" + std::to_string (prev));
+            out.append (",");
+        }
+        base = prev = id;
+    }
+    if (prev != INT64_MIN) {
+        out.append (std::to_string (base));
+        if (prev != base)
+            out.append ("-" + std::to_string (prev));
+    }
+}
+
+void rlite_match_writers_t::flush (const std::string &node)
+{
+    m_out.append ((m_out.empty ())? "{" : ",{");
+    if (!node.empty ())
+        m_out.append ("\"node\":\"" + node + "\",");
+    m_out.append ("\"children\":{");
+    for (auto it = m_children.begin (); it != m_children.end (); ++it) {
+        if (it != m_children.begin ())
+            m_out.append (",");
+        m_out.append ("\"" + it->first + "\":\"");
+        compress_ids (it->second, m_out);
+        m_out.append ("\"");
+    }
+    m_out.append ("}}");
+    m_children.clear ();
+}
+
+int rlite_match_writers_t::emit_vtx (unsigned int level,
+                                     const f_resource_graph_t &g,
+                                     const vtx_t &u, unsigned int needs,
+                                     bool exclusive)
+{
+    // Vertices are emitted in postorder: all of the resources
+    // of a node's subtree have been accumulated when the node is emitted.
+    if (g[u].type == "node") {
+        m_node_level = level;
+        flush (g[u].name);
+    } else if (m_node_level == 0 || level > m_node_level) {
+        m_children[g[u].type].insert (g[u].id);
+    }
+    return 0;
+}
+
+int rlite_match_writers_t::emit (std::ostream &out)
+{
+    // Resources that aren't contained in any node vertex
+    if (!m_children.empty ())
+        flush ("");
+    out << "[" << m_out << "]" << std::endl;
+    return out.bad ()? -1 : 0;
+}
+
+void rlite_match_writers_t::reset ()
+{
+    m_out.clear ();
+    m_children.clear ();
+    m_node_level = 0;
+}
+
+
+/****************************************************************************
+ *                                                                          *
+ *                 Binary Match Writers Class Public Definitions            *
+ *                                                                          *
+ ****************************************************************************/
+
+binary_match_writers_t::~binary_match_writers_t ()
+{
+
+}
+
+bool binary_match_writers_t::empty ()
+{
+    return m_records.empty ();
+}
+
+int binary_match_writers_t::emit_vtx (unsigned int level,
+                                      const f_resource_graph_t &g,
+                                      const vtx_t &u, unsigned int needs,
+                                      bool exclusive)
+{
+    record_t r;
+    r.vtx = (uint64_t)u;
+    r.needs = (uint32_t)needs;
+    r.exclusive = (exclusive)? 1 : 0;
+    m_records.push_back (r);
+    return 0;
+}
+
+int binary_match_writers_t::emit (std::ostream &out)
+{
+    uint64_t n = (uint64_t)m_records.size ();
+    out.write ((const char *)&n, sizeof (n));
+    if (n > 0)
+        out.write ((const char *)m_records.data (), n * sizeof (record_t));
+    return out.bad ()? -1 : 0;
+}
+
+void binary_match_writers_t::reset ()
+{
+    m_records.clear ();
+}
+
+
+/****************************************************************************
+ *                                                                          *
+ *              Match Writers Factory Class Public Definitions              *
+ *                                                                          *
+ ****************************************************************************/
+
+match_writers_t *match_writers_factory_t::create (match_format_t format)
+{
+    match_writers_t *w = NULL;
+    switch (format) {
+    case match_format_t::SIMPLE:
+        w = new simple_match_writers_t ();
+        break;
+    case match_format_t::RLITE:
+        w = new rlite_match_writers_t ();
+        break;
+    case match_format_t::BINARY:
+        w = new binary_match_writers_t ();
+        break;
+    default:
+        break;
+    }
+    return w;
+}
+
+int match_writers_factory_t::get_writers_type (const std::string &st,
+                                               match_format_t &format)
+{
+    int rc = 0;
+    if (st == "simple")
+        format = match_format_t::SIMPLE;
+    else if (st == "rlite")
+        format = match_format_t::RLITE;
+    else if (st == "binary")
+        format = match_format_t::BINARY;
+    else
+        rc = -1;
+    return rc;
+}
+
+} // namespace resource_model
+} // namespace Flux
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
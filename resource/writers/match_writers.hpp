@@ -0,0 +1,162 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#ifndef MATCH_WRITERS_HPP
+#define MATCH_WRITERS_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <ostream>
+#include <cstdint>
+#include "schema/resource_graph.hpp"
+
+namespace Flux {
+namespace resource_model {
+
+enum class match_format_t { SIMPLE, RLITE, BINARY };
+
+/*! Base match writers class for a matched resource set (R).
+ *  The traverser calls back emit_vtx and emit_edg for each resource vertex
+ *  and edge it has selected. A writer accumulates them into its own buffer,
+ *  which is retained across matches so that its storage is reused:
+ *  emit writes the buffer out and reset clears it for the next match.
+ */
+class match_writers_t {
+public:
+    virtual ~match_writers_t () {}
+    virtual bool empty () = 0;
+    virtual int emit_vtx (unsigned int level, const f_resource_graph_t &g,
+                          const vtx_t &u, unsigned int needs,
+                          bool exclusive) = 0;
+    virtual int emit_edg (unsigned int level, const f_resource_graph_t &g,
+                          const edg_t &e);
+    virtual int emit (std::ostream &out) = 0;
+    virtual void reset () = 0;
+};
+
+
+/*! Simple match writers class: human-readable text, one line per
+ *  resource vertex in the order emitted (i.e., a reversed tree shape).
+ */
+class simple_match_writers_t : public match_writers_t
+{
+public:
+    virtual ~simple_match_writers_t ();
+    virtual bool empty ();
+    virtual int emit_vtx (unsigned int level, const f_resource_graph_t &g,
+                          const vtx_t &u, unsigned int needs, bool exclusive);
+    virtual int emit (std::ostream &out);
+    virtual void reset ();
+private:
+    std::string m_out;
+};
+
+
+/*! R-lite match writers class: compact JSON grouped by node and
+ *  range-compressed on resource IDs; e.g.,
+ *  [{"node":"node12","children":{"core":"0-35","socket":"0-1"}}]
+ *  Resources below a node vertex are folded into that node's children.
+ *  Resources above nodes (e.g., rack or cluster) and allocated amounts
+ *  are not emitted.
+ */
+class rlite_match_writers_t : public match_writers_t
+{
+public:
+    virtual ~rlite_match_writers_t ();
+    virtual bool empty ();
+    virtual int emit_vtx (unsigned int level, const f_resource_graph_t &g,
+                          const vtx_t &u, unsigned int needs, bool exclusive);
+    virtual int emit (std::ostream &out);
+    virtual void reset ();
+
+    /*! Compress a set of IDs into a range string, e.g., "0-3,5,7-8".
+     */
+    static void compress_ids (const std::set<int64_t> &ids, std::string &out);
+
+private:
+    void flush (const std::string &node);
+
+    unsigned int m_node_level = 0;
+    std::map<std::string, std::set<int64_t>> m_children;
+    std::string m_out;
+};
+
+
+/*! Binary match writers class: a header with the record count followed
+ *  by fixed-size records in host byte order. Each record holds
+ *  the vertex descriptor, allocated count and exclusivity of
+ *  a matched resource, which a consumer sharing the same resource graph
+ *  can map back to a resource vertex without parsing any text.
+ */
+class binary_match_writers_t : public match_writers_t
+{
+public:
+    struct record_t {
+        uint64_t vtx;
+        uint32_t needs;
+        uint32_t exclusive;
+    };
+
+    virtual ~binary_match_writers_t ();
+    virtual bool empty ();
+    virtual int emit_vtx (unsigned int level, const f_resource_graph_t &g,
+                          const vtx_t &u, unsigned int needs, bool exclusive);
+    virtual int emit (std::ostream &out);
+    virtual void reset ();
+private:
+    std::vector<record_t> m_records;
+};
+
+
+/*! Match writers factory class.
+ */
+struct match_writers_factory_t {
+    /*! Create a match writers object of the format.
+     *
+     *  \param format    match format of match_format_t type.
+     *  \return          new match writers object on success; NULL on error.
+     */
+    static match_writers_t *create (match_format_t format);
+
+    /*! Convert a format name into match_format_t.
+     *
+     *  \param st        format name: simple, rlite or binary.
+     *  \param[out] format
+     *                   match format.
+     *  \return          0 on success; -1 on unknown format name.
+     */
+    static int get_writers_type (const std::string &st,
+                                 match_format_t &format);
+};
+
+} // namespace resource_model
+} // namespace Flux
+
+#endif // MATCH_WRITERS_HPP
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
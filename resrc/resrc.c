@@ -40,35 +40,30 @@
 #include "resrc_tree.h"
 #include "resrc_flow.h"
 #include "resrc_reqst.h"
+#include "twindow.h"
 #include "src/common/libutil/xzmalloc.h"
 
 
 
+/* Lifetime of a resource; inclusive of both ends */
 typedef struct window {
     int64_t starttime;
     int64_t endtime;
-    const char *job_id;
 } window_t;
 
-/* static window_t * window_new (int64_t starttime, int64_t endtime) { */
-/*     window_t *ret = malloc (sizeof *ret); */
-/*     ret->starttime = starttime; */
-/*     ret->endtime = endtime; */
-/*     return ret; */
-/* } */
-
-static void window_destructor (void **window_v) {
-    if (window_v) {
-        free(*window_v);
-        *window_v = NULL;
-    }
-}
+/* Set of interned property or tag names; bit i is feature id i */
+typedef struct resrc_bits {
+    uint64_t *words;
+    size_t nwords;
+} resrc_bits_t;
 
-static void *window_dup (const void *window) {
-    window_t * ret = malloc(sizeof *ret);
-    memcpy(ret, window, sizeof *ret);
-    return ret;
-}
+/* Count of resources of one type in the physical subtree of a resource */
+typedef struct resrc_agg {
+    char *type;
+    int64_t total;      /* all resources of this type */
+    int64_t included;   /* those not excluded */
+    int64_t usable;     /* those not excluded with units available now */
+} resrc_agg_t;
 
 struct resrc {
     char *type;
@@ -76,6 +71,7 @@ struct resrc {
     char *basename;
     char *name;
     char *digest;
+    int digest_id;              /* digest as interned by rs2rank, or -1 */
     int64_t id;
     uuid_t uuid;
     size_t size;
@@ -86,12 +82,131 @@ struct resrc {
     zhash_t *graphs;
     zhash_t *properties;
     zhash_t *tags;
+    resrc_bits_t prop_bits;     /* names of properties, for matching */
+    resrc_bits_t tag_bits;      /* names of tags, for matching */
     zhash_t *allocs;
     zlist_t *alloc_keys;
     zhash_t *reservtns;
-    zhashx_t *twindow;
+    window_t *lifetime;
+    twindow_t *twindow;
+    resrc_agg_t *aggs;
+    int naggs;
+    bool included;
+    bool usable;
 };
 
+/***************************************************************************
+ *  Feature bitsets
+ ***************************************************************************/
+
+/* Return the id of a property or tag name, interning it if new */
+static size_t feature_id (resrc_api_ctx_t *ctx, const char *name)
+{
+    uintptr_t id = (uintptr_t)zhash_lookup (ctx->feature_ids, name);
+    if (!id) {
+        id = ++(ctx->nfeatures);
+        zhash_insert (ctx->feature_ids, name, (void *)id);
+    }
+    return (size_t)(id - 1);
+}
+
+static void bits_set (resrc_bits_t *bits, size_t bit)
+{
+    size_t w = bit / 64;
+    if (w >= bits->nwords) {
+        bits->words = xrealloc (bits->words, (w + 1) * sizeof (uint64_t));
+        memset (bits->words + bits->nwords, 0,
+                (w + 1 - bits->nwords) * sizeof (uint64_t));
+        bits->nwords = w + 1;
+    }
+    bits->words[w] |= (uint64_t)1 << (bit % 64);
+}
+
+/* Return true if every bit of sub is also set in bits */
+static inline bool bits_subset (const resrc_bits_t *sub,
+                                const resrc_bits_t *bits)
+{
+    size_t i;
+    for (i = 0; i < sub->nwords; i++) {
+        uint64_t w = (i < bits->nwords)? bits->words[i] : 0;
+        if (sub->words[i] & ~w)
+            return false;
+    }
+    return true;
+}
+
+/***************************************************************************
+ *  Subtree aggregates
+ ***************************************************************************/
+
+static resrc_agg_t *agg_lookup (resrc_t *resrc, const char *type)
+{
+    int i;
+    for (i = 0; i < resrc->naggs; i++)
+        if (!strcmp (resrc->aggs[i].type, type))
+            return &(resrc->aggs[i]);
+    return NULL;
+}
+
+static resrc_agg_t *agg_get (resrc_t *resrc, const char *type)
+{
+    resrc_agg_t *agg = agg_lookup (resrc, type);
+    if (!agg) {
+        resrc->aggs = xrealloc (resrc->aggs,
+                                (resrc->naggs + 1) * sizeof (resrc_agg_t));
+        agg = &(resrc->aggs[resrc->naggs++]);
+        agg->type = xstrdup (type);
+        agg->total = 0;
+        agg->included = 0;
+        agg->usable = 0;
+    }
+    return agg;
+}
+
+/* Apply a change in the counts of resrc's type to it and its ancestors */
+static void agg_propagate (resrc_t *resrc, int64_t dtotal, int64_t dincluded,
+                           int64_t dusable)
+{
+    resrc_tree_t *tree = resrc->phys_tree;
+    resrc_agg_t *agg = NULL;
+
+    while (tree) {
+        agg = agg_get (resrc_tree_resrc (tree), resrc->type);
+        agg->total += dtotal;
+        agg->included += dincluded;
+        agg->usable += dusable;
+        tree = resrc_tree_parent (tree);
+    }
+}
+
+static inline bool resrc_is_usable (resrc_t *resrc)
+{
+    return resrc->state != RESOURCE_EXCLUDED && resrc->available > 0;
+}
+
+/* Called after a change to the state or the available units of resrc */
+static void agg_refresh (resrc_t *resrc)
+{
+    bool included = resrc->state != RESOURCE_EXCLUDED;
+    bool usable = resrc_is_usable (resrc);
+    if (resrc->phys_tree
+        && (included != resrc->included || usable != resrc->usable)) {
+        agg_propagate (resrc, 0, (int)included - (int)resrc->included,
+                       (int)usable - (int)resrc->usable);
+        resrc->included = included;
+        resrc->usable = usable;
+    }
+}
+
+/* Make resrc a node of the physical tree and count it in its ancestors */
+static void resrc_phys_attach (resrc_t *resrc, resrc_tree_t *parent_tree)
+{
+    resrc->phys_tree = resrc_tree_new (parent_tree, resrc);
+    resrc->included = resrc->state != RESOURCE_EXCLUDED;
+    resrc->usable = resrc_is_usable (resrc);
+    agg_propagate (resrc, 1, resrc->included? 1 : 0, resrc->usable? 1 : 0);
+}
+
 /***************************************************************************
  *  API
  ***************************************************************************/
@@ -105,6 +220,8 @@ resrc_api_ctx_t *resrc_api_init (void)
     ctx->tree_root = NULL;
     ctx->flow_names = NULL;
     ctx->flow_roots = zhash_new ();
+    ctx->feature_ids = zhash_new ();
+    ctx->nfeatures = 0;
     return ctx;
 }
 
@@ -122,6 +239,8 @@ void resrc_api_fini (resrc_api_ctx_t *ctx)
         zhash_destroy (&(ctx->flow_roots));
     if (ctx->flow_names)
         zlist_destroy (&(ctx->flow_names));
+    if (ctx->feature_ids)
+        zhash_destroy (&(ctx->feature_ids));
     /* tree_root_resrc should already have been destroyed */
     free (ctx);
 }
@@ -205,10 +324,24 @@ char *resrc_set_digest (resrc_t *resrc, char *digest)
     if (resrc) {
         old = resrc->digest;
         resrc->digest = digest;
+        resrc->digest_id = -1;
     }
     return old;
 }
 
+int resrc_digest_id (resrc_t *resrc)
+{
+    if (resrc)
+        return resrc->digest_id;
+    return -1;
+}
+
+void resrc_set_digest_id (resrc_t *resrc, int id)
+{
+    if (resrc)
+        resrc->digest_id = id;
+}
+
 int64_t resrc_id (resrc_t *resrc)
 {
     if (resrc)
@@ -230,228 +363,55 @@ size_t resrc_available (resrc_t *resrc)
     return 0;
 }
 
-size_t resrc_available_at_time (resrc_t *resrc, int64_t time)
+size_t resrc_staged (resrc_t *resrc)
 {
-    const char *id_ptr = NULL;
-    window_t *window = NULL;
-    size_t *size_ptr = NULL;
+    if (resrc)
+        return resrc->staged;
+    return 0;
+}
 
-    size_t available = resrc->size;
+size_t resrc_available_at_time (resrc_t *resrc, int64_t time)
+{
+    size_t used = 0;
 
     if (time < 0) {
         time = epochtime();
     }
 
     // Check that the time is during the resource lifetime
-    window = zhashx_lookup (resrc->twindow, "0");
-    if (window && (time < window->starttime || time > window->endtime)) {
+    if (resrc->lifetime && (time < resrc->lifetime->starttime
+                            || time > resrc->lifetime->endtime)) {
         return 0;
     }
 
-    // Iterate over all allocation windows in resrc.  We iterate using
-    // the hash to avoid copying the entire hash every time, using
-    // zhashx_cursor to retrieve the key to lookup the size in resrc->allocs.
-    window = zhashx_first (resrc->twindow);
-    while (window) {
-        id_ptr = zhashx_cursor(resrc->twindow);
-        if (!strcmp (id_ptr, "0")) {
-            /* This is the resource lifetime entry and should not be
-             * evaluated as an allocation or reservation entry */
-            window = zhashx_next (resrc->twindow);
-            continue;
-        }
-
-        // Does time intersect with window?
-        if (time >= window->starttime && time <= window->endtime) {
-            // Decrement available by allocation and/or reservation size
-            size_ptr = (size_t*)zhash_lookup (resrc->allocs, id_ptr);
-            if (size_ptr) {
-                available -= *size_ptr;
-            }
-            size_ptr = (size_t*)zhash_lookup (resrc->reservtns, id_ptr);
-            if (size_ptr) {
-                available -= *size_ptr;
-            }
-        }
-
-        window = zhashx_next (resrc->twindow);
-    }
-
-    return available;
-}
-
-static int compare_windows_starttime (const void *item1, const void *item2)
-{
-    const window_t * lhs = item1, *rhs = item2;
-    if (lhs->starttime < rhs->starttime)
-        return -1;
-    if (lhs->starttime == rhs->starttime)
-        return 0;
-    return 1;
-}
-
-static int compare_windows_endtime (const void *item1, const void *item2)
-{
-    const window_t * lhs = item1, *rhs = item2;
-    if (lhs->endtime < rhs->endtime)
-        return -1;
-    if (lhs->endtime == rhs->endtime)
-        return 0;
-    return 1;
+    used = twindow_max_used (resrc->twindow, time, time);
+    return (used < resrc->size)? resrc->size - used : 0;
 }
 
 size_t resrc_available_during_range (resrc_t *resrc, int64_t range_starttime,
                                      int64_t range_endtime, bool exclusive)
 {
-    window_t *window = NULL;
-    const char *id_ptr = NULL;
-    int64_t  curr_endtime = 0;
-    int64_t  curr_starttime = 0;
-    size_t   curr_available = 0;
-    size_t   min_available = 0;
-    size_t  *alloc_ptr = NULL;
-    size_t  *reservtn_ptr = NULL;
-    size_t  *size_ptr = NULL;
-    zlistx_t *matching_windows = NULL;
+    size_t used = 0;
 
     if (range_starttime == range_endtime) {
         return resrc_available_at_time (resrc, range_starttime);
     }
 
-    matching_windows = zlistx_new ();
-    /* zlistx_set_duplicator(matching_windows, window_dup); */
-    zlistx_set_destructor(matching_windows, window_destructor);
-
     // Check that the time is during the resource lifetime
-    window =  zhashx_lookup (resrc->twindow, "0");
-    if (window) {
-        curr_starttime = window->starttime;
-        curr_endtime = window->endtime;
-        if ( (range_starttime < curr_starttime) ||
-                (range_endtime > curr_endtime) ) {
-            return 0;
-        }
-    }
-
-    // Map allocation window strings to JSON objects.  Filter out
-    // windows that don't overlap with the input range. Then add the
-    // job id to the JSON obj and insert the JSON obj into the
-    // "matching windows" list.
-    window = zhashx_first (resrc->twindow);
-    while (window) {
-        id_ptr = zhashx_cursor(resrc->twindow);
-        if (!strcmp (id_ptr, "0")) {
-            /* This is the resource lifetime entry and should not be
-             * evaluated as an allocation or reservation entry */
-            window = zhashx_next (resrc->twindow);
-            continue;
-        }
-        curr_starttime = window->starttime;
-        curr_endtime = window->endtime;
-
-        // Does input range intersect with window?
-        if ( !((curr_starttime < range_starttime &&
-                curr_endtime < range_starttime) ||
-               (curr_starttime > range_endtime &&
-                curr_endtime > range_endtime)) ) {
-
-            /* If the sample requires exclusive access and we are
-             * here, then we now know that exclusivity cannot be
-             * granted over the requested range.  Leave now. */
-            if (exclusive)
-                goto ret;
-
-            alloc_ptr = (size_t*)zhash_lookup (resrc->allocs, id_ptr);
-            reservtn_ptr = (size_t*)zhash_lookup (resrc->reservtns, id_ptr);
-            if (alloc_ptr || reservtn_ptr) {
-                // Add the window key and insert JSON obj into the
-                // "matching windows" list
-                window_t * new_window = window_dup (window);
-                new_window->job_id = id_ptr;
-                zlistx_add_end (matching_windows, new_window);
-            }
-        }
-
-        window = zhashx_next (resrc->twindow);
+    if (resrc->lifetime && (range_starttime < resrc->lifetime->starttime
+                            || range_endtime > resrc->lifetime->endtime)) {
+        return 0;
     }
 
-    // Duplicate the "matching windows" list and then sort the 2 lists
-    // based on start and end times.  We will walk through these lists
-    // in order to find the minimum available during the input range
-    zlistx_t *start_windows = matching_windows;
-    zlistx_set_comparator(start_windows, compare_windows_starttime);
-    zlistx_t *end_windows = zlistx_dup (start_windows);
-    // Do not free items in this list, they are owned by the start_windows
-    // list
-    zlistx_set_destructor(end_windows, NULL);
-    zlistx_set_comparator(end_windows, compare_windows_endtime);
-    zlistx_sort (start_windows);
-    zlistx_sort (end_windows);
-
-    window_t *curr_start_window = zlistx_first (start_windows);
-    window_t *curr_end_window = zlistx_first (end_windows);
-
-    min_available = resrc->size;
-    curr_available = resrc->size;
-
-    // Start iterating over the windows and calculating the min
-    // available
-    //
-    // OPTIMIZE: stop iterating when curr_start_window == NULL Once we
-    // run out of start windows, curr available cannot get any
-    // smaller; we have hit our min.  Just need to test to verify that
-    // this optimziation is correct/safe.
-    while (curr_start_window) {
-        curr_starttime = curr_start_window->starttime;
-        curr_endtime = curr_end_window->endtime;
-
-        if ((curr_start_window) &&
-            (curr_starttime < curr_endtime)) {
-            // New range is starting, get its size and subtract it
-            // from current available
-            size_ptr = (size_t*)zhash_lookup (resrc->allocs, curr_start_window->job_id);
-            if (size_ptr)
-                curr_available -= *size_ptr;
-            size_ptr = (size_t*)zhash_lookup (resrc->reservtns, curr_start_window->job_id);
-            if (size_ptr)
-                curr_available -= *size_ptr;
-            curr_start_window = zlistx_next (start_windows);
-            if (curr_start_window) {
-                curr_starttime = curr_start_window->starttime;
-            } else {
-                curr_starttime = TIME_MAX;
-            }
-        } else if ((curr_end_window) &&
-                   (curr_endtime < curr_starttime)) {
-            // A range just ended, get its size and add it back into
-            // current available
-            id_ptr = curr_end_window->job_id;
-            size_ptr = (size_t*)zhash_lookup (resrc->allocs, id_ptr);
-            if (size_ptr)
-                curr_available += *size_ptr;
-            size_ptr = (size_t*)zhash_lookup (resrc->reservtns, id_ptr);
-            if (size_ptr)
-                curr_available += *size_ptr;
-            curr_end_window = zlistx_next (end_windows);
-            if (curr_end_window) {
-                curr_endtime = curr_end_window->endtime;
-            } else {
-                curr_endtime = TIME_MAX;
-            }
-        } else {
-            fprintf (stderr,
-                     "%s - ERR: Both start/end windows are empty\n",
-                     __FUNCTION__);
-        }
-        min_available = (curr_available < min_available) ? curr_available :
-            min_available;
+    /* If the sample requires exclusive access, any allocation or
+     * reservation window intersecting the range rules it out. */
+    if (exclusive) {
+        return twindow_overlaps (resrc->twindow, range_starttime,
+                                 range_endtime)? 0 : resrc->size;
     }
 
-    zlistx_destroy (&end_windows);
-ret:
-    zlistx_destroy (&matching_windows);
-
-    return min_available;
+    used = twindow_max_used (resrc->twindow, range_starttime, range_endtime);
+    return (used < resrc->size)? resrc->size - used : 0;
 }
 
 char* resrc_state_string (resrc_t *resrc)
@@ -496,6 +456,7 @@ int resrc_set_state (resrc_t *resrc, int state)
         return oldstate;
     oldstate = resrc->state;
     resrc->state = state;
+    agg_refresh (resrc);
     return oldstate;
 }
 
@@ -506,6 +467,22 @@ resrc_tree_t *resrc_phys_tree (resrc_t *resrc)
     return NULL;
 }
 
+int64_t resrc_subtree_count (resrc_t *resrc, const char *type, bool usable)
+{
+    resrc_agg_t *agg = NULL;
+    if (!resrc || !type || !(agg = agg_lookup (resrc, type)))
+        return 0;
+    return usable? agg->usable : agg->total;
+}
+
+int64_t resrc_subtree_capacity (resrc_t *resrc, const char *type)
+{
+    resrc_agg_t *agg = NULL;
+    if (!resrc || !type || !(agg = agg_lookup (resrc, type)))
+        return 0;
+    return agg->included;
+}
+
 size_t resrc_size_allocs (resrc_t *resrc)
 {
     if (resrc)
@@ -543,9 +520,26 @@ size_t resrc_size_reservtns (resrc_t *resrc)
 
 int resrc_twindow_insert (resrc_t *resrc, const char *key, int64_t starttime, int64_t endtime)
 {
-    const window_t w = {.starttime = starttime, .endtime = endtime};
-    int rc = zhashx_insert (resrc->twindow, key, (void *)&w);
-    return rc;
+    int64_t job_id = 0;
+    size_t size = 0;
+    size_t *size_ptr = NULL;
+
+    if (!strcmp (key, "0")) {
+        if (resrc->lifetime)
+            return -1;
+        resrc->lifetime = xzmalloc (sizeof (window_t));
+        resrc->lifetime->starttime = starttime;
+        resrc->lifetime->endtime = endtime;
+        return 0;
+    }
+    job_id = strtoll (key, NULL, 10);
+    if (twindow_has (resrc->twindow, job_id))
+        return -1;
+    if ((size_ptr = zhash_lookup (resrc->allocs, key)))
+        size += *size_ptr;
+    if ((size_ptr = zhash_lookup (resrc->reservtns, key)))
+        size += *size_ptr;
+    return twindow_add (resrc->twindow, job_id, starttime, endtime, size);
 }
 
 int resrc_graph_insert (resrc_t *resrc, const char *name, resrc_flow_t *flow)
@@ -619,6 +613,7 @@ resrc_t *resrc_new_resource (resrc_api_ctx_t *ctx, const char *type, const char
         resrc->digest = NULL;
         if (sig)
             resrc->digest = xstrdup (sig);
+        resrc->digest_id = -1;
         if (uuid)
             uuid_copy (resrc->uuid, uuid);
         else
@@ -634,53 +629,97 @@ resrc_t *resrc_new_resource (resrc_api_ctx_t *ctx, const char *type, const char
         resrc->reservtns = zhash_new ();
         resrc->properties = zhash_new ();
         resrc->tags = zhash_new ();
-        resrc->twindow = zhashx_new ();
-        zhashx_set_destructor(resrc->twindow, window_destructor);
-        zhashx_set_duplicator(resrc->twindow, window_dup);
+        resrc->prop_bits.words = NULL;
+        resrc->prop_bits.nwords = 0;
+        resrc->tag_bits.words = NULL;
+        resrc->tag_bits.nwords = 0;
+        resrc->lifetime = NULL;
+        resrc->twindow = twindow_new ();
+        resrc->aggs = NULL;
+        resrc->naggs = 0;
+        resrc->included = false;
+        resrc->usable = false;
     }
 
     return resrc;
 }
 
-/*
- * NOTE: until resrc_t can be refactor to contain only the base data
- * model of a resource, this copy constructor will find little use.
- * remove it for now.
- */
-#if 0
+/* Duplicate a table of job id -> units, as kept in allocs/reservtns */
+static zhash_t *units_dup (zhash_t *table)
+{
+    zhash_t *dup = zhash_new ();
+    size_t *size_ptr = NULL;
+
+    for (size_ptr = zhash_first (table); size_ptr;
+         size_ptr = zhash_next (table)) {
+        const char *key = zhash_cursor (table);
+        size_t *copy = xzmalloc (sizeof (size_t));
+        *copy = *size_ptr;
+        zhash_insert (dup, key, copy);
+        zhash_freefn (dup, key, free);
+    }
+    return dup;
+}
+
+static void bits_copy (resrc_bits_t *dst, const resrc_bits_t *src)
+{
+    dst->words = NULL;
+    dst->nwords = src->nwords;
+    if (src->nwords) {
+        dst->words = xzmalloc (src->nwords * sizeof (uint64_t));
+        memcpy (dst->words, src->words, src->nwords * sizeof (uint64_t));
+    }
+}
+
 resrc_t *resrc_copy_resource (resrc_t *resrc)
 {
     resrc_t *new_resrc = xzmalloc (sizeof (resrc_t));
-
-    if (new_resrc) {
-        new_resrc->type = xstrdup (resrc->type);
-        new_resrc->path = xstrdup (resrc->path);
-        new_resrc->basename = xstrdup (resrc->basename);
-        new_resrc->name = xstrdup (resrc->name);
-        if (resrc->digest)
-            new_resrc->digest = xstrdup (resrc->digest);
-        new_resrc->id = resrc->id;
-        uuid_copy (new_resrc->uuid, resrc->uuid);
-        new_resrc->state = resrc->state;
-        new_resrc->phys_tree = resrc_tree_copy (resrc->phys_tree);
-        new_resrc->graphs = zhash_dup (resrc->graphs);
-        new_resrc->allocs = zhash_dup (resrc->allocs);
-        new_resrc->reservtns = zhash_dup (resrc->reservtns);
-        new_resrc->properties = zhash_dup (resrc->properties);
-        new_resrc->tags = zhash_dup (resrc->tags);
-        if (resrc->twindow)
-            new_resrc->twindow = zhashx_dup (resrc->twindow);
-        else
-            new_resrc->twindow = NULL;
+    void *flow = NULL;
+
+    new_resrc->type = xstrdup (resrc->type);
+    new_resrc->path = xstrdup (resrc->path);
+    new_resrc->basename = xstrdup (resrc->basename);
+    new_resrc->name = xstrdup (resrc->name);
+    if (resrc->digest)
+        new_resrc->digest = xstrdup (resrc->digest);
+    new_resrc->digest_id = resrc->digest_id;
+    new_resrc->id = resrc->id;
+    uuid_copy (new_resrc->uuid, resrc->uuid);
+    new_resrc->size = resrc->size;
+    new_resrc->available = resrc->available;
+    new_resrc->staged = resrc->staged;
+    new_resrc->state = resrc->state;
+    new_resrc->phys_tree = NULL;
+    /* flow graphs are not owned by the resource */
+    new_resrc->graphs = zhash_new ();
+    for (flow = zhash_first (resrc->graphs); flow;
+         flow = zhash_next (resrc->graphs))
+        zhash_insert (new_resrc->graphs, zhash_cursor (resrc->graphs), flow);
+    new_resrc->properties = zhash_dup (resrc->properties);
+    new_resrc->tags = zhash_dup (resrc->tags);
+    bits_copy (&new_resrc->prop_bits, &resrc->prop_bits);
+    bits_copy (&new_resrc->tag_bits, &resrc->tag_bits);
+    /* allocs, reservtns and their time windows go together */
+    new_resrc->allocs = units_dup (resrc->allocs);
+    new_resrc->alloc_keys = NULL;
+    new_resrc->reservtns = units_dup (resrc->reservtns);
+    new_resrc->twindow = twindow_dup (resrc->twindow);
+    if (resrc->lifetime) {
+        new_resrc->lifetime = xzmalloc (sizeof (window_t));
+        *(new_resrc->lifetime) = *(resrc->lifetime);
     }
+    new_resrc->aggs = NULL;
+    new_resrc->naggs = 0;
+    new_resrc->included = resrc->included;
+    new_resrc->usable = resrc->usable;
 
     return new_resrc;
 }
-#endif
 
 void resrc_resource_destroy (resrc_api_ctx_t *ctx, void *object)
 {
     resrc_t *resrc = (resrc_t *) object;
+    int i;
 
     if (resrc) {
         if (resrc->type)
@@ -707,8 +746,13 @@ void resrc_resource_destroy (resrc_api_ctx_t *ctx, void *object)
         zhash_destroy (&resrc->reservtns);
         zhash_destroy (&resrc->properties);
         zhash_destroy (&resrc->tags);
-        if (resrc->twindow)
-            zhashx_destroy (&resrc->twindow);
+        free (resrc->prop_bits.words);
+        free (resrc->tag_bits.words);
+        free (resrc->lifetime);
+        twindow_destroy (&resrc->twindow);
+        for (i = 0; i < resrc->naggs; i++)
+            free (resrc->aggs[i].type);
+        free (resrc->aggs);
         free (resrc);
     }
 }
@@ -791,7 +835,7 @@ resrc_t *resrc_new_from_json (resrc_api_ctx_t *ctx, json_t *o, resrc_t *parent,
         if (physical) {
             if (parent)
                 parent_tree = parent->phys_tree;
-            resrc->phys_tree = resrc_tree_new (parent_tree, resrc);
+            resrc_phys_attach (resrc, parent_tree);
 
             /* add time window if we are given a start time */
             int64_t starttime;
@@ -820,6 +864,7 @@ resrc_t *resrc_new_from_json (resrc_api_ctx_t *ctx, json_t *o, resrc_t *parent,
                 if ((property = json_create_string (jpropo))) {
                     zhash_insert (resrc->properties, key, property);
                     zhash_freefn (resrc->properties, key, free);
+                    bits_set (&resrc->prop_bits, feature_id (ctx, key));
                 }
             }
         }
@@ -834,6 +879,7 @@ resrc_t *resrc_new_from_json (resrc_api_ctx_t *ctx, json_t *o, resrc_t *parent,
                 if ((tag = json_create_string (jtago))) {
                     zhash_insert (resrc->tags, key, tag);
                     zhash_freefn (resrc->tags, key, free);
+                    bits_set (&resrc->tag_bits, feature_id (ctx, key));
                 }
             }
         }
@@ -971,7 +1017,7 @@ static resrc_t *resrc_new_from_hwloc_obj (resrc_api_ctx_t *ctx, hwloc_obj_t obj,
     if (resrc) {
         if (parent)
             parent_tree = parent->phys_tree;
-        resrc->phys_tree = resrc_tree_new (parent_tree, resrc);
+        resrc_phys_attach (resrc, parent_tree);
 
         if (obj->memory.local_memory) {
             char *mempath = xasprintf ("%s/memory", path);
@@ -984,7 +1030,7 @@ static resrc_t *resrc_new_from_hwloc_obj (resrc_api_ctx_t *ctx, hwloc_obj_t obj,
             uuid_generate (uuid);
             mem_resrc = resrc_new_resource (ctx, "memory", mempath, "memory",
                                             "memory0", signature, 0, uuid, size);
-            mem_resrc->phys_tree = resrc_tree_new (resrc->phys_tree, mem_resrc);
+            resrc_phys_attach (mem_resrc, resrc->phys_tree);
             free (mempath);
         }
 
@@ -1016,7 +1062,7 @@ static resrc_t *resrc_create_cluster (resrc_api_ctx_t *ctx, char *cluster)
     uuid_generate (uuid);
     resrc = resrc_new_resource (ctx, "cluster", path, cluster, cluster, NULL, -1,
                                 uuid, 1);
-    resrc->phys_tree = resrc_tree_new (NULL, resrc);
+    resrc_phys_attach (resrc, NULL);
     free (path);
     return resrc;
 }
@@ -1207,7 +1253,6 @@ bool resrc_walltime_match (resrc_t *resrc, resrc_reqst_t *request,
                            size_t reqrd_size, int *reason)
 {
     bool rc = false;
-    window_t *window = NULL;
     int64_t endtime = resrc_reqst_endtime (request);
     int64_t starttime = resrc_reqst_starttime (request);
     size_t available = 0;
@@ -1215,9 +1260,8 @@ bool resrc_walltime_match (resrc_t *resrc, resrc_reqst_t *request,
 
     /* If request endtime is greater than the lifetime of the
        resource, then return false */
-    window = zhashx_lookup (resrc->twindow, "0");
-    if (window) {
-        if (endtime > (window->endtime - 10)) {
+    if (resrc->lifetime) {
+        if (endtime > (resrc->lifetime->endtime - 10)) {
             *reason = DUE_TO_TIME;
             return false;
         }
@@ -1242,8 +1286,6 @@ bool resrc_match_resource (resrc_t *resrc, resrc_reqst_t *request,
                            bool available, int *reason)
 {
     bool rc = false;
-    char *rproperty = NULL;                             /* request property */
-    char *rtag = NULL;                                  /* request tag */
     resrc_t *reqst_resrc = resrc_reqst_resrc (request); /* request's resrc */
     resrc_graph_req_t *graph_req = NULL;
     *reason = REASON_NONE;
@@ -1254,37 +1296,13 @@ bool resrc_match_resource (resrc_t *resrc, resrc_reqst_t *request,
             goto ret;
         }
 
-        if (zhash_size (reqst_resrc->properties)) {
-            if (!zhash_size (resrc->properties)) {
-                *reason = DUE_TO_FEATURE;
-                goto ret;
-            }
-            /* be sure the resource has all the requested properties */
-            /* TODO: validate the value of each property */
-            zhash_first (reqst_resrc->properties);
-            do {
-                rproperty = (char *)zhash_cursor (reqst_resrc->properties);
-                if (!zhash_lookup (resrc->properties, rproperty)) {
-                    *reason = DUE_TO_FEATURE;
-                    goto ret;
-                }
-            } while (zhash_next (reqst_resrc->properties));
-        }
-
-        if (zhash_size (reqst_resrc->tags)) {
-            if (!zhash_size (resrc->tags)) {
-                *reason = DUE_TO_FEATURE;
-                goto ret;
-            }
-            /* be sure the resource has all the requested tags */
-            zhash_first (reqst_resrc->tags);
-            do {
-                rtag = (char *)zhash_cursor (reqst_resrc->tags);
-                if (!zhash_lookup (resrc->tags, rtag)) {
-                    *reason = DUE_TO_FEATURE;
-                    goto ret;
-                }
-            } while (zhash_next (reqst_resrc->tags));
+        /* be sure the resource has all the requested properties and
+         * tags: names are interned, so this is a subset test of bitsets */
+        /* TODO: validate the value of each property */
+        if (!bits_subset (&reqst_resrc->prop_bits, &resrc->prop_bits)
+            || !bits_subset (&reqst_resrc->tag_bits, &resrc->tag_bits)) {
+            *reason = DUE_TO_FEATURE;
+            goto ret;
         }
 
         graph_req = resrc_reqst_graph_reqs (request);
@@ -1419,6 +1437,7 @@ static int resrc_allocate_resource_now (resrc_t *resrc, int64_t job_id)
     resrc->available -= resrc->staged;
     resrc->staged = 0;
     resrc->state = RESOURCE_ALLOCATED;
+    agg_refresh (resrc);
     rc = 0;
     free (id_ptr);
 ret:
@@ -1450,10 +1469,10 @@ static int resrc_allocate_resource_in_time (resrc_t *resrc, int64_t job_id,
     *size_ptr = resrc->staged;
     zhash_insert (resrc->allocs, id_ptr, size_ptr);
     zhash_freefn (resrc->allocs, id_ptr, free);
-    resrc->staged = 0;
 
     /* add walltime */
-    resrc_twindow_insert (resrc, id_ptr, starttime, endtime);
+    twindow_add (resrc->twindow, job_id, starttime, endtime, resrc->staged);
+    resrc->staged = 0;
 
     rc = 0;
     free (id_ptr);
@@ -1525,6 +1544,7 @@ static int resrc_reserve_resource_now (resrc_t *resrc, int64_t job_id)
     resrc->staged = 0;
     if (resrc->state != RESOURCE_ALLOCATED)
         resrc->state = RESOURCE_RESERVED;
+    agg_refresh (resrc);
     rc = 0;
     free (id_ptr);
 ret:
@@ -1555,10 +1575,10 @@ static int resrc_reserve_resource_in_time (resrc_t *resrc, int64_t job_id,
     *size_ptr = resrc->staged;
     zhash_insert (resrc->reservtns, id_ptr, size_ptr);
     zhash_freefn (resrc->reservtns, id_ptr, free);
-    resrc->staged = 0;
 
     /* add walltime */
-    resrc_twindow_insert (resrc, id_ptr, starttime, endtime);
+    twindow_add (resrc->twindow, job_id, starttime, endtime, resrc->staged);
+    resrc->staged = 0;
 
     rc = 0;
     free (id_ptr);
@@ -1632,7 +1652,7 @@ int resrc_release_allocation (resrc_t *resrc, int64_t rel_job)
         if (resrc->state == RESOURCE_ALLOCATED)
             resrc->available += *size_ptr;
         else
-            zhashx_delete (resrc->twindow, id_ptr);
+            twindow_remove (resrc->twindow, rel_job);
 
         zhash_delete (resrc->allocs, id_ptr);
         if (((resrc->state != RESOURCE_INVALID)
@@ -1643,6 +1663,7 @@ int resrc_release_allocation (resrc_t *resrc, int64_t rel_job)
             else
                 resrc->state = RESOURCE_IDLE;
         }
+        agg_refresh (resrc);
     }
 
     free (id_ptr);
@@ -1676,7 +1697,7 @@ int resrc_release_all_reservations (resrc_t *resrc)
                 resrc->available += *size_ptr;
             else {
                 id_ptr = (char *)zhash_cursor (resrc->reservtns);
-                zhashx_delete (resrc->twindow, id_ptr);
+                twindow_remove (resrc->twindow, strtoll (id_ptr, NULL, 10));
             }
             size_ptr = zhash_next (resrc->reservtns);
         }
@@ -1691,6 +1712,39 @@ int resrc_release_all_reservations (resrc_t *resrc)
         else
             resrc->state = RESOURCE_IDLE;
     }
+    agg_refresh (resrc);
+ret:
+    return rc;
+}
+
+int resrc_release_reservation (resrc_t *resrc, int64_t rel_job)
+{
+    char *id_ptr = NULL;
+    size_t *size_ptr = NULL;
+    int rc = 0;
+
+    if (!resrc || !rel_job) {
+        rc = -1;
+        goto ret;
+    }
+
+    id_ptr = xasprintf ("%"PRId64"", rel_job);
+    size_ptr = zhash_lookup (resrc->reservtns, id_ptr);
+    if (size_ptr) {
+        if ((resrc->state == RESOURCE_ALLOCATED) ||
+            (resrc->state == RESOURCE_RESERVED))
+            resrc->available += *size_ptr;
+        else
+            twindow_remove (resrc->twindow, rel_job);
+
+        zhash_delete (resrc->reservtns, id_ptr);
+        if ((resrc->state == RESOURCE_RESERVED)
+            && !zhash_size (resrc->reservtns))
+            resrc->state = RESOURCE_IDLE;
+        agg_refresh (resrc);
+    }
+
+    free (id_ptr);
 ret:
     return rc;
 }
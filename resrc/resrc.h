@@ -71,10 +71,22 @@ char *resrc_digest (resrc_t *resrc);
 
  /*
  * Set the digest field of resrc with 'digest'. This will
- * return the old digest.
+ * return the old digest and clear the digest id.
  */
 char *resrc_set_digest (resrc_t *resrc, char *digest);
 
+ /*
+ * Return the id under which the rs2rank table interned the digest
+ * of resrc, or -1 if it has not been interned
+ */
+int resrc_digest_id (resrc_t *resrc);
+
+ /*
+ * Cache the id under which the rs2rank table interned the digest
+ * of resrc
+ */
+void resrc_set_digest_id (resrc_t *resrc, int id);
+
 /*
  * Return the id of the resouce
  */
@@ -90,6 +102,11 @@ size_t resrc_size (resrc_t *resrc);
  */
 size_t resrc_available (resrc_t *resrc);
 
+/*
+ * Return the quantity of units staged for the request being selected
+ */
+size_t resrc_staged (resrc_t *resrc);
+
 /*
  * Return the amount of the resource available at the given time
  */
@@ -122,6 +139,20 @@ int resrc_set_state (resrc_t *resrc, int state);
  */
 resrc_tree_t *resrc_phys_tree (resrc_t *resrc);
 
+/*
+ * Return the number of resources of the given type in the physical
+ * subtree rooted at resrc, including resrc itself.  If usable is true,
+ * count only those not excluded and with units available now.
+ */
+int64_t resrc_subtree_count (resrc_t *resrc, const char *type, bool usable);
+
+/*
+ * Return the number of resources of the given type in the physical
+ * subtree rooted at resrc that are not excluded, whether or not their
+ * units are in use now.
+ */
+int64_t resrc_subtree_capacity (resrc_t *resrc, const char *type);
+
 /*
  * Return the number of jobs allocated to this resource
  */
@@ -143,9 +174,10 @@ int64_t resrc_alloc_job_next (resrc_t *resrc);
 size_t resrc_size_reservtns (resrc_t *resrc);
 
 /*
- *  Insert item into twindow hash table with specified key and item.
- *  If key is already present returns -1 and leaves existing item
- *  unchanged.  Returns 0 on success.
+ *  Insert a time window for the specified key: "0" for the lifetime
+ *  of the resource, or a job id whose allocation or reservation
+ *  spans the window.  If key is already present returns -1 and leaves
+ *  existing item unchanged.  Returns 0 on success.
  */
 int resrc_twindow_insert (resrc_t *resrc, const char *key,
                           int64_t starttime, int64_t endtime);
@@ -177,11 +209,11 @@ resrc_t *resrc_new_resource (resrc_api_ctx_t *ctx,
                              size_t size);
 
 /*
- * Create a copy of a resource object
- * NOTE: as is, resrc_t contains fields that are not suitable
- * for a deep copy, let's not allow copy constructor for now
+ * Create a copy of a resource object, including its allocations,
+ * reservations and their time windows.  The copy is not linked into
+ * any physical tree, so it carries no subtree counts.
  */
-//resrc_t *resrc_copy_resource (resrc_t *resrc);
+resrc_t *resrc_copy_resource (resrc_t *resrc);
 
 /*
  * Destroy a resource object
@@ -289,6 +321,12 @@ int resrc_release_allocation (resrc_t *resrc, int64_t rel_job);
  */
 int resrc_release_all_reservations (resrc_t *resrc);
 
+/*
+ * Remove the reservation of a resource for the specified job
+ * Supports both now and time-based reservations.
+ */
+int resrc_release_reservation (resrc_t *resrc, int64_t rel_job);
+
 /*
  * Get epoch time
  */
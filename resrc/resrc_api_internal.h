@@ -12,6 +12,8 @@ struct resrc_api_ctx {
     resrc_tree_t *tree_root;  /* track the root resrc of the phys hierarcy */
     zlist_t *flow_names;      /* names of the flow hierarchies read in */
     zhash_t *flow_roots;      /* roots of the flow hierarchies indexed by name */
+    zhash_t *feature_ids;     /* property and tag names -> feature id + 1 */
+    size_t nfeatures;         /* number of interned feature names */
     /* additional API-level data here */
 };
 
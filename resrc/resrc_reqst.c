@@ -56,7 +56,7 @@ struct resrc_reqst {
 
 static bool match_children (resrc_api_ctx_t *ctx, resrc_tree_list_t *r_trees,
                             resrc_reqst_list_t *req_trees,
-                            resrc_tree_t *found_parent, bool available);
+                            resrc_tree_list_t *found, bool available);
 
 /***********************************************************************
  * Resource request
@@ -466,6 +466,74 @@ void resrc_reqst_list_destroy (resrc_api_ctx_t *ctx,
     }
 }
 
+/*
+ * Returns an upper bound on the number of resources in the physical
+ * subtree of resrc that can match resrc_reqst.  Only a search for
+ * resources available now can be bounded by the usable count.
+ */
+static int64_t subtree_candidates (resrc_t *resrc, resrc_reqst_t *resrc_reqst,
+                                   bool available)
+{
+    bool now = available && !resrc_reqst->starttime
+               && resrc_reqst->reqrd_size > 0;
+
+    if (!resrc_phys_tree (resrc))
+        return INT64_MAX;       /* no aggregates to go by */
+    if (!resrc_reqst->resrc)
+        return 0;
+    return resrc_subtree_count (resrc, resrc_type (resrc_reqst->resrc), now);
+}
+
+/*
+ * Adds a found tree node for resrc below *found_tree or, if there is
+ * none yet, makes it the found tree
+ */
+static resrc_tree_t *found_tree_add (resrc_tree_t **found_tree, resrc_t *resrc)
+{
+    resrc_tree_t *new_tree = resrc_tree_new (*found_tree, resrc);
+    if (!*found_tree)
+        *found_tree = new_tree;
+    return new_tree;
+}
+
+/*
+ * Moves the trees found below a resource under its found tree node
+ */
+static void found_tree_adopt (resrc_tree_t *new_tree, resrc_tree_list_t *found)
+{
+    resrc_tree_t *child = resrc_tree_list_first (found);
+    while (child) {
+        resrc_tree_add_child (new_tree, child);
+        child = resrc_tree_list_next (found);
+    }
+    resrc_tree_list_shallow_destroy (found);
+}
+
+/*
+ * Searches each of r_trees, appending what is found to the found list,
+ * and returns the number of requested resources found
+ */
+static int64_t search_trees (resrc_api_ctx_t *ctx, resrc_tree_list_t *r_trees,
+                             resrc_reqst_t *resrc_reqst,
+                             resrc_tree_list_t *found, bool available)
+{
+    int64_t nfound = 0;
+    resrc_tree_t *resrc_tree = NULL;
+    resrc_tree_t *sub_tree = NULL;
+
+    resrc_tree = resrc_tree_list_first (r_trees);
+    while (resrc_tree) {
+        sub_tree = NULL;
+        nfound += resrc_tree_search (ctx, resrc_tree_resrc (resrc_tree),
+                                     resrc_reqst, &sub_tree, available);
+        if (sub_tree)
+            resrc_tree_list_append (found, sub_tree);
+        resrc_tree = resrc_tree_list_next (r_trees);
+    }
+
+    return nfound;
+}
+
 /*
  * cycles through all of the resource children and returns the number of
  * requested resources found
@@ -473,21 +541,25 @@ void resrc_reqst_list_destroy (resrc_api_ctx_t *ctx,
 static int64_t match_child (resrc_api_ctx_t *ctx,
                             resrc_tree_list_t *r_trees,
                             resrc_reqst_t *resrc_reqst,
-                            resrc_tree_t *found_parent, bool available)
+                            resrc_tree_list_t *found, bool available)
 {
-    int64_t nfound = 0;
-    resrc_t *resrc = NULL;
+    int64_t n = 0;
+    int64_t ncandidates = 0;
     resrc_tree_t *resrc_tree = NULL;
 
+    /* Don't search children that cannot hold the required quantity */
     resrc_tree = resrc_tree_list_first (r_trees);
-    while (resrc_tree) {
-        resrc = resrc_tree_resrc (resrc_tree);
-        nfound += resrc_tree_search (ctx, resrc, resrc_reqst, &found_parent,
-                                     available);
+    while (resrc_tree && ncandidates < resrc_reqst->reqrd_qty) {
+        n = subtree_candidates (resrc_tree_resrc (resrc_tree), resrc_reqst,
+                                available);
+        ncandidates = (n > INT64_MAX - ncandidates)? INT64_MAX
+                                                    : ncandidates + n;
         resrc_tree = resrc_tree_list_next (r_trees);
     }
+    if (ncandidates < resrc_reqst->reqrd_qty)
+        return 0;
 
-    return nfound;
+    return search_trees (ctx, r_trees, resrc_reqst, found, available);
 }
 
 /*
@@ -497,29 +569,32 @@ static int64_t match_child (resrc_api_ctx_t *ctx,
 static bool match_children (resrc_api_ctx_t *ctx,
                             resrc_tree_list_t *r_trees,
                             resrc_reqst_list_t *req_trees,
-                            resrc_tree_t *found_parent, bool available)
+                            resrc_tree_list_t *found, bool available)
 {
-    bool found = false;
+    bool found_all = false;
     resrc_reqst_t *resrc_reqst = resrc_reqst_list_first (req_trees);
 
     while (resrc_reqst) {
         resrc_reqst->nfound = 0;
-        found = false;
+        found_all = false;
 
-        if (match_child (ctx, r_trees, resrc_reqst, found_parent, available)) {
+        if (match_child (ctx, r_trees, resrc_reqst, found, available)) {
             if (resrc_reqst->nfound >= resrc_reqst->reqrd_qty)
-                found = true;
+                found_all = true;
         }
-        if (!found)
+        if (!found_all)
             break;
 
         resrc_reqst = resrc_reqst_list_next (req_trees);
     }
 
-    return found;
+    return found_all;
 }
 
-/* returns the number of resource or resource composites found */
+/*
+ * returns the number of resource or resource composites found.  Found
+ * tree nodes are only created once something has been found below them.
+ */
 int64_t resrc_tree_search (resrc_api_ctx_t *ctx,
                            resrc_t *resrc_in, resrc_reqst_t *resrc_reqst,
                            resrc_tree_t **found_tree, bool available)
@@ -527,28 +602,33 @@ int64_t resrc_tree_search (resrc_api_ctx_t *ctx,
     int64_t nfound = 0;
     int reason = REASON_NONE;
     resrc_tree_list_t *children = NULL;
-    resrc_tree_t *child_tree;
-    resrc_tree_t *new_tree = NULL;
+    resrc_tree_list_t *found = NULL;
 
     if (!resrc_in || !found_tree || !resrc_reqst) {
         goto ret;
     }
 
+    /* Nothing below can match: skip the whole subtree */
+    if (!subtree_candidates (resrc_in, resrc_reqst, available))
+        goto ret;
+
     if (resrc_match_resource (resrc_in, resrc_reqst, available, &reason)) {
         if (resrc_reqst_num_children (resrc_reqst)) {
             if (resrc_tree_num_children (resrc_phys_tree (resrc_in))) {
-                new_tree = resrc_tree_new (*found_tree, resrc_in);
+                found = resrc_tree_list_new ();
                 children = resrc_tree_children (resrc_phys_tree (resrc_in));
-                if (match_children (ctx, children, resrc_reqst->children, new_tree,
+                if (match_children (ctx, children, resrc_reqst->children, found,
                                     available)) {
+                    found_tree_adopt (found_tree_add (found_tree, resrc_in),
+                                      found);
                     nfound = 1;
                     resrc_reqst->nfound++;
                 } else {
-                    resrc_tree_destroy (ctx, new_tree, false, false);
+                    resrc_tree_list_destroy (ctx, found, false);
                 }
             }
         } else {
-            (void) resrc_tree_new (*found_tree, resrc_in);
+            (void) found_tree_add (found_tree, resrc_in);
             nfound = 1;
             resrc_reqst->nfound++;
         }
@@ -566,23 +646,14 @@ int64_t resrc_tree_search (resrc_api_ctx_t *ctx,
          * and omit the intervening socket.
          */
 
-        new_tree = resrc_tree_new (NULL, resrc_in);
+        found = resrc_tree_list_new ();
         children = resrc_tree_children (resrc_phys_tree (resrc_in));
-        child_tree = resrc_tree_list_first (children);
-        while (child_tree) {
-            nfound += resrc_tree_search (ctx, resrc_tree_resrc (child_tree),
-                                         resrc_reqst, &new_tree, available);
-            child_tree = resrc_tree_list_next (children);
-        }
+        nfound = search_trees (ctx, children, resrc_reqst, found, available);
 
-        if (nfound) {
-            if (*found_tree)
-                resrc_tree_add_child (*found_tree, new_tree);
-            else
-                *found_tree = new_tree;
-        } else {
-            resrc_tree_destroy (ctx, new_tree, false, false);
-        }
+        if (nfound)
+            found_tree_adopt (found_tree_add (found_tree, resrc_in), found);
+        else
+            resrc_tree_list_destroy (ctx, found, false);
     }
 ret:
     return nfound;
@@ -67,6 +67,13 @@ resrc_tree_t *resrc_tree_root (resrc_api_ctx_t *ctx)
     return (ctx->tree_root)? ctx->tree_root : NULL;
 }
 
+resrc_tree_t *resrc_tree_parent (resrc_tree_t *resrc_tree)
+{
+    if (resrc_tree)
+        return resrc_tree->parent;
+    return NULL;
+}
+
 const char *resrc_tree_name (resrc_api_ctx_t *ctx)
 {
     if (!ctx)
@@ -395,6 +402,18 @@ int resrc_tree_release (resrc_tree_t *resrc_tree, int64_t job_id)
     return rc;
 }
 
+int resrc_tree_release_reservation (resrc_tree_t *resrc_tree, int64_t job_id)
+{
+    int rc = -1;
+    if (resrc_tree) {
+        rc = resrc_release_reservation (resrc_tree->resrc, job_id);
+        if (resrc_tree_num_children (resrc_tree))
+            rc = resrc_tree_list_release_reservation (resrc_tree->children,
+                                                      job_id);
+    }
+    return rc;
+}
+
 int resrc_tree_release_all_reservations (resrc_tree_t *resrc_tree)
 {
     int rc = -1;
@@ -618,6 +637,24 @@ int resrc_tree_list_release_all_reservations (resrc_tree_list_t *rtl)
     return rc;
 }
 
+int resrc_tree_list_release_reservation (resrc_tree_list_t *rtl,
+                                         int64_t job_id)
+{
+    resrc_tree_t *rt;
+    int rc = -1;
+
+    if (rtl) {
+        rc = 0;
+        rt = resrc_tree_list_first (rtl);
+        while (!rc && rt) {
+            rc = resrc_tree_release_reservation (rt, job_id);
+            rt = resrc_tree_list_next (rtl);
+        }
+    }
+
+    return rc;
+}
+
 void resrc_tree_list_unstage_resources (resrc_tree_list_t *rtl)
 {
     resrc_tree_t *rt;
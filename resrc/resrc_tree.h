@@ -22,6 +22,11 @@ resrc_t *resrc_tree_resrc (resrc_tree_t *resrc_tree);
  */
 resrc_tree_t *resrc_tree_root (resrc_api_ctx_t *ctx);
 
+/*
+ * Return the parent of this tree node; NULL at the root
+ */
+resrc_tree_t *resrc_tree_parent (resrc_tree_t *resrc_tree);
+
 /*
  * Return the name of this tree
  */
@@ -141,6 +146,11 @@ int resrc_tree_release (resrc_tree_t *resrc_tree, int64_t job_id);
  */
 int resrc_tree_release_all_reservations (resrc_tree_t *resrc_tree);
 
+/*
+ * Remove the reservation of a job from a resource tree
+ */
+int resrc_tree_release_reservation (resrc_tree_t *resrc_tree, int64_t job_id);
+
 /*
  * Unstage all resources in a resource tree
  */
@@ -227,6 +237,12 @@ int resrc_tree_list_release (resrc_tree_list_t *rtl, int64_t job_id);
  */
 int resrc_tree_list_release_all_reservations (resrc_tree_list_t *rtl);
 
+/*
+ * Release the reservation of a job from a list of resource trees
+ */
+int resrc_tree_list_release_reservation (resrc_tree_list_t *rtl,
+                                         int64_t job_id);
+
 /*
  * Unstage all resources in a list of resource trees
  */
@@ -90,8 +90,8 @@ ret:
     return selected_res;
 }
 
-// Contains 10 tests
-static int num_temporal_allocation_tests = 10;
+// Contains 13 tests
+static int num_temporal_allocation_tests = 13;
 static void test_temporal_allocation ()
 {
     int rc = 0;
@@ -100,6 +100,7 @@ static void test_temporal_allocation ()
     resrc_api_ctx_t *rsapi = resrc_api_init ();
     resrc_t *resource = resrc_new_resource (rsapi, "custom", "/test", "test",
                                             "test1", NULL, 1, NULL, 10);
+    resrc_t *copy = NULL;
 
     available = resrc_available_at_time (resource, 0);
     rc = (rc || !(available == 10));
@@ -228,8 +229,52 @@ static void test_temporal_allocation ()
     available = resrc_available_during_range (resource, 3001, 5000, false);
     rc = (rc || !(available == 10));
     ok (!rc, "resrc_available_during_range: range overlaps all job works");
+    rc = 0;
+
+    // Exclusive ranges and released windows
+    available = resrc_available_during_range (resource, 1500, 1600, true);
+    rc = (rc || !(available == 0));
+    available = resrc_available_during_range (resource, 3001, 5000, true);
+    rc = (rc || !(available == 10));
+    rc = (rc || resrc_release_allocation (resource, 3));
+    available = resrc_available_during_range (resource, 1001, 1999, true);
+    rc = (rc || !(available == 10));
+    available = resrc_available_during_range (resource, 0, 1999, false);
+    rc = (rc || !(available == 5));
+    ok (!rc, "resrc_available_during_range: exclusive and released work");
+    rc = 0;
+
+    // Releasing the reservation of a single job
+    resrc_stage_resrc (resource, 10, NULL);
+    rc = (rc || resrc_reserve_resource (resource, 4, 3001, 4000));
+    available = resrc_available_during_range (resource, 3500, 3600, false);
+    rc = (rc || !(available == 0));
+    rc = (rc || resrc_release_reservation (resource, 4));
+    available = resrc_available_during_range (resource, 3500, 3600, false);
+    rc = (rc || !(available == 10));
+    available = resrc_available_during_range (resource, 2000, 2500, false);
+    rc = (rc || !(available == 0));
+    ok (!rc, "resrc_release_reservation works");
+    rc = 0;
+
+    // A copy carries the windows of the allocations it copies
+    copy = resrc_copy_resource (resource);
+    available = resrc_available_during_range (copy, 2000, 2500, false);
+    rc = (rc || !(available == 0));
+    available = resrc_available_during_range (copy, 1, 1000, false);
+    rc = (rc || !(available == 5));
+    available = resrc_available_at_time (copy, 3001);
+    rc = (rc || !(available == 10));
+    rc = (rc || resrc_release_allocation (copy, 2));
+    available = resrc_available_during_range (copy, 2000, 2500, false);
+    rc = (rc || !(available == 10));
+    available = resrc_available_during_range (resource, 2000, 2500, false);
+    rc = (rc || !(available == 0));
+    ok (!rc, "resrc_copy_resource copies allocation windows");
 
 ret:
+    if (copy)
+        resrc_resource_destroy (rsapi, copy);
     if (resource)
         resrc_resource_destroy (rsapi, resource);
     if (rsapi)
@@ -237,6 +282,24 @@ ret:
     return;
 }
 
+static int num_digest_id_tests = 3;
+static void test_digest_id ()
+{
+    resrc_api_ctx_t *rsapi = resrc_api_init ();
+    resrc_t *resource = resrc_new_resource (rsapi, "custom", "/test", "test",
+                                            "test1", "abc", 1, NULL, 1);
+
+    ok (resrc_digest_id (resource) == -1, "a new resource has no digest id");
+    resrc_set_digest_id (resource, 7);
+    ok (resrc_digest_id (resource) == 7, "the digest id can be cached");
+    free (resrc_set_digest (resource, strdup ("def")));
+    ok (resrc_digest_id (resource) == -1,
+        "setting the digest clears the digest id");
+
+    resrc_resource_destroy (rsapi, resource);
+    resrc_api_fini (rsapi);
+}
+
 static int test_a_resrc (resrc_api_ctx_t *rsapi, resrc_t *resrc, bool rdl)
 {
     int found = 0;
@@ -255,6 +318,14 @@ static int test_a_resrc (resrc_api_ctx_t *rsapi, resrc_t *resrc, bool rdl)
     if (!resrc_tree)
         goto ret;
 
+    ok ((resrc_subtree_count (resrc, resrc_type (resrc), false) == 1
+         && resrc_subtree_count (resrc, "core", true) > 0
+         && resrc_subtree_count (resrc, "core", true)
+            <= resrc_subtree_capacity (resrc, "core")
+         && resrc_subtree_capacity (resrc, "core")
+            <= resrc_subtree_count (resrc, "core", false)),
+        "resource subtree aggregates valid");
+
     if (verbose) {
         printf ("Listing resource tree\n");
         resrc_tree_print (resrc_tree);
@@ -568,8 +639,9 @@ int main (int argc, char *argv[])
 {
     int rc1 = 1, rc2 = 1;
 
-    plan (27 + num_temporal_allocation_tests);
+    plan (29 + num_temporal_allocation_tests + num_digest_id_tests);
     test_temporal_allocation ();
+    test_digest_id ();
     rc1 = test_using_reader_rdl ();
     rc2 = test_using_reader_hwloc ();
     /* plance holder for testing with other reader types */
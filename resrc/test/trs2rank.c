@@ -0,0 +1,209 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <hwloc.h>
+
+#include "src/common/libtap/tap.h"
+#include "resrc.h"
+#include "resrc_tree.h"
+#include "resrc_api.h"
+#include "rs2rank.h"
+
+#define NNODES 4
+#define NROUNDS 6
+
+/* Each host is managed by nranks equivalent brokers, from rank on */
+static const struct {
+    const char *hn;
+    uint32_t rank;
+    int nranks;
+} hosts[NNODES] = {
+    { "n0", 0, 2 },
+    { "n1", 2, 3 },
+    { "n2", 5, 1 },
+    { "n3", 6, 2 },
+};
+
+/* Return the digest of the single partition of host i */
+static const char *host_digest (machs_t *m, int i)
+{
+    return rs2rank_tab_eq_by_count (m, hosts[i].hn, 2, 8);
+}
+
+/* Register every broker rank of every host as rsreader does */
+static machs_t *build_table (hwloc_topology_t topo)
+{
+    machs_t *m = rs2rank_tab_new ();
+    char buf[64];
+    int i, j;
+
+    for (i = 0; i < NNODES; i++) {
+        for (j = 0; j < hosts[i].nranks; j++) {
+            rssig_t *sig = NULL;
+            snprintf (buf, sizeof (buf), "%s partition", hosts[i].hn);
+            if (rs2rank_set_signature (buf, strlen (buf), NULL, topo, &sig)
+                || rs2rank_tab_update (m, hosts[i].hn, sig,
+                                       hosts[i].rank + j)) {
+                rs2rank_tab_destroy (m);
+                return NULL;
+            }
+        }
+    }
+    return m;
+}
+
+/* cluster -> rack0 (n0, n1), rack1 (n2, n3) */
+static resrc_tree_t *build_tree (resrc_api_ctx_t *rsapi, machs_t *m,
+                                 resrc_t **nodes)
+{
+    resrc_tree_t *root, *rack = NULL;
+    char name[16];
+    int i;
+
+    root = resrc_tree_new (NULL, resrc_new_resource (rsapi, "cluster",
+                           "/cluster", "cluster", NULL, NULL, 0, NULL, 1));
+    for (i = 0; i < NNODES; i++) {
+        if (i % 2 == 0) {
+            snprintf (name, sizeof (name), "rack%d", i / 2);
+            rack = resrc_tree_new (root, resrc_new_resource (rsapi, "rack",
+                                   "/cluster", "rack", name, NULL, i / 2,
+                                   NULL, 1));
+        }
+        nodes[i] = resrc_new_resource (rsapi, "node", "/cluster", "node",
+                                       hosts[i].hn, host_digest (m, i), i,
+                                       NULL, 1);
+        resrc_tree_new (rack, nodes[i]);
+    }
+    return root;
+}
+
+/*
+ * The ranks that rs2rank_tab_resolve_tree resolves for all the nodes of
+ * a multi-node allocation at once must be those that querying every
+ * node by hostname and digest hands out, round robin among the ranks
+ * that share a node, pass after pass.
+ */
+static void test_resolve_tree (hwloc_topology_t topo)
+{
+    resrc_api_ctx_t *rsapi = resrc_api_init ();
+    machs_t *bulk = build_table (topo);
+    machs_t *sign = build_table (topo);
+    resrc_t *nodes[NNODES];
+    resrc_tree_t *tree = NULL;
+    uint32_t ranks[NNODES];
+    uint32_t n1_ranks[NROUNDS];
+    uint32_t rank;
+    bool indexed = true;
+    int i, round;
+
+    ok (bulk && sign, "rs2rank tables are built");
+    if (!bulk || !sign)
+        goto done;
+    tree = build_tree (rsapi, bulk, nodes);
+
+    ok (rs2rank_tab_index (bulk, tree, false) == 0,
+        "rs2rank_tab_index indexes every node");
+    for (i = 0; i < NNODES; i++)
+        indexed = indexed && resrc_digest_id (nodes[i]) >= 0;
+    ok (indexed, "every node caches the id of its partition");
+
+    for (round = 0; round < NROUNDS; round++) {
+        bool match = true;
+        ssize_t n = rs2rank_tab_resolve_tree (bulk, tree, false,
+                                              ranks, NNODES);
+        for (i = 0; i < NNODES && n == NNODES; i++) {
+            if (rs2rank_tab_query_by_sign (sign, hosts[i].hn,
+                                           resrc_digest (nodes[i]),
+                                           false, &rank)
+                || rank != ranks[i]) {
+                diag ("round %d: %s resolved to %u, queried %u", round,
+                      hosts[i].hn, ranks[i], rank);
+                match = false;
+            }
+        }
+        ok (n == NNODES && match,
+            "round %d: bulk ranks match the per-node round robin", round);
+        n1_ranks[round] = ranks[1];
+    }
+    ok (n1_ranks[0] == 2 && n1_ranks[1] == 3 && n1_ranks[2] == 4
+        && n1_ranks[3] == 2, "a node's ranks wrap around in order");
+
+    ok (rs2rank_tab_resolve_tree (bulk, tree, false, ranks, NNODES - 1) == -1,
+        "resolving into too short an array fails");
+
+done:
+    if (tree)
+        resrc_tree_destroy (rsapi, tree, true, true);
+    rs2rank_tab_destroy (bulk);
+    rs2rank_tab_destroy (sign);
+    resrc_api_fini (rsapi);
+}
+
+/* A node that matches no partition can be neither indexed nor resolved */
+static void test_unknown_node (hwloc_topology_t topo)
+{
+    resrc_api_ctx_t *rsapi = resrc_api_init ();
+    machs_t *m = build_table (topo);
+    resrc_tree_t *tree = NULL;
+    uint32_t ranks[1];
+
+    tree = resrc_tree_new (NULL, resrc_new_resource (rsapi, "node",
+                           "/cluster", "node", "n9", "nodigest", 9, NULL, 1));
+    ok (rs2rank_tab_index (m, tree, false) == -1,
+        "indexing a node of an unknown host fails");
+    ok (rs2rank_tab_resolve_tree (m, tree, false, ranks, 1) == -1,
+        "resolving a node of an unknown host fails");
+
+    resrc_tree_destroy (rsapi, tree, true, true);
+    rs2rank_tab_destroy (m);
+    resrc_api_fini (rsapi);
+}
+
+int main (int argc, char *argv[])
+{
+    hwloc_topology_t topo;
+
+    plan (13);
+    if (hwloc_topology_init (&topo) < 0
+        || hwloc_topology_set_synthetic (topo, "socket:2 core:4") < 0
+        || hwloc_topology_load (topo) < 0)
+        BAIL_OUT ("failed to load a synthetic hwloc topology");
+    test_resolve_tree (topo);
+    test_unknown_node (topo);
+    hwloc_topology_destroy (topo);
+    done_testing ();
+    return 0;
+}
+
+/*
+ * vi: ts=4 sw=4 expandtab
+ */
@@ -0,0 +1,194 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "src/common/libtap/tap.h"
+#include "timeline.h"
+
+/* Set every limit to INT64_MAX except that of type t */
+static void limits_of (int64_t *limit, int t, int64_t max)
+{
+    int i;
+    for (i = 0; i < TIMELINE_MAX_TYPES; i++)
+        limit[i] = INT64_MAX;
+    limit[t] = max;
+}
+
+static void test_types ()
+{
+    timeline_t *tl = timeline_new ();
+
+    ok (timeline_type_index (tl, "node") == 0, "first type gets index 0");
+    ok (timeline_type_index (tl, "core") == 1, "second type gets index 1");
+    ok (timeline_type_index (tl, "node") == 0, "known type keeps its index");
+    ok (!strcmp (timeline_type_name (tl, 1), "core"),
+        "type name is found by index");
+    ok (timeline_type_name (tl, 2) == NULL, "unknown index has no name");
+    timeline_destroy (tl);
+}
+
+/*
+ * A node-exclusive request for all 4 nodes can only start once nothing
+ * is in use, so the earliest start is where every window ends.
+ */
+static void test_earliest ()
+{
+    int64_t counts[TIMELINE_MAX_TYPES] = {0};
+    int64_t limit[TIMELINE_MAX_TYPES];
+    timeline_t *tl = timeline_new ();
+    int n = timeline_type_index (tl, "node");
+
+    limits_of (limit, n, 0);
+    ok (timeline_earliest (tl, 0, 10, limit) == -1,
+        "earliest on an empty timeline finds no step");
+
+    counts[n] = 4;
+    ok (timeline_add (tl, 1, 50, 59, counts, false) == 0,
+        "add a window using every node from 50 to 59");
+    ok (timeline_nsteps (tl) == 3, "window splits the profile in 3 steps");
+    ok (timeline_earliest (tl, 0, 30, limit) == 60,
+        "earliest start is right after the window ends");
+
+    ok (timeline_add (tl, 2, 100, 109, counts, false) == 0,
+        "add a window using every node from 100 to 109");
+    ok (timeline_earliest (tl, 0, 30, limit) == 60,
+        "a short request fits in the gap between windows");
+    ok (timeline_earliest (tl, 0, 100, limit) == 110,
+        "a long request skips the gap it does not fit in");
+    ok (timeline_earliest (tl, 60, 30, limit) == 110,
+        "earliest only considers steps after the given time");
+
+    limits_of (limit, n, 2);
+    counts[n] = 2;
+    ok (timeline_add (tl, 2, 100, 109, counts, false) == 0,
+        "re-adding a job replaces its window");
+    ok (timeline_size (tl) == 2, "replaced window is not counted twice");
+    ok (timeline_earliest (tl, 0, 100, limit) == 60,
+        "a request for half the nodes fits beside the replaced window");
+    timeline_destroy (tl);
+}
+
+/*
+ * Reserved windows count against the profile like allocated ones, and
+ * clearing them leaves the allocated windows in place.
+ */
+static void test_reserved ()
+{
+    int64_t counts[TIMELINE_MAX_TYPES] = {0};
+    int64_t limit[TIMELINE_MAX_TYPES];
+    int64_t start = -1, end = -1;
+    bool reserved = false;
+    timeline_t *tl = timeline_new ();
+    int n = timeline_type_index (tl, "node");
+
+    limits_of (limit, n, 0);
+    counts[n] = 4;
+    timeline_add (tl, 1, 0, 99, counts, false);
+    ok (timeline_add (tl, 2, 100, 199, counts, true) == 0,
+        "reserve every node from 100 to 199");
+    ok (timeline_get (tl, 2, &start, &end, NULL, &reserved) == 0
+        && start == 100 && end == 199 && reserved,
+        "reserved window is returned as it was added");
+    ok (timeline_get (tl, 1, NULL, NULL, NULL, &reserved) == 0 && !reserved,
+        "allocated window is not reserved");
+    ok (timeline_earliest (tl, 0, 10, limit) == 200,
+        "earliest start is after the reservation");
+
+    timeline_clear_reserved (tl);
+    ok (!timeline_has (tl, 2) && timeline_has (tl, 1),
+        "clearing reservations keeps the allocated window");
+    ok (timeline_earliest (tl, 0, 10, limit) == 100,
+        "earliest start is after the allocation once reservations clear");
+    timeline_destroy (tl);
+}
+
+/*
+ * A job that ends before its walltime ran out has its window removed,
+ * as the backfill plugin's job_end () does, and the profile returns to
+ * what it was before the job was added.
+ */
+static void test_job_end ()
+{
+    int64_t counts[TIMELINE_MAX_TYPES] = {0};
+    int64_t limit[TIMELINE_MAX_TYPES];
+    timeline_t *tl = timeline_new ();
+    int n = timeline_type_index (tl, "node");
+
+    limits_of (limit, n, 0);
+    counts[n] = 4;
+    timeline_add (tl, 1, 0, 99, counts, false);
+    timeline_add (tl, 2, 100, 199, counts, true);
+    ok (timeline_remove (tl, 1) == 0, "remove the window of an ended job");
+    ok (timeline_earliest (tl, 0, 10, limit) == 200,
+        "the reservation still bounds the earliest start");
+    ok (timeline_nsteps (tl) == 3, "the ended job leaves no steps behind");
+    ok (timeline_remove (tl, 2) == 0 && timeline_nsteps (tl) == 1,
+        "removing the last window restores the empty profile");
+    errno = 0;
+    ok (timeline_remove (tl, 2) == -1 && errno == ENOENT,
+        "removing an unknown job fails with ENOENT");
+    timeline_destroy (tl);
+}
+
+static void test_purge ()
+{
+    int64_t counts[TIMELINE_MAX_TYPES] = {0};
+    timeline_t *tl = timeline_new ();
+    int n = timeline_type_index (tl, "node");
+
+    counts[n] = 1;
+    timeline_add (tl, 1, 0, 9, counts, false);
+    timeline_add (tl, 2, 5, 29, counts, false);
+    timeline_purge (tl, 20);
+    ok (!timeline_has (tl, 1) && timeline_has (tl, 2),
+        "purge removes only the windows that ended");
+    ok (timeline_nsteps (tl) == 2,
+        "purge folds the past steps into the current one");
+    timeline_destroy (tl);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (29);
+    test_types ();
+    test_earliest ();
+    test_reserved ();
+    test_job_end ();
+    test_purge ();
+    done_testing ();
+    return 0;
+}
+
+/*
+ * vi: ts=4 sw=4 expandtab
+ */
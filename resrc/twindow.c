@@ -0,0 +1,338 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+/*
+ * twindow.c - interval tree of resource time windows
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <czmq.h>
+
+#include "src/common/librbtree/rbtree.h"
+#include "src/common/librbtree/rbtree_augmented.h"
+#include "src/common/libutil/oom.h"
+#include "src/common/libutil/xzmalloc.h"
+#include "twindow.h"
+
+/* A window is a node of a red-black tree ordered by starttime and
+ * augmented with the latest endtime of its subtree, so that the windows
+ * intersecting a time range are found in O(log n + k).  Windows are
+ * also indexed by job id for O(1) lookup on release.
+ */
+typedef struct window {
+    int64_t         job_id;      /* also the key of the index */
+    int64_t         starttime;
+    int64_t         endtime;     /* inclusive */
+    size_t          size;
+    int64_t         subtree_end; /* max endtime in this subtree */
+    struct rb_node  rb;
+} window_t;
+
+struct twindow {
+    struct rb_root  root;
+    zhashx_t       *index;       /* int64 job id -> window_t */
+};
+
+typedef struct tw_event {
+    int64_t         at;
+    size_t          size;
+} tw_event_t;
+
+typedef struct tw_collect {
+    tw_event_t     *starts;
+    tw_event_t     *ends;
+    size_t          n;
+    size_t          alloc;
+    int64_t         starttime;
+} tw_collect_t;
+
+
+/******************************************************************************
+ *                                                                            *
+ *                             Utility functions                              *
+ *                                                                            *
+ ******************************************************************************/
+
+static size_t id_hasher (const void *key)
+{
+    uint64_t k = (uint64_t)*(const int64_t *)key;
+    /* 64-bit finalizer of MurmurHash3: job ids are mostly sequential */
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return (size_t)k;
+}
+
+static int id_comparator (const void *key1, const void *key2)
+{
+    int64_t k1 = *(const int64_t *)key1;
+    int64_t k2 = *(const int64_t *)key2;
+    return (k1 < k2)? -1 : (k1 > k2)? 1 : 0;
+}
+
+static void window_destructor (void **item)
+{
+    if (item) {
+        free (*item);
+        *item = NULL;
+    }
+}
+
+static inline int64_t window_subtree_end (window_t *w)
+{
+    int64_t end = w->endtime;
+    window_t *c = NULL;
+    if (w->rb.rb_left) {
+        c = rb_entry (w->rb.rb_left, window_t, rb);
+        if (c->subtree_end > end)
+            end = c->subtree_end;
+    }
+    if (w->rb.rb_right) {
+        c = rb_entry (w->rb.rb_right, window_t, rb);
+        if (c->subtree_end > end)
+            end = c->subtree_end;
+    }
+    return end;
+}
+
+RB_DECLARE_CALLBACKS (static, window_aug_cb, window_t, rb, int64_t,
+                      subtree_end, window_subtree_end)
+
+static void window_insert (twindow_t *tw, window_t *w)
+{
+    struct rb_node **link = &(tw->root.rb_node);
+    struct rb_node *parent = NULL;
+
+    w->subtree_end = w->endtime;
+    while (*link) {
+        window_t *this = rb_entry (*link, window_t, rb);
+        parent = *link;
+        if (this->subtree_end < w->endtime)
+            this->subtree_end = w->endtime;
+        if (w->starttime < this->starttime)
+            link = &((*link)->rb_left);
+        else
+            link = &((*link)->rb_right);
+    }
+    rb_link_node (&(w->rb), parent, link);
+    rb_insert_augmented (&(w->rb), &(tw->root), &window_aug_cb);
+}
+
+/* Interval search: if the left subtree has a window ending in time but
+ * none of its windows intersects [s, e], neither does the rest of the tree.
+ */
+static bool overlaps (struct rb_node *n, int64_t s, int64_t e)
+{
+    while (n) {
+        window_t *w = rb_entry (n, window_t, rb);
+        if (w->subtree_end < s)
+            return false;
+        if (n->rb_left
+            && rb_entry (n->rb_left, window_t, rb)->subtree_end >= s) {
+            n = n->rb_left;
+            continue;
+        }
+        if (w->starttime > e)
+            return false;
+        if (w->endtime >= s)
+            return true;
+        n = n->rb_right;
+    }
+    return false;
+}
+
+static void collect_add (tw_collect_t *c, window_t *w)
+{
+    if (c->n == c->alloc) {
+        c->alloc = c->alloc? c->alloc * 2 : 16;
+        if (!(c->starts = realloc (c->starts, c->alloc * sizeof (tw_event_t)))
+            || !(c->ends = realloc (c->ends, c->alloc * sizeof (tw_event_t))))
+            oom ();
+    }
+    c->starts[c->n].at = (w->starttime < c->starttime)? c->starttime
+                                                        : w->starttime;
+    c->starts[c->n].size = w->size;
+    c->ends[c->n].at = w->endtime;
+    c->ends[c->n].size = w->size;
+    c->n++;
+}
+
+/* Visit windows intersecting [s, e]; the starts come out sorted */
+static void collect (struct rb_node *n, int64_t s, int64_t e, tw_collect_t *c)
+{
+    window_t *w = NULL;
+    if (!n || (w = rb_entry (n, window_t, rb))->subtree_end < s)
+        return;
+    collect (n->rb_left, s, e, c);
+    if (w->starttime > e)
+        return;
+    if (w->endtime >= s)
+        collect_add (c, w);
+    collect (n->rb_right, s, e, c);
+}
+
+static int event_cmp (const void *a, const void *b)
+{
+    int64_t x = ((const tw_event_t *)a)->at;
+    int64_t y = ((const tw_event_t *)b)->at;
+    return (x < y)? -1 : (x > y)? 1 : 0;
+}
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                   API                                      *
+ *                                                                            *
+ ******************************************************************************/
+
+twindow_t *twindow_new (void)
+{
+    twindow_t *tw = xzmalloc (sizeof (*tw));
+    tw->root = RB_ROOT;
+    if (!(tw->index = zhashx_new ()))
+        oom ();
+    zhashx_set_key_hasher (tw->index, id_hasher);
+    zhashx_set_key_comparator (tw->index, id_comparator);
+    /* keys point into the windows they index */
+    zhashx_set_key_duplicator (tw->index, NULL);
+    zhashx_set_key_destructor (tw->index, NULL);
+    zhashx_set_destructor (tw->index, window_destructor);
+    return tw;
+}
+
+void twindow_destroy (twindow_t **tw_p)
+{
+    if (tw_p && *tw_p) {
+        zhashx_destroy (&((*tw_p)->index));
+        free (*tw_p);
+        *tw_p = NULL;
+    }
+}
+
+twindow_t *twindow_dup (twindow_t *tw)
+{
+    twindow_t *dup = twindow_new ();
+    struct rb_node *n = NULL;
+
+    if (tw) {
+        for (n = rb_first (&(tw->root)); n; n = rb_next (n)) {
+            window_t *w = rb_entry (n, window_t, rb);
+            twindow_add (dup, w->job_id, w->starttime, w->endtime, w->size);
+        }
+    }
+    return dup;
+}
+
+int twindow_add (twindow_t *tw, int64_t job_id, int64_t starttime,
+                 int64_t endtime, size_t size)
+{
+    window_t *w = NULL;
+
+    if (!tw || endtime < starttime) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((w = zhashx_lookup (tw->index, &job_id))) {
+        w->size += size;
+        return 0;
+    }
+    w = xzmalloc (sizeof (*w));
+    w->job_id = job_id;
+    w->starttime = starttime;
+    w->endtime = endtime;
+    w->size = size;
+    window_insert (tw, w);
+    zhashx_insert (tw->index, &(w->job_id), w);
+    return 0;
+}
+
+bool twindow_has (twindow_t *tw, int64_t job_id)
+{
+    return tw && zhashx_lookup (tw->index, &job_id) != NULL;
+}
+
+int twindow_remove (twindow_t *tw, int64_t job_id)
+{
+    window_t *w = NULL;
+
+    if (!tw || !(w = zhashx_lookup (tw->index, &job_id))) {
+        errno = ENOENT;
+        return -1;
+    }
+    rb_erase_augmented (&(w->rb), &(tw->root), &window_aug_cb);
+    zhashx_delete (tw->index, &job_id);
+    return 0;
+}
+
+size_t twindow_count (twindow_t *tw)
+{
+    return tw? zhashx_size (tw->index) : 0;
+}
+
+bool twindow_overlaps (twindow_t *tw, int64_t starttime, int64_t endtime)
+{
+    return tw && overlaps (tw->root.rb_node, starttime, endtime);
+}
+
+size_t twindow_max_used (twindow_t *tw, int64_t starttime, int64_t endtime)
+{
+    size_t i = 0;
+    size_t j = 0;
+    size_t used = 0;
+    size_t max = 0;
+    tw_collect_t c = {NULL, NULL, 0, 0, starttime};
+
+    if (!tw)
+        return 0;
+    collect (tw->root.rb_node, starttime, endtime, &c);
+    if (c.n == 0)
+        return 0;
+    /* Usage only rises at a start, so sweep the starts (already in
+     * order) and retire the windows ending strictly before each: windows
+     * are inclusive, so one ending at t still overlaps one starting at t.
+     */
+    qsort (c.ends, c.n, sizeof (tw_event_t), event_cmp);
+    for (i = 0; i < c.n; i++) {
+        while (j < c.n && c.ends[j].at < c.starts[i].at)
+            used -= c.ends[j++].size;
+        used += c.starts[i].size;
+        if (used > max)
+            max = used;
+    }
+    free (c.starts);
+    free (c.ends);
+    return max;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,63 @@
+#ifndef FLUX_RESRC_TWINDOW_H
+#define FLUX_RESRC_TWINDOW_H
+
+/*
+ *  Per-resource time windows of allocations and reservations,
+ *  kept in an interval tree keyed by integer job id
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct twindow twindow_t;
+
+twindow_t *twindow_new (void);
+void twindow_destroy (twindow_t **tw_p);
+
+/*
+ * Return a copy of tw holding the same windows
+ */
+twindow_t *twindow_dup (twindow_t *tw);
+
+/*
+ * Add size units for job_id over the inclusive window [starttime, endtime].
+ * If job_id already has a window, its size is increased and its times
+ * are left unchanged.  Returns 0 on success, -1 with errno on error.
+ */
+int twindow_add (twindow_t *tw, int64_t job_id, int64_t starttime,
+                 int64_t endtime, size_t size);
+
+/*
+ * Return true if job_id has a window
+ */
+bool twindow_has (twindow_t *tw, int64_t job_id);
+
+/*
+ * Remove the window of job_id.  Returns 0 on success, -1 with errno
+ * set to ENOENT if job_id has no window.
+ */
+int twindow_remove (twindow_t *tw, int64_t job_id);
+
+/*
+ * Return the number of windows
+ */
+size_t twindow_count (twindow_t *tw);
+
+/*
+ * Return true if any window intersects [starttime, endtime]
+ */
+bool twindow_overlaps (twindow_t *tw, int64_t starttime, int64_t endtime);
+
+/*
+ * Return the peak number of units used at any instant of
+ * [starttime, endtime].  Runs in O(log n + k log k) where k is the
+ * number of intersecting windows.
+ */
+size_t twindow_max_used (twindow_t *tw, int64_t starttime, int64_t endtime);
+
+#endif /* !FLUX_RESRC_TWINDOW_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,292 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+/*
+ * flux-sim-bench.c - benchmark report of a simulated trace replay
+ *
+ * The sched module, loaded with in-sim=true, samples its queue lengths
+ * and the wall time of its passes and plugin callbacks at every trigger
+ * of the simulator.  Once sim, submit and sim_exec have replayed a job
+ * trace, this command fetches those samples with the phase latencies
+ * from sched.stats and writes them as one JSON report.
+ *
+ * By default the sched module adds its own run time at every trigger to
+ * the simulated time, which then differs from one replay to the next.
+ * Load it with sim-charge=false as well to benchmark: simulated times
+ * only follow the trace, and stay in the report without wall times.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <czmq.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/shortjansson.h"
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/xzmalloc.h"
+#include "schedstats.h"
+
+#define OPTIONS "+ho:Tr"
+static const struct option longopts[] = {
+    {"help",          no_argument,        0, 'h'},
+    {"output",        required_argument,  0, 'o'},
+    {"no-timing",     no_argument,        0, 'T'},
+    {"reset",         no_argument,        0, 'r'},
+    { 0, 0, 0, 0 },
+};
+
+static void usage (void)
+{
+    fprintf (stderr,
+"Usage: flux-sim-bench [OPTIONS]\n"
+" Write a JSON benchmark report of the job trace the simulator replayed\n"
+" through the sched module: queue lengths, passes and wall times per\n"
+" trigger, and the number of calls of each plugin callback.\n"
+" The OPTIONS are:\n"
+"  -h, --help                    Display this message\n"
+"  -o, --output=path             Write the report to path (default: stdout)\n"
+"  -T, --no-timing               Leave the wall times out of the report so\n"
+"                                    that it is deterministic; simulated\n"
+"                                    times go as well unless sched was\n"
+"                                    loaded with sim-charge=false, since\n"
+"                                    they include the scheduler's run time\n"
+"  -r, --reset                   Clear the statistics once fetched\n"
+);
+    exit (1);
+}
+
+/* The plugin callback phases, whose time is split out of the passes */
+static const schedstats_phase_t plugin_phases[] = {
+    SCHEDSTATS_LOOP_SETUP,
+    SCHEDSTATS_FIND,
+    SCHEDSTATS_SELECT,
+    SCHEDSTATS_ALLOCATE,
+    SCHEDSTATS_RESERVE,
+};
+
+static int64_t phase_count (json_t *stats, schedstats_phase_t p)
+{
+    json_t *phase = NULL;
+    int64_t count = 0;
+
+    if (Jget_obj (stats, schedstats_phase_name (p), &phase))
+        Jget_int64 (phase, "count", &count);
+    return count;
+}
+
+/* Return a new report from the sched.stats response */
+static json_t *bench_report (json_t *stats, json_t *samples, bool timing,
+                             bool sim_charge)
+{
+    json_t *o = Jnew ();
+    json_t *calls = Jnew ();
+    json_t *queues = Jnew ();
+    json_t *triggers = Jnew_ar ();
+    json_t *tm = NULL;
+    json_t *phases = NULL;
+    json_t *s = NULL;
+    json_t *t = NULL;
+    int64_t v = 0;
+    int64_t passes = 0;
+    int64_t pending_max = 0;
+    int64_t pending_total = 0;
+    int64_t running_max = 0;
+    int64_t ns = 0;
+    int64_t max_ns = 0;
+    int64_t sched_ns = 0;
+    int64_t plugin_ns = 0;
+    double now = 0.;
+    int n = 0;
+    int i;
+    size_t k;
+
+    Jget_ar_len (samples, &n);
+    for (i = 0; i < n; i++) {
+        if (!Jget_ar_obj (samples, i, &s))
+            continue;
+        t = Jnew ();
+        if (Jget_int64 (s, "pending", &v)) {
+            Jadd_int64 (t, "pending", v);
+            pending_total += v;
+            if (v > pending_max)
+                pending_max = v;
+        }
+        if (Jget_int64 (s, "running", &v)) {
+            Jadd_int64 (t, "running", v);
+            if (v > running_max)
+                running_max = v;
+        }
+        if (Jget_int64 (s, "passes", &v)) {
+            Jadd_int64 (t, "passes", v);
+            passes += v;
+        }
+        if ((timing || !sim_charge) && Jget_double (s, "time", &now))
+            Jadd_double (t, "time", now);
+        if (timing) {
+            if (Jget_int64 (s, "ns", &v)) {
+                Jadd_int64 (t, "ns", v);
+                ns += v;
+                if (v > max_ns)
+                    max_ns = v;
+            }
+            if (Jget_int64 (s, "sched_ns", &v)) {
+                Jadd_int64 (t, "sched_ns", v);
+                sched_ns += v;
+            }
+            if (Jget_int64 (s, "plugin_ns", &v)) {
+                Jadd_int64 (t, "plugin_ns", v);
+                plugin_ns += v;
+            }
+        }
+        Jadd_ar_obj (triggers, t);
+        Jput (t);
+    }
+    Jadd_int64 (o, "passes", passes);
+
+    /* the number of callbacks, unlike their latencies, is deterministic */
+    for (k = 0; k < sizeof (plugin_phases) / sizeof (plugin_phases[0]); k++)
+        Jadd_int64 (calls, schedstats_phase_name (plugin_phases[k]),
+                    phase_count (stats, plugin_phases[k]));
+    Jadd_obj (o, "plugin_calls", calls);
+
+    Jadd_int64 (queues, "pending_max", pending_max);
+    Jadd_double (queues, "pending_mean",
+                 n ? (double)pending_total / n : 0.);
+    Jadd_int64 (queues, "running_max", running_max);
+    Jadd_obj (o, "queues", queues);
+
+    if (timing) {
+        tm = Jnew ();
+        Jadd_int64 (tm, "total_ns", ns);
+        Jadd_int64 (tm, "trigger_max_ns", max_ns);
+        Jadd_int64 (tm, "trigger_mean_ns", n ? ns / n : 0);
+        Jadd_int64 (tm, "schedule_jobs_ns", sched_ns);
+        Jadd_int64 (tm, "plugin_ns", plugin_ns);
+        Jadd_int64 (tm, "schedule_jobs_self_ns", sched_ns - plugin_ns);
+        phases = json_deep_copy (stats);
+        json_object_del (phases, "triggers");
+        json_object_del (phases, "sim_charge");
+        Jadd_obj (tm, "phases", phases);
+        Jput (phases);
+        Jadd_obj (o, "timing", tm);
+        Jput (tm);
+    }
+    Jadd_obj (o, "triggers", triggers);
+
+    Jput (triggers);
+    Jput (queues);
+    Jput (calls);
+    return o;
+}
+
+int main (int argc, char *argv[])
+{
+    flux_t *h = NULL;
+    flux_future_t *f = NULL;
+    json_t *stats = NULL;
+    json_t *samples = NULL;
+    json_t *o = NULL;
+    char *output = NULL;
+    char *s = NULL;
+    bool timing = true;
+    bool reset = false;
+    bool sim_charge = true;
+    FILE *fp = stdout;
+    int ch = 0;
+    int rc = 1;
+
+    log_init ("flux-sim-bench");
+    while ((ch = getopt_long (argc, argv, OPTIONS, longopts, NULL)) != -1) {
+        switch (ch) {
+            case 'h': /* --help */
+                usage ();
+                break;
+            case 'o': /* --output */
+                output = optarg;
+                break;
+            case 'T': /* --no-timing */
+                timing = false;
+                break;
+            case 'r': /* --reset */
+                reset = true;
+                break;
+            default:
+                usage ();
+                break;
+        }
+    }
+    if (optind != argc)
+        usage ();
+    if (!(h = flux_open (NULL, 0)))
+        log_err_exit ("flux_open");
+
+    if (!(f = flux_rpc_pack (h, "sched.stats", FLUX_NODEID_ANY, 0,
+                             "{s:b s:b}", "reset", reset,
+                             "triggers", true))
+        || flux_rpc_get_unpack (f, "o", &stats) < 0) {
+        log_err ("sched.stats");
+        goto done;
+    }
+    if (!Jget_obj (stats, "triggers", &samples)) {
+        log_msg ("sched.stats: no trigger samples, is sched in-sim?");
+        goto done;
+    }
+    Jget_bool (stats, "sim_charge", &sim_charge);
+    o = bench_report (stats, samples, timing, sim_charge);
+    if (!(s = json_dumps (o, JSON_SORT_KEYS | JSON_INDENT (2)))) {
+        log_msg ("failed to encode the benchmark report");
+        goto done;
+    }
+    if (output && !(fp = fopen (output, "w"))) {
+        log_err ("failed to open %s", output);
+        goto done;
+    }
+    if (fprintf (fp, "%s\n", s) < 0) {
+        log_err ("failed to write the benchmark report");
+        goto done;
+    }
+    rc = 0;
+done:
+    if (fp && fp != stdout && fclose (fp) != 0) {
+        log_err ("failed to close %s", output);
+        rc = 1;
+    }
+    free (s);
+    Jput (o);
+    flux_future_destroy (f);
+    flux_close (h);
+    log_fini ();
+    return rc;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,617 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+
+/*
+ * flux-sim-replay.c - replay a job trace against a sched plugin in-process
+ *
+ * The simulator modules (sim, submit, sim_exec) drive the sched module
+ * through the broker, with messages and kvs updates for every job event.
+ * This driver instead loads the behavior plugin, the resrc tree and the
+ * job queues into one process, runs the sched module's own scheduling
+ * pass (schedpass.c) on them and advances a simulated clock over an
+ * in-memory event queue: trace submits, and job completions kept in a
+ * binary heap ordered by end time.  No broker is needed; plugin log
+ * messages go to stderr.
+ *
+ * Jobs are pulled from the trace as the clock reaches their submit time
+ * and reported and freed as they complete, so only the pending and the
+ * running jobs are held in memory.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <getopt.h>
+#include <errno.h>
+#include <argz.h>
+#include <inttypes.h>
+#include <czmq.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/log.h"
+#include "src/common/libutil/oom.h"
+#include "src/common/libutil/xzmalloc.h"
+#include "src/common/libutil/shortjansson.h"
+#include "resrc.h"
+#include "resrc_tree.h"
+#include "rsreader.h"
+#include "jobqueue.h"
+#include "scheduler.h"
+#include "plugin.h"
+#include "schedstats.h"
+#include "schedpass.h"
+#include "../simulator/simulator.h"
+
+typedef struct {
+    flux_lwj_t lwj;
+    flux_res_t req;
+    int trace_id;            /* JobID column of the trace */
+    double submit;           /* submit time from the trace */
+    double runtime;          /* seconds the job runs once started */
+    double start;            /* simulated start time, -1 until started */
+    double end;              /* simulated end time */
+} rjob_t;
+
+typedef struct {
+    resrc_api_ctx_t *rsapi;
+    struct sched_plugin_loader *loader;
+    struct behavior_plugin *plugin;
+    struct priority_plugin *priority_plugin;
+    jobqueue_t *jobs;
+    schedpass_t *pass;       /* the sched module's scheduling pass */
+    job_trace_t *trace;      /* jobs not submitted yet */
+    bool node_excl;
+    size_t njobs;            /* jobs submitted so far */
+    rjob_t **running;        /* completion heap ordered by (end, jobid) */
+    size_t nrunning;
+    size_t maxrunning;
+    zlist_t *started;        /* jobs started by the current pass */
+    double now;
+    size_t npasses;
+    schedstats_t *stats;     /* latencies of the scheduling phases */
+    FILE *out;               /* report, one line per completed job */
+    double first_submit;
+    double last_end;
+    double *waits;           /* wait times of the completed jobs */
+    size_t nwaits;
+    size_t maxwaits;
+} replay_t;
+
+/* plugin.c answers sched.insmod through the broker's sched module, which
+ * is not here: the replay's own parameters stand in.
+ */
+static sched_params_t replay_params = {
+    .queue_depth = SCHED_PARAM_Q_DEPTH_DEFAULT,
+    .delay_sched = SCHED_PARAM_DELAY_DEFAULT,
+};
+
+const sched_params_t *sched_params_get (flux_t *h)
+{
+    return &replay_params;
+}
+
+#define OPTIONS "+hr:p:o:P:O:q:n:x"
+static const struct option longopts[] = {
+    {"help",          no_argument,        0, 'h'},
+    {"rdl-conf",      required_argument,  0, 'r'},
+    {"plugin",        required_argument,  0, 'p'},
+    {"plugin-opts",   required_argument,  0, 'o'},
+    {"priority-plugin", required_argument, 0, 'P'},
+    {"priority-opts", required_argument,  0, 'O'},
+    {"queue-depth",   required_argument,  0, 'q'},
+    {"num-jobs",      required_argument,  0, 'n'},
+    {"node-excl",     no_argument,        0, 'x'},
+    { 0, 0, 0, 0 },
+};
+
+static void usage (void)
+{
+    fprintf (stderr,
+"Usage: flux-sim-replay [OPTIONS] job-trace.csv\n"
+" Replay a job trace against a scheduler plugin without a Flux instance\n"
+" and print each job's start and end times followed by wait-time\n"
+" statistics.\n"
+" The OPTIONS are:\n"
+"  -h, --help                    Display this message\n"
+"  -r, --rdl-conf=path           RDL file describing the resources\n"
+"  -p, --plugin=name             Scheduler plugin (default: sched.fcfs)\n"
+"  -o, --plugin-opts=opts        Comma-separated options for the plugin\n"
+"  -P, --priority-plugin=name    Priority plugin (default: none)\n"
+"  -O, --priority-opts=opts      Comma-separated options for the priority\n"
+"                                    plugin\n"
+"  -q, --queue-depth=N           Max jobs to consider per scheduling pass\n"
+"                                    (default: %d)\n"
+"  -n, --num-jobs=N              Replay only the first N jobs of the trace\n"
+"  -x, --node-excl               Give jobs exclusive use of their nodes\n",
+    SCHED_PARAM_Q_DEPTH_DEFAULT);
+    exit (1);
+}
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            Completion Heap                                 *
+ *                                                                            *
+ ******************************************************************************/
+
+static inline bool rjob_before (const rjob_t *a, const rjob_t *b)
+{
+    if (a->end != b->end)
+        return a->end < b->end;
+    return a->lwj.lwj_id < b->lwj.lwj_id;
+}
+
+static void running_push (replay_t *r, rjob_t *rj)
+{
+    size_t pos;
+
+    if (r->nrunning == r->maxrunning) {
+        r->maxrunning = r->maxrunning ? 2 * r->maxrunning : 64;
+        r->running = xrealloc (r->running,
+                               sizeof (rjob_t *) * r->maxrunning);
+    }
+    pos = r->nrunning++;
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!rjob_before (rj, r->running[parent]))
+            break;
+        r->running[pos] = r->running[parent];
+        pos = parent;
+    }
+    r->running[pos] = rj;
+}
+
+static rjob_t *running_pop (replay_t *r)
+{
+    rjob_t *top = r->running[0];
+    rjob_t *last = r->running[--r->nrunning];
+    size_t pos = 0;
+    size_t child;
+
+    while ((child = 2 * pos + 1) < r->nrunning) {
+        if (child + 1 < r->nrunning
+            && rjob_before (r->running[child + 1], r->running[child]))
+            child++;
+        if (!rjob_before (r->running[child], last))
+            break;
+        r->running[pos] = r->running[child];
+        pos = child;
+    }
+    if (r->nrunning > 0)
+        r->running[pos] = last;
+    return top;
+}
+
+
+/******************************************************************************
+ *                                                                            *
+ *                              Trace Loading                                 *
+ *                                                                            *
+ ******************************************************************************/
+
+/* Turn the next job of the trace into a replay job.  As with the submit
+ * module, jobs get ids in order of submission; the request mirrors what
+ * it asks for.  Returns NULL if the job is skipped or the trace is
+ * exhausted.
+ */
+static rjob_t *next_job (replay_t *r)
+{
+    job_t *job = NULL;
+    rjob_t *rj = NULL;
+
+    if (!(job = job_trace_next (r->trace)))
+        return NULL;
+    if (job->nnodes <= 0 && job->ncpus <= 0) {
+        log_msg ("trace job %d requests no resources: skipped", job->id);
+        free_job (job);
+        return NULL;
+    }
+    rj = xzmalloc (sizeof (*rj));
+    rj->lwj.lwj_id = (int64_t)++r->njobs;
+    rj->lwj.state = J_SCHEDREQ;
+    rj->lwj.req = &rj->req;
+    rj->lwj.submittime = (int64_t)job->submit_time;
+    if (job->user)
+        rj->lwj.user = xstrdup (job->user);
+    if (job->account)
+        rj->lwj.account = xstrdup (job->account);
+    rj->req.nnodes = (uint64_t)job->nnodes;
+    rj->req.ncores = (uint64_t)job->ncpus;
+    rj->req.ngpus = (uint64_t)job->ngpus;
+    rj->req.walltime = (job->time_limit > 0) ?
+        (uint64_t)job->time_limit : (uint64_t)3600;
+    rj->req.node_exclusive = r->node_excl;
+    rj->trace_id = job->id;
+    rj->submit = job->submit_time;
+    rj->runtime = job->execution_time;
+    rj->start = -1.;
+    free_job (job);
+    if (r->njobs == 1)
+        r->first_submit = r->last_end = rj->submit;
+    return rj;
+}
+
+static void rjob_destroy (replay_t *r, rjob_t *rj)
+{
+    if (rj->lwj.resrc_tree)
+        resrc_tree_destroy (r->rsapi, rj->lwj.resrc_tree, false, false);
+    free (rj->lwj.user);
+    free (rj->lwj.account);
+    free (rj);
+}
+
+
+/******************************************************************************
+ *                                                                            *
+ *                            Scheduling Loop                                 *
+ *                                                                            *
+ ******************************************************************************/
+
+/* A pass allocated resources to a job: it starts now.  The queue is
+ * being walked by the pass, so the job is only moved to the running
+ * queue once the pass is over.
+ */
+static int alloc_cb (flux_lwj_t *job, void *arg)
+{
+    replay_t *r = arg;
+
+    job->state = J_RUNNING;
+    zlist_append (r->started, (rjob_t *)job);
+    return 0;
+}
+
+/* One scheduling pass, the very one the sched module makes, followed by
+ * the start of the jobs it allocated resources to.
+ */
+static int schedule_jobs (replay_t *r)
+{
+    rjob_t *rj = NULL;
+    uint64_t t0 = 0;
+    int rc;
+
+    rc = schedpass_run (r->pass, (int64_t)r->now, replay_params.queue_depth);
+    while ((rj = zlist_pop (r->started))) {
+        t0 = schedstats_now ();
+        jobqueue_move (r->jobs, &rj->lwj, JOBQ_RUNNING);
+        schedstats_record (r->stats, SCHEDSTATS_QUEUE_MOVE, t0);
+        rj->start = r->now;
+        rj->end = r->now + rj->runtime;
+        running_push (r, rj);
+    }
+    r->npasses++;
+    return rc;
+}
+
+static void report_job (replay_t *r, rjob_t *rj);
+
+static void complete_job (replay_t *r, rjob_t *rj)
+{
+    flux_lwj_t *job = &rj->lwj;
+
+    if (resrc_tree_release (job->resrc_tree, job->lwj_id))
+        log_msg ("failed to release resources for job %"PRId64"",
+                 job->lwj_id);
+    /* usage is charged up to the end time */
+    job->endtime = (int64_t)rj->end;
+    job->state = J_COMPLETE;
+    if (r->plugin->job_end)
+        r->plugin->job_end (job);
+    if (r->priority_plugin)
+        r->priority_plugin->record_job_usage (NULL, job);
+    resrc_tree_destroy (r->rsapi, job->resrc_tree, false, false);
+    job->resrc_tree = NULL;
+    jobqueue_remove (r->jobs, job);
+    schedpass_rs_released (r->pass);
+    report_job (r, rj);
+    rjob_destroy (r, rj);
+}
+
+/* Advance the clock from event to event: completions due at that time
+ * free their resources first, then the jobs submitted at that time are
+ * queued, and a scheduling pass follows.  Jobs left pending once nothing
+ * runs and nothing remains to be submitted can never be scheduled.
+ */
+static int replay_run (replay_t *r)
+{
+    rjob_t *rj = NULL;
+    double submit;
+    uint64_t t0 = 0;
+
+    while ((submit = job_trace_next_submit_time (r->trace)) >= 0.
+           || r->nrunning > 0) {
+        if (r->nrunning > 0 && (submit < 0.
+                                || r->running[0]->end <= submit))
+            r->now = r->running[0]->end;
+        else
+            r->now = submit;
+        while (r->nrunning > 0 && r->running[0]->end <= r->now)
+            complete_job (r, running_pop (r));
+        while ((submit = job_trace_next_submit_time (r->trace)) >= 0.
+               && submit <= r->now) {
+            if (!(rj = next_job (r)))
+                continue;
+            t0 = schedstats_now ();
+            if (jobqueue_pending_add (r->jobs, &rj->lwj) < 0) {
+                log_err ("failed to queue job %"PRId64"", rj->lwj.lwj_id);
+                rjob_destroy (r, rj);
+                return -1;
+            }
+            schedstats_record (r->stats, SCHEDSTATS_QUEUE_ADD, t0);
+        }
+        if (schedule_jobs (r) < 0) {
+            log_msg ("scheduling pass at %.3f failed", r->now);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                 Report                                     *
+ *                                                                            *
+ ******************************************************************************/
+
+static int cmp_double (const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of the sorted values v[0..n-1] */
+static double percentile (const double *v, size_t n, size_t pct)
+{
+    size_t rank = (pct * n + 99) / 100;
+    if (rank < 1)
+        rank = 1;
+    return v[rank - 1];
+}
+
+static void report_header (replay_t *r)
+{
+    fprintf (r->out, "jobid,trace_jobid,submit,start,end,wait\n");
+}
+
+/* Print the line of a completed job and keep its wait time for the
+ * summary.
+ */
+static void report_job (replay_t *r, rjob_t *rj)
+{
+    double wait = rj->start - rj->submit;
+
+    fprintf (r->out, "%"PRId64",%d,%.3f,%.3f,%.3f,%.3f\n", rj->lwj.lwj_id,
+             rj->trace_id, rj->submit, rj->start, rj->end, wait);
+    if (r->nwaits == r->maxwaits) {
+        r->maxwaits = r->maxwaits ? 2 * r->maxwaits : 64;
+        r->waits = xrealloc (r->waits, sizeof (double) * r->maxwaits);
+    }
+    r->waits[r->nwaits++] = wait;
+    if (rj->end > r->last_end)
+        r->last_end = rj->end;
+}
+
+/* Jobs still pending once the replay is over were never scheduled */
+static void report_summary (replay_t *r)
+{
+    size_t n = r->nwaits;
+    double total = 0.;
+    size_t i;
+
+    fprintf (r->out, "# jobs: %zu\n", r->njobs);
+    fprintf (r->out, "# unscheduled: %zu\n",
+             jobqueue_size (r->jobs, JOBQ_PENDING));
+    fprintf (r->out, "# passes: %zu\n", r->npasses);
+    fprintf (r->out, "# tries: %zu\n",
+             schedstats_count (r->stats, SCHEDSTATS_FIND));
+    fprintf (r->out, "# makespan: %.3f\n", r->last_end - r->first_submit);
+    if (n > 0) {
+        for (i = 0; i < n; i++)
+            total += r->waits[i];
+        qsort (r->waits, n, sizeof (double), cmp_double);
+        fprintf (r->out, "# wait-mean: %.3f\n", total / n);
+        fprintf (r->out, "# wait-median: %.3f\n",
+                 percentile (r->waits, n, 50));
+        fprintf (r->out, "# wait-p95: %.3f\n", percentile (r->waits, n, 95));
+        fprintf (r->out, "# wait-max: %.3f\n", r->waits[n - 1]);
+    }
+}
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                   Main                                     *
+ *                                                                            *
+ ******************************************************************************/
+
+static int load_plugin (replay_t *r, const char *name, char *opts)
+{
+    struct sched_prop prop;
+    char *argz = NULL;
+    size_t argz_len = 0;
+    int rc = -1;
+
+    if (sched_plugin_load (r->loader, name) < 0
+        || !(r->plugin = behavior_plugin_get (r->loader))) {
+        log_msg ("failed to load %s", name);
+        goto done;
+    }
+    if (opts)
+        argz_create_sep (opts, ',', &argz, &argz_len);
+    if (r->plugin->process_args (NULL, argz, argz_len, &replay_params) < 0) {
+        log_msg ("failed to process args for %s", name);
+        goto done;
+    }
+    memset (&prop, 0, sizeof (prop));
+    if (r->plugin->get_sched_properties (NULL, &prop) < 0) {
+        log_msg ("failed to fetch sched plugin properties for %s", name);
+        goto done;
+    }
+    schedpass_set_props (r->pass, &prop);
+    rc = 0;
+done:
+    free (argz);
+    return rc;
+}
+
+/* The priority plugin reads its associations file from the working
+ * directory, as it does under the sched module.
+ */
+static int load_priority_plugin (replay_t *r, const char *name, char *opts)
+{
+    char *argz = NULL;
+    size_t argz_len = 0;
+    int rc = -1;
+
+    if (sched_plugin_load (r->loader, name) < 0
+        || !(r->priority_plugin = priority_plugin_get (r->loader))) {
+        log_msg ("failed to load %s", name);
+        goto done;
+    }
+    if (opts)
+        argz_create_sep (opts, ',', &argz, &argz_len);
+    if (r->priority_plugin->priority_setup (NULL, argz, argz_len) < 0) {
+        log_msg ("failed to setup priority plugin %s", name);
+        goto done;
+    }
+    rc = 0;
+done:
+    free (argz);
+    return rc;
+}
+
+int main (int argc, char *argv[])
+{
+    replay_t r;
+    int ch = 0;
+    char *rdl = NULL;
+    char *plugin = "sched.fcfs";
+    char *plugin_opts = NULL;
+    char *prio_plugin = NULL;
+    char *prio_opts = NULL;
+    int num_jobs = INT_MAX;
+    bool node_excl = false;
+    flux_lwj_t *job = NULL;
+    int rc = 1;
+
+    log_init ("flux-sim-replay");
+    while ((ch = getopt_long (argc, argv, OPTIONS, longopts, NULL)) != -1) {
+        switch (ch) {
+            case 'h': /* --help */
+                usage ();
+                break;
+            case 'r': /* --rdl-conf */
+                rdl = optarg;
+                break;
+            case 'p': /* --plugin */
+                plugin = optarg;
+                break;
+            case 'o': /* --plugin-opts */
+                plugin_opts = optarg;
+                break;
+            case 'P': /* --priority-plugin */
+                prio_plugin = optarg;
+                break;
+            case 'O': /* --priority-opts */
+                prio_opts = optarg;
+                break;
+            case 'q': /* --queue-depth */
+                replay_params.queue_depth = strtol (optarg, NULL, 10);
+                if (replay_params.queue_depth <= 0)
+                    log_msg_exit ("queue depth must be a positive number");
+                break;
+            case 'n': /* --num-jobs */
+                num_jobs = strtol (optarg, NULL, 10);
+                if (num_jobs <= 0)
+                    log_msg_exit ("number of jobs must be a positive number");
+                break;
+            case 'x': /* --node-excl */
+                node_excl = true;
+                break;
+            default:
+                usage ();
+                break;
+        }
+    }
+    if (optind != argc - 1 || !rdl)
+        usage ();
+
+    memset (&r, 0, sizeof (r));
+    r.out = stdout;
+    r.node_excl = node_excl;
+    if (!(r.jobs = jobqueue_new ()) || !(r.started = zlist_new ())
+        || !(r.stats = schedstats_new ()))
+        oom ();
+    if (!(r.rsapi = resrc_api_init ()))
+        log_msg_exit ("failed to initialize the resrc api");
+    if (rsreader_resrc_bulkload (r.rsapi, rdl, NULL) != 0)
+        log_msg_exit ("failed to load resources from %s", rdl);
+    if (!(r.loader = sched_plugin_loader_create (NULL)))
+        log_msg_exit ("failed to initialize the plugin loader");
+    if (!(r.pass = schedpass_new (NULL, r.rsapi, r.loader, r.jobs, r.stats,
+                                  alloc_cb, &r)))
+        log_msg_exit ("failed to initialize the scheduling pass");
+    if (load_plugin (&r, plugin, plugin_opts) < 0)
+        goto done;
+    if (prio_plugin && load_priority_plugin (&r, prio_plugin, prio_opts) < 0)
+        goto done;
+    if (!(r.trace = job_trace_open (NULL, argv[optind], num_jobs))) {
+        log_msg ("failed to read job trace %s", argv[optind]);
+        goto done;
+    }
+    report_header (&r);
+    if (replay_run (&r) < 0)
+        goto done;
+    report_summary (&r);
+    rc = 0;
+done:
+    while (r.nrunning > 0)
+        rjob_destroy (&r, running_pop (&r));
+    while ((job = jobqueue_first (r.jobs, JOBQ_PENDING))) {
+        jobqueue_remove (r.jobs, job);
+        rjob_destroy (&r, (rjob_t *)job);
+    }
+    job_trace_close (r.trace);
+    jobqueue_destroy (r.jobs);
+    zlist_destroy (&r.started);
+    schedstats_destroy (r.stats);
+    schedpass_destroy (r.pass);
+    sched_plugin_loader_destroy (r.loader);
+    resrc_api_fini (r.rsapi);
+    free (r.running);
+    free (r.waits);
+    log_fini ();
+    return rc;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,547 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+/*
+ * jobqueue.c - indexed pending/running/complete job queues
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <czmq.h>
+
+#include "src/common/librbtree/rbtree.h"
+#include "src/common/libutil/oom.h"
+#include "src/common/libutil/xzmalloc.h"
+#include "jobqueue.h"
+
+/* Per-job bookkeeping. The pending queue is a red-black tree keyed
+ * by (priority, seq) so that insertion and removal are O(log n) and
+ * the scheduling loop can walk the queue in order without sorting.
+ * The running and complete queues are intrusive doubly-linked lists;
+ * a pending job is on the fresh list instead until it is first updated,
+ * and then on the list of its priority association.
+ */
+typedef struct jobq_entry {
+    int64_t            id;       /* also the key of the job index */
+    flux_lwj_t        *job;
+    jobq_kind_t        kind;     /* queue this entry is linked into */
+    uint64_t           seq;      /* enqueue order: tie breaker */
+    double             prio;     /* priority this entry is keyed with */
+    struct rb_node     prio_rb;  /* node of the pending tree */
+    struct jobq_entry *prev;     /* running/complete/fresh list links */
+    struct jobq_entry *next;
+    bool               fresh;    /* on the fresh list */
+    struct jobq_assoc *assoc;    /* association list, if on one */
+    struct jobq_entry *aprev;    /* association list links */
+    struct jobq_entry *anext;
+} jobq_entry_t;
+
+typedef struct jobq_list {
+    jobq_entry_t      *head;
+    jobq_entry_t      *tail;
+    size_t             size;
+} jobq_list_t;
+
+/* Pending jobs that share a priority association handle */
+typedef struct jobq_assoc {
+    const void        *handle;   /* also the key of the association index */
+    jobq_entry_t      *head;
+    size_t             size;
+} jobq_assoc_t;
+
+struct jobqueue {
+    zhashx_t          *index;    /* int64 job id -> jobq_entry_t */
+    zhashx_t          *assocs;   /* association handle -> jobq_assoc_t */
+    struct rb_root     pending;
+    size_t             npending;
+    jobq_list_t        running;
+    jobq_list_t        complete;
+    jobq_list_t        fresh;    /* pending jobs not updated yet */
+    uint64_t           seq;
+    jobq_kind_t        cursor_kind;
+    jobq_entry_t      *cursor;
+};
+
+
+/******************************************************************************
+ *                                                                            *
+ *                             Utility functions                              *
+ *                                                                            *
+ ******************************************************************************/
+
+static size_t id_hasher (const void *key)
+{
+    uint64_t k = (uint64_t)*(const int64_t *)key;
+    /* 64-bit finalizer of MurmurHash3: job ids are mostly sequential */
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return (size_t)k;
+}
+
+static int id_comparator (const void *key1, const void *key2)
+{
+    int64_t k1 = *(const int64_t *)key1;
+    int64_t k2 = *(const int64_t *)key2;
+    return (k1 < k2)? -1 : (k1 > k2)? 1 : 0;
+}
+
+static size_t handle_hasher (const void *key)
+{
+    uint64_t k = (uint64_t)(uintptr_t)*(const void * const *)key;
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    return (size_t)k;
+}
+
+static int handle_comparator (const void *key1, const void *key2)
+{
+    uintptr_t k1 = (uintptr_t)*(const void * const *)key1;
+    uintptr_t k2 = (uintptr_t)*(const void * const *)key2;
+    return (k1 < k2)? -1 : (k1 > k2)? 1 : 0;
+}
+
+static void entry_destructor (void **item)
+{
+    if (item) {
+        free (*item);
+        *item = NULL;
+    }
+}
+
+/* Higher priority first; among equal priorities, earlier enqueue first */
+static inline bool entry_before (const jobq_entry_t *a, const jobq_entry_t *b)
+{
+    if (a->prio != b->prio)
+        return a->prio > b->prio;
+    return a->seq < b->seq;
+}
+
+static void pending_insert (jobqueue_t *q, jobq_entry_t *e)
+{
+    struct rb_node **link = &(q->pending.rb_node);
+    struct rb_node *parent = NULL;
+
+    e->prio = e->job->priority;
+    while (*link) {
+        jobq_entry_t *this = rb_entry (*link, jobq_entry_t, prio_rb);
+        parent = *link;
+        if (entry_before (e, this))
+            link = &((*link)->rb_left);
+        else
+            link = &((*link)->rb_right);
+    }
+    rb_link_node (&(e->prio_rb), parent, link);
+    rb_insert_color (&(e->prio_rb), &(q->pending));
+    q->npending++;
+}
+
+static void pending_erase (jobqueue_t *q, jobq_entry_t *e)
+{
+    rb_erase (&(e->prio_rb), &(q->pending));
+    RB_CLEAR_NODE (&(e->prio_rb));
+    q->npending--;
+}
+
+static void list_append (jobq_list_t *l, jobq_entry_t *e)
+{
+    e->next = NULL;
+    e->prev = l->tail;
+    if (l->tail)
+        l->tail->next = e;
+    else
+        l->head = e;
+    l->tail = e;
+    l->size++;
+}
+
+static void list_unlink (jobq_list_t *l, jobq_entry_t *e)
+{
+    if (e->prev)
+        e->prev->next = e->next;
+    else
+        l->head = e->next;
+    if (e->next)
+        e->next->prev = e->prev;
+    else
+        l->tail = e->prev;
+    e->prev = e->next = NULL;
+    l->size--;
+}
+
+static void assoc_link (jobqueue_t *q, jobq_entry_t *e, const void *handle)
+{
+    jobq_assoc_t *a = zhashx_lookup (q->assocs, &handle);
+
+    if (!a) {
+        a = xzmalloc (sizeof (*a));
+        a->handle = handle;
+        if (zhashx_insert (q->assocs, &(a->handle), a) != 0)
+            oom ();
+    }
+    e->aprev = NULL;
+    e->anext = a->head;
+    if (a->head)
+        a->head->aprev = e;
+    a->head = e;
+    a->size++;
+    e->assoc = a;
+}
+
+static void assoc_unlink (jobqueue_t *q, jobq_entry_t *e)
+{
+    jobq_assoc_t *a = e->assoc;
+
+    if (!a)
+        return;
+    if (e->aprev)
+        e->aprev->anext = e->anext;
+    else
+        a->head = e->anext;
+    if (e->anext)
+        e->anext->aprev = e->aprev;
+    e->aprev = e->anext = NULL;
+    e->assoc = NULL;
+    /* handles go stale as the plugin's associations come and go */
+    if (--a->size == 0)
+        zhashx_delete (q->assocs, &(a->handle));
+}
+
+static inline jobq_list_t *kind2list (jobqueue_t *q, jobq_kind_t kind)
+{
+    if (kind == JOBQ_RUNNING)
+        return &(q->running);
+    else if (kind == JOBQ_COMPLETE)
+        return &(q->complete);
+    return NULL;
+}
+
+static void entry_unlink (jobqueue_t *q, jobq_entry_t *e)
+{
+    if (q->cursor == e)
+        q->cursor = NULL;
+    if (e->kind == JOBQ_PENDING) {
+        pending_erase (q, e);
+        if (e->fresh)
+            list_unlink (&(q->fresh), e);
+        e->fresh = false;
+        assoc_unlink (q, e);
+    } else if (e->kind != JOBQ_NONE)
+        list_unlink (kind2list (q, e->kind), e);
+    e->kind = JOBQ_NONE;
+}
+
+static void entry_link (jobqueue_t *q, jobq_entry_t *e, jobq_kind_t to)
+{
+    if (to == JOBQ_PENDING) {
+        e->seq = q->seq++;
+        pending_insert (q, e);
+        list_append (&(q->fresh), e);
+        e->fresh = true;
+    } else if (to != JOBQ_NONE) {
+        list_append (kind2list (q, to), e);
+    }
+    e->kind = to;
+}
+
+static inline jobq_entry_t *entry_lookup (jobqueue_t *q, flux_lwj_t *job)
+{
+    jobq_entry_t *e = NULL;
+    if (!job || !(e = zhashx_lookup (q->index, &(job->lwj_id)))) {
+        errno = ENOENT;
+        return NULL;
+    }
+    return e;
+}
+
+
+/******************************************************************************
+ *                                                                            *
+ *                               Public API                                   *
+ *                                                                            *
+ ******************************************************************************/
+
+jobqueue_t *jobqueue_new (void)
+{
+    jobqueue_t *q = xzmalloc (sizeof (*q));
+    if (!(q->index = zhashx_new ()))
+        oom ();
+    zhashx_set_key_hasher (q->index, id_hasher);
+    zhashx_set_key_comparator (q->index, id_comparator);
+    /* keys point into the entries themselves: no key copies */
+    zhashx_set_key_duplicator (q->index, NULL);
+    zhashx_set_key_destructor (q->index, NULL);
+    zhashx_set_destructor (q->index, entry_destructor);
+    if (!(q->assocs = zhashx_new ()))
+        oom ();
+    zhashx_set_key_hasher (q->assocs, handle_hasher);
+    zhashx_set_key_comparator (q->assocs, handle_comparator);
+    /* keys point into the association lists themselves */
+    zhashx_set_key_duplicator (q->assocs, NULL);
+    zhashx_set_key_destructor (q->assocs, NULL);
+    zhashx_set_destructor (q->assocs, entry_destructor);
+    q->pending = RB_ROOT;
+    q->cursor_kind = JOBQ_NONE;
+    return q;
+}
+
+void jobqueue_destroy (jobqueue_t *q)
+{
+    if (q) {
+        zhashx_destroy (&(q->index));
+        zhashx_destroy (&(q->assocs));
+        free (q);
+    }
+}
+
+int jobqueue_pending_add (jobqueue_t *q, flux_lwj_t *job)
+{
+    jobq_entry_t *e = NULL;
+
+    if (zhashx_lookup (q->index, &(job->lwj_id))) {
+        errno = EEXIST;
+        return -1;
+    }
+    e = xzmalloc (sizeof (*e));
+    e->id = job->lwj_id;
+    e->job = job;
+    e->kind = JOBQ_NONE;
+    RB_CLEAR_NODE (&(e->prio_rb));
+    if (zhashx_insert (q->index, &(e->id), e) != 0) {
+        free (e);
+        errno = EEXIST;
+        return -1;
+    }
+    entry_link (q, e, JOBQ_PENDING);
+    job->enqueue_pos = (int64_t)q->npending;
+    return 0;
+}
+
+flux_lwj_t *jobqueue_find (jobqueue_t *q, int64_t id)
+{
+    jobq_entry_t *e = zhashx_lookup (q->index, &id);
+    return e? e->job : NULL;
+}
+
+int jobqueue_move (jobqueue_t *q, flux_lwj_t *job, jobq_kind_t to)
+{
+    jobq_entry_t *e = NULL;
+    if (!(e = entry_lookup (q, job)))
+        return -1;
+    entry_unlink (q, e);
+    entry_link (q, e, to);
+    return 0;
+}
+
+int jobqueue_remove (jobqueue_t *q, flux_lwj_t *job)
+{
+    jobq_entry_t *e = NULL;
+    if (!(e = entry_lookup (q, job)))
+        return -1;
+    entry_unlink (q, e);
+    /* the index destructor frees the entry */
+    zhashx_delete (q->index, &(e->id));
+    return 0;
+}
+
+jobq_kind_t jobqueue_kind (jobqueue_t *q, flux_lwj_t *job)
+{
+    jobq_entry_t *e = entry_lookup (q, job);
+    return e? e->kind : JOBQ_NONE;
+}
+
+size_t jobqueue_pending_reorder (jobqueue_t *q)
+{
+    size_t i = 0;
+    size_t n = 0;
+    struct rb_node *node = NULL;
+    jobq_entry_t **moved = NULL;
+
+    if (q->npending == 0)
+        return 0;
+    moved = xzmalloc (q->npending * sizeof (*moved));
+    for (node = rb_first (&(q->pending)); node; node = rb_next (node)) {
+        jobq_entry_t *e = rb_entry (node, jobq_entry_t, prio_rb);
+        if (e->prio != e->job->priority)
+            moved[n++] = e;
+    }
+    /* Keep the original enqueue order (seq) to remain FIFO among equals */
+    for (i = 0; i < n; i++)
+        pending_erase (q, moved[i]);
+    for (i = 0; i < n; i++)
+        pending_insert (q, moved[i]);
+    free (moved);
+    return n;
+}
+
+int jobqueue_pending_update (jobqueue_t *q, flux_lwj_t *job)
+{
+    jobq_entry_t *e = NULL;
+    if (!(e = entry_lookup (q, job)))
+        return -1;
+    if (e->kind != JOBQ_PENDING)
+        return 0;
+    if (e->fresh) {
+        list_unlink (&(q->fresh), e);
+        e->fresh = false;
+    }
+    if (!e->assoc || e->assoc->handle != job->prio_assoc) {
+        assoc_unlink (q, e);
+        if (job->prio_assoc)
+            assoc_link (q, e, job->prio_assoc);
+    }
+    if (e->prio == job->priority)
+        return 0;
+    pending_erase (q, e);
+    pending_insert (q, e);
+    return 1;
+}
+
+size_t jobqueue_pending_fresh (jobqueue_t *q, zlist_t *jobs)
+{
+    jobq_entry_t *e = NULL;
+
+    for (e = q->fresh.head; e; e = e->next)
+        if (zlist_append (jobs, e->job) < 0)
+            oom ();
+    return q->fresh.size;
+}
+
+size_t jobqueue_pending_assoc (jobqueue_t *q, const void *handle,
+                               zlist_t *jobs)
+{
+    jobq_assoc_t *a = NULL;
+    jobq_entry_t *e = NULL;
+
+    if (!handle || !(a = zhashx_lookup (q->assocs, &handle)))
+        return 0;
+    for (e = a->head; e; e = e->anext)
+        if (zlist_append (jobs, e->job) < 0)
+            oom ();
+    return a->size;
+}
+
+double jobqueue_pending_prio (jobqueue_t *q, flux_lwj_t *job)
+{
+    jobq_entry_t *e = entry_lookup (q, job);
+    if (!e || e->kind != JOBQ_PENDING)
+        return job? job->priority : 0.;
+    return e->prio;
+}
+
+bool jobqueue_pending_before (jobqueue_t *q, flux_lwj_t *a, double pa,
+                              flux_lwj_t *b, double pb)
+{
+    jobq_entry_t *ea = entry_lookup (q, a);
+    jobq_entry_t *eb = entry_lookup (q, b);
+    if (!ea || !eb)
+        return false;
+    if (pa != pb)
+        return pa > pb;
+    return ea->seq < eb->seq;
+}
+
+bool jobqueue_pending_drops_behind (jobqueue_t *q, flux_lwj_t *job)
+{
+    jobq_entry_t *e = entry_lookup (q, job);
+    jobq_entry_t *n = NULL;
+    struct rb_node *node = NULL;
+
+    if (!e || e->kind != JOBQ_PENDING || job->priority >= e->prio)
+        return false;
+    for (node = rb_next (&(e->prio_rb)); node; node = rb_next (node)) {
+        n = rb_entry (node, jobq_entry_t, prio_rb);
+        /* n comes after where job moves to: so do the ones behind it */
+        if (n->prio < job->priority
+            || (n->prio == job->priority && n->seq > e->seq))
+            break;
+        if (n->prio == n->job->priority)
+            return true;
+    }
+    return false;
+}
+
+flux_lwj_t *jobqueue_pending_last (jobqueue_t *q)
+{
+    struct rb_node *node = rb_last (&(q->pending));
+    return node? rb_entry (node, jobq_entry_t, prio_rb)->job : NULL;
+}
+
+flux_lwj_t *jobqueue_first (jobqueue_t *q, jobq_kind_t kind)
+{
+    struct rb_node *node = NULL;
+    jobq_list_t *l = NULL;
+
+    q->cursor_kind = kind;
+    q->cursor = NULL;
+    if (kind == JOBQ_PENDING) {
+        if ((node = rb_first (&(q->pending))))
+            q->cursor = rb_entry (node, jobq_entry_t, prio_rb);
+    } else if ((l = kind2list (q, kind))) {
+        q->cursor = l->head;
+    }
+    return q->cursor? q->cursor->job : NULL;
+}
+
+flux_lwj_t *jobqueue_next (jobqueue_t *q)
+{
+    struct rb_node *node = NULL;
+
+    if (!q->cursor)
+        return NULL;
+    if (q->cursor_kind == JOBQ_PENDING) {
+        node = rb_next (&(q->cursor->prio_rb));
+        q->cursor = node? rb_entry (node, jobq_entry_t, prio_rb) : NULL;
+    } else {
+        q->cursor = q->cursor->next;
+    }
+    return q->cursor? q->cursor->job : NULL;
+}
+
+size_t jobqueue_size (jobqueue_t *q, jobq_kind_t kind)
+{
+    jobq_list_t *l = NULL;
+    if (kind == JOBQ_PENDING)
+        return q->npending;
+    else if ((l = kind2list (q, kind)))
+        return l->size;
+    return 0;
+}
+
+size_t jobqueue_indexed (jobqueue_t *q)
+{
+    return zhashx_size (q->index);
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,144 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#ifndef JOBQUEUE_H
+#define JOBQUEUE_H 1
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <czmq.h>
+
+#include "scheduler.h"
+
+typedef struct jobqueue jobqueue_t;
+
+typedef enum {
+    JOBQ_NONE,               /* indexed, but not linked into any queue */
+    JOBQ_PENDING,            /* pending queue ordered by priority */
+    JOBQ_RUNNING,            /* running queue in arrival order */
+    JOBQ_COMPLETE            /* complete/cancelled queue in arrival order */
+} jobq_kind_t;
+
+/* Job queue c'tor/d'tor. The queue set keeps its own bookkeeping per job,
+ * but never owns the flux_lwj_t objects themselves: destroying the queue
+ * set or removing a job from it never frees the job.
+ */
+jobqueue_t *jobqueue_new (void);
+void jobqueue_destroy (jobqueue_t *q);
+
+/* Index job by its lwj_id and link it into the pending queue. The pending
+ * queue is ordered by decreasing job->priority and then by enqueue order.
+ * Sets job->enqueue_pos to the size of the pending queue after the insert.
+ * Returns 0 on success; -1 with errno set to EEXIST if a job with the
+ * same id is already indexed.
+ */
+int jobqueue_pending_add (jobqueue_t *q, flux_lwj_t *job);
+
+/* Look up an indexed job by id regardless of the queue it is linked into.
+ * Returns NULL if not found.
+ */
+flux_lwj_t *jobqueue_find (jobqueue_t *q, int64_t id);
+
+/* Unlink job from whichever queue it is in and link it into 'to'.
+ * JOBQ_NONE only unlinks the job and leaves it indexed.
+ * Returns 0 on success; -1 with errno set to ENOENT if job is not indexed.
+ */
+int jobqueue_move (jobqueue_t *q, flux_lwj_t *job, jobq_kind_t to);
+
+/* Unlink job from its queue and drop it from the index.
+ * Returns 0 on success; -1 with errno set to ENOENT if job is not indexed.
+ */
+int jobqueue_remove (jobqueue_t *q, flux_lwj_t *job);
+
+/* Return the queue job is currently linked into */
+jobq_kind_t jobqueue_kind (jobqueue_t *q, flux_lwj_t *job);
+
+/* Re-sort the pending queue after job->priority has been modified in place
+ * (e.g., by a priority plugin). Only the jobs whose priority actually
+ * changed are repositioned. Returns the number of repositioned jobs.
+ */
+size_t jobqueue_pending_reorder (jobqueue_t *q);
+
+/* Reposition a single pending job after job->priority has been modified
+ * in place, in O(log n) and keeping its enqueue order among equals.
+ * The job is also taken off the fresh list and filed under its priority
+ * association handle, job->prio_assoc.
+ * Returns 1 if the job was repositioned, 0 if it is not pending or its
+ * priority is unchanged; -1 with errno set to ENOENT if job is not indexed.
+ */
+int jobqueue_pending_update (jobqueue_t *q, flux_lwj_t *job);
+
+/* Append to 'jobs' the fresh pending jobs: those linked into the pending
+ * queue and not passed to jobqueue_pending_update since.
+ * Returns the number of jobs appended.
+ */
+size_t jobqueue_pending_fresh (jobqueue_t *q, zlist_t *jobs);
+
+/* Append to 'jobs' the pending jobs last updated with the priority
+ * association handle 'handle'. Returns the number of jobs appended.
+ */
+size_t jobqueue_pending_assoc (jobqueue_t *q, const void *handle,
+                               zlist_t *jobs);
+
+/* Return the priority a pending job is keyed with in the queue, which
+ * differs from job->priority while the job is not repositioned yet.
+ * Returns job->priority if the job is not pending.
+ */
+double jobqueue_pending_prio (jobqueue_t *q, flux_lwj_t *job);
+
+/* Would pending job a come before pending job b if they were keyed with
+ * priorities pa and pb? As in the queue, higher priority comes first and
+ * then earlier enqueue order. Returns false if either job is not indexed.
+ */
+bool jobqueue_pending_before (jobqueue_t *q, flux_lwj_t *a, double pa,
+                              flux_lwj_t *b, double pb);
+
+/* Would repositioning pending job at the lower job->priority move it
+ * behind a job whose priority did not change?  Only the jobs it would
+ * move past are visited.  Must be called before they are repositioned.
+ */
+bool jobqueue_pending_drops_behind (jobqueue_t *q, flux_lwj_t *job);
+
+/* Return the lowest-priority pending job or NULL if the queue is empty */
+flux_lwj_t *jobqueue_pending_last (jobqueue_t *q);
+
+/* Iterate over a queue: the pending queue in priority order, the running
+ * and complete queues in the order jobs were linked into them. As with
+ * zlist, the queue must not be modified while iterating.
+ */
+flux_lwj_t *jobqueue_first (jobqueue_t *q, jobq_kind_t kind);
+flux_lwj_t *jobqueue_next (jobqueue_t *q);
+
+/* Number of jobs linked into the given queue */
+size_t jobqueue_size (jobqueue_t *q, jobq_kind_t kind);
+
+/* Number of indexed jobs */
+size_t jobqueue_indexed (jobqueue_t *q);
+
+#endif /* JOBQUEUE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,136 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+
+/*
+ * jobreq.c - translate a job's resource counts into a resrc request
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common/libutil/shortjansson.h"
+#include "jobreq.h"
+
+resrc_reqst_t *jobreq_resrc_reqst (resrc_api_ctx_t *rsapi, flux_lwj_t *job,
+                                   int64_t starttime, int64_t *nreqrd)
+{
+    json_t *req_res = NULL;
+    resrc_reqst_t *resrc_reqst = NULL;
+
+    /*
+     * Require at least one task per node, and
+     * Assume (for now) one task per core.
+     *
+     * At this point, our flux_lwj_t structure supplies a simple count
+     * of nodes and cores.  This is a short term solution that
+     * supports the typical request.  Until a more complex model is
+     * available, we will have to interpret the request along these
+     * most likely scenarios:
+     *
+     * - If only cores are requested, the number of nodes we find to
+     *   supply the requested cores does not matter to the user.
+     *
+     * - If only nodes are requested, we will return only nodes whose
+     *   cores are all idle.
+     *
+     * - If nodes and cores are requested, we will return the
+     *   requested number of nodes with at least the requested number
+     *   of cores on each node.  We will not attempt to provide a
+     *   balanced number of cores per node.
+     */
+    req_res = Jnew ();
+    if (job->req->nnodes > 0) {
+        Jadd_str (req_res, "type", "node");
+        Jadd_int64 (req_res, "req_qty", job->req->nnodes);
+        *nreqrd = job->req->nnodes;
+
+        /* Since nodes are requested, make sure we look for at
+         * least one core on each node */
+        if (job->req->ncores < job->req->nnodes)
+            job->req->ncores = job->req->nnodes;
+        job->req->corespernode = (job->req->ncores + job->req->nnodes - 1) /
+            job->req->nnodes;
+        job->req->gpuspernode = 0;
+        if (job->req->node_exclusive) {
+            Jadd_int64 (req_res, "req_size", 1);
+            Jadd_bool (req_res, "exclusive", true);
+        } else {
+            Jadd_int64 (req_res, "req_size", 0);
+            Jadd_bool (req_res, "exclusive", false);
+        }
+
+        json_t *child_core = Jnew ();
+        Jadd_str (child_core, "type", "core");
+        Jadd_int64 (child_core, "req_qty", job->req->corespernode);
+        /* setting size == 1 devotes (all of) the core to the job */
+        Jadd_int64 (child_core, "req_size", 1);
+        /* setting exclusive to true prevents multiple jobs per core */
+        Jadd_bool (child_core, "exclusive", true);
+        Jadd_int64 (child_core, "starttime", starttime);
+        Jadd_int64 (child_core, "endtime", starttime + job->req->walltime);
+
+        json_t *children = Jnew_ar();
+        json_array_append_new (children, child_core);
+        if (job->req->ngpus) {
+            job->req->gpuspernode = (job->req->ngpus + job->req->nnodes - 1) /
+            job->req->nnodes;
+            json_t *child_gpu = Jnew ();
+            Jadd_str (child_gpu, "type", "gpu");
+            Jadd_int64 (child_gpu, "req_qty", job->req->gpuspernode);
+            /* setting size == 1 devotes (all of) the gpu to the job */
+            Jadd_int64 (child_gpu, "req_size", 1);
+            /* setting exclusive to true prevents multiple jobs per core */
+            Jadd_bool (child_gpu, "exclusive", true);
+            Jadd_int64 (child_gpu, "starttime", starttime);
+            Jadd_int64 (child_gpu, "endtime", starttime + job->req->walltime);
+            json_array_append_new (children, child_gpu);
+        }
+        json_object_set_new (req_res, "req_children", children);
+    } else if (job->req->ncores > 0) {
+        Jadd_str (req_res, "type", "core");
+        Jadd_int (req_res, "req_qty", job->req->ncores);
+        *nreqrd = job->req->ncores;
+
+        Jadd_int64 (req_res, "req_size", 1);
+        /* setting exclusive to true prevents multiple jobs per core */
+        Jadd_bool (req_res, "exclusive", true);
+    } else
+        goto done;
+
+    Jadd_int64 (req_res, "starttime", starttime);
+    Jadd_int64 (req_res, "endtime", starttime + job->req->walltime);
+    resrc_reqst = resrc_reqst_from_json (rsapi, req_res, NULL);
+
+done:
+    Jput (req_res);
+    return resrc_reqst;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
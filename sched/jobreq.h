@@ -0,0 +1,48 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+
+#ifndef JOBREQ_H
+#define JOBREQ_H 1
+
+#include <stdint.h>
+
+#include "resrc_api.h"
+#include "resrc_reqst.h"
+#include "scheduler.h"
+
+/* Build the resource request for job's flux_res_t, spanning the window
+ * [starttime, starttime + walltime].  Fills in the per-node core and gpu
+ * counts of job->req and sets *nreqrd to the number of top-level
+ * resources (nodes or cores) the request asks for.
+ * Returns NULL if the job requests neither nodes nor cores.
+ */
+resrc_reqst_t *jobreq_resrc_reqst (resrc_api_ctx_t *rsapi, flux_lwj_t *job,
+                                   int64_t starttime, int64_t *nreqrd);
+
+#endif /* JOBREQ_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
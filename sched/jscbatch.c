@@ -0,0 +1,394 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+/*
+ * jscbatch.c - batched job control block updates and run requests
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <czmq.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/oom.h"
+#include "src/common/libutil/xzmalloc.h"
+#include "src/common/libutil/shortjansson.h"
+#include "jscbatch.h"
+
+typedef enum {
+    OP_RLITE,
+    OP_STATE,
+    OP_RUN
+} op_type_t;
+
+typedef struct op {
+    op_type_t     type;
+    int64_t       jobid;
+    job_state_t   os;
+    job_state_t   ns;
+    json_t       *R_lite;
+    char         *path;          /* resolved KVS directory of the job */
+    bool          failed;
+} op_t;
+
+struct jscbatch {
+    flux_t         *h;
+    zlist_t        *ops;
+    jscbatch_run_f  run_cb;
+    jscbatch_fail_f fail_cb;
+    void           *arg;
+};
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                libjsc shim                                 *
+ *                                                                            *
+ ******************************************************************************/
+
+/* libjsc has no batched form of jsc_update_jcb (), so a batch writes what
+ * it would have written itself.  Everything below reproduces libjsc
+ * internals that are not part of its API (flux-core's jstatctl.c): how a
+ * job id is mapped to its KVS directory, the keys updated under that
+ * directory and the event announcing a state change.  It is kept here,
+ * and nowhere else, so that a change in libjsc has a single place to be
+ * followed in.  Batching is opt-in (jsc-batch=true) for that reason.
+ */
+
+/* The service libjsc asks for the KVS directories of job ids */
+#define SHIM_KVSPATH_TOPIC   "job.kvspath"
+
+/* The directory libjsc falls back to without that service */
+static char *shim_default_path (int64_t jobid)
+{
+    return xasprintf ("lwj.%"PRId64"", jobid);
+}
+
+/* Request the KVS directories of the job ids in ids, a json array */
+static flux_future_t *shim_kvspath_rpc (flux_t *h, json_t *ids)
+{
+    return flux_rpc_pack (h, SHIM_KVSPATH_TOPIC, FLUX_NODEID_ANY, 0,
+                          "{s:O}", "ids", ids);
+}
+
+/* Get the directories, a json array in the order of the ids requested */
+static int shim_kvspath_get (flux_future_t *f, json_t **paths)
+{
+    return flux_rpc_get_unpack (f, "{s:o}", "paths", paths);
+}
+
+/* Stage the R_lite of the job at path */
+static int shim_txn_rlite (flux_kvs_txn_t *txn, const char *path,
+                           json_t *R_lite)
+{
+    int rc;
+    char *key = xasprintf ("%s.R_lite", path);
+    rc = flux_kvs_txn_pack (txn, 0, key, "O", R_lite);
+    free (key);
+    return rc;
+}
+
+/* Stage the state of the job at path */
+static int shim_txn_state (flux_kvs_txn_t *txn, const char *path,
+                           job_state_t ns)
+{
+    int rc;
+    char *key = xasprintf ("%s.state", path);
+    rc = flux_kvs_txn_pack (txn, 0, key, "s", jsc_job_num2state (ns));
+    free (key);
+    return rc;
+}
+
+/* Announce the state change, once committed, as libjsc does */
+static int shim_send_state_event (flux_t *h, int64_t jobid, job_state_t ns)
+{
+    int rc = -1;
+    char *topic = xasprintf ("jsc.state.%s", jsc_job_num2state (ns));
+    flux_msg_t *msg = NULL;
+
+    if ((msg = flux_event_pack (topic, "{s:I}", "jobid", jobid))
+        && flux_send (h, msg, 0) == 0)
+        rc = 0;
+    flux_msg_destroy (msg);
+    free (topic);
+    return rc;
+}
+
+
+/******************************************************************************
+ *                                                                            *
+ *                             Utility functions                              *
+ *                                                                            *
+ ******************************************************************************/
+
+static void op_destroy (void *arg)
+{
+    op_t *op = (op_t *)arg;
+    if (op) {
+        Jput (op->R_lite);
+        free (op->path);
+        free (op);
+    }
+}
+
+static int op_append (jscbatch_t *b, op_t *op)
+{
+    if (zlist_append (b->ops, op) < 0) {
+        op_destroy (op);
+        errno = ENOMEM;
+        return -1;
+    }
+    zlist_freefn (b->ops, op, op_destroy, true);
+    return 0;
+}
+
+/* Resolve the KVS directory of every job in the batch with one request.
+ * Fall back to libjsc's default directory if the service does not answer,
+ * as under the simulator.
+ */
+static void resolve_paths (jscbatch_t *b)
+{
+    int i = 0;
+    int n = 0;
+    int64_t last = -1;
+    op_t *op = NULL;
+    json_t *ids = Jnew_ar ();
+    json_t *paths = NULL;
+    const char *p = NULL;
+    flux_future_t *f = NULL;
+
+    for (op = zlist_first (b->ops); op; op = zlist_next (b->ops)) {
+        if (op->type != OP_RUN && op->jobid != last) {
+            json_array_append_new (ids, json_integer (op->jobid));
+            last = op->jobid;
+        }
+    }
+    if (json_array_size (ids) == 0)
+        goto done;
+    if (!(f = shim_kvspath_rpc (b->h, ids))
+        || shim_kvspath_get (f, &paths) < 0
+        || !Jget_ar_len (paths, &n) || n != (int)json_array_size (ids))
+        paths = NULL;
+
+    last = -1;
+    for (op = zlist_first (b->ops); op; op = zlist_next (b->ops)) {
+        if (op->type == OP_RUN)
+            continue;
+        if (op->jobid != last) {
+            p = NULL;
+            if (paths && !Jget_ar_str (paths, i, &p))
+                p = NULL;
+            i++;
+            last = op->jobid;
+        }
+        op->path = p? xstrdup (p) : shim_default_path (op->jobid);
+    }
+done:
+    flux_future_destroy (f);
+    Jput (ids);
+}
+
+static int commit_all (jscbatch_t *b)
+{
+    int rc = -1;
+    op_t *op = NULL;
+    flux_kvs_txn_t *txn = NULL;
+    flux_future_t *f = NULL;
+
+    if (!(txn = flux_kvs_txn_create ()))
+        goto done;
+    for (op = zlist_first (b->ops); op; op = zlist_next (b->ops)) {
+        if (op->type == OP_RLITE
+            && shim_txn_rlite (txn, op->path, op->R_lite) < 0)
+            goto done;
+        if (op->type == OP_STATE
+            && shim_txn_state (txn, op->path, op->ns) < 0)
+            goto done;
+    }
+    if (!(f = flux_kvs_commit (b->h, 0, txn)) || flux_future_get (f, NULL) < 0)
+        goto done;
+    rc = 0;
+done:
+    flux_future_destroy (f);
+    flux_kvs_txn_destroy (txn);
+    return rc;
+}
+
+/* Same update as the batched one, but through jsc_update_jcb () */
+static int update_one (jscbatch_t *b, op_t *op)
+{
+    int rc = -1;
+    char *jcbstr = NULL;
+    json_t *jcb = Jnew ();
+    json_t *o = NULL;
+
+    if (op->type == OP_RLITE) {
+        Jadd_obj (jcb, JSC_R_LITE, op->R_lite);
+        jcbstr = Jtostr (jcb);
+        rc = jsc_update_jcb (b->h, op->jobid, JSC_R_LITE, jcbstr);
+    } else {
+        o = Jnew ();
+        Jadd_int64 (o, JSC_STATE_PAIR_OSTATE, (int64_t) op->os);
+        Jadd_int64 (o, JSC_STATE_PAIR_NSTATE, (int64_t) op->ns);
+        json_object_set_new (jcb, JSC_STATE_PAIR, o);
+        jcbstr = Jtostr (jcb);
+        rc = jsc_update_jcb (b->h, op->jobid, JSC_STATE_PAIR, jcbstr);
+    }
+    free (jcbstr);
+    Jput (jcb);
+    return rc;
+}
+
+
+/******************************************************************************
+ *                                                                            *
+ *                               Public API                                   *
+ *                                                                            *
+ ******************************************************************************/
+
+jscbatch_t *jscbatch_new (flux_t *h, jscbatch_run_f run_cb,
+                          jscbatch_fail_f fail_cb, void *arg)
+{
+    jscbatch_t *b = xzmalloc (sizeof (*b));
+    b->h = h;
+    if (!(b->ops = zlist_new ()))
+        oom ();
+    b->run_cb = run_cb;
+    b->fail_cb = fail_cb;
+    b->arg = arg;
+    return b;
+}
+
+void jscbatch_destroy (jscbatch_t *b)
+{
+    if (b) {
+        zlist_destroy (&(b->ops));
+        free (b);
+    }
+}
+
+int jscbatch_add_rlite (jscbatch_t *b, int64_t jobid, json_t *R_lite)
+{
+    op_t *op = xzmalloc (sizeof (*op));
+    op->type = OP_RLITE;
+    op->jobid = jobid;
+    op->R_lite = Jget (R_lite);
+    return op_append (b, op);
+}
+
+int jscbatch_add_state (jscbatch_t *b, int64_t jobid, job_state_t os,
+                        job_state_t ns)
+{
+    op_t *op = xzmalloc (sizeof (*op));
+    op->type = OP_STATE;
+    op->jobid = jobid;
+    op->os = os;
+    op->ns = ns;
+    return op_append (b, op);
+}
+
+int jscbatch_add_runrequest (jscbatch_t *b, int64_t jobid)
+{
+    op_t *op = xzmalloc (sizeof (*op));
+    op->type = OP_RUN;
+    op->jobid = jobid;
+    return op_append (b, op);
+}
+
+size_t jscbatch_size (jscbatch_t *b)
+{
+    return zlist_size (b->ops);
+}
+
+int jscbatch_commit (jscbatch_t *b)
+{
+    int i = 0;
+    int j = 0;
+    int n = 0;
+    int nfailed = 0;
+    bool batched = false;
+    op_t *op = NULL;
+    op_t **v = NULL;
+
+    if ((n = (int)zlist_size (b->ops)) == 0)
+        return 0;
+
+    resolve_paths (b);
+    if (commit_all (b) == 0) {
+        batched = true;
+    } else {
+        flux_log (b->h, LOG_ERR, "%s: batched commit of %d updates failed: "
+                  "%s; retrying one by one", __FUNCTION__, n, strerror (errno));
+    }
+
+    v = xzmalloc (n * sizeof (*v));
+    for (op = zlist_first (b->ops); op; op = zlist_next (b->ops))
+        v[i++] = op;
+    for (i = 0; i < n; i++) {
+        op = v[i];
+        if (op->failed)
+            continue;
+        if (op->type == OP_RUN) {
+            if (b->run_cb && b->run_cb (b->h, op->jobid, b->arg) < 0) {
+                flux_log (b->h, LOG_ERR, "%s: run request failed for job "
+                          "%"PRId64"", __FUNCTION__, op->jobid);
+                op->failed = true;
+            }
+        } else if (!batched) {
+            if (update_one (b, op) != 0) {
+                flux_log (b->h, LOG_ERR, "%s: jsc update failed for job "
+                          "%"PRId64" (%s)", __FUNCTION__, op->jobid,
+                          strerror (errno));
+                op->failed = true;
+            }
+        } else if (op->type == OP_STATE
+                   && shim_send_state_event (b->h, op->jobid, op->ns) < 0) {
+            flux_log (b->h, LOG_ERR, "%s: state event failed for job "
+                      "%"PRId64"", __FUNCTION__, op->jobid);
+        }
+        if (op->failed) {
+            /* Don't advance or run a job once one of its updates failed */
+            for (j = i + 1; j < n; j++)
+                if (v[j]->jobid == op->jobid)
+                    v[j]->failed = true;
+            nfailed++;
+            if (b->fail_cb)
+                b->fail_cb (b->h, op->jobid,
+                            (op->type == OP_STATE)? op->ns : J_NULL, b->arg);
+        }
+    }
+    free (v);
+    zlist_purge (b->ops);
+    return nfailed;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
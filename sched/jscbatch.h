@@ -0,0 +1,83 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#ifndef JSCBATCH_H
+#define JSCBATCH_H 1
+
+#include <stdint.h>
+#include <stddef.h>
+#include <flux/core.h>
+#include <jansson.h>
+
+typedef struct jscbatch jscbatch_t;
+
+/* Called once per job whose run request was queued with
+ * jscbatch_add_runrequest, after its state update has been committed.
+ * Returns 0 on success, -1 on error.
+ */
+typedef int (*jscbatch_run_f)(flux_t *h, int64_t jobid, void *arg);
+
+/* Called once per job for which a queued update could not be applied,
+ * with the new state of the failed state update (J_NULL if only the
+ * R_lite update failed).
+ */
+typedef void (*jscbatch_fail_f)(flux_t *h, int64_t jobid, job_state_t ns,
+                                void *arg);
+
+/* Batch c'tor/d'tor. A batch collects the job control block updates
+ * and run requests that the scheduler would otherwise issue job by job
+ * through jsc_update_jcb () and apply them with a single KVS commit.
+ */
+jscbatch_t *jscbatch_new (flux_t *h, jscbatch_run_f run_cb,
+                          jscbatch_fail_f fail_cb, void *arg);
+void jscbatch_destroy (jscbatch_t *b);
+
+/* Queue the R_lite of a job. The batch takes a reference to R_lite */
+int jscbatch_add_rlite (jscbatch_t *b, int64_t jobid, json_t *R_lite);
+
+/* Queue a job state transition from os to ns */
+int jscbatch_add_state (jscbatch_t *b, int64_t jobid, job_state_t os,
+                        job_state_t ns);
+
+/* Queue a run request for a job */
+int jscbatch_add_runrequest (jscbatch_t *b, int64_t jobid);
+
+/* Number of queued updates and run requests */
+size_t jscbatch_size (jscbatch_t *b);
+
+/* Apply everything queued so far, in order, and empty the batch:
+ * job KVS directories are resolved with one request, all KVS updates
+ * go into one transaction, then a JSC state event is sent
+ * per state transition and the run requests are issued. If the batched
+ * commit fails, every update is retried on its own with jsc_update_jcb ()
+ * and fail_cb is called for each job whose update still fails.
+ * Returns the number of failed jobs.
+ */
+int jscbatch_commit (jscbatch_t *b);
+
+#endif /* JSCBATCH_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
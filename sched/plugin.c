@@ -129,6 +129,11 @@ static struct behavior_plugin *behavior_plugin_create (flux_t *h, void *dso)
         flux_log (h, LOG_ERR, "can't load process_args: %s", strerr);
         goto error;
     }
+    /* job_end and job_skipped are optional */
+    plugin->job_end = dlsym (dso, "job_end");
+    dlerror ();
+    plugin->job_skipped = dlsym (dso, "job_skipped");
+    dlerror ();
     plugin->dso = dso;
     return plugin;
 error:
@@ -170,6 +175,13 @@ static struct priority_plugin *priority_plugin_create (flux_t *h, void *dso)
         flux_log (h, LOG_ERR, "can't load record_job_usage: %s", strerr);
         goto error;
     }
+    /* update_jobs, changed_assocs and charge_job_usage are optional */
+    plugin->update_jobs = dlsym (dso, "sched_priority_update_jobs");
+    dlerror ();
+    plugin->changed_assocs = dlsym (dso, "sched_priority_changed_assocs");
+    dlerror ();
+    plugin->charge_job_usage = dlsym (dso, "sched_priority_charge_job_usage");
+    dlerror ();
     plugin->dso = dso;
     return plugin;
 error:
@@ -422,8 +434,8 @@ struct sched_plugin_loader *sched_plugin_loader_create (flux_t *h)
     }
     memset (sploader, 0, sizeof (*sploader));
     sploader->h = h;
-    if (flux_msg_handler_addvec (h, plugin_htab, sploader,
-                                 &sploader->handlers) < 0) {
+    if (h && flux_msg_handler_addvec (h, plugin_htab, sploader,
+                                      &sploader->handlers) < 0) {
         flux_log_error (h, "flux_msghandler_addvec");
         free (sploader);
         return NULL;
@@ -436,7 +448,8 @@ void sched_plugin_loader_destroy (struct sched_plugin_loader *sploader)
     if (sploader) {
         behavior_plugin_unload (sploader);
         priority_plugin_unload (sploader);
-        flux_msg_handler_delvec (sploader->handlers);
+        if (sploader->handlers)
+            flux_msg_handler_delvec (sploader->handlers);
         free (sploader);
     }
 }
@@ -46,6 +46,7 @@ struct behavior_plugin {
                                          size_t argz_len,
                                          const sched_params_t *params);
     int                  (*job_end)(flux_lwj_t *job);
+    int                  (*job_skipped)(flux_lwj_t *job);
 };
 
 struct priority_plugin {
@@ -53,12 +54,17 @@ struct priority_plugin {
     char         *name;               /* Name of plugin */
     char         *path;               /* Path to plugin dso */
 
-    int         (*priority_setup)(flux_t *h);
+    int         (*priority_setup)(flux_t *h, char *argz, size_t argz_len);
     void        (*prioritize_jobs)(flux_t *h, zlist_t *jobs);
+    void        (*update_jobs)(flux_t *h, zlist_t *jobs, zlist_t *changed);
+    int         (*changed_assocs)(flux_t *h, zlist_t *assocs);
     int         (*record_job_usage)(flux_t *h, flux_lwj_t *job);
+    int         (*charge_job_usage)(flux_t *h, flux_lwj_t *job, int64_t now);
 };
 
 /* Create/destroy the plugin loader apparatus.
+ * With a NULL handle, no sched.insmod/rmmod/lsmod services are registered
+ * and plugins can only be loaded with sched_plugin_load ().
  */
 struct sched_plugin_loader;
 struct sched_plugin_loader *sched_plugin_loader_create (flux_t *h);
@@ -26,14 +26,21 @@ public:
     void remove_child (std::shared_ptr<prio_node>);
     void add_parent (std::shared_ptr<prio_node>);
     std::shared_ptr<prio_node> get_parent ();
-    void add_usage (double usage);
+    void add_usage (double usage, double when, double half_life);
     void set_shares (unsigned long shares);
     bool is_root ();
-    double get_fs_factor ();
-    void tree_calc_fs_factors (); // Can only be called on root node
+    bool is_dirty ();
+    double get_fs_factor () const;
+    double get_usage (double when, double half_life) const;
+    // Can only be called on root node
+    void tree_calc_fs_factors (double half_life,
+                               std::vector<prio_node *> *changed);
 
 private:
-    void tree_calc_fs_factors (double low_factor);
+    void mark_dirty ();
+    void decay_to (double now, double half_life);
+    void tree_calc_fs_factors (double low_factor, double half_life,
+                               std::vector<prio_node *> *changed);
     void calc_fs_factor (unsigned long level_shares,
                          double level_usage,
                          double range_low,
@@ -42,15 +49,20 @@ private:
     std::string name;
     unsigned long shares;
     unsigned long child_shares; /* sum of all children's shares */
-    double usage;               /* historical cpu-second sum */
+    double usage;               /* decayed cpu-second sum */
+    double usage_time;          /* time usage was last decayed to */
     double fs_factor;           /* normalized fair-share factor */
+    double low_factor;          /* range_low last handed to our children */
+    double high_factor;         /* range_high last handed to our children */
+    bool dirty;                 /* usage/shares changed here or below */
     std::shared_ptr<prio_node> parent;
     std::vector<std::shared_ptr<prio_node>> children;
     friend std::ostream& operator<<(std::ostream& s, prio_node const& n);
 };
 
 priority_tree::priority_tree ()
-    : update_in_progress{false}
+    : update_in_progress{false}, generation{1},
+      half_life{PRIO_USAGE_HALF_LIFE_DEFAULT}
 {
     root = make_shared<prio_node>(prio_node_type::root_account,
                                   "root", 1);
@@ -99,6 +111,7 @@ void priority_tree::create_node (string key, prio_node_type nodetype,
     node->add_parent(parent_node);
     parent_node->add_child(node);
     node_map.insert (make_pair (key, node));
+    generation++;
 }
 
 void priority_tree::refresh_node (string key, unsigned long shares)
@@ -115,6 +128,7 @@ void priority_tree::remove_node (string key)
     shared_ptr<prio_node> node = get_node (key);
     node->get_parent ()->remove_child (node);
     node_map.erase (key);
+    generation++;
 }
 
 void priority_tree::update_add_user (string user, string parent,
@@ -148,14 +162,33 @@ void priority_tree::update_add_account (string account, string parent,
 
 prio_node::prio_node (prio_node_type type, string name, unsigned long shares)
     : type{type}, name{name}, shares{shares},
-      child_shares{0}, usage{0.0}, fs_factor{1.0}
+      child_shares{0}, usage{0.0}, usage_time{0.0}, fs_factor{1.0},
+      low_factor{0.0}, high_factor{1.0}, dirty{true}
 {
 }
 
+/*
+ * Flag this node and every ancestor as needing recomputation.  A dirty
+ * node always has dirty ancestors, so the walk stops at the first node
+ * that is already flagged.
+ */
+void prio_node::mark_dirty ()
+{
+    for (prio_node *node = this; node && !node->dirty;
+         node = node->parent.get ())
+        node->dirty = true;
+}
+
+bool prio_node::is_dirty ()
+{
+    return dirty;
+}
+
 void prio_node::add_child (shared_ptr<prio_node> child)
 {
     child_shares += child->shares;
     children.push_back(child);
+    mark_dirty ();
 }
 
 void prio_node::remove_child (shared_ptr<prio_node> child)
@@ -163,6 +196,7 @@ void prio_node::remove_child (shared_ptr<prio_node> child)
     child_shares -= child->shares;
     auto && iter = find (children.begin(), children.end(), child);
     children.erase (iter, iter+1);
+    mark_dirty ();
 }
 
 void prio_node::add_parent (shared_ptr<prio_node> node)
@@ -175,18 +209,58 @@ std::shared_ptr<prio_node> prio_node::get_parent ()
     return parent;
 }
 
-void prio_node::add_usage (double new_usage)
+/*
+ * Usage decays exponentially: after half_life seconds it counts half.
+ * Decay is applied lazily, only when a node's usage is added to or read
+ * for a recomputation, from the time it was last brought up to date.
+ * Times are those of the charges, so simulated time works as well.
+ */
+void prio_node::decay_to (double now, double half_life)
 {
-    usage += new_usage;
-    if (parent)
-        parent->add_usage (new_usage);
+    if (now <= usage_time)
+        return;
+    if (half_life > 0.0 && usage > 0.0)
+        usage *= exp2 (-(now - usage_time) / half_life);
+    usage_time = now;
+}
+
+/*
+ * Charge usage accrued at time 'when' to this node and its ancestors.
+ * Usage older than a node's last decay time is decayed on the way in.
+ */
+void prio_node::add_usage (double new_usage, double when, double half_life)
+{
+    if (new_usage == 0.0)
+        return;
+    for (prio_node *node = this; node; node = node->parent.get ()) {
+        node->decay_to (when, half_life);
+        double amount = new_usage;
+        if (half_life > 0.0 && when < node->usage_time)
+            amount *= exp2 (-(node->usage_time - when) / half_life);
+        node->usage += amount;
+        node->dirty = true;
+    }
+}
+
+/*
+ * Return the usage as decayed to 'when', leaving the node untouched.
+ */
+double prio_node::get_usage (double when, double half_life) const
+{
+    if (half_life > 0.0 && when > usage_time)
+        return usage * exp2 (-(when - usage_time) / half_life);
+    return usage;
 }
 
 void prio_node::set_shares (unsigned long new_shares)
 {
     long share_diff = new_shares - shares;
+    if (share_diff == 0)
+        return;
     shares = new_shares;
     parent->child_shares += share_diff;
+    // Our siblings' normalized shares changed too
+    parent->mark_dirty ();
 }
 
 bool prio_node::is_root ()
@@ -194,7 +268,7 @@ bool prio_node::is_root ()
     return type == prio_node_type::root_account;
 }
 
-double prio_node::get_fs_factor ()
+double prio_node::get_fs_factor () const
 {
     return fs_factor;
 }
@@ -237,6 +311,10 @@ double prio_node::get_fs_factor ()
  * fair-share value.
  *
  * You'll see this formula in calc_fs_factor()
+ *
+ * Since every association's usage decays at the same rate, decay alone
+ * never changes U, and with it any fair-share factor.  That is what lets
+ * clean subtrees keep both their stale usage and their cached factors.
  */
 
 void prio_node::calc_fs_factor (unsigned long level_shares,
@@ -275,16 +353,41 @@ bool compare_prio_node (const shared_ptr<prio_node> &node1,
 
 /*
  * A recursive function that is first called for the root association.
+ *
+ * Our children's factors depend only on their own shares and usage,
+ * our child_shares and usage, and the range [low_factor, fs_factor]
+ * we hand down.  A subtree with no usage or share changes below it
+ * whose range is unchanged since the last pass is skipped entirely.
+ * On the levels that are recomputed, children are decayed to their
+ * parent's usage time (never older than theirs, since every charge
+ * decays the whole path to the root), so that siblings and their parent
+ * are compared at the same point in time.
  */
-void prio_node::tree_calc_fs_factors (double low_factor)
+void prio_node::tree_calc_fs_factors (double new_low_factor,
+                                      double half_life,
+                                      vector<prio_node *> *changed)
 {
+    if (!dirty && new_low_factor == low_factor && fs_factor == high_factor)
+        return;
+    low_factor = new_low_factor;
+    high_factor = fs_factor;
+    dirty = false;
+
     // First have each child calculate its fair-share factor
     for (auto && child: children) {
+        double old_factor = child->fs_factor;
+        child->decay_to (usage_time, half_life);
         child->calc_fs_factor (child_shares, usage, low_factor, fs_factor);
+        if (changed && child->type == prio_node_type::user
+            && child->fs_factor != old_factor)
+            changed->push_back (child.get ());
     }
 
-    // Next sort the children by their fair-share factors
-    sort(children.begin(), children.end(), compare_prio_node);
+    // Next sort the children by their fair-share factors.  Siblings
+    // with equal factors get the same low_factor below, so the order
+    // among ties does not matter and a still-sorted level is left alone.
+    if (!is_sorted (children.begin(), children.end(), compare_prio_node))
+        sort(children.begin(), children.end(), compare_prio_node);
 
     // Finally, call tree_calc_fs_factors() for all children
     double previous_fs_factor = low_factor;
@@ -293,19 +396,20 @@ void prio_node::tree_calc_fs_factors (double low_factor)
         // All siblings with the same fs_factor are assigned the same low_factor
         if (child->fs_factor != previous_fs_factor)
             current_low_factor = previous_fs_factor;
-        child->tree_calc_fs_factors (current_low_factor);
+        child->tree_calc_fs_factors (current_low_factor, half_life, changed);
         previous_fs_factor = child->fs_factor;
     }
 }
 
-void prio_node::tree_calc_fs_factors ()
+void prio_node::tree_calc_fs_factors (double half_life,
+                                      vector<prio_node *> *changed)
 {
     if (type != prio_node_type::root_account) {
         throw std::runtime_error("Parameterless tree_calc_fs_factors() may"
                                  " only be called for the root account.\n");
     }
     // The root account has no siblings, so the low_factor is always zero.
-    tree_calc_fs_factors (0.0);
+    tree_calc_fs_factors (0.0, half_life, changed);
 }
 
 shared_ptr<prio_node> priority_tree::get_node (const string key)
@@ -335,9 +439,26 @@ shared_ptr<prio_node> priority_tree::get_node (const string account,
     return node;
 }
 
-void priority_tree::calc_fs_factors()
+/*
+ * Recompute the fair-share factors of the subtrees whose usage or
+ * shares changed since the last call; a no-op when nothing changed.
+ * The user associations whose factor changed are appended to 'changed'
+ * if it is non-NULL.
+ */
+void priority_tree::calc_fs_factors (vector<prio_node *> *changed)
+{
+    if (root->is_dirty ())
+        root->tree_calc_fs_factors (half_life, changed);
+}
+
+void priority_tree::set_half_life (double seconds)
+{
+    half_life = (seconds > 0.0) ? seconds : 0.0;
+}
+
+double priority_tree::get_half_life ()
 {
-    root->tree_calc_fs_factors();
+    return half_life;
 }
 
 double priority_tree::get_fair_share_factor(const std::string &parent,
@@ -355,24 +476,25 @@ double priority_tree::get_fair_share_factor(const std::string &parent,
 double priority_tree::get_fair_share_factor (const char *parent,
                                              const char *user)
 {
-    get_fair_share_factor (string (user), string (parent));
+    return get_fair_share_factor (string (parent), string (user));
 }
 
 void priority_tree::add_usage (const std::string &parent,
-                               const std::string &user, double usage)
+                               const std::string &user, double usage,
+                               double when)
 {
     shared_ptr<prio_node> node;
 
     node = get_node (parent, user);
     if (!node)
         return;
-    node->add_usage (usage);
+    node->add_usage (usage, when, half_life);
 }
 
-void priority_tree::add_usage (const char *parent,
-                               const char *user, double usage)
+void priority_tree::add_usage (const char *parent, const char *user,
+                               double usage, double when)
 {
-    add_usage (string (user), string (parent), usage);
+    add_usage (string (parent), string (user), usage, when);
 }
 
 unsigned priority_tree::get_node_count ()
@@ -380,6 +502,53 @@ unsigned priority_tree::get_node_count ()
     return node_map.size();
 }
 
+/*
+ * Return the node of a user association, or of the account itself if
+ * 'user' is NULL, or nullptr if there is none.
+ */
+prio_node *priority_tree::find_node (const char *account, const char *user)
+{
+    string key (account);
+    if (user) {
+        key += '-';
+        key += user;
+    }
+
+    auto && iter = node_map.find (key);
+    if (iter == node_map.end ())
+        return nullptr;
+    return iter->second.get ();
+}
+
+uint64_t priority_tree::get_generation ()
+{
+    return generation;
+}
+
+double priority_tree::get_fair_share_factor (const prio_node *node)
+{
+    if (!node)
+        return 0.0;
+    return node->get_fs_factor ();
+}
+
+/*
+ * Return the usage accrued by the node, decayed to 'when', or 0.0 if
+ * there is no node.
+ */
+double priority_tree::get_usage (const prio_node *node, double when)
+{
+    if (!node)
+        return 0.0;
+    return node->get_usage (when, half_life);
+}
+
+void priority_tree::add_usage (prio_node *node, double usage, double when)
+{
+    if (node)
+        node->add_usage (usage, when, half_life);
+}
+
 namespace {
 /*
  * This class magically makes everything in 'dest' stream
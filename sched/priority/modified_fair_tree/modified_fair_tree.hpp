@@ -1,5 +1,6 @@
 #ifndef _MODIFIED_PRIORITY_TREE_H
 
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <memory>
@@ -14,17 +15,35 @@ namespace Priority {
 class prio_node;
 enum class prio_node_type {root_account, account, user};
 
+/* Default half-life of accrued usage, in seconds (one week) */
+#define PRIO_USAGE_HALF_LIFE_DEFAULT (7 * 24 * 60 * 60)
+
 class priority_tree {
 public:
     priority_tree ();
-    void calc_fs_factors();
+    void calc_fs_factors (std::vector<prio_node *> *changed = nullptr);
+    void set_half_life (double seconds);
+    double get_half_life ();
     double get_fair_share_factor (const std::string &parent,
                                   const std::string &user);
     double get_fair_share_factor (const char *parent, const char *user);
     void add_usage (const std::string &parent,
-                    const std::string &user, double usage);
-    void add_usage (const char *parent, const char *user, double usage);
+                    const std::string &user, double usage, double when);
+    void add_usage (const char *parent, const char *user,
+                    double usage, double when);
     unsigned get_node_count ();
+
+    /*
+     * Node handles let callers resolve an association once and skip the
+     * key lookup afterwards.  A handle is only valid while the tree's
+     * generation is unchanged; any node creation or removal bumps it.
+     */
+    prio_node *find_node (const char *account, const char *user);
+    uint64_t get_generation ();
+    double get_fair_share_factor (const prio_node *node);
+    double get_usage (const prio_node *node, double when);
+    void add_usage (prio_node *node, double usage, double when);
+
     void update_start ();
     void update_add_user (std::string user, std::string parent,
                           unsigned long shares);
@@ -36,6 +55,8 @@ private:
     std::shared_ptr<prio_node> root;
     std::unordered_map<std::string, std::shared_ptr<prio_node>> node_map;
     bool update_in_progress;
+    uint64_t generation;
+    double half_life;           /* seconds; 0 disables decay */
     std::unordered_set<std::string> known_keys;
 
     std::shared_ptr<prio_node> get_node (const std::string key);
@@ -6,6 +6,9 @@
 #include <czmq.h>
 
 #include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <vector>
@@ -22,14 +25,30 @@ using namespace std;
 namespace Flux {
 namespace Priority {
 
+/* State shared by every job in one prioritization pass */
+typedef struct {
+    double epoch;       /* fixed reference time of wait_time */
+} prio_pass_t;
+
 typedef struct {
     const char *name;
     double weight;
-    double (*fn)(flux_lwj_t *job);
+    double (*fn)(flux_lwj_t *job, const prio_pass_t *pass);
 } job_priority_factor_t;
 
 vector<job_priority_factor_t> prio_factors; /* Job priority factors */
 priority_tree ptree;
+double prio_epoch;                          /* time the plugin was set up */
+uint64_t prio_generation;                   /* tree generation last reported */
+
+/*
+ * Per-pass scratch space, kept across passes to avoid reallocation.
+ * factor_values holds one column of prio_jobs.size() values per factor.
+ */
+vector<flux_lwj_t *> prio_jobs;
+vector<double> factor_values;
+vector<double> job_priorities;
+vector<prio_node *> changed_nodes;
 
 /*
  * An association contains the shares of computing resources assigned
@@ -235,14 +254,36 @@ int process_association_file (flux_t *h, const char *filename)
     return n_assoc;
 }
 
-/* Return the number of seconds that have elapsed since the job was
- * submitted.  The longer the job has been waiting in the queue, the
- * greater its wait_time priority component.
+/*
+ * Return the priority tree node of the job's association, resolving it
+ * only if the job has never been resolved or the tree has since gained
+ * or lost nodes.  The handle is cached on the job.
  */
-double wait_time (flux_lwj_t *job)
+prio_node *job_assoc (flux_lwj_t *job)
+{
+    uint64_t gen = ptree.get_generation ();
+
+    if (job->prio_assoc_gen != gen) {
+        assert (job->account != NULL);
+        assert (job->user != NULL);
+        job->prio_assoc = ptree.find_node (job->account, job->user);
+        job->prio_assoc_gen = gen;
+    }
+    return (prio_node *) job->prio_assoc;
+}
+
+/* Return the number of seconds the job had been waiting at the plugin's
+ * epoch (negative if it was submitted later).  The longer the job has
+ * been waiting in the queue, the greater its wait_time priority
+ * component.  Measuring from a fixed epoch rather than from the current
+ * time leaves out the part of the wait that all pending jobs share: it
+ * does not change their order, and without it a job's priority only
+ * moves when its own factors do.
+ */
+double wait_time (flux_lwj_t *job, const prio_pass_t *pass)
 {
     if (job->submittime)
-        return ((double)time (NULL) - job->submittime);
+        return (pass->epoch - job->submittime);
     return 0.0;
 }
 
@@ -251,15 +292,12 @@ double wait_time (flux_lwj_t *job)
  * account.  If that association can't be found, return a zero
  * fair-share factor.
  */
-double fair_share (flux_lwj_t *job)
+double fair_share (flux_lwj_t *job, const prio_pass_t *pass)
 {
-    assert (job->account != NULL);
-    assert (job->user != NULL);
-
-    return ptree.get_fair_share_factor(job->account, job->user);
+    return ptree.get_fair_share_factor (job_assoc (job));
 }
 
-double qos (flux_lwj_t *job)
+double qos (flux_lwj_t *job, const prio_pass_t *pass)
 {
     /*
      * TODO: Return the value associated with a Quality of Service
@@ -267,7 +305,7 @@ double qos (flux_lwj_t *job)
     return 0.0;
 }
 
-double queue (flux_lwj_t *job)
+double queue (flux_lwj_t *job, const prio_pass_t *pass)
 {
     /*
      * TODO: Return the value associated with Flux's equivalent of a
@@ -276,7 +314,7 @@ double queue (flux_lwj_t *job)
     return 0.0;
 }
 
-double job_size (flux_lwj_t *job)
+double job_size (flux_lwj_t *job, const prio_pass_t *pass)
 {
     /*
      * TODO: If smaller jobs should receive the higher priority, then
@@ -287,7 +325,7 @@ double job_size (flux_lwj_t *job)
     return job->req->nnodes * job->req->ncores;
 }
 
-double user (flux_lwj_t *job)
+double user (flux_lwj_t *job, const prio_pass_t *pass)
 {
     /* User allowed to decrease their job's priority only */
     if (job->user_prio < 0.0)
@@ -305,12 +343,48 @@ job_priority_factor_t jpfs[] = {
     { NULL, 0.0, NULL}
 };
 
+/*
+ * Options arrive as the module's priority-opts, e.g.
+ * priority-opts=half-life=86400.  half-life is the number of seconds
+ * after which accrued usage counts half; 0 disables decay.
+ */
+static int process_args (flux_t *h, char *argz, size_t argz_len)
+{
+    char *entry = NULL;
+    char *endptr = NULL;
+    double half_life = PRIO_USAGE_HALF_LIFE_DEFAULT;
+
+    for (entry = argz; entry; entry = argz_next (argz, argz_len, entry)) {
+        if (!strncmp ("half-life=", entry, sizeof ("half-life"))) {
+            const char *str = strstr (entry, "=") + 1;
+            errno = 0;
+            half_life = strtod (str, &endptr);
+            if (errno || endptr == str || *endptr != '\0' || half_life < 0) {
+                flux_log (h, LOG_ERR, "%s: invalid half-life: %s",
+                          __FUNCTION__, str);
+                errno = EINVAL;
+                return -1;
+            }
+        } else {
+            flux_log (h, LOG_ERR, "%s: unknown option: %s",
+                      __FUNCTION__, entry);
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    ptree.set_half_life (half_life);
+    return 0;
+}
+
 extern "C"
-int sched_priority_setup (flux_t *h)
+int sched_priority_setup (flux_t *h, char *argz, size_t argz_len)
 {
     int num_assoc;
     job_priority_factor_t* jpf = NULL;
 
+    if (process_args (h, argz, argz_len) < 0)
+        return -1;
+    prio_epoch = (double) time (NULL);
     jpf = &jpfs[0];
     while (jpf->name) {
         prio_factors.push_back(*jpf);
@@ -324,12 +398,31 @@ int sched_priority_setup (flux_t *h)
     return 0;
 }
 
+/*
+ * Charge the job for the core*seconds it consumed between the time it
+ * was last charged (or started) and 'until', and remember 'until'.
+ */
+static void charge_job (flux_lwj_t *job, int64_t until)
+{
+    int64_t from = (job->usage_time > job->starttime) ?
+        job->usage_time : job->starttime;
+
+    if (until <= from)
+        return;
+    double usage = (double)(until - from)
+        * job->req->nnodes * job->req->ncores;
+    ptree.add_usage (job_assoc (job), usage, (double) until);
+    job->usage_time = until;
+}
+
 /*
  * Usage is currently implemented as core*seconds.  This could
  * eventually expand to include memory, GPUs, power, etc.  The scalar
  * "usage" value is intended to represent a weighted composite of all
- * of the charge-able, compute-related resources.  record_job_usage()
- * will meter that data at the completion of every job.
+ * of the charge-able, compute-related resources.  charge_job_usage()
+ * meters that data for running jobs on every scheduling pass, and
+ * record_job_usage() charges whatever remains at the completion of
+ * every job.
  */
 extern "C"
 int sched_priority_record_job_usage (flux_t *h, flux_lwj_t *job)
@@ -337,26 +430,103 @@ int sched_priority_record_job_usage (flux_t *h, flux_lwj_t *job)
     assert (job->account != NULL);
     assert (job->user != NULL);
 
-    double usage = (job->endtime - job->starttime)
-        * job->req->nnodes * job->req->ncores;
-    ptree.add_usage (job->account, job->user, usage);
-
+    charge_job (job, job->endtime);
     return 0;
 }
 
 extern "C"
-void sched_priority_prioritize_jobs (flux_t *h, zlist_t *jobs)
+int sched_priority_charge_job_usage (flux_t *h, flux_lwj_t *job, int64_t now)
+{
+    assert (job->account != NULL);
+    assert (job->user != NULL);
+
+    charge_job (job, now);
+    return 0;
+}
+
+/*
+ * Evaluate every factor for every job into a column per factor, then
+ * form the weighted sums column by column.  The summing loop runs over
+ * contiguous doubles and carries no calls, so the compiler can
+ * vectorize it.  Jobs whose priority changed are appended to 'changed'
+ * if it is non-NULL.
+ */
+static void prioritize (zlist_t *jobs, zlist_t *changed)
 {
+    prio_pass_t pass;
+    size_t n = 0;
+
     ptree.calc_fs_factors ();
+    pass.epoch = prio_epoch;
 
+    prio_jobs.clear ();
     flux_lwj_t *job = (flux_lwj_t *) zlist_first (jobs);
     while (job) {
-        job->priority = 0;
-        for (auto && factor: prio_factors) {
-            job->priority += factor.weight * factor.fn(job);
-        }
+        prio_jobs.push_back (job);
         job = (flux_lwj_t *) zlist_next (jobs);
     }
+    n = prio_jobs.size ();
+    factor_values.resize (prio_factors.size () * n);
+    job_priorities.assign (n, 0.0);
+
+    for (size_t f = 0; f < prio_factors.size (); f++) {
+        double *col = &factor_values[f * n];
+        for (size_t i = 0; i < n; i++)
+            col[i] = prio_factors[f].fn (prio_jobs[i], &pass);
+    }
+
+    double *prio = job_priorities.data ();
+    for (size_t f = 0; f < prio_factors.size (); f++) {
+        const double w = prio_factors[f].weight;
+        const double *col = &factor_values[f * n];
+        for (size_t i = 0; i < n; i++)
+            prio[i] += w * col[i];
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (prio_jobs[i]->priority == prio[i])
+            continue;
+        prio_jobs[i]->priority = prio[i];
+        if (changed)
+            zlist_append (changed, prio_jobs[i]);
+    }
+}
+
+extern "C"
+void sched_priority_prioritize_jobs (flux_t *h, zlist_t *jobs)
+{
+    prioritize (jobs, NULL);
+}
+
+extern "C"
+void sched_priority_update_jobs (flux_t *h, zlist_t *jobs, zlist_t *changed)
+{
+    prioritize (jobs, changed);
+}
+
+/*
+ * A job's priority only moves with the fair-share factor of its
+ * association: the other factors are fixed once it is submitted.
+ * Recompute the factors and append to 'assocs' the handles (as cached
+ * in job->prio_assoc) of the associations whose factor changed.
+ * Return 1 instead if the tree gained or lost associations since the
+ * last call, as every job must then be resolved again.
+ */
+extern "C"
+int sched_priority_changed_assocs (flux_t *h, zlist_t *assocs)
+{
+    uint64_t gen = ptree.get_generation ();
+
+    changed_nodes.clear ();
+    ptree.calc_fs_factors (&changed_nodes);
+    if (gen != prio_generation) {
+        prio_generation = gen;
+        return 1;
+    }
+    for (auto node : changed_nodes)
+        if (zlist_append (assocs, node) < 0)
+            return 1;
+    return 0;
 }
 
 } // namespace Priority
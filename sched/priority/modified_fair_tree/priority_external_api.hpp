@@ -8,9 +8,12 @@ namespace Flux {
 namespace Priority {
 extern "C" {
 
-int sched_priority_setup (flux_t *h);
+int sched_priority_setup (flux_t *h, char *argz, size_t argz_len);
 int sched_priority_record_job_usage (flux_t *h, flux_lwj_t *job);
+int sched_priority_charge_job_usage (flux_t *h, flux_lwj_t *job, int64_t now);
 void sched_priority_prioritize_jobs (flux_t *h, zlist_t *jobs);
+void sched_priority_update_jobs (flux_t *h, zlist_t *jobs, zlist_t *changed);
+int sched_priority_changed_assocs (flux_t *h, zlist_t *assocs);
 
 } // extern "C"
 
@@ -0,0 +1,312 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "modified_fair_tree.hpp"
+#include "priority_external_api.hpp"
+#include "src/common/libtap/tap.h"
+
+namespace Flux {
+namespace Priority {
+extern priority_tree ptree;
+}
+}
+
+using namespace std;
+using namespace Flux::Priority;
+
+static bool near (double a, double b)
+{
+    return fabs (a - b) <= 1e-9 * (fabs (a) + fabs (b) + 1.0);
+}
+
+/* One account "a" under root with two users, u1 and u2, of equal shares */
+static void build_tree (priority_tree &t)
+{
+    t.update_start ();
+    t.update_add_account ("a", "root", 1);
+    t.update_add_user ("u1", "a", 1);
+    t.update_add_user ("u2", "a", 1);
+    t.update_finish ();
+}
+
+static void test_decay ()
+{
+    priority_tree t;
+
+    build_tree (t);
+    t.set_half_life (100.0);
+    prio_node *u1 = t.find_node ("a", "u1");
+    prio_node *u2 = t.find_node ("a", "u2");
+    ok (u1 && u2, "users of the tree are found");
+
+    t.add_usage (u1, 80.0, 1000.0);
+    ok (near (t.get_usage (u1, 1000.0), 80.0),
+        "usage is undecayed at the time it was charged");
+    ok (near (t.get_usage (u1, 1100.0), 40.0),
+        "usage is halved after one half-life");
+    ok (near (t.get_usage (u1, 1200.0), 20.0),
+        "usage is quartered after two half-lives");
+    ok (near (t.get_usage (u1, 1050.0), 80.0 * exp2 (-0.5)),
+        "usage decays continuously in between");
+    ok (near (t.get_usage (u1, 1100.0), 40.0),
+        "reading the usage does not decay it");
+
+    t.add_usage (u2, 40.0, 1100.0);
+    t.calc_fs_factors ();
+    ok (near (t.get_fair_share_factor (u1), t.get_fair_share_factor (u2)),
+        "decayed usage equal to a later charge gives an equal factor");
+
+    t.add_usage (u1, 80.0, 1000.0);
+    ok (near (t.get_usage (u1, 1100.0), 80.0),
+        "a charge older than the last one is decayed on the way in");
+    t.calc_fs_factors ();
+    ok (t.get_fair_share_factor (u1) < t.get_fair_share_factor (u2),
+        "more decayed usage gives a lower factor");
+}
+
+static void test_no_decay ()
+{
+    priority_tree t;
+
+    build_tree (t);
+    ok (t.get_half_life () == PRIO_USAGE_HALF_LIFE_DEFAULT,
+        "half-life defaults to one week");
+    t.set_half_life (0.0);
+    ok (t.get_half_life () == 0.0, "half-life can be set to 0");
+    prio_node *u1 = t.find_node ("a", "u1");
+    t.add_usage (u1, 80.0, 0.0);
+    ok (near (t.get_usage (u1, 1e9), 80.0),
+        "usage does not decay with a half-life of 0");
+    t.set_half_life (-5.0);
+    ok (t.get_half_life () == 0.0,
+        "a negative half-life disables decay as well");
+}
+
+/*
+ * Charge a running job on every pass and once more when it completes:
+ * every charge covers only the time since the previous one, and lands
+ * at the time it was taken.
+ */
+static void test_charge_running ()
+{
+    flux_res_t req = {};
+    flux_lwj_t job = {};
+    char user[] = "u1";
+    char account[] = "a";
+    double half_life = 100.0;
+    double expected;
+
+    build_tree (ptree);
+    ptree.set_half_life (half_life);
+    prio_node *u1 = ptree.find_node ("a", "u1");
+
+    req.nnodes = 2;
+    req.ncores = 4;
+    job.user = user;
+    job.account = account;
+    job.req = &req;
+    job.starttime = 100;
+
+    sched_priority_charge_job_usage (NULL, &job, 90);
+    ok (ptree.get_usage (u1, 100.0) == 0.0 && job.usage_time == 0,
+        "a job is not charged before it starts");
+
+    sched_priority_charge_job_usage (NULL, &job, 110);
+    expected = 10.0 * 8;
+    ok (near (ptree.get_usage (u1, 110.0), expected) && job.usage_time == 110,
+        "a running job is charged from its start time");
+
+    sched_priority_charge_job_usage (NULL, &job, 110);
+    sched_priority_charge_job_usage (NULL, &job, 105);
+    ok (near (ptree.get_usage (u1, 110.0), expected),
+        "a running job is charged only once for the same time");
+
+    sched_priority_charge_job_usage (NULL, &job, 210);
+    expected = expected * exp2 (-100.0 / half_life) + 100.0 * 8;
+    ok (near (ptree.get_usage (u1, 210.0), expected),
+        "the next charge covers only the time since the last one");
+
+    job.endtime = 260;
+    sched_priority_record_job_usage (NULL, &job);
+    expected = expected * exp2 (-50.0 / half_life) + 50.0 * 8;
+    ok (near (ptree.get_usage (u1, 260.0), expected)
+        && job.usage_time == 260,
+        "completion charges the remainder up to the end time");
+
+    sched_priority_record_job_usage (NULL, &job);
+    ok (near (ptree.get_usage (u1, 260.0), expected),
+        "a completed job is not charged twice");
+    ok (near (ptree.get_usage (ptree.find_node ("a", "u2"), 260.0), 0.0),
+        "other users are not charged");
+}
+
+/*
+ * Accounts A (with subaccount A1) and B under root, with users of
+ * uneven shares, so that the levels sort in different orders.
+ */
+static const struct {
+    const char *account;
+    const char *user;
+    const char *parent;
+    unsigned long shares;
+} assocs[] = {
+    { "A", NULL, "root", 2 },
+    { "B", NULL, "root", 1 },
+    { "A1", NULL, "A", 1 },
+    { "A", "u1", NULL, 1 },
+    { "A", "u2", NULL, 3 },
+    { "A1", "u3", NULL, 1 },
+    { "A1", "u4", NULL, 1 },
+    { "B", "u5", NULL, 1 },
+    { "B", "u6", NULL, 2 },
+    { NULL, NULL, NULL, 0 }
+};
+
+static const struct {
+    const char *account;
+    const char *user;
+    double usage;
+    double when;
+} charges[] = {
+    { "A", "u1", 500.0, 1000.0 },
+    { "A", "u2", 300.0, 1000.0 },
+    { "A1", "u4", 200.0, 1000.0 },
+    { "B", "u5", 100.0, 1000.0 },
+    { "B", "u6", 400.0, 1000.0 },
+    { "A1", "u3", 700.0, 2000.0 },
+    { "B", "u5", 900.0, 3000.0 },
+    { "A", "u2", 50.0, 2500.0 },
+};
+
+static void build_assocs (priority_tree &t)
+{
+    t.set_half_life (1000.0);
+    t.update_start ();
+    for (int i = 0; assocs[i].account; i++) {
+        if (assocs[i].user)
+            t.update_add_user (assocs[i].user, assocs[i].account,
+                               assocs[i].shares);
+        else
+            t.update_add_account (assocs[i].account, assocs[i].parent,
+                                  assocs[i].shares);
+    }
+    t.update_finish ();
+}
+
+static void charge (priority_tree &t, int i)
+{
+    t.add_usage (t.find_node (charges[i].account, charges[i].user),
+                 charges[i].usage, charges[i].when);
+}
+
+/* Return true if every association has the same factor in both trees */
+static bool same_factors (priority_tree &t1, priority_tree &t2)
+{
+    for (int i = 0; assocs[i].account; i++) {
+        prio_node *n1 = t1.find_node (assocs[i].account, assocs[i].user);
+        prio_node *n2 = t2.find_node (assocs[i].account, assocs[i].user);
+        if (!n1 || !n2
+            || !near (t1.get_fair_share_factor (n1),
+                      t2.get_fair_share_factor (n2))) {
+            diag ("%s %s: %f != %f", assocs[i].account,
+                  assocs[i].user ? assocs[i].user : "-",
+                  t1.get_fair_share_factor (n1),
+                  t2.get_fair_share_factor (n2));
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Charge one leaf at a time and recompute only what changed, then
+ * compare every association against a tree freshly built with the same
+ * charges and computed in one go.
+ */
+static void test_incremental ()
+{
+    const int ncharges = sizeof (charges) / sizeof (charges[0]);
+    const int first = 5;
+    priority_tree t;
+
+    build_assocs (t);
+    for (int i = 0; i < first; i++)
+        charge (t, i);
+    t.calc_fs_factors ();
+
+    for (int n = first; n < ncharges; n++) {
+        priority_tree fresh;
+        vector<prio_node *> changed;
+        prio_node *leaf = t.find_node (charges[n].account, charges[n].user);
+        double old_factor = t.get_fair_share_factor (leaf);
+
+        charge (t, n);
+        t.calc_fs_factors (&changed);
+        ok (t.get_fair_share_factor (leaf) != old_factor
+            && find (changed.begin (), changed.end (), leaf) != changed.end (),
+            "charging %s %s moves its factor and reports it changed",
+            charges[n].account, charges[n].user);
+
+        build_assocs (fresh);
+        for (int i = 0; i <= n; i++)
+            charge (fresh, i);
+        fresh.calc_fs_factors ();
+        ok (same_factors (t, fresh),
+            "after charging %s %s every factor matches a fresh tree",
+            charges[n].account, charges[n].user);
+    }
+
+    vector<prio_node *> changed;
+    t.calc_fs_factors (&changed);
+    ok (changed.empty (), "a recompute with no new usage changes nothing");
+}
+
+int main (int argc, char *argv[])
+{
+    plan (27);
+
+    test_decay ();
+
+    test_no_decay ();
+
+    test_charge_running ();
+
+    test_incremental ();
+
+    done_testing ();
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * vi: ts=4 sw=4 expandtab
+ */
@@ -31,6 +31,7 @@
 #endif
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 #include <czmq.h>
 #include <hwloc.h>
 
@@ -50,9 +51,15 @@
  * Each value of the partition hash table includes an
  * equivalent set of broker ranks that control and mananage
  * that partition.
+ * Every partition is also interned under a dense id: parts is
+ * indexed by it, so that once a node-type resrc_t object caches the
+ * id of its partition, its rank is resolved with no string hashing.
  */
 struct machs {
     zhash_t      *tab;
+    struct partition **parts;
+    int           nparts;
+    int           maxparts;
 };
 
 /* Each resource partition within a host holds an object of
@@ -66,8 +73,11 @@ struct rssig {
 
 typedef struct partition {
     struct rssig *sig;
-    int           rrobin;
-    zlist_t      *ranks;
+    int           id;
+    int           next;       /* round-robin cursor into ranks */
+    int           nranks;
+    int           maxranks;
+    uint32_t     *ranks;
 } partition_t;
 
 
@@ -105,8 +115,7 @@ static void partition_freefn (void *data)
             free (o->sig);
             o->sig = NULL;
         }
-        if (o->ranks)
-            zlist_destroy (&(o->ranks));
+        free (o->ranks);
         free (o);
         o = NULL;
     }
@@ -121,38 +130,103 @@ static inline void partition_tab_new (zhash_t *tab, const char *hn)
     zhash_freefn (tab, hn, partition_tab_freefn);
 }
 
-static inline void partition_new (zhash_t *partab, rssig_t *sig)
+static inline void partition_new (machs_t *m, zhash_t *partab, rssig_t *sig)
 {
     partition_t *nobj = (partition_t *)xzmalloc (sizeof (*nobj));
     nobj->sig = sig;
-    nobj->rrobin = 0;
-    if (!(nobj->ranks = zlist_new ()))
-        oom ();
+    nobj->next = 0;
+    if (m->nparts == m->maxparts) {
+        m->maxparts = m->maxparts ? 2 * m->maxparts : 16;
+        m->parts = xrealloc (m->parts, m->maxparts * sizeof (*m->parts));
+    }
+    nobj->id = m->nparts;
+    m->parts[m->nparts++] = nobj;
     zhash_insert (partab, sig->digest, (void *)nobj);
     zhash_freefn (partab, sig->digest, partition_freefn);
 }
 
 static int get_rank_rrobin (partition_t *part, uint32_t *rank)
 {
-    int rc = 0;
-    uint32_t *tmp;
-    if (!(part->ranks))
+    if (part->nranks == 0)
         return -1;
+    /* wrap to the first rank in the end */
+    if (part->next >= part->nranks)
+        part->next = 0;
+    *rank = part->ranks[part->next++];
+    return 0;
+}
 
-    if (part->rrobin && (tmp = zlist_next (part->ranks))) {
-        *rank = *tmp;
-        part->rrobin = 1;
-    }
-    else if ((tmp = zlist_first (part->ranks))) {
-        *rank = *tmp;
-        part->rrobin =1;
-    }
-    else
-        rc = -1;
+static partition_t *lookup_partition (machs_t *m, const char *hn,
+                                      const char *digest)
+{
+    zhash_t *partab = NULL;
+
+    if (!digest)
+        return NULL;
+    if (!hn)
+        partab = zhash_first (m->tab);
+    else if (host_seen (m->tab, hn))
+        partab = zhash_lookup (m->tab, hn);
+    return partab ? zhash_lookup (partab, digest) : NULL;
+}
+
+/* Return the partition of a node-type resrc_t object, interning its id
+ * in the object on first sight
+ */
+static partition_t *node_partition (machs_t *m, resrc_t *r, bool by_none)
+{
+    partition_t *part = NULL;
+    int id = resrc_digest_id (r);
+
+    if (id >= 0 && id < m->nparts)
+        return m->parts[id];
+    if ((part = lookup_partition (m, by_none ? NULL : resrc_name (r),
+                                  resrc_digest (r))))
+        resrc_set_digest_id (r, part->id);
+    return part;
+}
+
+static int index_tree (machs_t *m, resrc_tree_t *rt, bool by_none)
+{
+    resrc_tree_t *child = NULL;
+    resrc_t *r = resrc_tree_resrc (rt);
+    int rc = 0;
 
+    if (!strcmp (resrc_type (r), "node"))
+        return node_partition (m, r, by_none) ? 0 : -1;
+    if (resrc_tree_num_children (rt)) {
+        resrc_tree_list_t *children = resrc_tree_children (rt);
+        for (child = resrc_tree_list_first (children); child;
+             child = resrc_tree_list_next (children))
+            rc += index_tree (m, child, by_none);
+    }
     return rc;
 }
 
+static int resolve_tree (machs_t *m, resrc_tree_t *rt, bool by_none,
+                         uint32_t *ranks, size_t len, size_t *n)
+{
+    resrc_tree_t *child = NULL;
+    resrc_t *r = resrc_tree_resrc (rt);
+    partition_t *part = NULL;
+
+    if (!strcmp (resrc_type (r), "node")) {
+        if (*n >= len || !(part = node_partition (m, r, by_none))
+            || get_rank_rrobin (part, &ranks[*n]) != 0)
+            return -1;
+        (*n)++;
+        return 0;
+    }
+    if (resrc_tree_num_children (rt)) {
+        resrc_tree_list_t *children = resrc_tree_children (rt);
+        for (child = resrc_tree_list_first (children); child;
+             child = resrc_tree_list_next (children))
+            if (resolve_tree (m, child, by_none, ranks, len, n) != 0)
+                return -1;
+    }
+    return 0;
+}
+
 
 /******************************************************************************
  *                                                                            *
@@ -174,6 +248,7 @@ void rs2rank_tab_destroy (machs_t *m)
     if (m) {
         if (m->tab)
             zhash_destroy (&(m->tab));
+        free (m->parts);
         free (m);
     }
 }
@@ -182,16 +257,11 @@ int rs2rank_tab_query_by_sign (machs_t *m, const char *hn, const char *digest,
                                 bool reset, uint32_t *rank)
 {
     int rc = -1;
-    zhash_t *partab = NULL;
     partition_t *part = NULL;
-    if (!host_seen (m->tab, hn))
-        goto done;
-    if (!(partab = zhash_lookup (m->tab, hn)))
-        goto done;
-    if (!(part = zhash_lookup (partab, digest)))
+    if (!hn || !(part = lookup_partition (m, hn, digest)))
         goto done;
     if (reset)
-        part->rrobin = 0;
+        part->next = 0;
     if (get_rank_rrobin (part, rank) != 0)
         goto done;
 
@@ -204,14 +274,11 @@ int rs2rank_tab_query_by_none (machs_t *m, const char *digest,
                                bool reset, uint32_t *rank)
 {
     int rc = -1;
-    zhash_t *partab = NULL;
     partition_t *part = NULL;
-    if (!(partab = zhash_first (m->tab)))
-        goto done;
-    if (!(part = zhash_lookup (partab, digest)))
+    if (!(part = lookup_partition (m, NULL, digest)))
         goto done;
     if (reset)
-        part->rrobin = 0;
+        part->next = 0;
     if (get_rank_rrobin (part, rank) != 0)
         goto done;
     rc = 0;
@@ -219,10 +286,28 @@ done:
     return rc;
 }
 
+int rs2rank_tab_index (machs_t *m, resrc_tree_t *rt, bool by_none)
+{
+    if (!m || !rt)
+        return -1;
+    return index_tree (m, rt, by_none) ? -1 : 0;
+}
+
+ssize_t rs2rank_tab_resolve_tree (machs_t *m, resrc_tree_t *rt, bool by_none,
+                                  uint32_t *ranks, size_t len)
+{
+    size_t n = 0;
+
+    if (!m || !rt || !ranks)
+        return -1;
+    if (resolve_tree (m, rt, by_none, ranks, len, &n) != 0)
+        return -1;
+    return (ssize_t)n;
+}
+
 int rs2rank_tab_update (machs_t *m, const char *hn, rssig_t *sig, uint32_t rank)
 {
     int rc = -1;
-    uint32_t *rcp = NULL;
     partition_t *robj = NULL;
     zhash_t *partab = NULL;
 
@@ -234,17 +319,17 @@ int rs2rank_tab_update (machs_t *m, const char *hn, rssig_t *sig, uint32_t rank)
     if (!(partab = zhash_lookup (m->tab, hn)))
         goto done;
     else if (!partition_seen (partab, sig->digest))
-        partition_new (partab, sig);
+        partition_new (m, partab, sig);
 
     if (!(robj = zhash_lookup (partab, sig->digest)))
         goto done;
 
-    rcp = xzmalloc (sizeof (*rcp));
-    *rcp = rank;
-    if (zlist_append (robj->ranks, (void *)rcp) != 0)
-        goto done;
-    else if (!zlist_freefn (robj->ranks, (void *)rcp, free, false))
-        goto done;
+    if (robj->nranks == robj->maxranks) {
+        robj->maxranks = robj->maxranks ? 2 * robj->maxranks : 4;
+        robj->ranks = xrealloc (robj->ranks,
+                                robj->maxranks * sizeof (*robj->ranks));
+    }
+    robj->ranks[robj->nranks++] = rank;
     rc = 0;
 
 done:
@@ -25,7 +25,9 @@
 #ifndef RS2RANK_H
 #define RS2RANK_H 1
 
+#include <sys/types.h>
 #include <hwloc.h>
+#include "resrc_tree.h"
 
 typedef struct machs machs_t;
 typedef struct rssig rssig_t;
@@ -74,6 +76,22 @@ int rs2rank_tab_query_by_sign (machs_t *m, const char *hn, const char *digest,
 int rs2rank_tab_query_by_none (machs_t *m, const char *digest,
                                bool reset, uint32_t *rank);
 
+/* Cache in every node-type resrc_t object of the tree rt the id of the
+ * partition its hostname and digest map to (or that its digest maps to
+ * in the first host if by_none), so that resolving its rank later needs
+ * no hashing.  Call once the resources are linked to the table.
+ * Return -1 if a node matches no partition.
+ */
+int rs2rank_tab_index (machs_t *m, resrc_tree_t *rt, bool by_none);
+
+/* Resolve the broker ranks of all node-type resrc_t objects of the tree
+ * rt at once, in depth-first order, into ranks (of len entries).  Nodes
+ * not yet indexed are indexed on the way.  Return the number of ranks
+ * resolved or -1 if a node matches no partition or ranks is too short.
+ */
+ssize_t rs2rank_tab_resolve_tree (machs_t *m, resrc_tree_t *rt, bool by_none,
+                                  uint32_t *ranks, size_t len);
+
 
 /* Allocate and set signature s using the hwloc xml string (rsb), its length,
  * optional auxiliary information and hwloc obj. s should be freed
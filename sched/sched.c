@@ -49,6 +49,10 @@
 #include "resrc_reqst.h"
 #include "rs2rank.h"
 #include "rsreader.h"
+#include "jobqueue.h"
+#include "jscbatch.h"
+#include "schedstats.h"
+#include "schedpass.h"
 #include "scheduler.h"
 #include "plugin.h"
 
@@ -57,7 +61,8 @@
 #define DYNAMIC_SCHEDULING 0
 #define ENABLE_TIMER_EVENT 0
 #define SCHED_UNIMPL -1
-#define GET_ROOT_RESRC(rsapi) resrc_tree_resrc (resrc_tree_root ((rsapi)))
+#define CQ_RETAIN_DEFAULT 4096     /* max jobs kept in the complete queue */
+#define CQ_MAX_AGE_DEFAULT 0       /* max seconds kept there; 0: no limit */
 
 #if ENABLE_TIMER_EVENT
 static int timer_event_cb (flux_t *h, void *arg);
@@ -78,6 +83,8 @@ static void sched_params_set_request_cb (flux_t *h, flux_msg_handler_t *w,
                               const flux_msg_t *msg, void *arg);
 static void sched_params_get_request_cb (flux_t *h, flux_msg_handler_t *w,
                               const flux_msg_t *msg, void *arg);
+static void sched_stats_request_cb (flux_t *h, flux_msg_handler_t *w,
+                              const flux_msg_t *msg, void *arg);
 static int job_status_cb (const char *jcbstr, void *arg, int errnum);
 
 
@@ -105,6 +112,10 @@ typedef struct {
     zlist_t      *res_queue;
     zlist_t      *jsc_queue;
     zlist_t      *timer_queue;
+    json_t       *triggers;           /* A sample per trigger, for sched.stats */
+    int64_t       npasses;            /* Passes made in the current trigger */
+    uint64_t      pass_ns;            /* Their wall time */
+    uint64_t      plugin_ns;          /* Part of pass_ns in plugin callbacks */
 } simctx_t;
 
 typedef struct {
@@ -113,28 +124,34 @@ typedef struct {
     char         *userplugin;
     char         *userplugin_opts;
     char         *prio_plugin;
+    char         *prio_plugin_opts;
     bool          reap;               /* Enable job reap support */
     bool          node_excl;          /* Node exclusive */
     bool          sim;
+    bool          sim_charge;         /* Charge sched run time to sim time */
     bool          schedonce;          /* Use resources only once */
     bool          fail_on_error;      /* Fail immediately on error */
+    bool          jsc_batch;          /* Batch jcb updates and run requests */
     int           verbosity;
+    int64_t       cq_retain;          /* Max jobs kept in complete queue */
+    int64_t       cq_max_age;         /* Max seconds kept in complete queue */
+    char         *cq_archive;         /* File evicted jobs are archived to */
     rsreader_t    r_mode;
     sched_params_t s_params;
 } ssrvarg_t;
 
-/* TODO: Implement prioritization function for p_queue */
 typedef struct {
     flux_t       *h;
-    zhash_t      *job_index;          /* For fast job lookup for all queues*/
-    zlist_t      *p_queue;            /* Pending job priority queue */
+    jobqueue_t   *jobs;               /* Indexed pending/running/complete q */
     bool          pq_state;           /* schedulable state change in p_queue */
-    zlist_t      *r_queue;            /* Running job queue */
-    zlist_t      *c_queue;            /* Complete/cancelled job queue */
     machs_t      *machs;              /* Helps resolve resources to ranks */
-    bool          ooo_capable;        /* sched policy schedule jobs out of order */
     ssrvarg_t     arg;                /* args passed to this module */
     simctx_t      sctx;               /* simulator context */
+    FILE         *archive;            /* Archive of evicted complete jobs */
+    jscbatch_t   *batch;              /* Batched jcb updates if non-NULL */
+    flux_watcher_t *flush;            /* Applies the batch once per loop */
+    schedstats_t *stats;              /* Per-phase latency histograms */
+    schedpass_t  *pass;               /* Scheduling pass over the p_queue */
     resrc_api_ctx_t *rsapi;           /* resrc_api handle */
     struct sched_plugin_loader *loader; /* plugin loader */
     flux_watcher_t *before;
@@ -145,6 +162,7 @@ typedef struct {
 } ssrvctx_t;
 
 static int schedule_jobs (ssrvctx_t *ctx);  /* Forward declaration */
+static void q_flush_batch (ssrvctx_t *ctx);  /* Forward declaration */
 
 /******************************************************************************
  *                                                                            *
@@ -208,12 +226,18 @@ static inline void ssrvarg_init (ssrvarg_t *arg)
     arg->userplugin = NULL;
     arg->userplugin_opts = NULL;
     arg->prio_plugin = NULL;
+    arg->prio_plugin_opts = NULL;
     arg->reap = false;
     arg->node_excl = false;
     arg->sim = false;
+    arg->sim_charge = true;
     arg->schedonce = false;
     arg->fail_on_error = false;
+    arg->jsc_batch = false;
     arg->verbosity = 0;
+    arg->cq_retain = CQ_RETAIN_DEFAULT;
+    arg->cq_max_age = CQ_MAX_AGE_DEFAULT;
+    arg->cq_archive = NULL;
     sched_params_default (&(arg->s_params));
 }
 
@@ -224,6 +248,8 @@ static inline void ssrvarg_free (ssrvarg_t *arg)
     free (arg->userplugin);
     free (arg->userplugin_opts);
     free (arg->prio_plugin);
+    free (arg->prio_plugin_opts);
+    free (arg->cq_archive);
 }
 
 static inline int ssrvarg_process_args (int argc, char **argv, ssrvarg_t *a)
@@ -235,7 +261,11 @@ static inline int ssrvarg_process_args (int argc, char **argv, ssrvarg_t *a)
     char *immediate = NULL;
     char *vlevel= NULL;
     char *sim = NULL;
+    char *sim_charge = NULL;
     char *sprms = NULL;
+    char *retain = NULL;
+    char *max_age = NULL;
+    char *jsc_batch = NULL;
     for (i = 0; i < argc; i++) {
         if (!strncmp ("rdl-conf=", argv[i], sizeof ("rdl-conf"))) {
             a->path = xstrdup (strstr (argv[i], "=") + 1);
@@ -254,6 +284,8 @@ static inline int ssrvarg_process_args (int argc, char **argv, ssrvarg_t *a)
             a->uri = xstrdup (strstr (argv[i], "=") + 1);
         } else if (!strncmp ("in-sim=", argv[i], sizeof ("in-sim"))) {
             sim = xstrdup (strstr (argv[i], "=") + 1);
+        } else if (!strncmp ("sim-charge=", argv[i], sizeof ("sim-charge"))) {
+            sim_charge = xstrdup (strstr (argv[i], "=") + 1);
         } else if (!strncmp ("plugin=", argv[i], sizeof ("plugin"))) {
             a->userplugin = xstrdup (strstr (argv[i], "=") + 1);
         } else if (!strncmp ("plugin-opts=", argv[i], sizeof ("plugin-opts"))) {
@@ -261,8 +293,19 @@ static inline int ssrvarg_process_args (int argc, char **argv, ssrvarg_t *a)
         } else if (!strncmp ("priority-plugin=", argv[i],
                              sizeof ("priority-plugin"))) {
             a->prio_plugin = xstrdup (strstr (argv[i], "=") + 1);
+        } else if (!strncmp ("priority-opts=", argv[i],
+                             sizeof ("priority-opts"))) {
+            a->prio_plugin_opts = xstrdup (strstr (argv[i], "=") + 1);
         } else if (!strncmp ("sched-params=", argv[i], sizeof ("sched-params"))) {
             sprms = xstrdup (strstr (argv[i], "=") + 1);
+        } else if (!strncmp ("cq-retain=", argv[i], sizeof ("cq-retain"))) {
+            retain = xstrdup (strstr (argv[i], "=") + 1);
+        } else if (!strncmp ("cq-max-age=", argv[i], sizeof ("cq-max-age"))) {
+            max_age = xstrdup (strstr (argv[i], "=") + 1);
+        } else if (!strncmp ("cq-archive=", argv[i], sizeof ("cq-archive"))) {
+            a->cq_archive = xstrdup (strstr (argv[i], "=") + 1);
+        } else if (!strncmp ("jsc-batch=", argv[i], sizeof ("jsc-batch"))) {
+            jsc_batch = xstrdup (strstr (argv[i], "=") + 1);
         } else {
             rc = -1;
             errno = EINVAL;
@@ -281,6 +324,19 @@ static inline int ssrvarg_process_args (int argc, char **argv, ssrvarg_t *a)
         a->sim = true;
         free (sim);
     }
+    /* with in-sim=true, sim-charge=false keeps the scheduler's own run
+     * time out of the simulated time, so that replays are reproducible */
+    if (sim_charge) {
+        if (!strncmp (sim_charge, "false", sizeof ("false")))
+            a->sim_charge = false;
+        else if (strncmp (sim_charge, "true", sizeof ("true")))
+            rc = -1;
+        free (sim_charge);
+        if (rc < 0) {
+            errno = EINVAL;
+            goto done;
+        }
+    }
     if (node_excl && !strncmp (node_excl, "true", sizeof ("true"))) {
         a->node_excl = true;
         free (node_excl);
@@ -293,10 +349,32 @@ static inline int ssrvarg_process_args (int argc, char **argv, ssrvarg_t *a)
         a->fail_on_error = true;
         free (immediate);
     }
+    if (jsc_batch && !strncmp (jsc_batch, "true", sizeof ("true"))) {
+        a->jsc_batch = true;
+        free (jsc_batch);
+    }
     if (vlevel) {
          a->verbosity = strtol(vlevel, (char **)NULL, 10);
          free (vlevel);
     }
+    if (retain) {
+        a->cq_retain = strtoll (retain, (char **)NULL, 10);
+        free (retain);
+        if (a->cq_retain < 0) {
+            rc = -1;
+            errno = EINVAL;
+            goto done;
+        }
+    }
+    if (max_age) {
+        a->cq_max_age = strtoll (max_age, (char **)NULL, 10);
+        free (max_age);
+        if (a->cq_max_age < 0) {
+            rc = -1;
+            errno = EINVAL;
+            goto done;
+        }
+    }
     if (a->path)
         a->r_mode = (a->sim)? RSREADER_RESRC_EMUL : RSREADER_RESRC;
     else
@@ -383,21 +461,26 @@ done:
 static void freectx (void *arg)
 {
     ssrvctx_t *ctx = arg;
-    zhash_destroy (&(ctx->job_index));
-    zlist_destroy (&(ctx->p_queue));
-    zlist_destroy (&(ctx->r_queue));
-    zlist_destroy (&(ctx->c_queue));
+    jobqueue_destroy (ctx->jobs);
     rs2rank_tab_destroy (ctx->machs);
     ssrvarg_free (&(ctx->arg));
     resrc_tree_destroy (ctx->rsapi, resrc_tree_root (ctx->rsapi), true, true);
     resrc_api_fini (ctx->rsapi);
     free_simstate (ctx->sctx.sim_state);
+    if (ctx->archive)
+        fclose (ctx->archive);
+    flux_watcher_destroy (ctx->flush);
+    jscbatch_destroy (ctx->batch);
+    schedpass_destroy (ctx->pass);
+    schedstats_destroy (ctx->stats);
     if (ctx->sctx.res_queue)
         zlist_destroy (&(ctx->sctx.res_queue));
     if (ctx->sctx.jsc_queue)
         zlist_destroy (&(ctx->sctx.jsc_queue));
     if (ctx->sctx.timer_queue)
         zlist_destroy (&(ctx->sctx.timer_queue));
+    if (ctx->sctx.triggers)
+        Jput (ctx->sctx.triggers);
     if (ctx->loader)
         sched_plugin_loader_destroy (ctx->loader);
     if (ctx->before)
@@ -417,18 +500,12 @@ static ssrvctx_t *getctx (flux_t *h)
     if (!ctx) {
         ctx = xzmalloc (sizeof (*ctx));
         ctx->h = h;
-        if (!(ctx->job_index = zhash_new ()))
-            oom ();
-        if (!(ctx->p_queue = zlist_new ()))
+        if (!(ctx->jobs = jobqueue_new ()))
             oom ();
+        ctx->stats = schedstats_new ();
         ctx->pq_state = false;
-        if (!(ctx->r_queue = zlist_new ()))
-            oom ();
-        if (!(ctx->c_queue = zlist_new ()))
-            oom ();
         if (!(ctx->machs = rs2rank_tab_new ()))
             oom ();
-        ctx->ooo_capable = true;
         ssrvarg_init (&(ctx->arg));
         ctx->rsapi = resrc_api_init ();
         ctx->sctx.in_sim = false;
@@ -436,7 +513,11 @@ static ssrvctx_t *getctx (flux_t *h)
         ctx->sctx.res_queue = NULL;
         ctx->sctx.jsc_queue = NULL;
         ctx->sctx.timer_queue = NULL;
+        ctx->sctx.triggers = NULL;
+        ctx->archive = NULL;
+        ctx->batch = NULL;
         ctx->loader = NULL;
+        ctx->pass = NULL;
         ctx->before = NULL;
         ctx->after = NULL;
         ctx->idle = NULL;
@@ -543,6 +624,22 @@ static int plugin_process_args (ssrvctx_t *ctx, char *userplugin_opts)
     return rc;
 }
 
+static int priority_setup (ssrvctx_t *ctx,
+                           struct priority_plugin *priority_plugin,
+                           char *prio_plugin_opts)
+{
+    int rc = -1;
+    char *argz = NULL;
+    size_t argz_len = 0;
+
+    if (prio_plugin_opts)
+        argz_create_sep (prio_plugin_opts, ',', &argz, &argz_len);
+    rc = priority_plugin->priority_setup (ctx->h, argz, argz_len);
+    free (argz);
+
+    return rc;
+}
+
 
 /********************************************************************************
  *                                                                              *
@@ -552,9 +649,9 @@ static int plugin_process_args (ssrvctx_t *ctx, char *userplugin_opts)
 
 static int q_enqueue_into_pqueue (ssrvctx_t *ctx, json_t *jcb)
 {
-    int rc = -1;
     int64_t jid = -1;
-    char *key = NULL;
+    int rc = -1;
+    uint64_t t0 = 0;
     flux_lwj_t *job = NULL;
 
     get_jobid (jcb, &jid);
@@ -564,31 +661,36 @@ static int q_enqueue_into_pqueue (ssrvctx_t *ctx, json_t *jcb)
     job->lwj_id = jid;
     job->state = J_NULL;
     job->submittime = time (NULL);
-    if (zlist_append (ctx->p_queue, job) != 0) {
-        flux_log (ctx->h, LOG_ERR, "failed to append to pending job queue.");
-        goto done;
-    }
-    job->enqueue_pos = (int64_t)zlist_size (ctx->p_queue);
-    key = xasprintf ("%"PRId64"", jid);
-    if (zhash_insert(ctx->job_index, key, job) != 0) {
-        flux_log (ctx->h, LOG_ERR, "failed to index a job.");
-        goto done;
+    /* the job queue only indexes the job; the job is freed by action () */
+    t0 = schedstats_now ();
+    rc = jobqueue_pending_add (ctx->jobs, job);
+    schedstats_record (ctx->stats, SCHEDSTATS_QUEUE_ADD, t0);
+    if (rc != 0) {
+        flux_log (ctx->h, LOG_ERR, "failed to enqueue and index job "
+                  "%"PRId64".", jid);
+        free (job);
+        return -1;
     }
-    /* please don't free the job using job_index; this is just a lookup table */
-    rc = 0;
-done:
-    free (key);
-    return rc;
+    return 0;
 }
 
 static flux_lwj_t *q_find_job (ssrvctx_t *ctx, int64_t id)
 {
-    flux_lwj_t *j = NULL;
-    char *key = NULL;
-    key = xasprintf ("%"PRId64"", id);
-    j = zhash_lookup (ctx->job_index, key);
-    free (key);
-    return j;
+    uint64_t t0 = schedstats_now ();
+    flux_lwj_t *job = jobqueue_find (ctx->jobs, id);
+
+    schedstats_record (ctx->stats, SCHEDSTATS_QUEUE_FIND, t0);
+    return job;
+}
+
+/* Move a job to queue q, accounting for the time it takes */
+static int q_move (ssrvctx_t *ctx, flux_lwj_t *j, jobq_kind_t q)
+{
+    uint64_t t0 = schedstats_now ();
+    int rc = jobqueue_move (ctx->jobs, j, q);
+
+    schedstats_record (ctx->stats, SCHEDSTATS_QUEUE_MOVE, t0);
+    return rc;
 }
 
 static int q_mark_schedulability (ssrvctx_t *ctx, flux_lwj_t *job)
@@ -603,7 +705,7 @@ static int q_mark_schedulability (ssrvctx_t *ctx, flux_lwj_t *job)
 
 static void q_rm_from_pqueue (ssrvctx_t *ctx, flux_lwj_t *j)
 {
-    zlist_remove (ctx->p_queue, j);
+    q_move (ctx, j, JOBQ_NONE);
     /* dequeue operation should always be a schedulable queue operation */
     if (ctx->pq_state == false)
         ctx->pq_state = true;
@@ -611,7 +713,7 @@ static void q_rm_from_pqueue (ssrvctx_t *ctx, flux_lwj_t *j)
 
 static void q_rm_from_rqueue (ssrvctx_t *ctx, flux_lwj_t *j)
 {
-    zlist_remove (ctx->r_queue, j);
+    q_move (ctx, j, JOBQ_NONE);
     /* dequeue operation should always be a schedulable queue operation */
     if (ctx->pq_state == false)
         ctx->pq_state = true;
@@ -619,20 +721,135 @@ static void q_rm_from_rqueue (ssrvctx_t *ctx, flux_lwj_t *j)
 
 static int q_move_to_rqueue (ssrvctx_t *ctx, flux_lwj_t *j)
 {
-    zlist_remove (ctx->p_queue, j);
     /* dequeue operation should always be a schedulable queue operation */
     if (ctx->pq_state == false)
         ctx->pq_state = true;
-    return zlist_append (ctx->r_queue, j);
+    return q_move (ctx, j, JOBQ_RUNNING);
+}
+
+/* Record a change that may let a blocked job be scheduled: resources
+ * excluded, or the pending queue reordered ahead of blocked jobs. Every
+ * blocked job is retried by the next scheduling pass.
+ */
+static inline void q_rs_changed (ssrvctx_t *ctx)
+{
+    schedpass_rs_changed (ctx->pass);
+}
+
+/* Record that resources were released or included, or that a pending
+ * job was cancelled along with its reservation */
+static inline void q_rs_released (ssrvctx_t *ctx)
+{
+    schedpass_rs_released (ctx->pass);
+}
+
+/* Release the resources of a job and let the behavior plugin know */
+static int q_release_resrc (ssrvctx_t *ctx, flux_lwj_t *j)
+{
+    struct behavior_plugin *plugin = behavior_plugin_get (ctx->loader);
+    int rc = resrc_tree_release (j->resrc_tree, j->lwj_id);
+
+    if (plugin && plugin->job_end)
+        plugin->job_end (j);
+    return rc;
+}
+
+/* Unlink the job from whatever queue it is in and drop it from the index */
+static void q_unindex_job (ssrvctx_t *ctx, flux_lwj_t *j)
+{
+    uint64_t t0 = schedstats_now ();
+
+    jobqueue_remove (ctx->jobs, j);
+    schedstats_record (ctx->stats, SCHEDSTATS_QUEUE_MOVE, t0);
+}
+
+static inline int64_t q_now (ssrvctx_t *ctx)
+{
+    return (ctx->sctx.in_sim) ?
+        (int64_t) ctx->sctx.sim_state->sim_time : epochtime ();
+}
+
+/* Append a compact, one-line JSON record of job to the archive file */
+static void q_archive_job (ssrvctx_t *ctx, flux_lwj_t *j)
+{
+    char *s = NULL;
+    json_t *o = NULL;
+
+    if (!ctx->archive)
+        return;
+    o = Jnew ();
+    Jadd_int64 (o, "jobid", j->lwj_id);
+    Jadd_str (o, "state", jsc_job_num2state (j->state));
+    Jadd_int64 (o, "submittime", j->submittime);
+    Jadd_int64 (o, "starttime", j->starttime);
+    Jadd_int64 (o, "endtime", j->endtime);
+    if (j->req) {
+        Jadd_int64 (o, "nnodes", (int64_t)j->req->nnodes);
+        Jadd_int64 (o, "ncores", (int64_t)j->req->ncores);
+        Jadd_int64 (o, "ngpus", (int64_t)j->req->ngpus);
+        Jadd_int64 (o, "walltime", (int64_t)j->req->walltime);
+    }
+    if (j->user)
+        Jadd_str (o, "user", j->user);
+    if (j->account)
+        Jadd_str (o, "account", j->account);
+    s = Jtostr (o);
+    if (fprintf (ctx->archive, "%s\n", s) < 0)
+        flux_log (ctx->h, LOG_ERR, "%s: failed to archive job %"PRId64"",
+                  __FUNCTION__, j->lwj_id);
+    free (s);
+    Jput (o);
+}
+
+/* Drop a job from the complete queue before it is reaped: archive it,
+ * account for its usage as reaping would have, and free it.
+ */
+static void q_evict_job (ssrvctx_t *ctx, flux_lwj_t *j)
+{
+    struct priority_plugin *priority_plugin = priority_plugin_get (ctx->loader);
+
+    flux_log (ctx->h, LOG_DEBUG, "evicting %s job %"PRId64" from complete "
+              "queue", jsc_job_num2state (j->state), j->lwj_id);
+    q_archive_job (ctx, j);
+    if (priority_plugin && j->state == J_COMPLETE)
+        priority_plugin->record_job_usage (ctx->h, j);
+    q_unindex_job (ctx, j);
+    if (j->resrc_tree)
+        resrc_tree_destroy (ctx->rsapi, j->resrc_tree, false, false);
+    free (j->req);
+    free (j->user);
+    free (j->account);
+    free (j);
+}
+
+/* Bound the complete queue by count and by age, oldest first */
+static void q_retire_cqueue (ssrvctx_t *ctx)
+{
+    flux_lwj_t *j = NULL;
+    int64_t now = q_now (ctx);
+    int64_t retain = ctx->arg.cq_retain;
+    int64_t max_age = ctx->arg.cq_max_age;
+
+    while ((j = jobqueue_first (ctx->jobs, JOBQ_COMPLETE))) {
+        if ((int64_t)jobqueue_size (ctx->jobs, JOBQ_COMPLETE) <= retain
+            && (max_age == 0 || (now - j->endtime) <= max_age))
+            break;
+        q_evict_job (ctx, j);
+    }
+    if (ctx->archive)
+        fflush (ctx->archive);
 }
 
 static int q_move_to_cqueue (ssrvctx_t *ctx, flux_lwj_t *j)
 {
-    zlist_remove (ctx->r_queue, j);
+    int rc = 0;
     /* dequeue operation should always be a schedulable queue operation */
     if (ctx->pq_state == false)
         ctx->pq_state = true;
-    return zlist_append (ctx->c_queue, j);
+    j->endtime = q_now (ctx);
+    if ((rc = q_move (ctx, j, JOBQ_COMPLETE)) == 0)
+        q_retire_cqueue (ctx);
+    return rc;
 }
 
 static flux_lwj_t *fetch_job_and_event (ssrvctx_t *ctx, json_t *jcb,
@@ -828,6 +1045,12 @@ static int load_resources (ssrvctx_t *ctx)
         break;
     }
 
+    /* intern the partition of every node now that all are linked: a node
+     * left out is indexed again, and may fail, once it is allocated */
+    if (rc == 0 && rs2rank_tab_index (ctx->machs, resrc_tree_root (ctx->rsapi),
+                                      ctx->sctx.in_sim) != 0)
+        flux_log (ctx->h, LOG_INFO, "some nodes map to no broker rank");
+
 done:
     return rc;
 }
@@ -995,6 +1218,29 @@ static void sim_res_event_cb (flux_t *h, flux_msg_handler_t *w,
     zlist_append (ctx->sctx.res_queue, event);
 }
 
+/* Sample what the trigger that started at t0 did: the queue lengths it
+ * left, the passes it made and the wall time it and they took.
+ */
+static void sample_trigger (ssrvctx_t *ctx, double now, uint64_t t0)
+{
+    json_t *o = Jnew ();
+
+    Jadd_double (o, "time", now);
+    Jadd_int64 (o, "pending",
+                (int64_t)jobqueue_size (ctx->jobs, JOBQ_PENDING));
+    Jadd_int64 (o, "running",
+                (int64_t)jobqueue_size (ctx->jobs, JOBQ_RUNNING));
+    Jadd_int64 (o, "passes", ctx->sctx.npasses);
+    Jadd_int64 (o, "ns", (int64_t)(schedstats_now () - t0));
+    Jadd_int64 (o, "sched_ns", (int64_t)ctx->sctx.pass_ns);
+    Jadd_int64 (o, "plugin_ns", (int64_t)ctx->sctx.plugin_ns);
+    Jadd_ar_obj (ctx->sctx.triggers, o);
+    Jput (o);
+    ctx->sctx.npasses = 0;
+    ctx->sctx.pass_ns = 0;
+    ctx->sctx.plugin_ns = 0;
+}
+
 static void trigger_cb (flux_t *h,
                         flux_msg_handler_t *w,
                         const flux_msg_t *msg,
@@ -1002,10 +1248,12 @@ static void trigger_cb (flux_t *h,
 {
     clock_t start, diff;
     double seconds;
+    double now;
     bool sched_loop;
     const char *json_str = NULL;
     json_t *o = NULL;
     ssrvctx_t *ctx = getctx (h);
+    uint64_t t0 = schedstats_now ();
 
     if (flux_request_decode (msg, NULL, &json_str) < 0 || json_str == NULL
         || !(o = Jfromstr (json_str))) {
@@ -1014,8 +1262,10 @@ static void trigger_cb (flux_t *h,
         return;
     }
 
+    /* triggers carry only the timers changed since our last one */
     flux_log (h, LOG_DEBUG, "Setting sim_state to new values");
-    ctx->sctx.sim_state = json_to_sim_state (o);
+    ctx->sctx.sim_state = sim_state_update (ctx->sctx.sim_state, o);
+    now = ctx->sctx.sim_state->sim_time;
     ev_prep_cb (NULL, NULL, 0, ctx);
 
     start = clock ();
@@ -1026,7 +1276,8 @@ static void trigger_cb (flux_t *h,
     sched_loop = true;
     diff = clock () - start;
     seconds = ((double)diff) / CLOCKS_PER_SEC;
-    ctx->sctx.sim_state->sim_time += seconds;
+    if (ctx->arg.sim_charge)
+        ctx->sctx.sim_state->sim_time += seconds;
     if (sched_loop) {
         flux_log (h,
                   LOG_DEBUG,
@@ -1040,12 +1291,11 @@ static void trigger_cb (flux_t *h,
     }
 
     ev_check_cb (NULL, NULL, 0, ctx);
+    q_flush_batch (ctx);
     handle_timer_queue (ctx, ctx->sctx.sim_state);
+    sample_trigger (ctx, now, t0);
 
     send_reply_request (h, "sched", ctx->sctx.sim_state);
-
-    free_simstate (ctx->sctx.sim_state);
-    ctx->sctx.sim_state = NULL;
     Jput (o);
 }
 
@@ -1062,6 +1312,7 @@ static void trigger_cb (flux_t *h,
 static const struct flux_msg_handler_spec sim_htab[] = {
     {FLUX_MSGTYPE_EVENT, "sim.start", start_cb, 0},
     {FLUX_MSGTYPE_REQUEST, "sched.trigger", trigger_cb, 0},
+    {FLUX_MSGTYPE_REQUEST, "sched.stats", sched_stats_request_cb, 0},
     {FLUX_MSGTYPE_EVENT, "sched.res.*", sim_res_event_cb, 0},
     FLUX_MSGHANDLER_TABLE_END,
 };
@@ -1107,6 +1358,7 @@ static int setup_sim (ssrvctx_t *ctx, bool sim)
         ctx->sctx.res_queue = zlist_new ();
         ctx->sctx.jsc_queue = zlist_new ();
         ctx->sctx.timer_queue = zlist_new ();
+        ctx->sctx.triggers = Jnew_ar ();
     }
     else
         rc = -1;
@@ -1127,6 +1379,7 @@ static const struct flux_msg_handler_spec htab[] = {
     { FLUX_MSGTYPE_REQUEST,   "sched.include",  include_request_cb, 0},
     { FLUX_MSGTYPE_REQUEST,   "sched.params.set", sched_params_set_request_cb, 0},
     { FLUX_MSGTYPE_REQUEST,   "sched.params.get", sched_params_get_request_cb, 0},
+    { FLUX_MSGTYPE_REQUEST,   "sched.stats", sched_stats_request_cb, 0},
     { FLUX_MSGTYPE_EVENT,     "sched.res.*",  res_event_cb, 0},
     FLUX_MSGHANDLER_TABLE_END
 };
@@ -1219,7 +1472,7 @@ done:
     return rc;
 }
 
-static inline int bridge_send_runrequest (ssrvctx_t *ctx, flux_lwj_t *job)
+static inline int bridge_send_runrequest (ssrvctx_t *ctx, int64_t jobid)
 {
     int rc = -1;
     flux_t *h = ctx->h;
@@ -1228,7 +1481,7 @@ static inline int bridge_send_runrequest (ssrvctx_t *ctx, flux_lwj_t *job)
 
     if (ctx->sctx.in_sim) {
         /* Emulation mode */
-        if (asprintf (&topic, "sim_exec.run.%"PRId64"", job->lwj_id) < 0) {
+        if (asprintf (&topic, "sim_exec.run.%"PRId64"", jobid) < 0) {
             flux_log (h, LOG_ERR, "%s: topic create failed: %s",
                       __FUNCTION__, strerror (errno));
         } else if (!(msg = flux_request_encode (topic, NULL))
@@ -1237,12 +1490,12 @@ static inline int bridge_send_runrequest (ssrvctx_t *ctx, flux_lwj_t *job)
                       __FUNCTION__, strerror (errno));
         } else {
             queue_timer_change (ctx, "sim_exec");
-            flux_log (h, LOG_DEBUG, "job %"PRId64" runrequest", job->lwj_id);
+            flux_log (h, LOG_DEBUG, "job %"PRId64" runrequest", jobid);
             rc = 0;
         }
     } else {
         /* Normal mode */
-        if (asprintf (&topic, "wrexec.run.%"PRId64"", job->lwj_id) < 0) {
+        if (asprintf (&topic, "wrexec.run.%"PRId64"", jobid) < 0) {
             flux_log (h, LOG_ERR, "%s: topic create failed: %s",
                       __FUNCTION__, strerror (errno));
         } else if (!(msg = flux_event_encode (topic, NULL))
@@ -1250,7 +1503,7 @@ static inline int bridge_send_runrequest (ssrvctx_t *ctx, flux_lwj_t *job)
             flux_log (h, LOG_ERR, "%s: event create failed: %s",
                       __FUNCTION__, strerror (errno));
         } else {
-            flux_log (h, LOG_DEBUG, "job %"PRId64" runrequest", job->lwj_id);
+            flux_log (h, LOG_DEBUG, "job %"PRId64" runrequest", jobid);
             rc = 0;
         }
     }
@@ -1265,22 +1518,16 @@ static inline void bridge_update_timer (ssrvctx_t *ctx)
         queue_timer_change (ctx, "sched");
 }
 
-static inline int bridge_rs2rank_tab_query (ssrvctx_t *ctx, const char *name,
-                                            const char *digest, uint32_t *rank)
+static inline ssize_t bridge_rs2rank_tab_resolve (ssrvctx_t *ctx,
+                                                  resrc_tree_t *rt,
+                                                  uint32_t *ranks, size_t len)
 {
-    int rc = -1;
-    if (ctx->sctx.in_sim) {
-        rc = rs2rank_tab_query_by_none (ctx->machs, digest, false, rank);
-    } else {
-        flux_log (ctx->h, LOG_INFO, "hostname: %s, digest: %s", name, digest);
-        rc = rs2rank_tab_query_by_sign (ctx->machs, name, digest, false, rank);
-    }
-    if (rc == 0)
-        flux_log (ctx->h, LOG_INFO, "broker found, rank: %"PRIu32, *rank);
-    else
+    /* in emulation, every node is managed by the first host's brokers */
+    ssize_t n = rs2rank_tab_resolve_tree (ctx->machs, rt, ctx->sctx.in_sim,
+                                          ranks, len);
+    if (n < 0)
         flux_log (ctx->h, LOG_ERR, "controlling broker not found!");
-
-    return rc;
+    return n;
 }
 
 /********************************************************************************
@@ -1289,22 +1536,22 @@ static inline int bridge_rs2rank_tab_query (ssrvctx_t *ctx, const char *name,
  *                                                                              *
  *******************************************************************************/
 
-static int resolve_rank (ssrvctx_t *ctx, json_t *o)
+/* Replace the digest of each node entry of o, the serialized form of
+ * the resource tree rt, with the rank of its broker.  The ranks of all
+ * the nodes are resolved at once, in the order they are serialized.
+ */
+static int resolve_rank (ssrvctx_t *ctx, resrc_tree_t *rt, json_t *o)
 {
     int rc = -1;
     size_t index = 0;
+    size_t len = json_array_size (o);
     json_t *value = NULL;
+    uint32_t *ranks = xzmalloc ((len + 1) * sizeof (*ranks));
 
+    if (bridge_rs2rank_tab_resolve (ctx, rt, ranks, len) != (ssize_t)len)
+        goto done;
     json_array_foreach (o, index, value) {
-        uint32_t rank = 0;
-        char *hn = NULL;
-        char *digest = NULL;
-        if (json_unpack (value, "{s:s s:s}", "node", &hn, "digest", &digest))
-            goto done;
-        if (bridge_rs2rank_tab_query (ctx, hn, digest, &rank))
-            goto done;
-
-        json_t *j_rank = json_integer ((json_int_t)rank);
+        json_t *j_rank = json_integer ((json_int_t)ranks[index]);
         if (json_object_del (value, "digest"))
             goto done;
         if (json_object_set_new (value, "rank", j_rank))
@@ -1313,6 +1560,7 @@ static int resolve_rank (ssrvctx_t *ctx, json_t *o)
     rc = 0;
 
 done:
+    free (ranks);
     return rc;
 }
 
@@ -1347,11 +1595,20 @@ static int req_tpexec_allocate (ssrvctx_t *ctx, flux_lwj_t *job)
         flux_log (h, LOG_ERR, "job (%"PRId64") resource serialization failed",
                   job->lwj_id);
         goto done;
-    } else if (resolve_rank (ctx, gat)) {
+    } else if (resolve_rank (ctx, job->resrc_tree, gat)) {
         flux_log (ctx->h, LOG_ERR, "resolving a hostname to rank failed");
         goto done;
     }
 
+    if (ctx->batch) {
+        /* applied at the end of the scheduling pass by q_flush_batch () */
+        jscbatch_add_rlite (ctx->batch, job->lwj_id, gat);
+        jscbatch_add_state (ctx->batch, job->lwj_id, job->state, J_ALLOCATED);
+        Jput (gat);
+        bridge_update_timer (ctx);
+        rc = 0;
+        goto done;
+    }
     json_object_set_new (jcb, JSC_R_LITE, gat);
     jcbstr = Jtostr (jcb);
     if (jsc_update_jcb (h, job->lwj_id, JSC_R_LITE, jcbstr) != 0) {
@@ -1410,11 +1667,15 @@ static int req_tpexec_exec (flux_t *h, flux_lwj_t *job)
     ssrvctx_t *ctx = getctx (h);
     int rc = -1;
 
-    if ((update_state (h, job->lwj_id, job->state, J_RUNREQUEST)) != 0) {
+    if (ctx->batch) {
+        jscbatch_add_state (ctx->batch, job->lwj_id, job->state, J_RUNREQUEST);
+        jscbatch_add_runrequest (ctx->batch, job->lwj_id);
+        rc = 0;
+    } else if ((update_state (h, job->lwj_id, job->state, J_RUNREQUEST)) != 0) {
         flux_log (h, LOG_ERR, "failed to update the state of job %"PRId64"",
                   job->lwj_id);
         goto done;
-    } else if (bridge_send_runrequest (ctx, job) != 0) {
+    } else if (bridge_send_runrequest (ctx, job->lwj_id) != 0) {
         flux_log (h, LOG_ERR, "failed to send runrequest for job %"PRId64"",
                   job->lwj_id);
         goto done;
@@ -1444,245 +1705,90 @@ static int req_tpexec_run (flux_t *h, flux_lwj_t *job)
  *                                                                              *
  *******************************************************************************/
 
-static resrc_reqst_t *get_resrc_reqst (ssrvctx_t *ctx, flux_lwj_t *job,
-                          int64_t starttime, int64_t *nreqrd)
+/* Batched run requests are sent once their state update is committed */
+static int batch_run_cb (flux_t *h, int64_t jobid, void *arg)
 {
-    json_t *req_res = NULL;
-    resrc_reqst_t *resrc_reqst = NULL;
-
-    /*
-     * Require at least one task per node, and
-     * Assume (for now) one task per core.
-     *
-     * At this point, our flux_lwj_t structure supplies a simple count
-     * of nodes and cores.  This is a short term solution that
-     * supports the typical request.  Until a more complex model is
-     * available, we will have to interpret the request along these
-     * most likely scenarios:
-     *
-     * - If only cores are requested, the number of nodes we find to
-     *   supply the requested cores does not matter to the user.
-     *
-     * - If only nodes are requested, we will return only nodes whose
-     *   cores are all idle.
-     *
-     * - If nodes and cores are requested, we will return the
-     *   requested number of nodes with at least the requested number
-     *   of cores on each node.  We will not attempt to provide a
-     *   balanced number of cores per node.
-     */
-    req_res = Jnew ();
-    if (job->req->nnodes > 0) {
-        Jadd_str (req_res, "type", "node");
-        Jadd_int64 (req_res, "req_qty", job->req->nnodes);
-        *nreqrd = job->req->nnodes;
-
-        /* Since nodes are requested, make sure we look for at
-         * least one core on each node */
-        if (job->req->ncores < job->req->nnodes)
-            job->req->ncores = job->req->nnodes;
-        job->req->corespernode = (job->req->ncores + job->req->nnodes - 1) /
-            job->req->nnodes;
-        job->req->gpuspernode = 0;
-        if (job->req->node_exclusive) {
-            Jadd_int64 (req_res, "req_size", 1);
-            Jadd_bool (req_res, "exclusive", true);
-        } else {
-            Jadd_int64 (req_res, "req_size", 0);
-            Jadd_bool (req_res, "exclusive", false);
-        }
-
-        json_t *child_core = Jnew ();
-        Jadd_str (child_core, "type", "core");
-        Jadd_int64 (child_core, "req_qty", job->req->corespernode);
-        /* setting size == 1 devotes (all of) the core to the job */
-        Jadd_int64 (child_core, "req_size", 1);
-        /* setting exclusive to true prevents multiple jobs per core */
-        Jadd_bool (child_core, "exclusive", true);
-        Jadd_int64 (child_core, "starttime", starttime);
-        Jadd_int64 (child_core, "endtime", starttime + job->req->walltime);
-
-        json_t *children = Jnew_ar();
-        json_array_append_new (children, child_core);
-        if (job->req->ngpus) {
-            job->req->gpuspernode = (job->req->ngpus + job->req->nnodes - 1) /
-            job->req->nnodes;
-            json_t *child_gpu = Jnew ();
-            Jadd_str (child_gpu, "type", "gpu");
-            Jadd_int64 (child_gpu, "req_qty", job->req->gpuspernode);
-            /* setting size == 1 devotes (all of) the gpu to the job */
-            Jadd_int64 (child_gpu, "req_size", 1);
-            /* setting exclusive to true prevents multiple jobs per core */
-            Jadd_bool (child_gpu, "exclusive", true);
-            Jadd_int64 (child_gpu, "starttime", starttime);
-            Jadd_int64 (child_gpu, "endtime", starttime + job->req->walltime);
-            json_array_append_new (children, child_gpu);
-        }
-        json_object_set_new (req_res, "req_children", children);
-    } else if (job->req->ncores > 0) {
-        Jadd_str (req_res, "type", "core");
-        Jadd_int (req_res, "req_qty", job->req->ncores);
-        *nreqrd = job->req->ncores;
-
-        Jadd_int64 (req_res, "req_size", 1);
-        /* setting exclusive to true prevents multiple jobs per core */
-        Jadd_bool (req_res, "exclusive", true);
-    } else
-        goto done;
+    ssrvctx_t *ctx = (ssrvctx_t *)arg;
+    return bridge_send_runrequest (ctx, jobid);
+}
 
-    Jadd_int64 (req_res, "starttime", starttime);
-    Jadd_int64 (req_res, "endtime", starttime + job->req->walltime);
-    resrc_reqst = resrc_reqst_from_json (ctx->rsapi, req_res, NULL);
+/* Per-job error handling of the batched updates: a job whose allocation
+ * could not be recorded gets its resources back and is rescheduled.
+ */
+static void batch_fail_cb (flux_t *h, int64_t jobid, job_state_t ns, void *arg)
+{
+    ssrvctx_t *ctx = (ssrvctx_t *)arg;
+    flux_lwj_t *job = q_find_job (ctx, jobid);
 
-done:
-    Jput (req_res);
-    return resrc_reqst;
+    flux_log (h, LOG_ERR, "failed to update job %"PRId64" to %s", jobid,
+              (ns == J_NULL)? JSC_R_LITE : jsc_job_num2state (ns));
+    if (!job || job->state != J_SELECTED)
+        return;
+    if (job->resrc_tree) {
+        if (q_release_resrc (ctx, job))
+            flux_log (h, LOG_ERR, "%s: failed to release resources for job "
+                      "%"PRId64"", __FUNCTION__, job->lwj_id);
+        resrc_tree_destroy (ctx->rsapi, job->resrc_tree, false, false);
+        job->resrc_tree = NULL;
+    }
+    job->state = J_SCHEDREQ;
+    q_rs_released (ctx);
+    ctx->pq_state = true;
 }
 
-/* Sort jobs by decreasing priority */
-static int compare_priority (void *item1, void *item2)
+static void q_flush_batch (ssrvctx_t *ctx)
 {
-    int ret = 0;
-    flux_lwj_t *job1 = (flux_lwj_t*)item1;
-    flux_lwj_t *job2 = (flux_lwj_t*)item2;
-
-    if (job1->priority < job2->priority)
-        ret = 1;
-    else if (job1->priority > job2->priority)
-        ret = -1;
-    return ret;
+    int nfailed = 0;
+    if (ctx->batch && jscbatch_size (ctx->batch) > 0) {
+        if ((nfailed = jscbatch_commit (ctx->batch)) != 0)
+            flux_log (ctx->h, LOG_ERR, "%s: %d job(s) failed to update",
+                      __FUNCTION__, nfailed);
+    }
 }
 
-/*
- * schedule_job() searches through all of the idle resources to
- * satisfy a job's requirements.  If enough resources are found, it
- * proceeds to allocate those resources and update the kvs's lwj entry
- * in preparation for job execution.  If less resources
- * are found than the job requires, and if the job asks to reserve
- * resources, then those resources will be reserved.
+/* The run requests queued by the job events handled in one iteration of
+ * the reactor are sent together, before it waits for the next events.
  */
-int schedule_job (ssrvctx_t *ctx, flux_lwj_t *job, int64_t starttime)
+static void batch_flush_cb (flux_reactor_t *r, flux_watcher_t *w,
+                            int revents, void *arg)
 {
-    flux_t *h = ctx->h;
-    int rc = -1;
-    int64_t nfound = 0;
-    int64_t nreqrd = 0;
-    resrc_reqst_t *resrc_reqst = NULL;
-    resrc_tree_t *found_tree = NULL;
-    resrc_tree_t *selected_tree = NULL;
-    struct behavior_plugin *plugin = behavior_plugin_get (ctx->loader);
-
-    if (!plugin) {
-        flux_log (h, LOG_ERR, "No scheduler policy plugin has been loaded!");
-        return rc;
-    }
+    q_flush_batch ((ssrvctx_t *)arg);
+}
 
-    if (!(resrc_reqst = get_resrc_reqst (ctx, job, starttime, &nreqrd))) {
-        flux_log (h, LOG_ERR, "Null resource request object!");
-        goto done;
-    }
+/* A pass allocated resources to job: record the allocation */
+static int pass_alloc_cb (flux_lwj_t *job, void *arg)
+{
+    ssrvctx_t *ctx = (ssrvctx_t *)arg;
 
-    if ((nfound = plugin->find_resources (h, ctx->rsapi,
-                                          GET_ROOT_RESRC(ctx->rsapi),
-                                          resrc_reqst, &found_tree))) {
-        flux_log (h, LOG_DEBUG, "Found %"PRId64" %s(s) for job %"PRId64", "
-                  "required: %"PRId64"", nfound,
-                  resrc_type (resrc_reqst_resrc (resrc_reqst)), job->lwj_id,
-                  nreqrd);
-
-        resrc_tree_unstage_resources (found_tree);
-        resrc_reqst_clear_found (resrc_reqst);
-        if ((selected_tree = plugin->select_resources (h, ctx->rsapi, found_tree,
-                                                       resrc_reqst, NULL))) {
-            if (resrc_reqst_all_found (resrc_reqst)) {
-                plugin->allocate_resources (h, ctx->rsapi,
-                                            selected_tree, job->lwj_id,
-                                            starttime, starttime +
-                                            job->req->walltime);
-                /* Scheduler specific job transition */
-                // TODO: handle this some other way (JSC?)
-                job->starttime = starttime;
-                job->state = J_SELECTED;
-                if (job->resrc_tree != NULL) {
-                    resrc_tree_destroy (ctx->rsapi, job->resrc_tree, false, false);
-                    job->resrc_tree = NULL;
-                }
-                job->resrc_tree = selected_tree;
-                if (req_tpexec_allocate (ctx, job) != 0) {
-                    flux_log (h, LOG_ERR,
-                              "failed to request allocate for job %"PRId64"",
-                              job->lwj_id);
-                    resrc_tree_destroy (ctx->rsapi, job->resrc_tree, false,false);
-                    job->resrc_tree = NULL;
-                    goto done;
-                }
-                flux_log (h, LOG_DEBUG, "Allocated %"PRId64" %s(s) for job "
-                          "%"PRId64"", nreqrd,
-                          resrc_type (resrc_reqst_resrc (resrc_reqst)),
-                          job->lwj_id);
-            } else {
-                rc = plugin->reserve_resources (h, ctx->rsapi,
-                                                &selected_tree, job->lwj_id,
-                                                starttime, job->req->walltime,
-                                                GET_ROOT_RESRC(ctx->rsapi),
-                                                resrc_reqst);
-                if (rc) {
-                    resrc_tree_destroy (ctx->rsapi, selected_tree, false, false);
-                    job->resrc_tree = NULL;
-                } else {
-                    if (job->resrc_tree != NULL) {
-                        resrc_tree_destroy (ctx->rsapi, job->resrc_tree, false, false);
-                        job->resrc_tree = NULL;
-                    }
-                    job->resrc_tree = selected_tree;
-                }
-            }
-        }
+    /* Scheduler specific job transition */
+    // TODO: handle this some other way (JSC?)
+    job->state = J_SELECTED;
+    if (req_tpexec_allocate (ctx, job) != 0) {
+        flux_log (ctx->h, LOG_ERR,
+                  "failed to request allocate for job %"PRId64"",
+                  job->lwj_id);
+        return -1;
     }
-    rc = 0;
-done:
-    if (resrc_reqst)
-        resrc_reqst_destroy (ctx->rsapi, resrc_reqst);
-    if (found_tree)
-        resrc_tree_destroy (ctx->rsapi, found_tree, false, false);
-
-    return rc;
+    return 0;
 }
 
 static int schedule_jobs (ssrvctx_t *ctx)
 {
-    int rc = 0;
-    int qdepth = 0;
-    flux_lwj_t *job = NULL;
-    struct behavior_plugin *behavior_plugin = behavior_plugin_get (ctx->loader);
-    struct priority_plugin *priority_plugin = priority_plugin_get (ctx->loader);
     /*
      * TODO: when dynamic scheduling is supported, the loop should
      * traverse through running job queue as well.
      */
-    zlist_t *jobs = ctx->p_queue;
-    int64_t starttime = (ctx->sctx.in_sim) ?
-        (int64_t) ctx->sctx.sim_state->sim_time : epochtime();
-
-    if (priority_plugin)
-        priority_plugin->prioritize_jobs (ctx->h, jobs);
-    if (!behavior_plugin)
-        return -1;
-
-    /* Sort by decreasing priority */
-    zlist_sort (jobs, compare_priority);
-    if (ctx->ooo_capable)
-        resrc_tree_release_all_reservations (resrc_tree_root (ctx->rsapi));
-    rc = behavior_plugin->sched_loop_setup (ctx->h);
-    job = zlist_first (jobs);
-    while (!rc && job && (qdepth < ctx->arg.s_params.queue_depth)) {
-        if (job->state == J_SCHEDREQ) {
-            rc = schedule_job (ctx, job, starttime);
-        }
-        job = (flux_lwj_t*)zlist_next (jobs);
-        qdepth++;
+    uint64_t pass_ns = 0;
+    uint64_t plugin_ns = 0;
+    int rc = schedpass_run (ctx->pass, q_now (ctx),
+                            ctx->arg.s_params.queue_depth);
+    if (ctx->sctx.in_sim) {
+        schedpass_last_ns (ctx->pass, &pass_ns, &plugin_ns);
+        ctx->sctx.npasses++;
+        ctx->sctx.pass_ns += pass_ns;
+        ctx->sctx.plugin_ns += plugin_ns;
     }
-
+    q_flush_batch (ctx);
     return rc;
 }
 
@@ -1712,7 +1818,6 @@ static int action (ssrvctx_t *ctx, flux_lwj_t *job, job_state_t newstate,
                    json_t *jcb)
 {
     flux_t *h = ctx->h;
-    char *key = NULL;
     job_state_t oldstate = job->state;
     struct priority_plugin *priority_plugin = priority_plugin_get (ctx->loader);
 
@@ -1730,6 +1835,9 @@ static int action (ssrvctx_t *ctx, flux_lwj_t *job, job_state_t newstate,
         /* fall through for implicit event generation */
     case J_PENDING:
         VERIFY (trans (J_SCHEDREQ, J_SCHEDREQ, &(job->state)));
+        /* a new job queued ahead of others can change their reservations */
+        if (jobqueue_pending_last (ctx->jobs) != job)
+            q_rs_changed (ctx);
         if (!ctx->arg.s_params.delay_sched)
             schedule_jobs (ctx);
         else
@@ -1739,13 +1847,15 @@ static int action (ssrvctx_t *ctx, flux_lwj_t *job, job_state_t newstate,
         /* A schedule requested should not get an event. */
         /* SCHEDREQ -> SELECTED happens implicitly within schedule_jobs */
         VERIFY (trans (J_CANCELLED, newstate, &(job->state)));
+        schedpass_drop_reservation (ctx->pass, job);
         if (!ctx->arg.reap) {
             if (job->req)
                 free (job->req);
-            key = xasprintf ("%"PRId64"", job->lwj_id);
-            zhash_delete (ctx->job_index, key);
-            free (key);
+            q_unindex_job (ctx, job);
             free (job);
+        } else {
+            /* keep it around until reaped, subject to retention */
+            q_move_to_cqueue (ctx, job);
         }
         break;
     case J_SELECTED:
@@ -1761,10 +1871,11 @@ static int action (ssrvctx_t *ctx, flux_lwj_t *job, job_state_t newstate,
         if (newstate == J_FAILED) {
             if (!ctx->arg.schedonce) {
                 /* support testing by actually not releasing the resrc */
-                if (resrc_tree_release (job->resrc_tree, job->lwj_id)) {
+                if (q_release_resrc (ctx, job)) {
                     flux_log (h, LOG_ERR, "%s: failed to release resources for job "
                           "%"PRId64"", __FUNCTION__, job->lwj_id);
                 }
+                q_rs_released (ctx);
             }
             if (!ctx->arg.s_params.delay_sched) {
                 flux_msg_t *msg = flux_event_encode ("sched.res.freed", NULL);
@@ -1783,9 +1894,7 @@ static int action (ssrvctx_t *ctx, flux_lwj_t *job, job_state_t newstate,
                 q_rm_from_pqueue (ctx, job);
                 free (job->req);
                 resrc_tree_destroy (ctx->rsapi, job->resrc_tree, false, false);
-                key = xasprintf ("%"PRId64"", job->lwj_id);
-                zhash_delete (ctx->job_index, key);
-                free (key);
+                q_unindex_job (ctx, job);
                 free (job);
             }
          }
@@ -1798,10 +1907,11 @@ static int action (ssrvctx_t *ctx, flux_lwj_t *job, job_state_t newstate,
         } else if (newstate == J_FAILED) {
             if (!ctx->arg.schedonce) {
                 /* support testing by actually not releasing the resrc */
-                if (resrc_tree_release (job->resrc_tree, job->lwj_id)) {
+                if (q_release_resrc (ctx, job)) {
                     flux_log (h, LOG_ERR, "%s: failed to release resources for job "
                           "%"PRId64"", __FUNCTION__, job->lwj_id);
                 }
+                q_rs_released (ctx);
             }
             if (!ctx->arg.s_params.delay_sched) {
                 flux_msg_t *msg = flux_event_encode ("sched.res.freed", NULL);
@@ -1820,9 +1930,7 @@ static int action (ssrvctx_t *ctx, flux_lwj_t *job, job_state_t newstate,
                 q_rm_from_pqueue (ctx, job);
                 free (job->req);
                 resrc_tree_destroy (ctx->rsapi, job->resrc_tree, false, false);
-                key = xasprintf ("%"PRId64"", job->lwj_id);
-                zhash_delete (ctx->job_index, key);
-                free (key);
+                q_unindex_job (ctx, job);
                 free (job);
             }
         }
@@ -1834,10 +1942,11 @@ static int action (ssrvctx_t *ctx, flux_lwj_t *job, job_state_t newstate,
         VERIFY (trans (J_COMPLETE, newstate, &(job->state)));
         if (!ctx->arg.schedonce) {
             /* support testing by actually not releasing the resrc */
-            if (resrc_tree_release (job->resrc_tree, job->lwj_id)) {
+            if (q_release_resrc (ctx, job)) {
                 flux_log (h, LOG_ERR, "%s: failed to release resources for job "
                       "%"PRId64"", __FUNCTION__, job->lwj_id);
             }
+            q_rs_released (ctx);
         }
         if (!ctx->arg.s_params.delay_sched) {
             flux_msg_t *msg = flux_event_encode ("sched.res.freed", NULL);
@@ -1858,9 +1967,7 @@ static int action (ssrvctx_t *ctx, flux_lwj_t *job, job_state_t newstate,
             q_rm_from_rqueue (ctx, job);
             free (job->req);
             resrc_tree_destroy (ctx->rsapi, job->resrc_tree, false, false);
-            key = xasprintf ("%"PRId64"", job->lwj_id);
-            zhash_delete (ctx->job_index, key);
-            free (key);
+            q_unindex_job (ctx, job);
             free (job);
         }
         break;
@@ -1868,9 +1975,7 @@ static int action (ssrvctx_t *ctx, flux_lwj_t *job, job_state_t newstate,
         VERIFY (trans (J_REAPED, newstate, &(job->state)));
         if (ctx->arg.reap) {
              free (job->req);
-             key = xasprintf ("%"PRId64"", job->lwj_id);
-             zhash_delete (ctx->job_index, key);
-             free (key);
+             q_unindex_job (ctx, job);
              free (job);
         } else {
             flux_log (h, LOG_ERR, "Reap support is not enabled (Use reap=true");
@@ -1881,12 +1986,9 @@ static int action (ssrvctx_t *ctx, flux_lwj_t *job, job_state_t newstate,
         if (ctx->arg.reap) {
             if (priority_plugin)
                 priority_plugin->record_job_usage (ctx->h, job);
-            zlist_remove (ctx->c_queue, job);
             free (job->req);
             resrc_tree_destroy (ctx->rsapi, job->resrc_tree, false, false);
-            key = xasprintf ("%"PRId64"", job->lwj_id);
-            zhash_delete (ctx->job_index, key);
-            free (key);
+            q_unindex_job (ctx, job);
             free (job);
         } else {
             flux_log (h, LOG_ERR, "Reap support is not enabled (Use reap=true");
@@ -1955,6 +2057,7 @@ static void cancel_request_cb (flux_t *h, flux_msg_handler_t *w,
     }
 
     q_rm_from_pqueue (ctx, job);
+    q_rs_released (ctx);
 
     if ((update_state (h, jobid, job->state, J_CANCELLED)) != 0) {
         flux_log (h, LOG_ERR,
@@ -2029,6 +2132,7 @@ static void exclude_request_cb (flux_t *h, flux_msg_handler_t *w,
             goto error;
         }
         resrc_set_state (node, RESOURCE_EXCLUDED);
+        q_rs_changed (ctx);
         if (kill) {
             if (kill_jobs_on_node (h, node) != 0) {
                 goto error;
@@ -2088,6 +2192,7 @@ static void include_request_cb (flux_t *h, flux_msg_handler_t *w,
             continue;
         }
         resrc_set_state (node, RESOURCE_IDLE);
+        q_rs_released (ctx);
     } while ((node = resrc_lookup_next (ctx->rsapi, hostname)));
 
     flux_log (h, LOG_DEBUG, "include node resource (%s), ", hostname);
@@ -2209,6 +2314,53 @@ error:
         flux_log_error (h, "%s", __FUNCTION__);
 }
 
+/* Respond with the latency histograms of the scheduler phases in
+ * nanoseconds; a request carrying "reset": true clears them afterwards.
+ */
+static void sched_stats_request_cb (flux_t *h, flux_msg_handler_t *w,
+                                    const flux_msg_t *msg, void *arg)
+{
+    ssrvctx_t *ctx = getctx ((flux_t *)arg);
+    const char *json_str = NULL;
+    json_t *in = NULL;
+    json_t *out = NULL;
+    bool reset = false;
+    bool triggers = false;
+
+    if (flux_request_decode (msg, NULL, &json_str) < 0)
+        goto error;
+    if (json_str) {
+        if (!(in = Jfromstr (json_str))) {
+            errno = EPROTO;
+            goto error;
+        }
+        Jget_bool (in, "reset", &reset);
+        Jget_bool (in, "triggers", &triggers);
+        Jput (in);
+    }
+
+    out = schedstats_to_json (ctx->stats);
+    /* under the simulator, the samples taken at each trigger on request */
+    if (triggers && ctx->sctx.triggers) {
+        Jadd_obj (out, "triggers", ctx->sctx.triggers);
+        Jadd_bool (out, "sim_charge", ctx->arg.sim_charge);
+    }
+    if (reset) {
+        schedstats_reset (ctx->stats);
+        if (ctx->sctx.triggers) {
+            Jput (ctx->sctx.triggers);
+            ctx->sctx.triggers = Jnew_ar ();
+        }
+    }
+    if (flux_respond_pack (h, msg, "o", out) < 0)
+        flux_log_error (h, "%s", __FUNCTION__);
+    return;
+
+error:
+    if (flux_respond (h, msg, errno, NULL) < 0)
+        flux_log_error (h, "%s", __FUNCTION__);
+}
+
 static void ev_prep_cb (flux_reactor_t *r, flux_watcher_t *w, int ev, void *a)
 {
     ssrvctx_t *ctx = (ssrvctx_t *)a;
@@ -2268,10 +2420,29 @@ int mod_main (flux_t *h, int argc, char **argv)
         flux_log (h, LOG_ERR, "can't process module args");
         goto done;
     }
+    if (ctx->arg.cq_archive
+        && !(ctx->archive = fopen (ctx->arg.cq_archive, "a"))) {
+        flux_log_error (h, "can't open archive file %s", ctx->arg.cq_archive);
+        goto done;
+    }
+    if (ctx->arg.jsc_batch
+        && !(ctx->batch = jscbatch_new (h, batch_run_cb, batch_fail_cb, ctx))) {
+        flux_log (h, LOG_ERR, "can't create the jcb update batch");
+        goto done;
+    }
     if (bridge_set_execmode (ctx) != 0) {
         flux_log (h, LOG_ERR, "failed to setup execution mode");
         goto done;
     }
+    /* under the simulator, the batch is applied at the end of a trigger */
+    if (ctx->batch && !ctx->sctx.in_sim) {
+        if (!(ctx->flush = flux_prepare_watcher_create (flux_get_reactor (h),
+                                                        batch_flush_cb, ctx))) {
+            flux_log_error (h, "can't create the jcb update batch watcher");
+            goto done;
+        }
+        flux_watcher_start (ctx->flush);
+    }
     if (adjust_for_sched_params (ctx) != 0) {
         flux_log (h, LOG_ERR, "can't adjust for schedule parameters");
         goto done;
@@ -2281,6 +2452,11 @@ int mod_main (flux_t *h, int argc, char **argv)
         flux_log_error (h, "failed to initialize plugin loader");
         goto done;
     }
+    if (!(ctx->pass = schedpass_new (h, ctx->rsapi, ctx->loader, ctx->jobs,
+                                     ctx->stats, pass_alloc_cb, ctx))) {
+        flux_log_error (h, "failed to initialize the scheduling pass");
+        goto done;
+    }
     if (ctx->arg.userplugin) {
         if (sched_plugin_load (ctx->loader, ctx->arg.userplugin) < 0) {
             flux_log_error (h, "failed to load %s", ctx->arg.userplugin);
@@ -2293,6 +2469,7 @@ int mod_main (flux_t *h, int argc, char **argv)
             goto done;
         }
         struct sched_prop prop;
+        memset (&prop, 0, sizeof (prop));
         struct behavior_plugin *behavior_plugin = behavior_plugin_get (ctx->loader);
         if (behavior_plugin->get_sched_properties (h, &prop) < 0) {
             flux_log_error (h, "failed to fetch sched plugin properties for %s",
@@ -2300,7 +2477,7 @@ int mod_main (flux_t *h, int argc, char **argv)
             errno = EINVAL;
             goto done;
         }
-        ctx->ooo_capable = prop.out_of_order_capable;
+        schedpass_set_props (ctx->pass, &prop);
     }
     if (ctx->arg.prio_plugin) {
         if (sched_plugin_load (ctx->loader, ctx->arg.prio_plugin) < 0) {
@@ -2311,7 +2488,8 @@ int mod_main (flux_t *h, int argc, char **argv)
         struct priority_plugin *priority_plugin = priority_plugin_get
             (ctx->loader);
         if (priority_plugin) {
-            if (priority_plugin->priority_setup (h))
+            if (priority_setup (ctx, priority_plugin,
+                                ctx->arg.prio_plugin_opts) < 0)
                 flux_log (h, LOG_ERR, "failed to setup priority plugin");
             else
                 flux_log (h, LOG_INFO, "successfully setup priority plugin");
@@ -41,28 +41,19 @@
 #include "resrc_tree.h"
 #include "resrc_reqst.h"
 #include "scheduler.h"
+#include "timeline.h"
 
 static int reservation_depth = 1;
 static int curr_reservation_depth = 0;
-static zlist_t *completion_times = NULL;
+static bool persist_reservations = false;
 
-#if CZMQ_VERSION < CZMQ_MAKE_VERSION(3, 0, 1)
-static bool compare_int64_ascending (void *item1, void *item2)
-{
-    int64_t time1 = *((int64_t *) item1);
-    int64_t time2 = *((int64_t *) item2);
-
-    return time1 > time2;
-}
-#else
-static int compare_int64_ascending (void *item1, void *item2)
-{
-    int64_t time1 = *((int64_t *) item1);
-    int64_t time2 = *((int64_t *) item2);
-
-    return time1 - time2;
-}
-#endif
+/* Time windows of the allocated jobs and of the reservations held on
+ * the resource tree, and the per-type usage profile they add up to.
+ * Only resources a job holds (staged a non-zero size of) are counted,
+ * so the profile bounds from above the number of resources of a type
+ * that an exclusive request can get at any time.
+ */
+static timeline_t *timeline = NULL;
 
 static bool select_children (flux_t *h, resrc_api_ctx_t *rsapi,
                              resrc_tree_list_t *children,
@@ -80,14 +71,124 @@ int get_sched_properties (flux_t *h, struct sched_prop *prop)
         return -1;
 
     prop->out_of_order_capable = true;
+    prop->persistent_reservations = persist_reservations;
     return 0;
 }
 
 int sched_loop_setup (flux_t *h)
 {
     curr_reservation_depth = 0;
-    if (!completion_times)
-        completion_times = zlist_new ();
+    if (!timeline)
+        timeline = timeline_new ();
+    return 0;
+}
+
+/*
+ * job_end() drops the window of a job whose resources were released,
+ * which may be before its walltime ran out, or whose reservation was
+ * given up.  Reserved windows otherwise stay across passes along with
+ * the reservations on the resource tree.
+ */
+int job_end (flux_lwj_t *job)
+{
+    if (!timeline || !job)
+        return -1;
+    if (timeline_has (timeline, job->lwj_id))
+        timeline_remove (timeline, job->lwj_id);
+    return 0;
+}
+
+/*
+ * job_skipped() accounts for the reservation, if any, of a blocked job
+ * that the pass does not try again.  The reservation counts toward the
+ * reservation depth of this pass like one just made; it is given up
+ * (-1 is returned) if the depth is already reached.
+ */
+int job_skipped (flux_lwj_t *job)
+{
+    bool reserved = false;
+
+    if (!timeline || !job
+        || timeline_get (timeline, job->lwj_id, NULL, NULL, NULL, &reserved)
+        || !reserved)
+        return 0;
+    if (curr_reservation_depth >= reservation_depth)
+        return -1;
+    curr_reservation_depth++;
+    return 0;
+}
+
+/*
+ * Count, by type, the resources of a selected tree that are staged for
+ * the job.
+ */
+static void tree_counts (resrc_tree_t *rt, int64_t *counts)
+{
+    resrc_t *resrc = resrc_tree_resrc (rt);
+    resrc_tree_list_t *children = NULL;
+    resrc_tree_t *child = NULL;
+    int t;
+
+    if (resrc_staged (resrc)
+        && (t = timeline_type_index (timeline, resrc_type (resrc))) >= 0)
+        counts[t]++;
+    if (resrc_tree_num_children (rt)) {
+        children = resrc_tree_children (rt);
+        for (child = resrc_tree_list_first (children); child;
+             child = resrc_tree_list_next (children))
+            tree_counts (child, counts);
+    }
+}
+
+/*
+ * Add up, by type, the resources an exclusive request asks for: the
+ * quantity at each level multiplied by the quantities above it.
+ */
+static void reqst_demand (resrc_reqst_t *resrc_reqst, int64_t mult,
+                          int64_t *demand)
+{
+    resrc_reqst_list_t *children = NULL;
+    resrc_reqst_t *child = NULL;
+    int64_t qty = mult * resrc_reqst_reqrd_qty (resrc_reqst);
+    int t;
+
+    if (resrc_reqst_exclusive (resrc_reqst)
+        && resrc_reqst_reqrd_size (resrc_reqst) > 0
+        && (t = timeline_type_index (timeline,
+                    resrc_type (resrc_reqst_resrc (resrc_reqst)))) >= 0)
+        demand[t] += qty;
+    if (resrc_reqst_num_children (resrc_reqst)) {
+        children = resrc_reqst_children (resrc_reqst);
+        for (child = resrc_reqst_list_first (children); child;
+             child = resrc_reqst_list_next (children))
+            reqst_demand (child, qty, demand);
+    }
+}
+
+/*
+ * Fill limit with the most resources of each type that may be in use
+ * for the request to still fit under resrc.  The limit is taken from
+ * all the resources that are not excluded, not only those idle now,
+ * since the profile already counts what the jobs hold.  Returns -1 if
+ * the request can never fit.
+ */
+static int reqst_limits (resrc_t *resrc, resrc_reqst_t *resrc_reqst,
+                         int64_t *limit)
+{
+    int64_t demand[TIMELINE_MAX_TYPES] = {0};
+    int t;
+
+    reqst_demand (resrc_reqst, 1, demand);
+    for (t = 0; t < TIMELINE_MAX_TYPES; t++) {
+        limit[t] = INT64_MAX;
+        if (!demand[t])
+            continue;
+        limit[t] = resrc_subtree_capacity (resrc,
+                                           timeline_type_name (timeline, t))
+                   - demand[t];
+        if (limit[t] < 0)
+            return -1;
+    }
     return 0;
 }
 
@@ -258,24 +359,42 @@ int allocate_resources (flux_t *h, resrc_api_ctx_t *rsapi,
                         resrc_tree_t *selected_tree, int64_t job_id,
                         int64_t starttime, int64_t endtime)
 {
+    int64_t counts[TIMELINE_MAX_TYPES] = {0};
     int rc = -1;
 
     if (selected_tree) {
+        /* count what the job holds before allocation unstages it */
+        tree_counts (selected_tree, counts);
         rc = resrc_tree_allocate (selected_tree, job_id, starttime, endtime);
 
         if (!rc) {
-            int64_t *completion_time = xzmalloc (sizeof(int64_t));
-            *completion_time = endtime;
-            rc = zlist_append (completion_times, completion_time);
-            zlist_freefn (completion_times, completion_time, free, true);
+            rc = timeline_add (timeline, job_id, starttime, endtime, counts,
+                               false);
             flux_log (h, LOG_DEBUG, "Allocated job %"PRId64" from %"PRId64" to "
-                      "%"PRId64"", job_id, starttime, *completion_time);
+                      "%"PRId64"", job_id, starttime, endtime);
         }
     }
 
     return rc;
 }
 
+/*
+ * Return the next candidate start after 'after', which is the old start
+ * time of a reservation being moved (prev, cleared once returned) if no
+ * step of the profile comes first.
+ */
+static int64_t next_start (int64_t after, int64_t walltime,
+                           const int64_t *limit, int64_t *prev)
+{
+    int64_t time = timeline_earliest (timeline, after, walltime, limit);
+
+    if (*prev > after && (time < 0 || time > *prev)) {
+        time = *prev;
+        *prev = -1;
+    }
+    return time;
+}
+
 /*
  * reserve_resources() reserves resources for the specified job id.
  * Unlike the FCFS version where selected_tree provides the tree of
@@ -283,6 +402,15 @@ int allocate_resources (flux_t *h, resrc_api_ctx_t *rsapi,
  * future to find a time window when all of the required resources are
  * available, reserve those, and return the pointer to the selected
  * tree.
+ *
+ * Candidate start times come from the usage profile of the timeline:
+ * only those from which enough resources of every requested type stay
+ * unused for the walltime are searched, earliest first.
+ *
+ * When reservations persist across passes, selected_tree comes in as
+ * the reservation the job already holds, if any.  It is kept as is
+ * unless the profile shows the job could now start earlier, in which
+ * case the job is placed again, trying its old start time in turn.
  */
 int reserve_resources (flux_t *h, resrc_api_ctx_t *rsapi,
                        resrc_tree_t **selected_tree, int64_t job_id,
@@ -290,15 +418,26 @@ int reserve_resources (flux_t *h, resrc_api_ctx_t *rsapi,
                        resrc_reqst_t *resrc_reqst)
 {
     int rc = -1;
-    int64_t *completion_time = NULL;
     int64_t nfound = 0;
-    int64_t prev_completion_time = -1;
+    int64_t time = -1;
+    int64_t prev = -1;
+    int64_t limit[TIMELINE_MAX_TYPES];
+    int64_t held[TIMELINE_MAX_TYPES];
+    bool reserved = false;
     resrc_tree_t *found_tree = NULL;
 
     if (!resrc || !resrc_reqst) {
         flux_log (h, LOG_ERR, "%s: invalid arguments", __FUNCTION__);
         goto ret;
     }
+    if (persist_reservations && *selected_tree) {
+        /* the job holds a reservation from an earlier pass */
+        if (!timeline_get (timeline, job_id, &prev, NULL, held, &reserved)
+            && reserved)
+            timeline_remove (timeline, job_id);
+        else
+            prev = -1;
+    }
     if (!reservation_depth)
         /* All backfilling (no reservations).  Return success to
          * backfill all jobs remaining in the queue */
@@ -312,57 +451,87 @@ int reserve_resources (flux_t *h, resrc_api_ctx_t *rsapi,
         /* Stop reserving and return -1 to stop scheduling any more jobs */
         goto ret;
 
+    /* Purge past windows from consideration */
+    timeline_purge (timeline, starttime);
+    if (reqst_limits (resrc, resrc_reqst, limit) < 0) {
+        flux_log (h, LOG_DEBUG, "Job %"PRId64" requests more resources than "
+                  "exist", job_id);
+        goto ret;
+    }
+
+    if (prev > starttime) {
+        time = timeline_earliest (timeline, starttime, walltime, limit);
+        if (time < 0 || time >= prev) {
+            /* nothing has freed up ahead of it: the reservation stands */
+            timeline_add (timeline, job_id, prev, prev + walltime, held, true);
+            resrc_reqst_set_starttime (resrc_reqst, prev);
+            resrc_reqst_set_endtime (resrc_reqst, prev + walltime);
+            curr_reservation_depth++;
+            flux_log (h, LOG_DEBUG, "Kept reservation of job %"PRId64" from "
+                      "%"PRId64" to %"PRId64"", job_id, prev, prev + walltime);
+            return 0;
+        }
+        flux_log (h, LOG_DEBUG, "Moving reservation of job %"PRId64" ahead "
+                  "of %"PRId64"", job_id, prev);
+    }
     if (*selected_tree) {
+        if (persist_reservations)
+            resrc_tree_release_reservation (*selected_tree, job_id);
         resrc_tree_destroy (rsapi, *selected_tree, false, false);
         *selected_tree = NULL;
     }
-    zlist_sort (completion_times, compare_int64_ascending);
-
-    for (completion_time = zlist_first (completion_times);
-         completion_time;
-         completion_time = zlist_next (completion_times)) {
-        /* Purge past times from consideration */
-        if (*completion_time < starttime) {
-            zlist_remove (completion_times, completion_time);
-            continue;
-        }
-        /* Don't test the same time multiple times */
-        if (prev_completion_time == *completion_time)
-            continue;
 
-        resrc_reqst_set_starttime (resrc_reqst, *completion_time + 1);
-        resrc_reqst_set_endtime (resrc_reqst, *completion_time + 1 + walltime);
+    for (time = next_start (starttime, walltime, limit, &prev);
+         time >= 0;
+         time = next_start (time, walltime, limit, &prev)) {
+        resrc_reqst_set_starttime (resrc_reqst, time);
+        resrc_reqst_set_endtime (resrc_reqst, time + walltime);
         flux_log (h, LOG_DEBUG, "Attempting to reserve %"PRId64" nodes for job "
                   "%"PRId64" at time %"PRId64"",
-                  resrc_reqst_reqrd_qty (resrc_reqst), job_id,
-                  *completion_time + 1);
+                  resrc_reqst_reqrd_qty (resrc_reqst), job_id, time);
 
         nfound = resrc_tree_search (rsapi, resrc, resrc_reqst, &found_tree, true);
         if (nfound >= resrc_reqst_reqrd_qty (resrc_reqst)) {
+            resrc_tree_unstage_resources (found_tree);
+            resrc_reqst_clear_found (resrc_reqst);
             *selected_tree = select_resources (h, rsapi,
                                  found_tree, resrc_reqst, NULL);
+            if (*selected_tree && !resrc_reqst_all_found (resrc_reqst)) {
+                resrc_tree_unstage_resources (*selected_tree);
+                resrc_tree_destroy (rsapi, *selected_tree, false, false);
+                *selected_tree = NULL;
+            }
             resrc_tree_destroy (rsapi, found_tree, false, false);
+            found_tree = NULL;
             if (*selected_tree) {
+                int64_t counts[TIMELINE_MAX_TYPES] = {0};
+
+                tree_counts (*selected_tree, counts);
                 rc = resrc_tree_reserve (*selected_tree, job_id,
-                                         *completion_time + 1,
-                                         *completion_time + 1 + walltime);
+                                         time, time + walltime);
                 if (rc) {
                     resrc_tree_destroy (rsapi, *selected_tree, false, false);
                     *selected_tree = NULL;
                 } else {
+                    timeline_add (timeline, job_id, time, time + walltime,
+                                  counts, true);
                     curr_reservation_depth++;
                     flux_log (h, LOG_DEBUG, "Reserved %"PRId64" nodes for job "
                               "%"PRId64" from %"PRId64" to %"PRId64"",
                               resrc_reqst_reqrd_qty (resrc_reqst), job_id,
-                              *completion_time + 1,
-                              *completion_time + 1 + walltime);
+                              time, time + walltime);
                 }
                 break;
             }
+        } else if (found_tree) {
+            resrc_tree_destroy (rsapi, found_tree, false, false);
+            found_tree = NULL;
         }
-        prev_completion_time = *completion_time;
     }
 ret:
+    /* a held reservation that could not be kept is given up */
+    if (rc && persist_reservations && *selected_tree)
+        resrc_tree_release_reservation (*selected_tree, job_id);
     return rc;
 }
 
@@ -371,10 +540,13 @@ ret:
 //     1 = EASY Backfill
 //    >1 = Hybrid Backfill
 //    <0 = Conservative Backfill
+//
+// reserve-persist=true keeps conservative reservations across passes
 int process_args (flux_t *h, char *argz, size_t argz_len, const sched_params_t *sp)
 {
     int rc = 0;
     char *reserve_depth_str = NULL;
+    char *reserve_persist_str = NULL;
     char *entry = NULL;
 
     for (entry = argz;
@@ -383,6 +555,9 @@ int process_args (flux_t *h, char *argz, size_t argz_len, const sched_params_t *
 
         if (!strncmp ("reserve-depth=", entry, sizeof ("reserve-depth"))) {
             reserve_depth_str = strstr (entry, "=") + 1;
+        } else if (!strncmp ("reserve-persist=", entry,
+                             sizeof ("reserve-persist"))) {
+            reserve_persist_str = strstr (entry, "=") + 1;
         } else {
             rc = -1;
             errno = EINVAL;
@@ -396,11 +571,20 @@ int process_args (flux_t *h, char *argz, size_t argz_len, const sched_params_t *
     } else {
         reservation_depth = 0;
     }
+    persist_reservations = (reserve_persist_str
+                            && !strncmp (reserve_persist_str, "true",
+                                         sizeof ("true")));
 
     if (!sp) {
         flux_log (h, LOG_ERR, "scheduling parameters unavailable");
         rc = -1;
         errno = EINVAL;
+    } else if (persist_reservations && reservation_depth != -1) {
+        flux_log (h, LOG_ERR,
+                  "reserve-persist requires conservative backfill "
+                  "(reserve-depth=-1)");
+        rc = -1;
+        errno = EINVAL;
     } else if (reservation_depth == -1) {
         /* Conservative backfill (-1) will still be limited by the queue-depth
          * but we just treat queue-depth as the limit for it
@@ -270,6 +270,16 @@ int reserve_resources (flux_t *h, resrc_api_ctx_t *rsapi,
 }
 
 
+/*
+ * job_skipped() lets a blocked job that the pass does not try again keep
+ * its reservation: the reservations of this plugin are not limited in
+ * number.
+ */
+int job_skipped (flux_lwj_t *job)
+{
+    return 0;
+}
+
 int process_args (flux_t *h, char *argz, size_t argz_len, const sched_params_t *sp)
 {
     queue_depth = sp->queue_depth;
@@ -0,0 +1,496 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+/*
+ * schedpass.c - the scheduling pass over the pending job queue
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <czmq.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/oom.h"
+#include "src/common/libutil/xzmalloc.h"
+#include "resrc.h"
+#include "resrc_tree.h"
+#include "resrc_reqst.h"
+#include "jobreq.h"
+#include "schedpass.h"
+
+#define GET_ROOT_RESRC(rsapi) resrc_tree_resrc (resrc_tree_root ((rsapi)))
+
+struct schedpass {
+    flux_t       *h;
+    resrc_api_ctx_t *rsapi;
+    struct sched_plugin_loader *loader;
+    jobqueue_t   *jobs;
+    schedstats_t *stats;
+    schedpass_alloc_f alloc_cb;
+    void         *arg;
+    bool          ooo_capable;        /* plugin schedules jobs out of order */
+    bool          persist_rsv;        /* plugin keeps its reservations */
+    uint64_t      rs_gen;             /* resource-state generation */
+    uint64_t      pass_gen;           /* rs_gen seen by the last pass */
+    uint64_t      rel_gen;            /* resource-release generation */
+    uint64_t      pass_rel_gen;       /* rel_gen seen by the last pass */
+    bool          released;           /* rel_gen moved before this pass */
+    int64_t       blocked_id;         /* first job blocked by the last pass */
+    uint64_t      pass_ns;            /* wall time of the last pass */
+    uint64_t      plugin_ns;          /* its behavior plugin time */
+};
+
+schedpass_t *schedpass_new (flux_t *h, resrc_api_ctx_t *rsapi,
+                            struct sched_plugin_loader *loader,
+                            jobqueue_t *jobs, schedstats_t *stats,
+                            schedpass_alloc_f alloc_cb, void *arg)
+{
+    schedpass_t *p = NULL;
+
+    if (!rsapi || !loader || !jobs || !stats || !alloc_cb) {
+        errno = EINVAL;
+        return NULL;
+    }
+    p = xzmalloc (sizeof (*p));
+    p->h = h;
+    p->rsapi = rsapi;
+    p->loader = loader;
+    p->jobs = jobs;
+    p->stats = stats;
+    p->alloc_cb = alloc_cb;
+    p->arg = arg;
+    p->ooo_capable = true;
+    p->persist_rsv = false;
+    p->rs_gen = 1;
+    p->blocked_id = -1;
+    p->pass_gen = 0;
+    p->rel_gen = 0;
+    p->pass_rel_gen = 0;
+    return p;
+}
+
+void schedpass_destroy (schedpass_t *p)
+{
+    free (p);
+}
+
+void schedpass_set_props (schedpass_t *p, const struct sched_prop *prop)
+{
+    p->ooo_capable = prop->out_of_order_capable;
+    p->persist_rsv = prop->persistent_reservations;
+}
+
+void schedpass_rs_changed (schedpass_t *p)
+{
+    p->rs_gen++;
+}
+
+void schedpass_rs_released (schedpass_t *p)
+{
+    p->rel_gen++;
+    p->rs_gen++;
+}
+
+void schedpass_drop_reservation (schedpass_t *p, flux_lwj_t *job)
+{
+    struct behavior_plugin *plugin = behavior_plugin_get (p->loader);
+
+    if (job->resrc_tree) {
+        resrc_tree_release_reservation (job->resrc_tree, job->lwj_id);
+        resrc_tree_destroy (p->rsapi, job->resrc_tree, false, false);
+        job->resrc_tree = NULL;
+        if (plugin && plugin->job_end)
+            plugin->job_end (job);
+    }
+    job->rsv_starttime = 0;
+}
+
+void schedpass_last_ns (schedpass_t *p, uint64_t *pass_ns,
+                        uint64_t *plugin_ns)
+{
+    if (pass_ns)
+        *pass_ns = p->pass_ns;
+    if (plugin_ns)
+        *plugin_ns = p->plugin_ns;
+}
+
+/* Release every reservation on the resource tree and drop the ones the
+ * pending jobs hold, so the plugin's view of them goes too.
+ */
+static void release_reservations (schedpass_t *p)
+{
+    flux_lwj_t *job = NULL;
+
+    resrc_tree_release_all_reservations (resrc_tree_root (p->rsapi));
+    for (job = jobqueue_first (p->jobs, JOBQ_PENDING); job;
+         job = jobqueue_next (p->jobs))
+        schedpass_drop_reservation (p, job);
+}
+
+/* Charge the wall time since t0 to behavior plugin callback phase ph */
+static void plugin_charge (schedpass_t *p, schedstats_phase_t ph, uint64_t t0)
+{
+    uint64_t ns = schedstats_now () - t0;
+
+    schedstats_record_ns (p->stats, ph, ns);
+    p->plugin_ns += ns;
+}
+
+/* Let the priority plugin charge running jobs for the usage they accrued
+ * since the last pass, so fair-share reflects long-running jobs before
+ * they complete.
+ */
+static void charge_running_jobs (schedpass_t *p,
+                                 struct priority_plugin *priority_plugin,
+                                 int64_t now)
+{
+    flux_lwj_t *job = NULL;
+
+    if (!priority_plugin->charge_job_usage)
+        return;
+    for (job = jobqueue_first (p->jobs, JOBQ_RUNNING); job;
+         job = jobqueue_next (p->jobs))
+        priority_plugin->charge_job_usage (p->h, job, now);
+}
+
+/* Return the first pending job the last pass left blocked, if it is
+ * still blocked at the current generation.  Any other blocked job comes
+ * after it in the queue.
+ */
+static flux_lwj_t *first_blocked (schedpass_t *p)
+{
+    flux_lwj_t *job = NULL;
+
+    if (p->blocked_id < 0 || p->pass_gen != p->rs_gen
+        || !(job = jobqueue_find (p->jobs, p->blocked_id))
+        || jobqueue_kind (p->jobs, job) != JOBQ_PENDING
+        || job->blocked_gen != p->rs_gen)
+        return NULL;
+    return job;
+}
+
+/* Has job, whose priority the plugin just changed, moved from behind the
+ * first blocked job to ahead of it?  The job is still keyed with its old
+ * priority; so must the blocked job be, with bprio.
+ */
+static bool moved_ahead_of_blocked (schedpass_t *p, flux_lwj_t *job,
+                                    flux_lwj_t *blocked, double bprio)
+{
+    double prio = jobqueue_pending_prio (p->jobs, job);
+
+    if (job == blocked || prio == job->priority)
+        return false;
+    return !jobqueue_pending_before (p->jobs, job, prio, blocked, bprio)
+           && jobqueue_pending_before (p->jobs, job, job->priority,
+                                       blocked, blocked->priority);
+}
+
+/* Collect into 'jobs' the pending jobs whose priority may have moved
+ * since the last pass.  A plugin that provides changed_assocs names the
+ * associations whose factors changed, and only the fresh jobs and the
+ * jobs of those associations are collected.  Otherwise, or if the
+ * plugin asks for it (e.g., its associations were reloaded), every
+ * pending job is.
+ */
+static void collect_pending_jobs (schedpass_t *p,
+                                  struct priority_plugin *priority_plugin,
+                                  zlist_t *jobs)
+{
+    zlist_t *assocs = NULL;
+    flux_lwj_t *job = NULL;
+    void *assoc = NULL;
+
+    if (priority_plugin->update_jobs && priority_plugin->changed_assocs) {
+        if (!(assocs = zlist_new ()))
+            oom ();
+        if (priority_plugin->changed_assocs (p->h, assocs) == 0) {
+            jobqueue_pending_fresh (p->jobs, jobs);
+            for (assoc = zlist_first (assocs); assoc;
+                 assoc = zlist_next (assocs))
+                jobqueue_pending_assoc (p->jobs, assoc, jobs);
+            zlist_destroy (&assocs);
+            return;
+        }
+        zlist_destroy (&assocs);
+    }
+    for (job = jobqueue_first (p->jobs, JOBQ_PENDING); job;
+         job = jobqueue_next (p->jobs))
+        if (zlist_append (jobs, job) < 0)
+            oom ();
+}
+
+/* Let the priority plugin recompute job->priority for the pending jobs
+ * collected above and reposition the jobs whose priority changed.
+ * A plugin that provides update_jobs hands back just the jobs it
+ * changed, which are repositioned one by one; otherwise the whole queue
+ * is scanned.  Blocked jobs are only retried if a job now comes before
+ * the first of them and did not before: each changed job is compared
+ * with it before being repositioned, and if the blocked job itself
+ * dropped, only the jobs it drops past are visited.
+ */
+static void prioritize_pending_jobs (schedpass_t *p,
+                                     struct priority_plugin *priority_plugin)
+{
+    zlist_t *jobs = NULL;
+    zlist_t *changed = NULL;
+    flux_lwj_t *job = NULL;
+    flux_lwj_t *blocked = first_blocked (p);
+    double bprio = blocked? jobqueue_pending_prio (p->jobs, blocked) : 0.;
+    bool ahead = false;
+    uint64_t t0 = 0;
+
+    if (!(jobs = zlist_new ()))
+        oom ();
+    t0 = schedstats_now ();
+    collect_pending_jobs (p, priority_plugin, jobs);
+    if (priority_plugin->update_jobs) {
+        if (!(changed = zlist_new ()))
+            oom ();
+        priority_plugin->update_jobs (p->h, jobs, changed);
+        schedstats_record (p->stats, SCHEDSTATS_PRIORITIZE, t0);
+        ahead = blocked && jobqueue_pending_drops_behind (p->jobs, blocked);
+        for (job = zlist_first (changed); job; job = zlist_next (changed)) {
+            if (blocked && !ahead)
+                ahead = moved_ahead_of_blocked (p, job, blocked, bprio);
+            jobqueue_pending_update (p->jobs, job);
+        }
+        /* file the unchanged ones under their associations too */
+        for (job = zlist_first (jobs); job; job = zlist_next (jobs))
+            jobqueue_pending_update (p->jobs, job);
+        zlist_destroy (&changed);
+    } else {
+        priority_plugin->prioritize_jobs (p->h, jobs);
+        schedstats_record (p->stats, SCHEDSTATS_PRIORITIZE, t0);
+        ahead = blocked && jobqueue_pending_drops_behind (p->jobs, blocked);
+        for (job = zlist_first (jobs); job && blocked && !ahead;
+             job = zlist_next (jobs))
+            ahead = moved_ahead_of_blocked (p, job, blocked, bprio);
+        jobqueue_pending_reorder (p->jobs);
+    }
+    if (ahead)
+        schedpass_rs_changed (p);
+    zlist_destroy (&jobs);
+}
+
+/*
+ * schedule_job() searches through all of the idle resources to
+ * satisfy a job's requirements.  If enough resources are found, it
+ * proceeds to allocate those resources and hands the job to alloc_cb.
+ * If less resources are found than the job requires, and if the job
+ * asks to reserve resources, then those resources will be reserved.
+ * With persistent reservations the plugin is also asked to place a job
+ * for which nothing is idle now.
+ */
+static int schedule_job (schedpass_t *p, flux_lwj_t *job, int64_t starttime)
+{
+    flux_t *h = p->h;
+    int rc = -1;
+    int64_t nfound = 0;
+    int64_t nreqrd = 0;
+    resrc_reqst_t *resrc_reqst = NULL;
+    resrc_tree_t *found_tree = NULL;
+    resrc_tree_t *selected_tree = NULL;
+    uint64_t t0 = 0;
+    struct behavior_plugin *plugin = behavior_plugin_get (p->loader);
+
+    if (!(resrc_reqst = jobreq_resrc_reqst (p->rsapi, job, starttime,
+                                            &nreqrd))) {
+        flux_log (h, LOG_ERR, "Null resource request object!");
+        goto done;
+    }
+
+    /* A kept reservation that starts within the job's walltime from now
+     * stands in the way of the job starting now on what it reserved.  It
+     * is given up, and the job placed again, only if resources were
+     * released since the last pass or if its start time has come without
+     * the job starting: otherwise the job cannot start now either.
+     */
+    if (p->persist_rsv && job->resrc_tree
+        && job->rsv_starttime <= starttime + (int64_t)job->req->walltime
+        && (p->released || job->rsv_starttime <= starttime))
+        schedpass_drop_reservation (p, job);
+
+    t0 = schedstats_now ();
+    nfound = plugin->find_resources (h, p->rsapi, GET_ROOT_RESRC(p->rsapi),
+                                     resrc_reqst, &found_tree);
+    plugin_charge (p, SCHEDSTATS_FIND, t0);
+    if (nfound) {
+        flux_log (h, LOG_DEBUG, "Found %"PRId64" %s(s) for job %"PRId64", "
+                  "required: %"PRId64"", nfound,
+                  resrc_type (resrc_reqst_resrc (resrc_reqst)), job->lwj_id,
+                  nreqrd);
+
+        resrc_tree_unstage_resources (found_tree);
+        resrc_reqst_clear_found (resrc_reqst);
+        t0 = schedstats_now ();
+        selected_tree = plugin->select_resources (h, p->rsapi, found_tree,
+                                                  resrc_reqst, NULL);
+        plugin_charge (p, SCHEDSTATS_SELECT, t0);
+    }
+    if (selected_tree && resrc_reqst_all_found (resrc_reqst)) {
+        /* resources found around a kept reservation */
+        if (p->persist_rsv && job->resrc_tree)
+            resrc_tree_release_reservation (job->resrc_tree, job->lwj_id);
+        t0 = schedstats_now ();
+        plugin->allocate_resources (h, p->rsapi, selected_tree, job->lwj_id,
+                                    starttime,
+                                    starttime + job->req->walltime);
+        plugin_charge (p, SCHEDSTATS_ALLOCATE, t0);
+        job->starttime = starttime;
+        if (job->resrc_tree != NULL) {
+            resrc_tree_destroy (p->rsapi, job->resrc_tree, false, false);
+            job->resrc_tree = NULL;
+        }
+        job->resrc_tree = selected_tree;
+        if (p->alloc_cb (job, p->arg) != 0) {
+            resrc_tree_destroy (p->rsapi, job->resrc_tree, false, false);
+            job->resrc_tree = NULL;
+            goto done;
+        }
+        flux_log (h, LOG_DEBUG, "Allocated %"PRId64" %s(s) for job "
+                  "%"PRId64"", nreqrd,
+                  resrc_type (resrc_reqst_resrc (resrc_reqst)),
+                  job->lwj_id);
+    } else if (selected_tree || p->persist_rsv) {
+        if (p->persist_rsv) {
+            /* the plugin gets the reservation the job holds, if any,
+             * and decides whether it stands */
+            resrc_tree_destroy (p->rsapi, selected_tree, false, false);
+            selected_tree = job->resrc_tree;
+            job->resrc_tree = NULL;
+        }
+        t0 = schedstats_now ();
+        rc = plugin->reserve_resources (h, p->rsapi, &selected_tree,
+                                        job->lwj_id, starttime,
+                                        job->req->walltime,
+                                        GET_ROOT_RESRC(p->rsapi),
+                                        resrc_reqst);
+        plugin_charge (p, SCHEDSTATS_RESERVE, t0);
+        if (rc) {
+            resrc_tree_destroy (p->rsapi, selected_tree, false, false);
+            job->resrc_tree = NULL;
+            job->rsv_starttime = 0;
+        } else {
+            if (job->resrc_tree != NULL) {
+                resrc_tree_destroy (p->rsapi, job->resrc_tree, false, false);
+                job->resrc_tree = NULL;
+            }
+            job->resrc_tree = selected_tree;
+            /* the request's starttime is where the plugin reserved the
+             * job, if it did */
+            job->rsv_starttime = (selected_tree)?
+                resrc_reqst_starttime (resrc_reqst) : 0;
+        }
+    }
+    rc = 0;
+done:
+    if (resrc_reqst)
+        resrc_reqst_destroy (p->rsapi, resrc_reqst);
+    if (found_tree)
+        resrc_tree_destroy (p->rsapi, found_tree, false, false);
+
+    return rc;
+}
+
+int schedpass_run (schedpass_t *p, int64_t now, long queue_depth)
+{
+    int rc = 0;
+    long qdepth = 0;
+    flux_lwj_t *job = NULL;
+    struct behavior_plugin *behavior_plugin = behavior_plugin_get (p->loader);
+    struct priority_plugin *priority_plugin = priority_plugin_get (p->loader);
+    uint64_t pass_t0 = schedstats_now ();
+    uint64_t t0 = 0;
+    bool skip_blocked = false;
+
+    p->plugin_ns = 0;
+    if (priority_plugin) {
+        charge_running_jobs (p, priority_plugin, now);
+        prioritize_pending_jobs (p, priority_plugin);
+    }
+    if (!behavior_plugin) {
+        flux_log (p->h, LOG_ERR, "No scheduler policy plugin has been loaded!");
+        return -1;
+    }
+
+    /* The pending queue is kept in decreasing priority order.
+     * A job that failed to be scheduled against the current resource-state
+     * generation cannot fit now either, so it is skipped along with the
+     * reservation it already holds, which the plugin accounts for through
+     * job_skipped. Reservations are only rebuilt when the generation has
+     * moved since the last pass. A plugin that reserves out of order
+     * without job_skipped has every job tried again on a clean slate.
+     */
+    skip_blocked = !p->ooo_capable || behavior_plugin->job_skipped;
+    if (p->ooo_capable && !p->persist_rsv
+        && (!skip_blocked || p->pass_gen != p->rs_gen))
+        release_reservations (p);
+    p->pass_gen = p->rs_gen;
+    p->released = (p->pass_rel_gen != p->rel_gen);
+    p->pass_rel_gen = p->rel_gen;
+    p->blocked_id = -1;
+    t0 = schedstats_now ();
+    rc = behavior_plugin->sched_loop_setup (p->h);
+    plugin_charge (p, SCHEDSTATS_LOOP_SETUP, t0);
+    job = jobqueue_first (p->jobs, JOBQ_PENDING);
+    while (!rc && job && (qdepth < queue_depth)) {
+        if (job->state == J_SCHEDREQ) {
+            if (skip_blocked && job->blocked_gen == p->rs_gen) {
+                if (job->resrc_tree && behavior_plugin->job_skipped
+                    && behavior_plugin->job_skipped (job) < 0)
+                    schedpass_drop_reservation (p, job);
+            } else {
+                rc = schedule_job (p, job, now);
+                if (!rc && job->state == J_SCHEDREQ)
+                    job->blocked_gen = p->rs_gen;
+            }
+            if (p->blocked_id < 0 && job->state == J_SCHEDREQ
+                && job->blocked_gen == p->rs_gen)
+                p->blocked_id = job->lwj_id;
+        }
+        job = jobqueue_next (p->jobs);
+        qdepth++;
+    }
+    /* jobs past the queue depth are not considered, and must not hold
+     * on to what they reserved while they were */
+    if (!rc && p->persist_rsv) {
+        for (; job; job = jobqueue_next (p->jobs))
+            if (job->state == J_SCHEDREQ && job->resrc_tree)
+                schedpass_drop_reservation (p, job);
+    }
+    p->pass_ns = schedstats_now () - pass_t0;
+    schedstats_record_ns (p->stats, SCHEDSTATS_PASS, p->pass_ns);
+
+    return rc;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
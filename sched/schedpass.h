@@ -0,0 +1,98 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#ifndef SCHEDPASS_H
+#define SCHEDPASS_H 1
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <czmq.h>
+#include <flux/core.h>
+
+#include "resrc_api.h"
+#include "scheduler.h"
+#include "plugin.h"
+#include "jobqueue.h"
+#include "schedstats.h"
+
+typedef struct schedpass schedpass_t;
+
+/* Called when a pass has allocated resources to a pending job, with
+ * job->resrc_tree and job->starttime set.  The caller moves the job on
+ * from there, e.g., by recording the allocation and asking for the job
+ * to run.  Returns 0 on success; on error the job's resource tree is
+ * dropped and the pass stops.
+ */
+typedef int (*schedpass_alloc_f)(flux_lwj_t *job, void *arg);
+
+/* Scheduling pass c'tor/d'tor. A pass walks the pending queue of jobs
+ * in priority order and has the plugins of loader find, select and then
+ * allocate or reserve resources for each job.  This is the scheduling
+ * loop of the sched module, shared with flux-sim-replay: h may be NULL,
+ * in which case plugin and pass log messages go to stderr.  Phase
+ * latencies are recorded in stats.
+ */
+schedpass_t *schedpass_new (flux_t *h, resrc_api_ctx_t *rsapi,
+                            struct sched_plugin_loader *loader,
+                            jobqueue_t *jobs, schedstats_t *stats,
+                            schedpass_alloc_f alloc_cb, void *arg);
+void schedpass_destroy (schedpass_t *p);
+
+/* Adopt the properties of the loaded behavior plugin */
+void schedpass_set_props (schedpass_t *p, const struct sched_prop *prop);
+
+/* Record a change to the resources or to the pending queue that may
+ * change how blocked jobs are scheduled, e.g., resources excluded or
+ * the queue reordered ahead of blocked jobs.  Every blocked job is
+ * retried by the next pass.
+ */
+void schedpass_rs_changed (schedpass_t *p);
+
+/* Record that resources were released or included, or that a pending
+ * job's reservation was cancelled, which is also a change as above.
+ * Persistent reservations that would start within the walltime of
+ * their job are only reconsidered after such a release.
+ */
+void schedpass_rs_released (schedpass_t *p);
+
+/* Give up the reservation a pending job holds, if any */
+void schedpass_drop_reservation (schedpass_t *p, flux_lwj_t *job);
+
+/* Run one pass at time now over at most queue_depth pending jobs.
+ * Returns 0 on success, -1 if no behavior plugin is loaded or a job
+ * could not be moved on.
+ */
+int schedpass_run (schedpass_t *p, int64_t now, long queue_depth);
+
+/* Wall time of the last pass and the part of it spent in behavior
+ * plugin callbacks, in nanoseconds.
+ */
+void schedpass_last_ns (schedpass_t *p, uint64_t *pass_ns,
+                        uint64_t *plugin_ns);
+
+#endif /* SCHEDPASS_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
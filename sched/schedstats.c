@@ -0,0 +1,239 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+/*
+ * schedstats.c - per-phase latency histograms of the scheduler
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/common/libutil/xzmalloc.h"
+#include "src/common/libutil/shortjansson.h"
+#include "schedstats.h"
+
+#define SUB_BITS     4
+#define SUB_COUNT    (1 << SUB_BITS)
+/* values below SUB_COUNT get a bucket each; above, each power of two
+ * from 2^SUB_BITS to 2^63 is split into SUB_COUNT buckets */
+#define NBUCKETS     (SUB_COUNT + (64 - SUB_BITS) * SUB_COUNT)
+
+typedef struct {
+    uint64_t      count;
+    uint64_t      sum;
+    uint64_t      min;
+    uint64_t      max;
+    uint64_t      buckets[NBUCKETS];
+} histogram_t;
+
+struct schedstats {
+    histogram_t   phases[SCHEDSTATS_NPHASES];
+};
+
+static const char *phase_names[SCHEDSTATS_NPHASES] = {
+    "sched_loop_setup",
+    "find_resources",
+    "select_resources",
+    "allocate_resources",
+    "reserve_resources",
+    "prioritize_jobs",
+    "schedule_pass",
+    "queue_add",
+    "queue_move",
+    "queue_find",
+};
+
+
+/******************************************************************************
+ *                                                                            *
+ *                             Utility functions                              *
+ *                                                                            *
+ ******************************************************************************/
+
+static inline int msb (uint64_t v)
+{
+    return 63 - __builtin_clzll (v);
+}
+
+static inline int bucket_index (uint64_t v)
+{
+    int e;
+
+    if (v < SUB_COUNT)
+        return (int)v;
+    e = msb (v) - SUB_BITS;
+    return SUB_COUNT + e * SUB_COUNT + (int)((v >> e) - SUB_COUNT);
+}
+
+/* Largest value that falls into bucket i */
+static inline uint64_t bucket_high (int i)
+{
+    int e;
+    uint64_t m;
+
+    if (i < SUB_COUNT)
+        return (uint64_t)i;
+    e = (i - SUB_COUNT) / SUB_COUNT;
+    m = (uint64_t)((i - SUB_COUNT) % SUB_COUNT) + SUB_COUNT;
+    return ((m + 1) << e) - 1;
+}
+
+static void histogram_reset (histogram_t *hg)
+{
+    memset (hg, 0, sizeof (*hg));
+    hg->min = UINT64_MAX;
+}
+
+
+/******************************************************************************
+ *                                                                            *
+ *                               Public API                                   *
+ *                                                                            *
+ ******************************************************************************/
+
+schedstats_t *schedstats_new (void)
+{
+    schedstats_t *s = xzmalloc (sizeof (*s));
+    schedstats_reset (s);
+    return s;
+}
+
+void schedstats_destroy (schedstats_t *s)
+{
+    free (s);
+}
+
+uint64_t schedstats_now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void schedstats_record_ns (schedstats_t *s, schedstats_phase_t p, uint64_t ns)
+{
+    histogram_t *hg = NULL;
+
+    if (!s || p < 0 || p >= SCHEDSTATS_NPHASES)
+        return;
+    hg = &s->phases[p];
+    hg->count++;
+    hg->sum += ns;
+    if (ns < hg->min)
+        hg->min = ns;
+    if (ns > hg->max)
+        hg->max = ns;
+    hg->buckets[bucket_index (ns)]++;
+}
+
+void schedstats_record (schedstats_t *s, schedstats_phase_t p, uint64_t start)
+{
+    uint64_t now = schedstats_now ();
+    schedstats_record_ns (s, p, (now > start)? now - start : 0);
+}
+
+void schedstats_reset (schedstats_t *s)
+{
+    int p;
+
+    if (s)
+        for (p = 0; p < SCHEDSTATS_NPHASES; p++)
+            histogram_reset (&s->phases[p]);
+}
+
+uint64_t schedstats_count (schedstats_t *s, schedstats_phase_t p)
+{
+    if (!s || p < 0 || p >= SCHEDSTATS_NPHASES)
+        return 0;
+    return s->phases[p].count;
+}
+
+uint64_t schedstats_quantile (schedstats_t *s, schedstats_phase_t p,
+                              double q)
+{
+    histogram_t *hg = NULL;
+    uint64_t rank = 0;
+    uint64_t seen = 0;
+    int i;
+
+    if (!s || p < 0 || p >= SCHEDSTATS_NPHASES || !s->phases[p].count)
+        return 0;
+    hg = &s->phases[p];
+    if (q <= 0.0)
+        return hg->min;
+    if (q >= 1.0)
+        return hg->max;
+    rank = (uint64_t)(q * (double)hg->count);
+    if ((double)rank < q * (double)hg->count || rank < 1)
+        rank++;
+    for (i = 0; i < NBUCKETS; i++) {
+        seen += hg->buckets[i];
+        if (seen >= rank) {
+            uint64_t v = bucket_high (i);
+            return (v > hg->max)? hg->max : v;
+        }
+    }
+    return hg->max;
+}
+
+const char *schedstats_phase_name (schedstats_phase_t p)
+{
+    if (p < 0 || p >= SCHEDSTATS_NPHASES)
+        return NULL;
+    return phase_names[p];
+}
+
+json_t *schedstats_to_json (schedstats_t *s)
+{
+    json_t *o = Jnew ();
+    json_t *phase = NULL;
+    histogram_t *hg = NULL;
+    int p;
+
+    for (p = 0; p < SCHEDSTATS_NPHASES; p++) {
+        hg = &s->phases[p];
+        phase = Jnew ();
+        Jadd_int64 (phase, "count", (int64_t)hg->count);
+        Jadd_int64 (phase, "min", (int64_t)(hg->count? hg->min : 0));
+        Jadd_int64 (phase, "max", (int64_t)hg->max);
+        Jadd_int64 (phase, "mean", (int64_t)(hg->count? hg->sum / hg->count
+                                                      : 0));
+        Jadd_int64 (phase, "p50", (int64_t)schedstats_quantile (s, p, 0.50));
+        Jadd_int64 (phase, "p90", (int64_t)schedstats_quantile (s, p, 0.90));
+        Jadd_int64 (phase, "p99", (int64_t)schedstats_quantile (s, p, 0.99));
+        Jadd_int64 (phase, "p999", (int64_t)schedstats_quantile (s, p, 0.999));
+        json_object_set_new (o, phase_names[p], phase);
+    }
+    return o;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,91 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#ifndef SCHEDSTATS_H
+#define SCHEDSTATS_H 1
+
+#include <stdint.h>
+#include <jansson.h>
+
+/* The scheduler phases whose latencies are recorded */
+typedef enum {
+    SCHEDSTATS_LOOP_SETUP,      /* behavior plugin sched_loop_setup */
+    SCHEDSTATS_FIND,            /* behavior plugin find_resources */
+    SCHEDSTATS_SELECT,          /* behavior plugin select_resources */
+    SCHEDSTATS_ALLOCATE,        /* behavior plugin allocate_resources */
+    SCHEDSTATS_RESERVE,         /* behavior plugin reserve_resources */
+    SCHEDSTATS_PRIORITIZE,      /* priority plugin prioritize_jobs */
+    SCHEDSTATS_PASS,            /* a whole scheduling pass */
+    SCHEDSTATS_QUEUE_ADD,       /* enqueue a new job */
+    SCHEDSTATS_QUEUE_MOVE,      /* move a job between queues */
+    SCHEDSTATS_QUEUE_FIND,      /* look a job up by id */
+    SCHEDSTATS_NPHASES
+} schedstats_phase_t;
+
+typedef struct schedstats schedstats_t;
+
+/* Stats c'tor/d'tor. Each phase keeps a log-linear latency histogram
+ * in nanoseconds (16 linear buckets per power of two, so any recorded
+ * value is reported within 1/16 of its true value) along with its count,
+ * sum, min and max.  Recording is a handful of integer updates with no
+ * allocation or locking: the scheduler only records from its reactor.
+ */
+schedstats_t *schedstats_new (void);
+void schedstats_destroy (schedstats_t *s);
+
+/* Monotonic clock in nanoseconds, to pass as start to schedstats_record */
+uint64_t schedstats_now (void);
+
+/* Record the time elapsed since start in phase p */
+void schedstats_record (schedstats_t *s, schedstats_phase_t p, uint64_t start);
+
+/* Record a latency of ns nanoseconds in phase p */
+void schedstats_record_ns (schedstats_t *s, schedstats_phase_t p, uint64_t ns);
+
+/* Clear every histogram */
+void schedstats_reset (schedstats_t *s);
+
+/* Return the value at or below which the given fraction (0 to 1) of
+ * the latencies of phase p fall, or 0 if none were recorded.
+ */
+uint64_t schedstats_quantile (schedstats_t *s, schedstats_phase_t p,
+                              double q);
+
+/* Number of latencies recorded in phase p */
+uint64_t schedstats_count (schedstats_t *s, schedstats_phase_t p);
+
+/* Name of phase p */
+const char *schedstats_phase_name (schedstats_phase_t p);
+
+/* Return a new JSON object keyed by phase name, each holding the count,
+ * min, max, mean and the 50th, 90th, 99th and 99.9th percentiles of
+ * the phase latencies in nanoseconds.
+ */
+json_t *schedstats_to_json (schedstats_t *s);
+
+#endif /* SCHEDSTATS_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -61,12 +61,18 @@ typedef struct {
     char    *account;    /*!< account to charge for resource usage */
     flux_res_t *req;     /*!< resources requested by this LWJ */
     resrc_tree_t *resrc_tree; /*!< resources allocated to this LWJ */
+    int64_t rsv_starttime; /*!< start of the reservation this LWJ holds */
     int64_t submittime;
     int64_t starttime;
     int64_t endtime;
+    int64_t usage_time;  /*!< time up to which usage has been charged */
     int64_t enqueue_pos; /*!< the initial enqueue position */
+    uint64_t blocked_gen; /*!< resource-state generation at which this job
+                               last failed to be scheduled */
     double user_prio;    /*!< user-requested priority */
     double priority;     /*!< scheduling priority */
+    void    *prio_assoc; /*!< priority plugin's cached association handle */
+    uint64_t prio_assoc_gen; /*!< plugin generation prio_assoc belongs to */
 } flux_lwj_t;
 
 /**
@@ -74,6 +80,8 @@ typedef struct {
  */
 struct sched_prop {
     bool out_of_order_capable; ;   /*!< true if out of order scheduling*/
+    bool persistent_reservations;  /*!< true if reservations are kept
+                                        across scheduling passes */
 };
 
 /**
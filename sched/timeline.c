@@ -0,0 +1,351 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+/*
+ * timeline.c - per-type resource usage profile of job time windows
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <czmq.h>
+
+#include "src/common/libutil/xzmalloc.h"
+#include "timeline.h"
+
+typedef struct {
+    int64_t       starttime;
+    int64_t       endtime;
+    int64_t       counts[TIMELINE_MAX_TYPES];
+    bool          reserved;
+} window_t;
+
+typedef struct {
+    int64_t       time;
+    int64_t       used[TIMELINE_MAX_TYPES];
+} step_t;
+
+struct timeline {
+    char         *types[TIMELINE_MAX_TYPES];
+    int           ntypes;
+    zhash_t      *windows;       /* job id -> window_t */
+    step_t       *steps;         /* sorted by time, steps[0] is the past */
+    size_t        nsteps;
+    size_t        cap;
+};
+
+
+/******************************************************************************
+ *                                                                            *
+ *                             Profile steps                                  *
+ *                                                                            *
+ ******************************************************************************/
+
+/* Index of the step in effect at time t */
+static size_t step_at (timeline_t *tl, int64_t t)
+{
+    size_t lo = 0;
+    size_t hi = tl->nsteps;
+
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (tl->steps[mid].time <= t)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Make sure a step starts at time t and return its index */
+static size_t step_split (timeline_t *tl, int64_t t)
+{
+    size_t i = step_at (tl, t);
+
+    if (tl->steps[i].time == t)
+        return i;
+    if (tl->nsteps == tl->cap) {
+        tl->cap *= 2;
+        tl->steps = xrealloc (tl->steps, tl->cap * sizeof (step_t));
+    }
+    i++;
+    memmove (&tl->steps[i + 1], &tl->steps[i],
+             (tl->nsteps - i) * sizeof (step_t));
+    memcpy (tl->steps[i].used, tl->steps[i - 1].used,
+            sizeof (tl->steps[i].used));
+    tl->steps[i].time = t;
+    tl->nsteps++;
+    return i;
+}
+
+/* Fold step i into step i - 1 if they use the same resources */
+static void step_coalesce (timeline_t *tl, size_t i)
+{
+    if (i == 0 || i >= tl->nsteps)
+        return;
+    if (memcmp (tl->steps[i].used, tl->steps[i - 1].used,
+                sizeof (tl->steps[i].used)))
+        return;
+    memmove (&tl->steps[i], &tl->steps[i + 1],
+             (tl->nsteps - i - 1) * sizeof (step_t));
+    tl->nsteps--;
+}
+
+static void profile_apply (timeline_t *tl, window_t *w, int sign)
+{
+    size_t i, j, k;
+    int t;
+
+    i = step_split (tl, w->starttime);
+    j = (w->endtime < INT64_MAX)? step_split (tl, w->endtime + 1) : tl->nsteps;
+    for (k = i; k < j; k++)
+        for (t = 0; t < tl->ntypes; t++)
+            tl->steps[k].used[t] += sign * w->counts[t];
+    step_coalesce (tl, j);
+    step_coalesce (tl, i);
+}
+
+static bool step_over (timeline_t *tl, size_t i, const int64_t *limit)
+{
+    int t;
+    for (t = 0; t < tl->ntypes; t++)
+        if (tl->steps[i].used[t] > limit[t])
+            return true;
+    return false;
+}
+
+
+/******************************************************************************
+ *                                                                            *
+ *                               Public API                                   *
+ *                                                                            *
+ ******************************************************************************/
+
+timeline_t *timeline_new (void)
+{
+    timeline_t *tl = xzmalloc (sizeof (*tl));
+
+    tl->windows = zhash_new ();
+    tl->cap = 64;
+    tl->steps = xzmalloc (tl->cap * sizeof (step_t));
+    tl->steps[0].time = INT64_MIN;
+    tl->nsteps = 1;
+    return tl;
+}
+
+void timeline_destroy (timeline_t *tl)
+{
+    int t;
+
+    if (tl) {
+        zhash_destroy (&tl->windows);
+        for (t = 0; t < tl->ntypes; t++)
+            free (tl->types[t]);
+        free (tl->steps);
+        free (tl);
+    }
+}
+
+int timeline_type_index (timeline_t *tl, const char *type)
+{
+    int t;
+
+    for (t = 0; t < tl->ntypes; t++)
+        if (!strcmp (tl->types[t], type))
+            return t;
+    if (tl->ntypes == TIMELINE_MAX_TYPES)
+        return -1;
+    tl->types[tl->ntypes] = xstrdup (type);
+    return tl->ntypes++;
+}
+
+const char *timeline_type_name (timeline_t *tl, int index)
+{
+    if (index < 0 || index >= tl->ntypes)
+        return NULL;
+    return tl->types[index];
+}
+
+int timeline_add (timeline_t *tl, int64_t job_id, int64_t starttime,
+                  int64_t endtime, const int64_t *counts, bool reserved)
+{
+    char key[32];
+    window_t *w = NULL;
+
+    if (endtime < starttime) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (timeline_has (tl, job_id))
+        timeline_remove (tl, job_id);
+
+    w = xzmalloc (sizeof (*w));
+    w->starttime = starttime;
+    w->endtime = endtime;
+    memcpy (w->counts, counts, sizeof (w->counts));
+    w->reserved = reserved;
+    snprintf (key, sizeof (key), "%"PRId64"", job_id);
+    zhash_insert (tl->windows, key, w);
+    zhash_freefn (tl->windows, key, free);
+    profile_apply (tl, w, 1);
+    return 0;
+}
+
+int timeline_remove (timeline_t *tl, int64_t job_id)
+{
+    char key[32];
+    window_t *w = NULL;
+
+    snprintf (key, sizeof (key), "%"PRId64"", job_id);
+    if (!(w = zhash_lookup (tl->windows, key))) {
+        errno = ENOENT;
+        return -1;
+    }
+    profile_apply (tl, w, -1);
+    zhash_delete (tl->windows, key);
+    return 0;
+}
+
+bool timeline_has (timeline_t *tl, int64_t job_id)
+{
+    char key[32];
+
+    snprintf (key, sizeof (key), "%"PRId64"", job_id);
+    return zhash_lookup (tl->windows, key) != NULL;
+}
+
+int timeline_get (timeline_t *tl, int64_t job_id, int64_t *starttime,
+                  int64_t *endtime, int64_t *counts, bool *reserved)
+{
+    char key[32];
+    window_t *w = NULL;
+
+    snprintf (key, sizeof (key), "%"PRId64"", job_id);
+    if (!(w = zhash_lookup (tl->windows, key))) {
+        errno = ENOENT;
+        return -1;
+    }
+    if (starttime)
+        *starttime = w->starttime;
+    if (endtime)
+        *endtime = w->endtime;
+    if (counts)
+        memcpy (counts, w->counts, sizeof (w->counts));
+    if (reserved)
+        *reserved = w->reserved;
+    return 0;
+}
+
+/* Remove the windows for which match (w, arg) is true */
+static void remove_windows (timeline_t *tl,
+                            bool (*match)(window_t *w, int64_t arg),
+                            int64_t arg)
+{
+    zlist_t *keys = zlist_new ();
+    window_t *w = NULL;
+    char *key = NULL;
+
+    for (w = zhash_first (tl->windows); w; w = zhash_next (tl->windows)) {
+        if (match (w, arg)) {
+            profile_apply (tl, w, -1);
+            zlist_append (keys, (void *)zhash_cursor (tl->windows));
+        }
+    }
+    for (key = zlist_first (keys); key; key = zlist_next (keys))
+        zhash_delete (tl->windows, key);
+    zlist_destroy (&keys);
+}
+
+static bool is_reserved (window_t *w, int64_t arg)
+{
+    return w->reserved;
+}
+
+static bool ended_before (window_t *w, int64_t now)
+{
+    return w->endtime < now;
+}
+
+void timeline_clear_reserved (timeline_t *tl)
+{
+    remove_windows (tl, is_reserved, 0);
+}
+
+void timeline_purge (timeline_t *tl, int64_t now)
+{
+    size_t i;
+
+    remove_windows (tl, ended_before, now);
+    if ((i = step_at (tl, now)) > 0) {
+        memcpy (tl->steps[0].used, tl->steps[i].used,
+                sizeof (tl->steps[0].used));
+        memmove (&tl->steps[1], &tl->steps[i + 1],
+                 (tl->nsteps - i - 1) * sizeof (step_t));
+        tl->nsteps -= i;
+    }
+}
+
+size_t timeline_size (timeline_t *tl)
+{
+    return zhash_size (tl->windows);
+}
+
+size_t timeline_nsteps (timeline_t *tl)
+{
+    return tl->nsteps;
+}
+
+int64_t timeline_earliest (timeline_t *tl, int64_t after, int64_t duration,
+                           const int64_t *limit)
+{
+    size_t i = step_at (tl, after) + 1;
+    size_t j;
+    int64_t start;
+    int64_t end;
+
+    while (i < tl->nsteps) {
+        if (step_over (tl, i, limit)) {
+            i++;
+            continue;
+        }
+        start = tl->steps[i].time;
+        end = (start > INT64_MAX - duration)? INT64_MAX : start + duration;
+        for (j = i + 1; j < tl->nsteps && tl->steps[j].time <= end; j++)
+            if (step_over (tl, j, limit))
+                break;
+        if (j == tl->nsteps || tl->steps[j].time > end)
+            return start;
+        i = j + 1;
+    }
+    return -1;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,103 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+#ifndef TIMELINE_H
+#define TIMELINE_H 1
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Number of distinct resource types a timeline keeps counts for */
+#define TIMELINE_MAX_TYPES 8
+
+typedef struct timeline timeline_t;
+
+/* Timeline c'tor/d'tor. A timeline records, per job, the time window
+ * [starttime, endtime] during which the job holds resources along with
+ * the number of resources of each type it holds, and keeps the usage
+ * profile that follows from those windows: a sorted array of steps,
+ * each giving the number of resources of every type in use from its
+ * time up to the next step.
+ */
+timeline_t *timeline_new (void);
+void timeline_destroy (timeline_t *tl);
+
+/* Return the index under which counts for resource type are kept,
+ * interning the type on first use, or -1 if TIMELINE_MAX_TYPES types
+ * are already known.
+ */
+int timeline_type_index (timeline_t *tl, const char *type);
+
+/* Return the resource type kept under index, or NULL */
+const char *timeline_type_name (timeline_t *tl, int index);
+
+/* Record that job_id holds counts[i] resources of the type with index i
+ * from starttime to endtime, inclusive.  counts must hold
+ * TIMELINE_MAX_TYPES entries.  A job already in the timeline is
+ * replaced.  A reserved window is one the job has not started in yet.
+ * Returns 0 on success, -1 on error.
+ */
+int timeline_add (timeline_t *tl, int64_t job_id, int64_t starttime,
+                  int64_t endtime, const int64_t *counts, bool reserved);
+
+/* Remove the window of job_id.  Returns 0 on success or -1 with errno
+ * set to ENOENT if the job is not in the timeline.
+ */
+int timeline_remove (timeline_t *tl, int64_t job_id);
+
+/* Is job_id in the timeline? */
+bool timeline_has (timeline_t *tl, int64_t job_id);
+
+/* Fetch the window of job_id; any of the outputs may be NULL, counts
+ * must otherwise hold TIMELINE_MAX_TYPES entries.  Returns 0 on success
+ * or -1 with errno set to ENOENT if the job is not in the timeline.
+ */
+int timeline_get (timeline_t *tl, int64_t job_id, int64_t *starttime,
+                  int64_t *endtime, int64_t *counts, bool *reserved);
+
+/* Remove every reserved window */
+void timeline_clear_reserved (timeline_t *tl);
+
+/* Remove the windows that ended before now and fold the steps of the
+ * past into the one in effect at now.
+ */
+void timeline_purge (timeline_t *tl, int64_t now);
+
+/* Number of windows and of profile steps */
+size_t timeline_size (timeline_t *tl);
+size_t timeline_nsteps (timeline_t *tl);
+
+/* Return the earliest step time strictly after 'after' from which, for
+ * 'duration' seconds, no more than limit[i] resources of each type i
+ * are in use, or -1 if there is none.  limit must hold
+ * TIMELINE_MAX_TYPES entries; use INT64_MAX for unconstrained types.
+ */
+int64_t timeline_earliest (timeline_t *tl, int64_t after, int64_t duration,
+                           const int64_t *limit);
+
+#endif /* TIMELINE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
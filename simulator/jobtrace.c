@@ -0,0 +1,456 @@
+/*****************************************************************************\
+ *  Copyright (c) 2014 Lawrence Livermore National Security, LLC.  Produced at
+ *  the Lawrence Livermore National Laboratory (cf, AUTHORS, DISCLAIMER.LLNS).
+ *  LLNL-CODE-658032 All rights reserved.
+ *
+ *  This file is part of the Flux resource manager framework.
+ *  For details, see https://github.com/flux-framework.
+ *
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the license, or (at your option)
+ *  any later version.
+ *
+ *  Flux is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the IMPLIED WARRANTY OF MERCHANTABILITY or
+ *  FITNESS FOR A PARTICULAR PURPOSE.  See the terms and conditions of the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA 02111-1307 USA.
+ *  See also:  http://www.gnu.org/licenses/
+\*****************************************************************************/
+
+
+/*
+ * jobtrace.c - streaming reader for job-trace csv files
+ *
+ * The trace is mapped rather than read.  One pass over it resolves the
+ * header into a column-to-field table and records, per data row, only
+ * the submit time and the row's offset.  Rows are sorted on that compact
+ * index and parsed into a job_t one at a time, in submit-time order, as
+ * the caller asks for them: memory stays at a few words per job no
+ * matter how large the trace is.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <flux/core.h>
+
+#include "src/common/libutil/oom.h"
+#include "src/common/libutil/xzmalloc.h"
+#include "simulator.h"
+
+typedef enum {
+    COL_IGNORED = 0,
+    COL_JOBID,
+    COL_USER,
+    COL_JOBNAME,
+    COL_ACCOUNT,
+    COL_NNODES,
+    COL_NCPUS,
+    COL_TIMELIMIT,
+    COL_SUBMIT,
+    COL_ELAPSED,
+    COL_IORATE,
+} trace_col_t;
+
+static const struct {
+    const char *name;
+    trace_col_t col;
+} trace_columns[] = {
+    { "JobID",      COL_JOBID },
+    { "User",       COL_USER },
+    { "JobName",    COL_JOBNAME },
+    { "Account",    COL_ACCOUNT },
+    { "NNodes",     COL_NNODES },
+    { "NCPUS",      COL_NCPUS },
+    { "Timelimit",  COL_TIMELIMIT },
+    { "Submit",     COL_SUBMIT },
+    { "Elapsed",    COL_ELAPSED },
+    { "IORate(MB)", COL_IORATE },
+};
+
+typedef struct {
+    double submit_time;
+    size_t offset;           // start of the row in the mapped trace
+} trace_row_t;
+
+struct job_trace {
+    flux_t *h;
+    char *data;              // the mapped trace
+    size_t size;
+    trace_col_t *cols;       // field of each column of the header
+    int ncols;
+    int submit_col;          // column holding the submit time, -1 if none
+    bool has_timelimit;
+    trace_row_t *rows;       // data rows in order of submit time
+    size_t nrows;
+    size_t next;             // next row job_trace_next () returns
+    int tm_key[4];           // year, month, day and hour of tm_base
+    time_t tm_base;          // local time of tm_key, -1 if not cached
+};
+
+/******************************************************************************
+ *                                                                            *
+ *                              Field Parsing                                 *
+ *                                                                            *
+ ******************************************************************************/
+
+static inline const char *line_end (job_trace_t *t, const char *p)
+{
+    const char *e = memchr (p, '\n', t->data + t->size - p);
+    return e ? e : t->data + t->size;
+}
+
+// Return the end of the field that starts at p on a line ending at eol
+static inline const char *field_end (const char *p, const char *eol)
+{
+    const char *e = memchr (p, ',', eol - p);
+    return e ? e : eol;
+}
+
+// Copy a field into buf, NUL-terminated and truncated to fit, so that
+// the number parsers never run past the end of the mapping
+static inline char *field_copy (char *buf, size_t len,
+                                const char *s, const char *e)
+{
+    size_t n = e - s;
+    if (n >= len)
+        n = len - 1;
+    memcpy (buf, s, n);
+    buf[n] = '\0';
+    return buf;
+}
+
+static inline char *field_dup (const char *s, const char *e)
+{
+    char *str = xzmalloc (e - s + 1);
+    memcpy (str, s, e - s);
+    return str;
+}
+
+// Parse up to n digits
+static bool parse_digits (const char **p, int n, int *val)
+{
+    int v = 0, i;
+    for (i = 0; i < n && **p >= '0' && **p <= '9'; i++, (*p)++)
+        v = v * 10 + (**p - '0');
+    *val = v;
+    return i > 0;
+}
+
+// Convert the string representation of time in the csv (hh:mm:ss) to sec
+static double convert_time_to_sec (const char *time)
+{
+    int hms[3] = { 0, 0, 0 };
+    int i;
+    for (i = 0; i < 3; i++) {
+        if (!parse_digits (&time, 9, &hms[i]) || *time++ != ':')
+            break;
+    }
+    return (double)((hms[0] * 3600) + (hms[1] * 60) + hms[2]);
+}
+
+// Convert a local yyyy-mm-ddThh:mm:ss timestamp to seconds since epoch.
+// Traces are mostly in time order, so the local time of the hour is
+// cached and mktime () only runs when the hour changes.
+static int convert_timestamp (job_trace_t *t, const char *s, double *stime)
+{
+    int key[4], min, sec;
+    struct tm tm_spec;
+
+    if (!parse_digits (&s, 4, &key[0]) || *s++ != '-'
+        || !parse_digits (&s, 2, &key[1]) || *s++ != '-'
+        || !parse_digits (&s, 2, &key[2]) || *s++ != 'T'
+        || !parse_digits (&s, 2, &key[3]) || *s++ != ':'
+        || !parse_digits (&s, 2, &min) || *s++ != ':'
+        || !parse_digits (&s, 2, &sec))
+        return -1;
+    if (t->tm_base == -1 || memcmp (key, t->tm_key, sizeof (key)) != 0) {
+        memset (&tm_spec, 0, sizeof (tm_spec));
+        tm_spec.tm_year = key[0] - 1900;
+        tm_spec.tm_mon = key[1] - 1;
+        tm_spec.tm_mday = key[2];
+        tm_spec.tm_hour = key[3];
+        tm_spec.tm_isdst = -1;
+        t->tm_base = mktime (&tm_spec);
+        memcpy (t->tm_key, key, sizeof (key));
+    }
+    *stime = (double)t->tm_base + min * 60 + sec;
+    return 0;
+}
+
+// Parse a submit time, given either in seconds since epoch or as a
+// timestamp
+static double parse_submit (job_trace_t *t, const char *s, const char *e)
+{
+    char buf[64];
+    char *endptr;
+    double stime = strtod (field_copy (buf, sizeof (buf), s, e), &endptr);
+
+    // Check if you parsed only a bit of the string (e.g. just the year)
+    // Trailing whitespace is not an error.
+    if (*endptr != '\0' && *endptr != ' ' && *endptr != '\t'
+        && convert_timestamp (t, buf, &stime) < 0)
+        endptr = buf;
+    if (endptr == buf)
+        flux_log (t->h, LOG_WARNING, "Incorrect Submit format, expects %s"
+                  " or seconds since epoch; replacing '%s' with %f",
+                  "%Y-%m-%dT%H:%M:%S (yyyy-mm-ddThh:mm:ss)", buf, stime);
+    return stime;
+}
+
+// Populate a field in the job_t based off a value extracted from the csv
+static void insert_into_job (job_trace_t *t, job_t *job, trace_col_t col,
+                             const char *s, const char *e)
+{
+    char buf[64];
+
+    switch (col) {
+    case COL_JOBID:
+        job->id = atoi (field_copy (buf, sizeof (buf), s, e));
+        break;
+    case COL_USER:
+        job->user = field_dup (s, e);
+        break;
+    case COL_JOBNAME:
+        job->jobname = field_dup (s, e);
+        break;
+    case COL_ACCOUNT:
+        job->account = field_dup (s, e);
+        break;
+    case COL_NNODES:
+        job->nnodes = atoi (field_copy (buf, sizeof (buf), s, e));
+        break;
+    case COL_NCPUS:
+        job->ncpus = atoi (field_copy (buf, sizeof (buf), s, e));
+        break;
+    case COL_TIMELIMIT:
+        job->time_limit =
+            convert_time_to_sec (field_copy (buf, sizeof (buf), s, e));
+        break;
+    case COL_SUBMIT:
+        job->submit_time = parse_submit (t, s, e);
+        break;
+    case COL_ELAPSED:
+        job->execution_time =
+            convert_time_to_sec (field_copy (buf, sizeof (buf), s, e));
+        break;
+    case COL_IORATE:
+        job->io_rate = atol (field_copy (buf, sizeof (buf), s, e));
+        break;
+    case COL_IGNORED:
+        break;
+    }
+}
+
+
+/******************************************************************************
+ *                                                                            *
+ *                              Trace Indexing                                *
+ *                                                                            *
+ ******************************************************************************/
+
+// Resolve each column name of the header once
+static void index_header (job_trace_t *t, const char *p, const char *eol)
+{
+    const char *e;
+    size_t i;
+    int maxcols = 16;
+
+    if (eol > p && eol[-1] == '\r')
+        eol--;
+    t->cols = xzmalloc (maxcols * sizeof (trace_col_t));
+    t->submit_col = -1;
+    while (p <= eol) {
+        e = field_end (p, eol);
+        if (t->ncols == maxcols) {
+            maxcols *= 2;
+            t->cols = xrealloc (t->cols, maxcols * sizeof (trace_col_t));
+        }
+        t->cols[t->ncols] = COL_IGNORED;
+        for (i = 0; i < sizeof (trace_columns) / sizeof (trace_columns[0]);
+             i++) {
+            if (strlen (trace_columns[i].name) == (size_t)(e - p)
+                && !memcmp (trace_columns[i].name, p, e - p)) {
+                t->cols[t->ncols] = trace_columns[i].col;
+                break;
+            }
+        }
+        if (t->cols[t->ncols] == COL_SUBMIT)
+            t->submit_col = t->ncols;
+        else if (t->cols[t->ncols] == COL_TIMELIMIT)
+            t->has_timelimit = true;
+        t->ncols++;
+        p = e + 1;
+    }
+}
+
+static int compare_rows (const void *a, const void *b)
+{
+    const trace_row_t *r1 = a;
+    const trace_row_t *r2 = b;
+    if (r1->submit_time != r2->submit_time)
+        return (r1->submit_time < r2->submit_time) ? -1 : 1;
+    return (r1->offset < r2->offset) ? -1 : (r1->offset > r2->offset);
+}
+
+// Record the submit time and offset of every data row up to the first
+// comment line, then order the rows by submit time
+static void index_rows (job_trace_t *t, const char *p)
+{
+    const char *end = t->data + t->size;
+    const char *eol, *row_end, *f;
+    size_t maxrows = 1024;
+    int col;
+
+    t->rows = xzmalloc (maxrows * sizeof (trace_row_t));
+    for (; p < end; p = eol + 1) {
+        eol = line_end (t, p);
+        if (*p == '#')  // reached a comment line, stop processing file
+            break;
+        row_end = (eol > p && eol[-1] == '\r') ? eol - 1 : eol;
+        if (row_end == p)
+            continue;
+        if (t->nrows == maxrows) {
+            maxrows *= 2;
+            t->rows = xrealloc (t->rows, maxrows * sizeof (trace_row_t));
+        }
+        t->rows[t->nrows].offset = p - t->data;
+        t->rows[t->nrows].submit_time = 0;
+        for (col = 0, f = p; col < t->submit_col && f <= row_end; col++)
+            f = field_end (f, row_end) + 1;
+        if (t->submit_col >= 0 && f <= row_end)
+            t->rows[t->nrows].submit_time =
+                parse_submit (t, f, field_end (f, row_end));
+        t->nrows++;
+    }
+    qsort (t->rows, t->nrows, sizeof (trace_row_t), compare_rows);
+}
+
+
+/******************************************************************************
+ *                                                                            *
+ *                                 API                                        *
+ *                                                                            *
+ ******************************************************************************/
+
+job_trace_t *job_trace_open (flux_t *h, const char *filename, int num_jobs)
+{
+    job_trace_t *t = xzmalloc (sizeof (*t));
+    struct stat sb;
+    const char *eol;
+    int fd = -1;
+
+    t->h = h;
+    t->tm_base = -1;
+    if ((fd = open (filename, O_RDONLY)) < 0 || fstat (fd, &sb) < 0) {
+        flux_log (h, LOG_ERR, "csv failed to open");
+        goto error;
+    }
+    t->size = sb.st_size;
+    if (t->size == 0) {
+        flux_log (h, LOG_ERR, "header not found");
+        goto error;
+    }
+    t->data = mmap (NULL, t->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (t->data == MAP_FAILED) {
+        t->data = NULL;
+        flux_log (h, LOG_ERR, "csv failed to map");
+        goto error;
+    }
+    close (fd);
+    fd = -1;
+
+    eol = line_end (t, t->data);
+    index_header (t, t->data, eol);
+    index_rows (t, eol + 1);
+    // Keep only the first N jobs (where N == num_jobs)
+    if (num_jobs >= 0 && t->nrows > (size_t)num_jobs)
+        t->nrows = num_jobs;
+    return t;
+error:
+    if (fd >= 0)
+        close (fd);
+    job_trace_close (t);
+    return NULL;
+}
+
+void job_trace_close (job_trace_t *t)
+{
+    if (t) {
+        if (t->data)
+            munmap (t->data, t->size);
+        free (t->cols);
+        free (t->rows);
+        free (t);
+    }
+}
+
+size_t job_trace_size (job_trace_t *t)
+{
+    return t->nrows;
+}
+
+double job_trace_next_submit_time (job_trace_t *t)
+{
+    if (!t || t->next >= t->nrows)
+        return -1;
+    return t->rows[t->next].submit_time;
+}
+
+job_t *job_trace_next (job_trace_t *t)
+{
+    const char *p, *eol, *e;
+    job_t *job;
+    int col;
+
+    if (!t || t->next >= t->nrows)
+        return NULL;
+    p = t->data + t->rows[t->next].offset;
+    eol = line_end (t, p);
+    if (eol > p && eol[-1] == '\r')
+        eol--;
+    job = blank_job ();
+    for (col = 0; col < t->ncols && p <= eol; col++, p = e + 1) {
+        e = field_end (p, eol);
+        if (t->cols[col] != COL_SUBMIT)
+            insert_into_job (t, job, t->cols[col], p, e);
+    }
+    job->submit_time = t->rows[t->next].submit_time;
+    if (t->has_timelimit && job->time_limit < job->execution_time)
+        job->execution_time = job->time_limit;
+    t->next++;
+    return job;
+}
+
+// Populate a list of jobs using the data contained in the csv
+int parse_job_csv (flux_t *h, char *filename, zlist_t *jobs, int num_jobs)
+{
+    job_trace_t *t = NULL;
+    job_t *job = NULL;
+
+    if (!(t = job_trace_open (h, filename, num_jobs)))
+        return -1;
+    while ((job = job_trace_next (t)))
+        zlist_append (jobs, job);
+    job_trace_close (t);
+    return 0;
+}
+
+/*
+ * vi: ts=4 sw=4 expandtab
+ */
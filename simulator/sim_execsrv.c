@@ -33,6 +33,7 @@
 #include <flux/core.h>
 
 #include "src/common/libutil/log.h"
+#include "src/common/libutil/oom.h"
 #include "src/common/libutil/shortjansson.h"
 #include "src/common/libutil/xzmalloc.h"
 #include "simulator.h"
@@ -40,33 +41,57 @@
 
 static const char *module_name = "sim_exec";
 
+/* A running job and its projected completion */
+typedef struct {
+    job_t *job;
+    double end;          // projected completion time
+    int pos;             // index in the running heap
+#if SIMEXEC_IO
+    double last;         // time up to which job->io_time is accounted
+    double io_penalty;   // slowdown from io contention since last
+    double min_bw;       // scratch for determine_all_min_bandwidth
+#endif
+} running_t;
+
 typedef struct {
     sim_state_t *sim_state;
     zlist_t *queued_events;  // holds int *
-    zlist_t *running_jobs;  // holds job_t *
+    running_t **running;     // binary min-heap on (end, job id)
+    int nrunning;
+    int maxrunning;
     flux_t *h;
     double prev_sim_time;
     struct rdllib *rdllib;
     struct rdl *rdl;
+#if SIMEXEC_IO
+    zhash_t *running_index;  // job id -> running_t
+    bool bw_changed;         // running set changed since the last
+                             // determine_all_min_bandwidth
+#endif
 } ctx_t;
 
 #if SIMEXEC_IO
 static double determine_io_penalty (double job_bandwidth, double min_bandwidth);
-static double *get_job_min_from_hash (zhash_t *job_hash, int job_id);
 #endif
 
 static void freectx (void *arg)
 {
     ctx_t *ctx = arg;
+    int i;
     free_simstate (ctx->sim_state);
 
     while (zlist_size (ctx->queued_events) > 0)
         free (zlist_pop (ctx->queued_events));
     zlist_destroy (&ctx->queued_events);
 
-    while (zlist_size (ctx->running_jobs) > 0)
-        free_job (zlist_pop (ctx->running_jobs));
-    zlist_destroy (&ctx->running_jobs);
+    for (i = 0; i < ctx->nrunning; i++) {
+        free_job (ctx->running[i]->job);
+        free (ctx->running[i]);
+    }
+    free (ctx->running);
+#if SIMEXEC_IO
+    zhash_destroy (&ctx->running_index);
+#endif
 
     rdllib_close (ctx->rdllib);
     free (ctx->rdl);
@@ -82,7 +107,14 @@ static ctx_t *getctx (flux_t *h)
         ctx->h = h;
         ctx->sim_state = NULL;
         ctx->queued_events = zlist_new ();
-        ctx->running_jobs = zlist_new ();
+        ctx->running = NULL;
+        ctx->nrunning = 0;
+        ctx->maxrunning = 0;
+#if SIMEXEC_IO
+        if (!(ctx->running_index = zhash_new ()))
+            oom ();
+        ctx->bw_changed = false;
+#endif
         ctx->prev_sim_time = 0;
         ctx->rdllib = rdllib_open ();
         ctx->rdl = NULL;
@@ -140,51 +172,142 @@ static int update_job_state (ctx_t *ctx,
     return rc;
 }
 
-static double calc_curr_progress (job_t *job, double sim_time)
+/*
+ * Running jobs are kept in a binary min-heap on their projected completion
+ * time, so the next completion is found in O(1) and a job whose rate
+ * changes is repositioned in O(log n).
+ */
+static inline bool running_before (const running_t *a, const running_t *b)
 {
-    double time_passed = sim_time - job->start_time + .000001;
-    double time_necessary = job->execution_time + job->io_time;
-    return time_passed / time_necessary;
+    if (a->end != b->end)
+        return a->end < b->end;
+    return a->job->id < b->job->id;
 }
 
-// Calculate when the next job is going to terminate assuming no new jobs are
-// added
-static double determine_next_termination (ctx_t *ctx,
-                                          double curr_time,
-                                          zhash_t *job_hash)
+static inline void running_place (ctx_t *ctx, running_t *r, int pos)
 {
-    double next_termination = -1, curr_termination = -1;
+    ctx->running[pos] = r;
+    r->pos = pos;
+}
+
+static void running_sift_up (ctx_t *ctx, int pos)
+{
+    running_t *r = ctx->running[pos];
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!running_before (r, ctx->running[parent]))
+            break;
+        running_place (ctx, ctx->running[parent], pos);
+        pos = parent;
+    }
+    running_place (ctx, r, pos);
+}
+
+static void running_sift_down (ctx_t *ctx, int pos)
+{
+    running_t *r = ctx->running[pos];
+    int n = ctx->nrunning;
+    while (2 * pos + 1 < n) {
+        int child = 2 * pos + 1;
+        if (child + 1 < n
+            && running_before (ctx->running[child + 1], ctx->running[child]))
+            child++;
+        if (!running_before (ctx->running[child], r))
+            break;
+        running_place (ctx, ctx->running[child], pos);
+        pos = child;
+    }
+    running_place (ctx, r, pos);
+}
+
+// Start tracking job, which began running at job->start_time
+static void running_add (ctx_t *ctx, job_t *job)
+{
+    running_t *r = xzmalloc (sizeof (*r));
+
+    r->job = job;
+    r->end = job->start_time
+             + ((job->execution_time > 0) ? job->execution_time : 0);
 #if SIMEXEC_IO
-    double projected_future_io_time, job_io_penalty, computation_time_remaining;
-    double *job_min_bandwidth;
+    char id[32];
+    r->last = job->start_time;
+    r->io_penalty = 0;
+    snprintf (id, sizeof (id), "%d", job->id);
+    zhash_update (ctx->running_index, id, r);
+    ctx->bw_changed = true;
 #endif
-    zlist_t *running_jobs = ctx->running_jobs;
-    job_t *job = zlist_first (running_jobs);
+    if (ctx->nrunning == ctx->maxrunning) {
+        ctx->maxrunning = (ctx->maxrunning > 0) ? ctx->maxrunning * 2 : 64;
+        ctx->running = xrealloc (ctx->running,
+                                 ctx->maxrunning * sizeof (running_t *));
+    }
+    running_place (ctx, r, ctx->nrunning++);
+    running_sift_up (ctx, r->pos);
+}
+
+// Stop tracking the job with the earliest projected completion
+static running_t *running_pop (ctx_t *ctx)
+{
+    running_t *r = ctx->running[0];
+    running_t *last = ctx->running[--ctx->nrunning];
 
-    while (job != NULL) {
-        if (job->start_time <= curr_time) {
-            curr_termination =
-                job->start_time + job->execution_time + job->io_time;
+    if (last != r) {
+        running_place (ctx, last, 0);
+        running_sift_down (ctx, 0);
+    }
 #if SIMEXEC_IO
-            computation_time_remaining =
-                job->execution_time
-                - ((curr_time - job->start_time) - job->io_time);
-            job_min_bandwidth = get_job_min_from_hash (job_hash, job->id);
-            job_io_penalty =
-                determine_io_penalty (job->io_rate, *job_min_bandwidth);
-            projected_future_io_time =
-                (computation_time_remaining)*job_io_penalty;
-            curr_termination += projected_future_io_time;
+    char id[32];
+    snprintf (id, sizeof (id), "%d", r->job->id);
+    zhash_delete (ctx->running_index, id);
+    ctx->bw_changed = true;
 #endif
-            if (curr_termination < next_termination || next_termination < 0) {
-                next_termination = curr_termination;
-            }
-        }
-        job = zlist_next (running_jobs);
+    return r;
+}
+
+// A job is done once the time passed covers its execution and io time,
+// give or take the slack the progress calculation has always allowed
+static inline bool running_done (const running_t *r, double sim_time)
+{
+    return r->end <= sim_time + .000001;
+}
+
+// Calculate when the next job is going to terminate assuming no new jobs are
+// added
+static double determine_next_termination (ctx_t *ctx)
+{
+    return (ctx->nrunning > 0) ? ctx->running[0]->end : -1;
+}
+
+#if SIMEXEC_IO
+// Charge the job the io time its penalty has cost it up to curr_time
+static void running_account_io (running_t *r, double curr_time)
+{
+    double io_percentage = r->io_penalty / (r->io_penalty + 1);
+    if (curr_time > r->last) {
+        r->job->io_time += (curr_time - r->last) * io_percentage;
+        r->last = curr_time;
     }
+}
 
-    return next_termination;
+// Change the io penalty of a running job from curr_time on.  The
+// computation left is slowed down by the penalty from then on.
+static void running_set_penalty (ctx_t *ctx, running_t *r, double curr_time,
+                                 double io_penalty)
+{
+    job_t *job = r->job;
+    double computation_time_remaining;
+
+    running_account_io (r, curr_time);
+    r->io_penalty = io_penalty;
+    computation_time_remaining =
+        job->execution_time - ((curr_time - job->start_time) - job->io_time);
+    if (computation_time_remaining < 0)
+        computation_time_remaining = 0;
+    r->end = curr_time + computation_time_remaining * (1 + io_penalty);
+    running_sift_up (ctx, r->pos);
+    running_sift_down (ctx, r->pos);
 }
+#endif
 
 // Set the timer for the given module
 static int set_event_timer (ctx_t *ctx, char *mod_name, double timer_value)
@@ -227,41 +350,24 @@ static int complete_job (ctx_t *ctx, job_t *job, double completion_time)
     return rc;
 }
 
-// Remove completed jobs from the list of running jobs
+// Remove completed jobs from the set of running jobs
 // Update sched timer as necessary (to trigger an event in sched)
 // Also change the state of the job in the KVS
 static int handle_completed_jobs (ctx_t *ctx)
 {
-    double curr_progress;
-    zlist_t *running_jobs = ctx->running_jobs;
-    job_t *job = NULL;
-    int num_jobs = zlist_size (running_jobs);
+    running_t *r = NULL;
     double sim_time = ctx->sim_state->sim_time;
 
-    // print_next_completing (running_jobs, ctx);
-
-    while (num_jobs > 0) {
-        job = zlist_pop (running_jobs);
-        if (job->execution_time > 0) {
-            curr_progress = calc_curr_progress (job, ctx->sim_state->sim_time);
-        } else {
-            curr_progress = 1;
-            flux_log (ctx->h,
-                      LOG_DEBUG,
-                      "handle_completed_jobs found a job (%d) with execution "
-                      "time <= 0 (%f), setting progress = 1",
-                      job->id,
-                      job->execution_time);
-        }
-        if (curr_progress < 1) {
-            zlist_append (running_jobs, job);
-        } else {
-            flux_log (ctx->h,
-                      LOG_DEBUG,
-                      "handle_completed_jobs found a completed job");
-            complete_job (ctx, job, sim_time);
-        }
-        num_jobs--;
+    while (ctx->nrunning > 0 && running_done (ctx->running[0], sim_time)) {
+        r = running_pop (ctx);
+        flux_log (ctx->h,
+                  LOG_DEBUG,
+                  "handle_completed_jobs found a completed job");
+#if SIMEXEC_IO
+        running_account_io (r, sim_time);
+#endif
+        complete_job (ctx, r->job, sim_time);
+        free (r);
     }
 
     return 0;
@@ -316,16 +422,16 @@ int compare_resource_alloc_bw (void *item1, void *item2)
 }
 #endif /* CZMQ_VERSION > 3.0.0 */
 
-static double *get_job_min_from_hash (zhash_t *job_hash, int job_id)
+static running_t *get_running_job (ctx_t *ctx, int job_id)
 {
-    char job_id_str[100];
-    sprintf (job_id_str, "%d", job_id);
-    return (double *)zhash_lookup (job_hash, job_id_str);
+    char job_id_str[32];
+    snprintf (job_id_str, sizeof (job_id_str), "%d", job_id);
+    return (running_t *)zhash_lookup (ctx->running_index, job_id_str);
 }
 
-static void determine_all_min_bandwidth_helper (struct resource *r,
-                                                double curr_min_bandwidth,
-                                                zhash_t *job_hash)
+static void determine_all_min_bandwidth_helper (ctx_t *ctx,
+                                                struct resource *r,
+                                                double curr_min_bandwidth)
 {
     struct resource *curr_child;
     int64_t job_id;
@@ -349,10 +455,10 @@ static void determine_all_min_bandwidth_helper (struct resource *r,
             curr_min_bandwidth = (curr_min_bandwidth < this_alloc_bandwidth)
                                      ? curr_min_bandwidth
                                      : this_alloc_bandwidth;
-            double *job_min_bw = get_job_min_from_hash (job_hash, job_id);
-            if (job_min_bw != NULL && curr_min_bandwidth < *job_min_bw) {
-                *job_min_bw = curr_min_bandwidth;
-            }  // if job_min_bw is NULL, the tag still exists in the RDL, but
+            running_t *job = get_running_job (ctx, job_id);
+            if (job != NULL && curr_min_bandwidth < job->min_bw) {
+                job->min_bw = curr_min_bandwidth;
+            }  // if job is NULL, the tag still exists in the RDL, but
                // the job completed
         }
         return;
@@ -401,9 +507,9 @@ static void determine_all_min_bandwidth_helper (struct resource *r,
             // Subtract the allocated bandwidth from the parent's total
             total_used_bandwidth -= child_alloc_bandwidth;
             // Recurse on the child
-            determine_all_min_bandwidth_helper (curr_child,
-                                                child_alloc_bandwidth,
-                                                job_hash);
+            determine_all_min_bandwidth_helper (ctx,
+                                                curr_child,
+                                                child_alloc_bandwidth);
         }
         rdl_resource_destroy (curr_child);
     }
@@ -415,32 +521,42 @@ static void determine_all_min_bandwidth_helper (struct resource *r,
     return;
 }
 
-static zhash_t *determine_all_min_bandwidth (struct rdl *rdl,
-                                             zlist_t *running_jobs)
+// Determine the bandwidth each running job gets between its resources and
+// the pfs and update the penalty of the jobs whose bandwidth changed.
+// Only needed once the set of running jobs has changed.
+static void determine_all_min_bandwidth (ctx_t *ctx)
 {
     double root_bw;
-    double *curr_value = NULL;
+    double curr_time = ctx->sim_state->sim_time;
+    double io_penalty;
     struct resource *root = NULL;
-    job_t *curr_job = NULL;
-    char job_id_str[100];
-    zhash_t *job_hash = zhash_new ();
+    zlist_t *changed = NULL;
+    running_t *r = NULL;
+    int i;
 
-    root = rdl_resource_get (rdl, "default");
+    if (!ctx->bw_changed)
+        return;
+    root = rdl_resource_get (ctx->rdl, "default");
     root_bw = get_max_bandwidth (root);
-
-    curr_job = zlist_first (running_jobs);
-    while (curr_job != NULL) {
-        curr_value = (double *)malloc (sizeof (double));
-        *curr_value = root_bw;
-        sprintf (job_id_str, "%d", curr_job->id);
-        zhash_insert (job_hash, job_id_str, curr_value);
-        zhash_freefn (job_hash, job_id_str, free);
-        curr_job = zlist_next (running_jobs);
+    for (i = 0; i < ctx->nrunning; i++)
+        ctx->running[i]->min_bw = root_bw;
+
+    determine_all_min_bandwidth_helper (ctx, root, root_bw);
+
+    // Reposition only the jobs whose rate changed, once the scan is over
+    if (!(changed = zlist_new ()))
+        oom ();
+    for (i = 0; i < ctx->nrunning; i++) {
+        r = ctx->running[i];
+        if (determine_io_penalty (r->job->io_rate, r->min_bw) != r->io_penalty)
+            zlist_append (changed, r);
     }
-
-    determine_all_min_bandwidth_helper (root, root_bw, job_hash);
-
-    return job_hash;
+    while ((r = zlist_pop (changed))) {
+        io_penalty = determine_io_penalty (r->job->io_rate, r->min_bw);
+        running_set_penalty (ctx, r, curr_time, io_penalty);
+    }
+    zlist_destroy (&changed);
+    ctx->bw_changed = false;
 }
 
 static double determine_io_penalty (double job_bandwidth, double min_bandwidth)
@@ -458,60 +574,26 @@ static double determine_io_penalty (double job_bandwidth, double min_bandwidth)
 }
 #endif
 
-// Model io contention that occurred between previous event and the
-// curr sim time. Remove completed jobs from the list of running jobs
-static int advance_time (ctx_t *ctx, zhash_t *job_hash)
+// Complete the jobs that terminated between the previous event and the
+// curr sim time, each at its own termination time.  Rates only change
+// when the set of running jobs does, so jobs still running are untouched.
+static int advance_time (ctx_t *ctx)
 {
-    // TODO: Make this not static? (pass it in?, store it in ctx?)
-    static double curr_time = 0;
-
-    job_t *job = NULL;
-    int num_jobs = -1;
-    double next_event = -1, next_termination = -1, curr_progress = -1
-#if SIMEXEC_IO
-        ,io_penalty = 0, io_percentage = 0;
-    double *job_min_bandwidth = NULL;
-#else
-    ;
-#endif
-
-    zlist_t *running_jobs = ctx->running_jobs;
+    running_t *r = NULL;
+    double next_event = -1;
     double sim_time = ctx->sim_state->sim_time;
 
-    while (curr_time < sim_time) {
-        num_jobs = zlist_size (running_jobs);
-        if (num_jobs == 0) {
-            curr_time = sim_time;
-            break;
-        }
-        next_termination =
-            determine_next_termination (ctx, curr_time, job_hash);
-        next_event = ((sim_time < next_termination) || (next_termination < 0))
-                         ? sim_time
-                         : next_termination;  // min of the two
-        while (num_jobs > 0) {
-            job = zlist_pop (running_jobs);
-            if (job->start_time <= curr_time) {
+    while (ctx->nrunning > 0 && ctx->running[0]->end < sim_time) {
+        next_event = ctx->running[0]->end;
+        while (ctx->nrunning > 0
+               && running_done (ctx->running[0], next_event)) {
+            r = running_pop (ctx);
 #if SIMEXEC_IO
-                // Get the minimum bandwidth between a resource in the job and
-                // the pfs
-                job_min_bandwidth = get_job_min_from_hash (job_hash, job->id);
-                io_penalty =
-                    determine_io_penalty (job->io_rate, *job_min_bandwidth);
-                io_percentage = (io_penalty / (io_penalty + 1));
-                job->io_time += (next_event - curr_time) * io_percentage;
+            running_account_io (r, next_event);
 #endif
-                curr_progress = calc_curr_progress (job, next_event);
-                if (curr_progress < 1)
-                    zlist_append (running_jobs, job);
-                else
-                    complete_job (ctx, job, next_event);
-            } else {
-                zlist_append (running_jobs, job);
-            }
-            num_jobs--;
+            complete_job (ctx, r->job, next_event);
+            free (r);
         }
-        curr_time = next_event;
     }
 
     return 0;
@@ -528,7 +610,6 @@ static int handle_queued_events (ctx_t *ctx)
     flux_kvsdir_t *kvs_dir;
     flux_t *h = ctx->h;
     zlist_t *queued_events = ctx->queued_events;
-    zlist_t *running_jobs = ctx->running_jobs;
     double sim_time = ctx->sim_state->sim_time;
 
     while (zlist_size (queued_events) > 0) {
@@ -562,7 +643,7 @@ static int handle_queued_events (ctx_t *ctx)
                   "job %d's state to starting then running",
                   *jobid);
         job->start_time = ctx->sim_state->sim_time;
-        zlist_append (running_jobs, job);
+        running_add (ctx, job);
     }
 
     return 0;
@@ -597,7 +678,6 @@ static void trigger_cb (flux_t *h,
     json_t *o = NULL;
     const char *json_str = NULL;
     double next_termination = -1;
-    zhash_t *job_hash = NULL;
     ctx_t *ctx = (ctx_t *)arg;
 
     if (flux_msg_get_string (msg, &json_str) < 0 || json_str == NULL
@@ -612,24 +692,20 @@ static void trigger_cb (flux_t *h,
               "received a trigger (sim_exec.trigger: %s",
               json_str);
 
-    // Handle the trigger
-    ctx->sim_state = json_to_sim_state (o);
+    // Handle the trigger, which only carries the timers that changed
+    ctx->sim_state = sim_state_update (ctx->sim_state, o);
     handle_queued_events (ctx);
+    advance_time (ctx);
+    handle_completed_jobs (ctx);
 #if SIMEXEC_IO
-    job_hash = determine_all_min_bandwidth (ctx->rdl, ctx->running_jobs);
+    determine_all_min_bandwidth (ctx);
 #endif
-    advance_time (ctx, job_hash);
-    handle_completed_jobs (ctx);
-    next_termination =
-        determine_next_termination (ctx, ctx->sim_state->sim_time, job_hash);
+    next_termination = determine_next_termination (ctx);
     set_event_timer (ctx, "sim_exec", next_termination);
     send_reply_request (h, module_name, ctx->sim_state);
 
     // Cleanup
-    free_simstate (ctx->sim_state);
-    ctx->sim_state = NULL;
     Jput (o);
-    zhash_destroy (&job_hash);
 }
 
 static void run_cb (flux_t *h,
@@ -33,21 +33,48 @@
 #include <flux/core.h>
 
 #include "src/common/libutil/log.h"
+#include "src/common/libutil/oom.h"
 #include "src/common/libutil/shortjansson.h"
 #include "src/common/libutil/xzmalloc.h"
 #include "simulator.h"
 
+/* A module's event timer as seen by the event calendar */
+typedef struct {
+    char *name;
+    double *time;       // the module's entry in sim_state->timers
+    int prio;           // breaks ties between equal times: lower goes first
+    int pos;            // index in the calendar heap, -1 if no event
+    uint64_t changed;   // update sequence of the last change to *time
+    uint64_t triggered; // update sequence at the module's last trigger
+} sim_timer_t;
+
 typedef struct {
     sim_state_t *sim_state;
     flux_t *h;
     bool rdl_changed;
     char *rdl_string;
     bool exit_on_complete;
+    zhash_t *timer_index;      // module name -> sim_timer_t
+    sim_timer_t **calendar;    // binary min-heap on (time, prio)
+    int ncalendar;
+    int next_prio;
+    uint64_t seq;
 } ctx_t;
 
+static void free_timer (void *arg)
+{
+    sim_timer_t *t = arg;
+    if (t) {
+        free (t->name);
+        free (t);
+    }
+}
+
 static void freectx (void *arg)
 {
     ctx_t *ctx = arg;
+    zhash_destroy (&ctx->timer_index);
+    free (ctx->calendar);
     free_simstate (ctx->sim_state);
     free (ctx->rdl_string);
     free (ctx);
@@ -64,26 +91,152 @@ static ctx_t *getctx (flux_t *h, bool exit_on_complete)
         ctx->rdl_string = NULL;
         ctx->rdl_changed = false;
         ctx->exit_on_complete = exit_on_complete;
+        if (!(ctx->timer_index = zhash_new ()))
+            oom ();
+        ctx->calendar = NULL;
+        ctx->ncalendar = 0;
+        ctx->next_prio = 1;
+        ctx->seq = 0;
         flux_aux_set (h, "simsrv", ctx, freectx);
     }
 
     return ctx;
 }
 
-// builds the trigger request and sends it to "mod_name"
-// converts sim_state to JSON, formats request tag based on "mod_name"
-static int send_trigger (flux_t *h, const char *mod_name, sim_state_t *sim_state)
+/*
+ * The event calendar: a binary min-heap of the timers that hold an event,
+ * ordered by time and then by module priority.  "sched" has priority 0
+ * so that it wins ties; the other modules rank in the order they joined.
+ */
+static inline bool timer_before (const sim_timer_t *a, const sim_timer_t *b)
+{
+    if (*a->time != *b->time)
+        return *a->time < *b->time;
+    return a->prio < b->prio;
+}
+
+static inline void calendar_place (ctx_t *ctx, sim_timer_t *t, int pos)
+{
+    ctx->calendar[pos] = t;
+    t->pos = pos;
+}
+
+static void calendar_sift_up (ctx_t *ctx, int pos)
+{
+    sim_timer_t *t = ctx->calendar[pos];
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!timer_before (t, ctx->calendar[parent]))
+            break;
+        calendar_place (ctx, ctx->calendar[parent], pos);
+        pos = parent;
+    }
+    calendar_place (ctx, t, pos);
+}
+
+static void calendar_sift_down (ctx_t *ctx, int pos)
+{
+    sim_timer_t *t = ctx->calendar[pos];
+    int n = ctx->ncalendar;
+    while (2 * pos + 1 < n) {
+        int child = 2 * pos + 1;
+        if (child + 1 < n
+            && timer_before (ctx->calendar[child + 1], ctx->calendar[child]))
+            child++;
+        if (!timer_before (ctx->calendar[child], t))
+            break;
+        calendar_place (ctx, ctx->calendar[child], pos);
+        pos = child;
+    }
+    calendar_place (ctx, t, pos);
+}
+
+// (Re)position t in the calendar after its time has changed
+static void calendar_update (ctx_t *ctx, sim_timer_t *t)
+{
+    int pos = t->pos;
+
+    if (*t->time < 0) {
+        if (pos < 0)
+            return;
+        sim_timer_t *last = ctx->calendar[--ctx->ncalendar];
+        t->pos = -1;
+        if (last != t) {
+            calendar_place (ctx, last, pos);
+            calendar_sift_up (ctx, pos);
+            calendar_sift_down (ctx, last->pos);
+        }
+    } else if (pos < 0) {
+        calendar_place (ctx, t, ctx->ncalendar++);
+        calendar_sift_up (ctx, t->pos);
+    } else {
+        calendar_sift_up (ctx, pos);
+        calendar_sift_down (ctx, t->pos);
+    }
+}
+
+// Set a module's timer, recording the change for the next triggers
+static void timer_set (ctx_t *ctx, sim_timer_t *t, double value)
+{
+    if (*t->time == value)
+        return;
+    *t->time = value;
+    t->changed = ++ctx->seq;
+    calendar_update (ctx, t);
+}
+
+// Add a joining module's timer to the sim_state and the calendar
+static int timer_add (ctx_t *ctx, const char *mod_name, double *next_event)
+{
+    sim_timer_t *t = NULL;
+    zhash_t *timers = ctx->sim_state->timers;
+
+    if (zhash_insert (timers, mod_name, next_event) < 0)
+        return -1;
+    zhash_freefn (timers, mod_name, free);
+    t = xzmalloc (sizeof (*t));
+    t->name = xstrdup (mod_name);
+    t->time = next_event;
+    t->prio = (!strcmp (mod_name, "sched")) ? 0 : ctx->next_prio++;
+    t->pos = -1;
+    t->changed = ++ctx->seq;
+    t->triggered = 0;
+    zhash_insert (ctx->timer_index, mod_name, t);
+    zhash_freefn (ctx->timer_index, mod_name, free_timer);
+    ctx->calendar = xrealloc (ctx->calendar, zhash_size (ctx->timer_index)
+                              * sizeof (sim_timer_t *));
+    calendar_update (ctx, t);
+    return 0;
+}
+
+// builds the trigger request and sends it to the module of timer "t"
+// the request carries sim_time and only the timers that changed since
+// the module's last trigger, which it merges into its own copy
+static int send_trigger (ctx_t *ctx, sim_timer_t *t)
 {
     int rc = 0;
+    flux_t *h = ctx->h;
+    const char *mod_name = t->name;
     flux_future_t *future = NULL;
     json_t *o = NULL;
+    json_t *event_timers = NULL;
     char *topic = NULL;
+    sim_timer_t *other = NULL;
 
     // Reset the next timer for "mod_name" to -1 before we trigger
-    double *next_time = zhash_lookup (sim_state->timers, mod_name);
-    *next_time = -1;
-
-    o = sim_state_to_json (sim_state);
+    timer_set (ctx, t, -1);
+
+    o = Jnew ();
+    event_timers = Jnew ();
+    for (other = zhash_first (ctx->timer_index); other;
+         other = zhash_next (ctx->timer_index)) {
+        if (other->changed > t->triggered)
+            Jadd_double (event_timers, other->name, *other->time);
+    }
+    Jadd_double (o, "sim_time", ctx->sim_state->sim_time);
+    Jadd_obj (o, "event_timers", event_timers);
+    Jput (event_timers);
+    t->triggered = ctx->seq;
 
     topic = xasprintf ("%s.trigger", mod_name);
     const char *jcstr = Jtostr (o);
@@ -138,54 +291,25 @@ int send_complete_event (flux_t *h)
     return rc;
 }
 
-static inline bool occurs_before (double curr_event_time,
-                                  double min_event_time)
-{
-    return (curr_event_time >=0) && (curr_event_time < min_event_time);
-}
-static inline bool breaks_tie (double curr_event_time,
-                              double min_event_time,
-                              const char *curr_mod_name)
-{
-    // sched get precedence in case of ties
-    return (curr_event_time == min_event_time)
-        && (!strcmp (curr_mod_name, "sched"));
-}
-
 // Looks at the current state and launches the next trigger
 static int handle_next_event (ctx_t *ctx)
 {
-    zhash_t *timers;
     sim_state_t *sim_state = ctx->sim_state;
     int rc = 0;
 
-    // get the timer hashtable, make sure its full, and get a list of its keys
-    timers = sim_state->timers;
-    if (zhash_size (timers) < 1) {
+    // make sure the timer hashtable is full
+    if (zhash_size (sim_state->timers) < 1) {
         flux_log (ctx->h, LOG_ERR, "timer hashtable has no elements");
         return -1;
     }
 
-    // Get the next occuring event time/module
-    double min_event_time = -1;
-    double *curr_event_time = NULL;
-    const char *mod_name = NULL, *curr_name = NULL;
-
-    for (curr_event_time = zhash_first (timers);
-         curr_event_time;
-         curr_event_time = zhash_next (timers)) {
-        curr_name = zhash_cursor (timers);
-        if (min_event_time < 0 ||
-            occurs_before (*curr_event_time, min_event_time) ||
-            breaks_tie (*curr_event_time, min_event_time, curr_name)) {
-            min_event_time = *curr_event_time;
-            mod_name = curr_name;
-        }
-    }
-
-    if (min_event_time < 0) {
+    // The next occuring event is at the top of the calendar
+    if (ctx->ncalendar == 0) {
         return -1;
     }
+    sim_timer_t *next = ctx->calendar[0];
+    double min_event_time = *next->time;
+    const char *mod_name = next->name;
 
     // advance time then send the trigger to the module with the next event
     if (min_event_time > sim_state->sim_time) {
@@ -203,7 +327,7 @@ static int handle_next_event (ctx_t *ctx)
               mod_name,
               sim_state->sim_time);
 
-    rc = send_trigger (ctx->h, mod_name, sim_state);
+    rc = send_trigger (ctx, next);
 
     return rc;
 }
@@ -219,7 +343,6 @@ static void join_cb (flux_t *h,
     const char *mod_name = NULL, *json_str = NULL;
     double *next_event = (double *)malloc (sizeof (double));
     ctx_t *ctx = arg;
-    sim_state_t *sim_state = ctx->sim_state;
     uint32_t size;
 
     if (flux_msg_get_string (msg, &json_str) < 0 || json_str == NULL
@@ -244,9 +367,7 @@ static void join_cb (flux_t *h,
               mod_rank,
               *next_event);
 
-    zhash_t *timers = sim_state->timers;
-    if (zhash_insert (timers, mod_name, next_event) < 0) {  // key already
-                                                            // exists
+    if (timer_add (ctx, mod_name, next_event) < 0) {  // key already exists
         flux_log (h,
                   LOG_ERR,
                   "duplicate join request from %s, module already exists in "
@@ -284,13 +405,13 @@ out:
 // those cases are checked for and logged.
 
 // TODO: verify all of this logic is correct, bugs could easily creep up here
-static int check_for_new_timers (const char *key, double *reply_event_time,
+static int check_for_new_timers (sim_timer_t *t, double *reply_event_time,
 		                 ctx_t *ctx)
 {
     sim_state_t *curr_sim_state = ctx->sim_state;
     double sim_time = curr_sim_state->sim_time;
-    double *curr_event_time =
-        (double *)zhash_lookup (curr_sim_state->timers, key);
+    double *curr_event_time = t->time;
+    const char *key = t->name;
 
     if (*curr_event_time < 0 && *reply_event_time < 0) {
         // flux_log (ctx->h, LOG_DEBUG, "%s - no timers found for %s, doing nothing", __FUNCTION__,
@@ -298,7 +419,7 @@ static int check_for_new_timers (const char *key, double *reply_event_time,
         return 0;
     } else if (*curr_event_time < 0) {
         if (*reply_event_time >= sim_time) {
-            *curr_event_time = *reply_event_time;
+            timer_set (ctx, t, *reply_event_time);
             // flux_log (ctx->h, LOG_DEBUG, "%s - change in timer accepted for %s", __FUNCTION__,
             //           key);
             return 0;
@@ -318,7 +439,7 @@ static int check_for_new_timers (const char *key, double *reply_event_time,
         return -1;
     } else if (*reply_event_time >= sim_time
                && *reply_event_time < *curr_event_time) {
-        *curr_event_time = *reply_event_time;
+        timer_set (ctx, t, *reply_event_time);
         // flux_log (ctx->h, LOG_DEBUG, "%s - change in timer accepted for %s", __FUNCTION__, key);
         return 0;
     } else {
@@ -336,13 +457,22 @@ static void copy_new_state_data (ctx_t *ctx,
         curr_sim_state->sim_time = reply_sim_state->sim_time;
     }
 
-    void *item = NULL;
+    double *item = NULL;
     const char *key = NULL;
+    sim_timer_t *t = NULL;
     for (item = zhash_first (reply_sim_state->timers);
          item;
          item = zhash_next (reply_sim_state->timers)) {
         key = zhash_cursor (reply_sim_state->timers);
-        check_for_new_timers (key, item, ctx);
+        if (!(t = zhash_lookup (ctx->timer_index, key))) {
+            flux_log (ctx->h, LOG_ERR, "%s - unknown timer %s", __FUNCTION__,
+                      key);
+            continue;
+        }
+        check_for_new_timers (t, item, ctx);
+        // The replying module now holds the rejected value: resend ours
+        if (*item != *t->time)
+            t->changed = ++ctx->seq;
     }
 }
 
@@ -116,6 +116,31 @@ sim_state_t *json_to_sim_state (json_t *o)
     return sim_state;
 }
 
+sim_state_t *sim_state_update (sim_state_t *sim_state, json_t *o)
+{
+    json_t *event_timers;
+    json_t *value;
+    const char *key;
+    double *event_time;
+
+    if (!sim_state)
+        sim_state = new_simstate ();
+    Jget_double (o, "sim_time", &sim_state->sim_time);
+    if (!Jget_obj (o, "event_timers", &event_timers))
+        return sim_state;
+    json_object_foreach (event_timers, key, value) {
+        if ((event_time = zhash_lookup (sim_state->timers, key))) {
+            *event_time = json_real_value (value);
+        } else {
+            event_time = (double *)malloc (sizeof (double));
+            *event_time = json_real_value (value);
+            zhash_insert (sim_state->timers, key, event_time);
+            zhash_freefn (sim_state->timers, key, free);
+        }
+    }
+    return sim_state;
+}
+
 void free_job (job_t *job)
 {
     free (job->user);
@@ -139,6 +164,7 @@ job_t *blank_job ()
     job->nnodes = 0;
     job->ncpus = 0;
     job->ngpus= 0;
+    job->io_rate = 0;
     job->kvs_dir = NULL;
     return job;
 }
@@ -56,6 +56,13 @@ void free_simstate (sim_state_t *sim_state);
 json_t *sim_state_to_json (sim_state_t *state);
 sim_state_t *json_to_sim_state (json_t *o);
 
+/* Merge a JSON sim state, which may carry only the timers that changed,
+ * into sim_state: sim_time is replaced and the timers present in o are
+ * added or updated.  A NULL sim_state is created first.  Returns the
+ * merged state.
+ */
+sim_state_t *sim_state_update (sim_state_t *sim_state, json_t *o);
+
 flux_kvsdir_t *job_kvsdir (flux_t *h, int jobid);
 int put_job_in_kvs (job_t *job, const char *initial_state);
 job_t *pull_job_from_kvs (int id, flux_kvsdir_t *kvs_dir);
@@ -75,6 +82,26 @@ int send_join_request (flux_t *h, const char *module_name, double next_event);
 
 zhash_t *zhash_fromargv (int argc, char **argv);
 
+/* Streaming reader for job-trace csv files.  job_trace_open () indexes
+ * the first num_jobs jobs of the trace in order of submit time, and each
+ * job_trace_next () parses the next of them into a new job_t, which the
+ * caller frees with free_job ().  It returns NULL past the last job.
+ * job_trace_next_submit_time () peeks at the submit time of that next
+ * job, or returns -1.  h is only used for logging and may be NULL.
+ */
+typedef struct job_trace job_trace_t;
+job_trace_t *job_trace_open (flux_t *h, const char *filename, int num_jobs);
+void job_trace_close (job_trace_t *trace);
+size_t job_trace_size (job_trace_t *trace);
+double job_trace_next_submit_time (job_trace_t *trace);
+job_t *job_trace_next (job_trace_t *trace);
+
+/* Read up to num_jobs jobs from the job-trace csv filename, appending
+ * them to jobs (a list of job_t) in order of submit time.  h is only used
+ * for logging and may be NULL.
+ */
+int parse_job_csv (flux_t *h, char *filename, zlist_t *jobs, int num_jobs);
+
 /*
 struct rdl *get_rdl (flux_t *h, char *path);
 void close_rdl ();
@@ -39,207 +39,14 @@
 #include "simulator.h"
 
 static const char *module_name = "submit";
-static zlist_t *jobs;  // TODO: remove from "global" scope
-
-#if CZMQ_VERSION < CZMQ_MAKE_VERSION(3, 0, 1)
-// Compare two job_t's based on submit time
-// Return true if they should be swapped
-// AKA job1 was submitted after job2
-bool compare_job_t (void *item1, void *item2)
-{
-    job_t *job1 = (job_t *)item1;
-    job_t *job2 = (job_t *)item2;
-    return job1->submit_time > job2->submit_time;
-}
-#else
-// Compare two job_t's based on submit time
-// Return > 0 if job1 was submitted after job2,
-//        < 0 if job1 was submitted before job2,
-//        = 0 if submit times are (essentially) equivalent
-int compare_job_t (void *x, void *y)
-{
-    double t1 = ((job_t *)x)->submit_time;
-    double t2 = ((job_t *)y)->submit_time;
-    double delta = t1 - t2;
-    if (fabs (delta) < DBL_EPSILON)
-        return 0;
-    else if (delta > 0)
-        return 1;
-    else
-        return (-1);
-}
-#endif /* CZMQ_VERSION > 3.0.0 */
+static job_trace_t *trace;  // TODO: remove from "global" scope
+static sim_state_t *curr_sim_state;  // kept across triggers
 
 // Figure out when the next submit time is
-// This assumes the list is sorted by submit time
+// The trace hands out jobs in order of submit time
 double get_next_submit_time ()
 {
-    job_t *job;
-    if (zlist_size (jobs) > 0) {
-        job = zlist_head (jobs);
-        return job->submit_time;
-    }
-    return -1;
-}
-
-// Convert the string representation of time in the csv to sec
-double convert_time_to_sec (char *time)
-{
-    int hours, minutes, seconds;
-    sscanf (time, "%d:%d:%d", &hours, &minutes, &seconds);
-    return (double)((hours * 3600) + (minutes * 60) + seconds);
-}
-
-// Populate a field in the job_t based off a value extracted from the csv
-int insert_into_job (flux_t *h, job_t *job, char *column_name, char *value)
-{
-    // Strip newline off the end, if it exists
-    int last_char_index = strlen(column_name) - 1;
-    if (column_name[last_char_index] == '\n') {
-        column_name[last_char_index] = '\0';
-    }
-
-    if (!strcmp (column_name, "JobID")) {
-        job->id = atoi (value);
-    } else if (!strcmp (column_name, "User")) {
-        job->user = xasprintf ("%s", value);
-    } else if (!strcmp (column_name, "JobName")) {
-        job->jobname = xasprintf ("%s", value);
-    } else if (!strcmp (column_name, "Account")) {
-        job->account = xasprintf ("%s", value);
-    } else if (!strcmp (column_name, "NNodes")) {
-        job->nnodes = atoi (value);
-    } else if (!strcmp (column_name, "NCPUS")) {
-        job->ncpus = atoi (value);
-    } else if (!strcmp (column_name, "Timelimit")) {
-        job->time_limit = convert_time_to_sec (value);
-        if(job->time_limit < job->execution_time) {
-          job->execution_time = job->time_limit;
-        }
-    } else if (!strcmp (column_name, "Submit")) {
-        char *endptr;
-        struct tm tm_spec; 
-        double stime = strtod(value, &endptr);
-        // Check if you parsed only a bit of the string (e.g. just the year)
-        // Trailing whitespace is not an error.
-        if (*endptr != '\0' && *endptr != ' ' && *endptr != '\t') {
-            endptr = strptime(value, "%Y-%m-%dT%H:%M:%S", &tm_spec);
-            if (endptr == NULL) {
-                endptr = value;
-            } else {
-                stime = (double) mktime(&tm_spec);
-            }
-        }
-        // endptr gets set by strtod or by strptime
-        if (endptr == value) {
-            flux_log (h, LOG_WARNING, "Incorrect Submit format, expects %s"
-                        " or seconds since epoch; replacing '%s' with %f",
-                        "%Y-%m-%dT%H:%M:%S (yyyy-mm-ddThh:mm:ss)",
-                        value, stime);
-        }
-        job->submit_time = stime;
-    } else if (!strcmp (column_name, "Elapsed")) {
-        if(convert_time_to_sec (value) > job->time_limit) {
-          job->execution_time = job->time_limit;
-        } else {
-          job->execution_time = convert_time_to_sec (value);
-        }
-    } else if (!strcmp (column_name, "IORate(MB)")) {
-        job->io_rate = atol (value);
-    }
-    return 0;
-}
-
-// Take the header string from the csv and tokenize it based on the ","
-// Then insert each column name into a zlist
-int populate_header (char *header_line, zlist_t *header_list)
-{
-    char *token_copy, *token;
-    token = strtok (header_line, ",");
-    while (token != NULL) {
-        token_copy = xasprintf ("%s", token);
-        zlist_append (header_list, token_copy);
-        token = strtok (NULL, ",");
-    }
-    return 0;
-}
-
-// Populate a list of jobs using the data contained in the csv
-// TODO: breakup this function into several smaller functions
-int parse_job_csv (flux_t *h, char *filename, zlist_t *jobs, int num_jobs)
-{
-    const int MAX_LINE_LEN = 500;  // sort of arbitrary, works for my data
-    char curr_line[MAX_LINE_LEN];  // current line of the input file
-    zlist_t *all_jobs = zlist_new (); // temporary list of all jobs
-    zlist_t *header = NULL;  // column names
-    char *fget_rc = NULL;  // stores the return code of fgets
-    char *token = NULL;  // current token from the current line
-    char *curr_column = NULL;  // current column name (pulled from header)
-    job_t *curr_job = NULL;  // current job object that we are populating
-
-    FILE *fp = fopen (filename, "r");
-    if (fp == NULL) {
-        flux_log (h, LOG_ERR, "csv failed to open");
-        return -1;
-    }
-
-    // Populate the header list of column names
-    header = zlist_new ();
-    fget_rc = fgets (curr_line, MAX_LINE_LEN, fp);
-    if (fget_rc != NULL && feof (fp) == 0) {
-        populate_header (curr_line, header);
-        fget_rc = fgets (curr_line, MAX_LINE_LEN, fp);
-        curr_column = zlist_first (header);
-    } else {
-        flux_log (h, LOG_ERR, "header not found");
-    }
-
-    // Start making jobs from the actual data
-    while (fget_rc != NULL && feof (fp) == 0) {
-        curr_job = blank_job ();
-        token = strtok (curr_line, ",");
-        // Walk through every column in record and insert the data into the job
-        while (token != NULL) {
-            if (curr_column == NULL) {
-                flux_log (h, LOG_ERR, "column name is NULL");
-                return -1;
-            }
-            insert_into_job (h, curr_job, curr_column, token);
-            token = strtok (NULL, ",");
-            curr_column = zlist_next (header);
-        }
-        zlist_append (all_jobs, curr_job);
-        fget_rc = fgets (curr_line, MAX_LINE_LEN, fp);
-        curr_column = zlist_first (header);
-        if (curr_line[0] == '#')  // reached a comment line, stop processing
-                                  // file
-            break;
-    }
-    // Sort the list in order of job submission time
-    zlist_sort (all_jobs, compare_job_t);
-
-    // Keep only the first N jobs (where N == num_jobs)
-    int curr_num_job = 0;
-    for (curr_num_job = 0, curr_job = zlist_first(all_jobs);
-         curr_num_job < num_jobs && curr_job;
-         curr_num_job++, curr_job = zlist_next (all_jobs)) {
-        zlist_append (jobs, curr_job);
-    }
-    // Free all the jobs we don't end up using
-    for (; curr_job; curr_job = zlist_next (all_jobs)) {
-        free_job (curr_job);
-    }
-    zlist_destroy (&all_jobs);
-
-    // Cleanup
-    while (zlist_size (header) > 0)
-        free (zlist_pop (header));
-    zlist_destroy (&header);
-    if (fclose (fp) != 0) {
-        flux_log (h, LOG_ERR, "csv file failed to close");
-        return -1;
-    }
-    return 0;
+    return job_trace_next_submit_time (trace);
 }
 
 // Based on the sim_time, schedule any jobs that need to be scheduled
@@ -258,7 +65,7 @@ int schedule_next_job (flux_t *h, sim_state_t *sim_state)
 
     // Get the next job to submit
     // Then craft a "job.create" from the job_t and wait for jobid in response
-    job = zlist_pop (jobs);
+    job = job_trace_next (trace);
     if (job == NULL) {
         flux_log (h, LOG_DEBUG, "no more jobs to submit");
         new_submit_mod_time = (double *)zhash_lookup (timers, module_name);
@@ -383,7 +190,6 @@ static void trigger_cb (flux_t *h,
 {
     json_t *o = NULL;
     const char *json_str = NULL;
-    sim_state_t *sim_state = NULL;
 
     if (flux_msg_get_string (msg, &json_str) < 0 || json_str == NULL
         || !(o = Jfromstr (json_str))) {
@@ -398,13 +204,12 @@ static void trigger_cb (flux_t *h,
               "received a trigger (submit.trigger): %s",
               json_str);
 
-    // Handle the trigger
-    sim_state = json_to_sim_state (o);
-    schedule_next_job (h, sim_state);
-    send_reply_request (h, module_name, sim_state);
+    // Handle the trigger, which only carries the timers that changed
+    curr_sim_state = sim_state_update (curr_sim_state, o);
+    schedule_next_job (h, curr_sim_state);
+    send_reply_request (h, module_name, curr_sim_state);
 
     // Cleanup
-    free_simstate (sim_state);
     Jput (o);
 }
 
@@ -444,9 +249,12 @@ int mod_main (flux_t *h, int argc, char **argv)
     } else {
         num_jobs = atoi (num_jobs_str);
     }
-    jobs = zlist_new ();
-    parse_job_csv (h, csv_filename, jobs, num_jobs);
-    flux_log (h, LOG_INFO, "submit comms module finished parsing job data");
+    if (!(trace = job_trace_open (h, csv_filename, num_jobs))) {
+        flux_log (h, LOG_ERR, "failed to read job data from %s", csv_filename);
+        return -1;
+    }
+    flux_log (h, LOG_INFO, "submit comms module indexed %zu jobs",
+              job_trace_size (trace));
 
     if (flux_event_subscribe (h, "sim.start") < 0) {
         flux_log (h, LOG_ERR, "subscribing to event: %s", strerror (errno));
@@ -467,6 +275,10 @@ int mod_main (flux_t *h, int argc, char **argv)
 done_delvec:
     flux_msg_handler_delvec (handlers);
     zhash_destroy (&args);
+    free_simstate (curr_sim_state);
+    curr_sim_state = NULL;
+    job_trace_close (trace);
+    trace = NULL;
     return rc;
 }
 
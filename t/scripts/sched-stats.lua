@@ -0,0 +1,46 @@
+#!/usr/bin/env lua
+
+local f = assert (require 'flux'.new())
+local phase = arg[1] or "all"
+local reset = (arg[2] == "reset")
+
+local function die (...)
+    io.stderr:write (string.format (...))
+    os.exit (1)
+end
+
+local function usage ()
+    io.stderr:write ('Usage: sched-stats [Phase [reset]]\n')
+    io.stderr:write ([[
+  Print the latency statistics of the sched module phases, one
+  "phase count=N p50=N p99=N max=N" line per phase (nanoseconds).
+
+  Optional Arguments
+      Phase       a specific phase to print; if "all" is given (default),
+                  print every phase.
+      reset       clear the statistics once they are fetched.
+]])
+end
+
+if phase == "-h" or phase == "--help" then
+    usage ()
+    os.exit ()
+end
+
+local resp, err = f:rpc ("sched.stats", { reset = reset })
+if not resp then die ("sched.stats: %s\n", err) end
+
+local names = {}
+for k,_ in pairs (resp) do table.insert (names, k) end
+table.sort (names)
+
+local hit = false
+for _,k in ipairs (names) do
+    if phase == "all" or phase == k then
+        local s = resp[k]
+        hit = true
+        print (string.format ("%s count=%d p50=%d p99=%d max=%d",
+                              k, s.count, s.p50, s.p99, s.max))
+    end
+end
+if not hit then die ("No statistics for phase %s\n", phase) end
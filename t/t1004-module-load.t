@@ -87,6 +87,17 @@ test_expect_success 'module-load: loads with slightly invalid reservation depth'
     flux module remove sched.backfill
 '
 
+test_expect_success 'module-load: rejects persistent non-conservative reservations' '
+    test_must_fail flux module load sched.backfill reserve-depth=1 reserve-persist=true &&
+    flux module remove sched.backfill
+'
+
+test_expect_success 'module-load: sched loads backfill with persistent reservations' '
+    flux module load sched.backfill reserve-depth=-1 reserve-persist=true &&
+    flux module list sched &&
+    flux module remove sched.backfill
+'
+
 test_expect_success 'module-load: sched loads the backfill plugin with arguments' '
     flux module load sched.backfill reserve-depth=-1 &&
     flux module list sched
@@ -0,0 +1,68 @@
+#!/bin/sh
+#set -x
+
+test_description='Test complete-queue retention of the sched module
+
+Ensure completed jobs are evicted from the complete queue according
+to cq-retain and archived into the cq-archive file.
+'
+
+. `dirname $0`/sharness.sh
+
+basepath=`readlink -e ${SHARNESS_TEST_SRCDIR}/data/hwloc-data`
+# each of the 4 brokers manages a full cab node exclusively
+excl_4N4B=$basepath/004N/exclusive/04-brokers
+excl_4N4B_nc=16
+excl_4N4B_njobs=4
+archive=${SHARNESS_TRASH_DIRECTORY}/cq-archive.out
+
+#
+# test_under_flux is under sharness.d/
+#
+test_under_flux 4
+
+#
+# print only with --debug
+#
+test_debug '
+    echo ${basepath} &&
+    echo ${excl_4N4B} &&
+    echo ${excl_4N4B_nc} &&
+    echo ${archive}
+'
+
+# wait up to $2 seconds until file $1 has $3 lines
+wait_for_nlines () {
+    local i=0
+    while [ $i -lt $2 ]; do
+        test -f $1 && test $(wc -l < $1) -eq $3 && return 0
+        sleep 1
+        i=$((i + 1))
+    done
+    return 1
+}
+
+test_expect_success 'cq-retain: invalid retention values are rejected' '
+    test_must_fail flux module load sched cq-retain=-1 &&
+    test_must_fail flux module load sched cq-max-age=-10
+'
+
+test_expect_success 'cq-retain: jobs are archived when retain is zero' '
+    adjust_session_info 4 &&
+    rm -f ${archive} &&
+    flux hwloc reload ${excl_4N4B} &&
+    flux module load sched sched-once=true reap=true cq-retain=0 \
+cq-archive=${archive} &&
+    timed_wait_job 5 &&
+    submit_1N_nproc_sleep_jobs ${excl_4N4B_nc} 0 &&
+    timed_sync_wait_job 10 &&
+    verify_1N_nproc_sleep_jobs ${excl_4N4B_nc} &&
+    wait_for_nlines ${archive} 5 ${excl_4N4B_njobs} &&
+    test $(grep -c "\"state\": *\"complete\"" ${archive}) -eq ${excl_4N4B_njobs}
+'
+
+test_expect_success 'cq-retain: unloaded sched module' '
+    flux module remove sched
+'
+
+test_done
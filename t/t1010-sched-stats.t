@@ -0,0 +1,73 @@
+#!/bin/sh
+#set -x
+
+test_description='Test the sched.stats service of the sched module
+
+Ensure the latencies of the scheduler phases are recorded as jobs are
+scheduled and that they can be reset.
+'
+
+. `dirname $0`/sharness.sh
+
+basepath=`readlink -e ${SHARNESS_TEST_SRCDIR}/data/hwloc-data`
+# each of the 4 brokers manages a full cab node exclusively
+excl_4N4B=$basepath/004N/exclusive/04-brokers
+excl_4N4B_nc=16
+excl_4N4B_njobs=4
+stats="${SHARNESS_TEST_SRCDIR}/scripts/sched-stats.lua"
+
+#
+# test_under_flux is under sharness.d/
+#
+test_under_flux 4
+
+#
+# print only with --debug
+#
+test_debug '
+    echo ${basepath} &&
+    echo ${excl_4N4B} &&
+    echo ${excl_4N4B_nc}
+'
+
+# print the count field of phase $1
+phase_count () {
+    ${stats} $1 | sed -n "s/.* count=\([0-9]*\) .*/\1/p"
+}
+
+test_expect_success 'sched-stats: all phases are reported empty at load' '
+    adjust_session_info 4 &&
+    flux hwloc reload ${excl_4N4B} &&
+    flux module load sched sched-once=true &&
+    ${stats} > output &&
+    test $(wc -l < output) -eq 10 &&
+    test $(phase_count find_resources) -eq 0 &&
+    test $(phase_count schedule_pass) -eq 0
+'
+
+test_expect_success 'sched-stats: scheduling jobs records latencies' '
+    timed_wait_job 5 &&
+    submit_1N_nproc_sleep_jobs ${excl_4N4B_nc} 0 &&
+    timed_sync_wait_job 10 &&
+    verify_1N_nproc_sleep_jobs ${excl_4N4B_nc} &&
+    test $(phase_count queue_add) -eq ${excl_4N4B_njobs} &&
+    test $(phase_count find_resources) -ge ${excl_4N4B_njobs} &&
+    test $(phase_count allocate_resources) -eq ${excl_4N4B_njobs} &&
+    test $(phase_count schedule_pass) -ge 1
+'
+
+test_expect_success 'sched-stats: unknown phases are rejected' '
+    test_must_fail ${stats} no_such_phase
+'
+
+test_expect_success 'sched-stats: statistics can be reset' '
+    ${stats} all reset > /dev/null &&
+    test $(phase_count queue_add) -eq 0 &&
+    test $(phase_count allocate_resources) -eq 0
+'
+
+test_expect_success 'sched-stats: unloaded sched module' '
+    flux module remove sched
+'
+
+test_done
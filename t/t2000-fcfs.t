@@ -56,4 +56,36 @@ test_expect_success 'sim: unloaded' '
 '
 
 
+#
+# Replay the same trace with the jcb updates and run requests batched
+#
+test_expect_success 'sim: started successfully with jsc-batch=true' '
+    adjust_session_info 12 &&
+    timed_wait_job 5 &&
+    flux module load sim exit-on-complete=false &&
+    flux module load submit job-csv=${jobdata} &&
+    flux module load sim_exec &&
+    flux module load sched rdl-conf=${rdlconf} in-sim=true plugin=sched.fcfs jsc-batch=true
+'
+
+test_expect_success 'sim: scheduled and ran all jobs with jsc-batch=true' '
+    timed_sync_wait_job 60
+'
+
+test_expect_success 'jobs scheduled in correct order with jsc-batch=true' '
+    start=$(get_start_jobid) &&
+    for x in $(seq 1 12); do
+        echo "$x $(flux kvs get $(job_kvs_path $((start + x - 1))).starting_time)"
+    done | sort -k 2n -k 1n | cut -d " " -f 1 > actual.batch &&
+    diff -u ${expected_order} ./actual.batch
+'
+
+test_expect_success 'sim: unloaded after jsc-batch=true' '
+    flux module remove sched &&
+    flux module remove sim_exec &&
+    flux module remove submit &&
+    flux module remove sim
+'
+
+
 test_done
@@ -0,0 +1,176 @@
+#!/bin/bash
+#set -x
+
+test_description='Test flux-sim-replay, the in-process trace replay
+
+Replay the simulator test trace without a Flux instance and ensure
+jobs start in the same order as under the simulator modules.
+'
+
+# source sharness from the directore where this test
+# file resides
+#
+. $(dirname $0)/sharness.sh
+
+rdlconf=$(readlink -e "${SHARNESS_TEST_SRCDIR}/../conf/hype-io.lua")
+jobdata=$(readlink -e "${SHARNESS_TEST_SRCDIR}/data/job-traces/hype-test.csv")
+fcfs_expected=$(readlink -e "${SHARNESS_TEST_SRCDIR}/data/emulator-data/fcfs_expected")
+easy_expected=$(readlink -e "${SHARNESS_TEST_SRCDIR}/data/emulator-data/easy_expected")
+
+#
+# print only with --debug
+#
+test_debug '
+	echo rdlconf=${rdlconf} &&
+    echo jobdata=${jobdata}
+'
+
+# Job ids of a replay report in order of start time
+start_order () {
+    grep -v "^#" $1 | tail -n +2 | sort -t, -k4n -k1n | cut -d, -f1
+}
+
+test_expect_success 'sim-replay: fcfs replays all jobs' '
+    flux sim-replay --rdl-conf=${rdlconf} ${jobdata} > fcfs.out &&
+    grep "^# jobs: 12$" fcfs.out &&
+    grep "^# unscheduled: 0$" fcfs.out
+'
+
+test_expect_success 'sim-replay: fcfs jobs started in correct order' '
+    start_order fcfs.out > fcfs.actual &&
+    diff -u ${fcfs_expected} fcfs.actual
+'
+
+test_expect_success 'sim-replay: fcfs with queue-depth=1 keeps the order' '
+    flux sim-replay --rdl-conf=${rdlconf} --queue-depth=1 ${jobdata} \
+        > inorder.out &&
+    start_order inorder.out > inorder.actual &&
+    diff -u ${fcfs_expected} inorder.actual
+'
+
+test_expect_success 'sim-replay: easy backfill jobs started in correct order' '
+    flux sim-replay --rdl-conf=${rdlconf} --plugin=sched.backfill \
+        --plugin-opts=reserve-depth=1 ${jobdata} > easy.out &&
+    start_order easy.out > easy.actual &&
+    diff -u ${easy_expected} easy.actual
+'
+
+#
+# Two jobs that need the whole cluster are blocked behind the first two
+# jobs, and so is a two-node job submitted next; with EASY only the first
+# of them holds a reservation. The passes made for the next submits skip
+# all three, yet the last job may still backfill onto the idle node at
+# once: nothing but the first blocked job reserved it.
+#
+easy_blocked=$(readlink -e "${SHARNESS_TEST_SRCDIR}/data/job-traces/easy-blocked.csv")
+test_expect_success 'sim-replay: easy keeps one reservation across passes' '
+    flux sim-replay --rdl-conf=${rdlconf} --plugin=sched.backfill \
+        --plugin-opts=reserve-depth=1 ${easy_blocked} > easy-blocked.out &&
+    grep "^# unscheduled: 0$" easy-blocked.out &&
+    grep "^6,6,104.000,104.000," easy-blocked.out &&
+    grep "^3,3,101.000,1100.000," easy-blocked.out &&
+    grep "^4,4,102.000,1200.000," easy-blocked.out &&
+    grep "^5,5,103.000,1300.000," easy-blocked.out
+'
+
+#
+# The whole-cluster job needs more cores than are idle while the first
+# job runs, which the usage profile already accounts for: it must still
+# get a reservation, which keeps the long one-node job from backfilling
+# onto the idle node.
+#
+easy_reserve=$(readlink -e "${SHARNESS_TEST_SRCDIR}/data/job-traces/easy-reserve.csv")
+test_expect_success 'sim-replay: easy reserves a job larger than the idle set' '
+    flux sim-replay --rdl-conf=${rdlconf} --plugin=sched.backfill \
+        --plugin-opts=reserve-depth=1 ${easy_reserve} > easy-reserve.out &&
+    grep "^# unscheduled: 0$" easy-reserve.out &&
+    grep "^2,2,101.000,1100.000," easy-reserve.out &&
+    grep "^3,3,102.000,1200.000," easy-reserve.out
+'
+
+#
+# Conservative backfill with reservations kept across passes: every
+# blocked job holds a reservation.  The two-node job starts as soon as
+# the node of the second job is released, and the last job, kept off
+# the idle node by that reservation, waits for the two whole-cluster
+# jobs, whose reservations stand until their start time comes.
+#
+test_expect_success 'sim-replay: conservative with reserve-persist=true' '
+    flux sim-replay --rdl-conf=${rdlconf} --plugin=sched.backfill \
+        --plugin-opts=reserve-depth=-1,reserve-persist=true \
+        ${easy_blocked} > persist.out &&
+    grep "^# unscheduled: 0$" persist.out &&
+    grep "^5,5,103.000,600.000," persist.out &&
+    grep "^3,3,101.000,1100.000," persist.out &&
+    grep "^4,4,102.000,1200.000," persist.out &&
+    grep "^6,6,104.000,1300.000," persist.out
+'
+
+#
+# Under the priority plugin the jobs are reordered on every pass, yet
+# by size and then by submit time, which is the order they arrived in:
+# no job moves ahead of a blocked one, so the blocked jobs are skipped
+# just as often as without the plugin.
+#
+prio_plugin=sched/priority/modified_fair_tree/.libs/priority_mod_fair_tree.so
+test_expect_success 'sim-replay: priority keeps blocked jobs skipped' '
+    cat >associations <<-EOT &&
+	root|1|||
+	42|1|root||
+	42|1||50|
+	EOT
+    flux sim-replay --rdl-conf=${rdlconf} --plugin=sched.backfill \
+        --plugin-opts=reserve-depth=1 \
+        --priority-plugin=$(sched_build_path ${prio_plugin}) \
+        ${easy_blocked} > prio-blocked.out &&
+    grep "^# unscheduled: 0$" prio-blocked.out &&
+    grep "^6,6,104.000,104.000," prio-blocked.out &&
+    grep "^3,3,101.000,1100.000," prio-blocked.out &&
+    grep "^4,4,102.000,1200.000," prio-blocked.out &&
+    grep "^5,5,103.000,1300.000," prio-blocked.out &&
+    grep "^# tries: " easy-blocked.out > tries.expected &&
+    grep "^# tries: " prio-blocked.out > tries.actual &&
+    test_cmp tries.expected tries.actual
+'
+
+test_expect_success 'sim-replay: priority accepts a half-life' '
+    flux sim-replay --rdl-conf=${rdlconf} \
+        --priority-plugin=$(sched_build_path ${prio_plugin}) \
+        --priority-opts=half-life=3600 ${easy_blocked} > prio-hl.out &&
+    grep "^# unscheduled: 0$" prio-hl.out &&
+    flux sim-replay --rdl-conf=${rdlconf} \
+        --priority-plugin=$(sched_build_path ${prio_plugin}) \
+        --priority-opts=half-life=0 ${easy_blocked} > prio-hl0.out &&
+    grep "^# unscheduled: 0$" prio-hl0.out
+'
+
+test_expect_success 'sim-replay: priority rejects a bad half-life' '
+    for opt in half-life= half-life=abc half-life=-1 half-life=10s \
+               halflife=10; do
+        test_must_fail flux sim-replay --rdl-conf=${rdlconf} \
+            --priority-plugin=$(sched_build_path ${prio_plugin}) \
+            --priority-opts=${opt} ${easy_blocked} || return 1
+    done
+'
+
+test_expect_success 'sim-replay: reserve-persist=true requires conservative' '
+    test_must_fail flux sim-replay --rdl-conf=${rdlconf} \
+        --plugin=sched.backfill \
+        --plugin-opts=reserve-depth=1,reserve-persist=true ${easy_blocked}
+'
+
+test_expect_success 'sim-replay: wait times are never negative' '
+    grep -v "^#" fcfs.out | tail -n +2 | awk -F, "\$6 < 0 { exit 1 }"
+'
+
+test_expect_success 'sim-replay: --num-jobs limits the replay' '
+    flux sim-replay --rdl-conf=${rdlconf} --num-jobs=3 ${jobdata} \
+        > three.out &&
+    grep "^# jobs: 3$" three.out
+'
+
+test_expect_success 'sim-replay: fails without an rdl' '
+    test_must_fail flux sim-replay ${jobdata}
+'
+
+test_done
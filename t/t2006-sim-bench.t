@@ -0,0 +1,131 @@
+#!/bin/bash
+#set -x
+
+test_description='Test the benchmark report of the simulator
+
+Replay the in-tree job trace through the simulator modules, build the
+report with flux sim-bench from the samples the sched module took at
+every trigger, and ensure that, without the wall times, it is the same
+from one replay to the next.  The sched module is loaded with
+sim-charge=false so that its run time does not move the simulated time.
+'
+
+# source sharness from the directore where this test
+# file resides
+#
+. $(dirname $0)/sharness.sh
+
+FLUX_MODULE_PATH="${SHARNESS_BUILD_DIRECTORY}/simulator/.libs:${FLUX_MODULE_PATH}"
+
+rdlconf=$(readlink -e "${SHARNESS_TEST_SRCDIR}/../conf/hype-io.lua")
+jobdata=$(readlink -e "${SHARNESS_TEST_SRCDIR}/data/job-traces/hype-test.csv")
+
+#
+# print only with --debug
+#
+test_debug '
+    echo rdlconf=${rdlconf} &&
+    echo jobdata=${jobdata}
+'
+
+#
+# test_under_flux is under sharness.d/
+#
+test_under_flux 1
+
+# Replay the trace with the sched module options given as arguments
+sim_start_charged () {
+    adjust_session_info 12 &&
+    timed_wait_job 5 &&
+    flux module load sim exit-on-complete=false &&
+    flux module load submit job-csv=${jobdata} &&
+    flux module load sim_exec &&
+    flux module load sched rdl-conf=${rdlconf} in-sim=true "$@" &&
+    timed_sync_wait_job 60
+}
+
+# ... without charging the scheduler's run time to the simulated time
+sim_start () {
+    sim_start_charged sim-charge=false "$@"
+}
+
+sim_stop () {
+    flux module remove sched &&
+    flux module remove sim_exec &&
+    flux module remove submit &&
+    flux module remove sim
+}
+
+test_expect_success 'sim-bench: fcfs replay reported' '
+    sim_start plugin=sched.fcfs &&
+    flux sim-bench --no-timing > fcfs.1 &&
+    flux sim-bench --output=fcfs.json &&
+    sim_stop
+'
+
+test_expect_success 'sim-bench: every job was allocated once' '
+    grep "\"allocate_resources\": 12," fcfs.1 &&
+    test $(grep -c "\"pending\":" fcfs.1) -ge 1
+'
+
+test_expect_success 'sim-bench: the untimed report has no wall times' '
+    test_must_fail grep "_ns\"" fcfs.1 &&
+    test_must_fail grep "\"timing\"" fcfs.1 &&
+    test_must_fail grep "\"sim_charge\"" fcfs.json
+'
+
+test_expect_success 'sim-bench: uncharged simulated times are reported' '
+    test $(grep -c "\"time\":" fcfs.1) -eq $(grep -c "\"pending\":" fcfs.1)
+'
+
+test_expect_success 'sim-bench: the timed report splits the pass times' '
+    grep "\"schedule_jobs_ns\":" fcfs.json &&
+    grep "\"plugin_ns\":" fcfs.json &&
+    grep "\"schedule_jobs_self_ns\":" fcfs.json &&
+    grep "\"schedule_pass\":" fcfs.json &&
+    test $(grep -c "\"time\":" fcfs.json) -ge $(grep -c "\"pending\":" fcfs.1)
+'
+
+test_expect_success 'sim-bench: fcfs replay is deterministic' '
+    sim_start plugin=sched.fcfs &&
+    flux sim-bench --no-timing > fcfs.2 &&
+    sim_stop &&
+    test_cmp fcfs.1 fcfs.2
+'
+
+test_expect_success 'sim-bench: backfill replay is deterministic' '
+    sim_start plugin=sched.backfill plugin-opts=reserve-depth=1 &&
+    flux sim-bench --no-timing --reset > backfill.1 &&
+    flux sim-bench --no-timing > backfill.empty &&
+    sim_stop &&
+    sim_start plugin=sched.backfill plugin-opts=reserve-depth=1 &&
+    flux sim-bench --no-timing > backfill.2 &&
+    sim_stop &&
+    test_cmp backfill.1 backfill.2 &&
+    grep "\"allocate_resources\": 12," backfill.1 &&
+    grep "\"allocate_resources\": 0," backfill.empty
+'
+
+test_expect_success 'sim-bench: charged simulated times are left out' '
+    sim_start_charged plugin=sched.fcfs &&
+    flux sim-bench --no-timing > charged.1 &&
+    sim_stop &&
+    grep "\"allocate_resources\": 12," charged.1 &&
+    test_must_fail grep "\"time\"" charged.1
+'
+
+test_expect_success 'sim-bench: sched rejects a bad sim-charge' '
+    test_must_fail flux module load sched in-sim=true sim-charge=maybe
+'
+
+test_expect_success 'sim-bench: fails without the sched module' '
+    test_must_fail flux sim-bench
+'
+
+test_expect_success 'sim-bench: fails without trigger samples' '
+    flux module load sched &&
+    test_must_fail flux sim-bench &&
+    flux module remove sched
+'
+
+test_done
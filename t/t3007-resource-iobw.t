@@ -37,4 +37,70 @@ test_expect_success "${test002_desc}" '
     test_cmp 002.R.out ${exp_dir}/002.R.out
 '
 
+#
+# Prune Filters -- pfs IO BW aggregates (-p)
+#     Aggregate bandwidth tracked at the zone and pfs vertices prunes
+#     the search without changing the selection
+#
+
+cmds003="${cmd_dir}/cmds01.in"
+test003_desc="match allocate with pfs IO BW prune filters (pol=hi)"
+test_expect_success "${test003_desc}" '
+    sed "s~@TEST_SRCDIR@~${SHARNESS_TEST_SRCDIR}~g" ${cmds003} > cmds003 &&
+    ${query} -G ${grugs} -S CA -P high -t 003.R.out \
+        -p :core,zone:bandwidth,pfs:bandwidth,rack:node < cmds003 &&
+    test_cmp 003.R.out ${exp_dir}/001.R.out
+'
+
+#
+# Prune Filters -- auxiliary subsystem (-p SS@HL:LL)
+#     The pfs bandwidth pool lives in the pfs1bw subsystem and is only
+#     reached by walking up from the nodes. An aggregate anchored at
+#     the pfs vertex of that subsystem prunes a request that exceeds
+#     the whole pool, and never changes the outcome of the others
+#
+
+aux_grugs="${SHARNESS_TEST_SRCDIR}/data/resource/grugs/coarse_iobw_aux.graphml"
+
+cmds004="${cmd_dir}/cmds03.in"
+test004_desc="aux subsystem prune filter rejects an oversized pfs IO BW request"
+test_expect_success "${test004_desc}" '
+    sed "s~@TEST_SRCDIR@~${SHARNESS_TEST_SRCDIR}~g" ${cmds004} > cmds004 &&
+    ${query} -G ${aux_grugs} -S C+PFS1BA -P high -t 004.R.out \
+        -p pfs1bw@pfs:bandwidth < cmds004 &&
+    grep "No matching resources found" 004.R.out &&
+    test_must_fail grep "RESOURCES=ALLOCATED" 004.R.out
+'
+
+cmds005="${cmd_dir}/cmds02.in"
+test005_desc="aux subsystem prune filter does not change the selection"
+test_expect_success "${test005_desc}" '
+    sed "s~@TEST_SRCDIR@~${SHARNESS_TEST_SRCDIR}~g" ${cmds005} > cmds005 &&
+    ${query} -G ${aux_grugs} -S C+PFS1BA -P high -t 005.R.out \
+        < cmds005 &&
+    ${query} -G ${aux_grugs} -S C+PFS1BA -P high -t 005.pruned.R.out \
+        -p pfs1bw@pfs:bandwidth < cmds005 &&
+    test_cmp 005.R.out 005.pruned.R.out &&
+    test $(grep -c "No matching resources found" 005.pruned.R.out) -ge 1
+'
+
+#
+# Prune Filters -- no anchor at the root (-p rack:node)
+#     allocate_orelse_reserve finds when to reserve from the aggregates
+#     at the root, which are kept there whatever the filters anchor
+#
+
+cmds006="${cmd_dir}/cmds01.in"
+test006_desc="allocate_orelse_reserve with a non-root prune filter (pol=hi)"
+test_expect_success "${test006_desc}" '
+    sed "s~@TEST_SRCDIR@~${SHARNESS_TEST_SRCDIR}~g" ${cmds006} > cmds006 &&
+    ${query} -G ${grugs} -S CA -P high -t 006.R.out -p rack:node < cmds006 &&
+    grep "RESOURCES=RESERVED" 006.R.out &&
+    test_cmp 006.R.out ${exp_dir}/001.R.out
+'
+
+test_expect_success 'prune filters on an unused subsystem are rejected' '
+    test_must_fail ${query} -G ${grugs} -S CA -p power@pdu:power < /dev/null
+'
+
 test_done
@@ -0,0 +1,64 @@
+#!/bin/sh
+
+test_description='Test the emit formats of the matched resource set'
+
+. $(dirname $0)/sharness.sh
+
+cmd_dir="${SHARNESS_TEST_SRCDIR}/data/resource/commands/format"
+exp_dir="${SHARNESS_TEST_SRCDIR}/data/resource/expected/format"
+grugs="${SHARNESS_TEST_SRCDIR}/data/resource/grugs/tiny.graphml"
+query="../../resource/utilities/resource-query"
+
+#
+# Match Format -- R-lite (-F rlite)
+#     Resources are grouped by node and their IDs are range-compressed
+#     (e.g., "core":"13-17,31-35")
+#
+
+cmds001="${cmd_dir}/cmds01.in"
+test001_desc="match with the rlite emit format (pol=hi)"
+test_expect_success "${test001_desc}" '
+    sed "s~@TEST_SRCDIR@~${SHARNESS_TEST_SRCDIR}~g" ${cmds001} > cmds001 &&
+    ${query} -G ${grugs} -S CA -P high -F rlite -t 001.R.out < cmds001 &&
+    test_cmp 001.R.out ${exp_dir}/001.R.out
+'
+
+cmds002="${cmd_dir}/cmds01.in"
+test002_desc="match with the rlite emit format (pol=low)"
+test_expect_success "${test002_desc}" '
+    sed "s~@TEST_SRCDIR@~${SHARNESS_TEST_SRCDIR}~g" ${cmds002} > cmds002 &&
+    ${query} -G ${grugs} -S CA -P low -F rlite -t 002.R.out < cmds002 &&
+    test_cmp 002.R.out ${exp_dir}/002.R.out
+'
+
+#
+# Match Format -- None (-F none)
+#     Emission is skipped entirely; only the schedule info is printed
+#
+
+cmds003="${cmd_dir}/cmds01.in"
+test003_desc="match with emission turned off"
+test_expect_success "${test003_desc}" '
+    sed "s~@TEST_SRCDIR@~${SHARNESS_TEST_SRCDIR}~g" ${cmds003} > cmds003 &&
+    ${query} -G ${grugs} -S CA -P high -F none -t 003.R.out < cmds003 &&
+    test_cmp 003.R.out ${exp_dir}/003.R.out
+'
+
+#
+# Match Format -- Binary (-F binary)
+#     The header holds the number of the emitted records
+#
+
+cmds004="${cmd_dir}/cmds01.in"
+test004_desc="match with the binary emit format"
+test_expect_success "${test004_desc}" '
+    sed "s~@TEST_SRCDIR@~${SHARNESS_TEST_SRCDIR}~g" ${cmds004} > cmds004 &&
+    ${query} -G ${grugs} -S CA -P high -F binary -t 004.R.out < cmds004 &&
+    test -s 004.R.out
+'
+
+test_expect_success 'unknown match format is rejected' '
+    test_must_fail ${query} -G ${grugs} -S CA -P high -F foo < /dev/null
+'
+
+test_done
@@ -0,0 +1,27 @@
+#!/bin/sh
+
+test_description='Test the occupancy-aware best-fit match policy'
+
+. $(dirname $0)/sharness.sh
+
+cmd_dir="${SHARNESS_TEST_SRCDIR}/data/resource/commands/bestfit"
+exp_dir="${SHARNESS_TEST_SRCDIR}/data/resource/expected/bestfit"
+grugs="${SHARNESS_TEST_SRCDIR}/data/resource/grugs/tiny.graphml"
+query="../../resource/utilities/resource-query"
+
+#
+# Selection Policy -- Best fit (-P bestfit)
+#     The resource vertex whose subtree is more occupied is preferred
+#     among its kind (e.g., a partially used node1 is preferred over
+#     an idle node0)
+#
+
+cmds001="${cmd_dir}/cmds01.in"
+test001_desc="match allocate packs jobs onto occupied nodes (pol=bestfit)"
+test_expect_success "${test001_desc}" '
+    sed "s~@TEST_SRCDIR@~${SHARNESS_TEST_SRCDIR}~g" ${cmds001} > cmds001 &&
+    ${query} -G ${grugs} -S CA -P bestfit -t 001.R.out < cmds001 &&
+    test_cmp 001.R.out ${exp_dir}/001.R.out
+'
+
+test_done
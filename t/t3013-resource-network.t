@@ -0,0 +1,55 @@
+#!/bin/sh
+
+test_description='Test the network-locality match policy'
+
+. $(dirname $0)/sharness.sh
+
+cmd_dir="${SHARNESS_TEST_SRCDIR}/data/resource/commands/network"
+exp_dir="${SHARNESS_TEST_SRCDIR}/data/resource/expected/network"
+grugs="${SHARNESS_TEST_SRCDIR}/data/resource/grugs/ibnet.graphml"
+query="../../resource/utilities/resource-query"
+
+#
+# Selection Policy -- Network locality (-P network)
+#     Nodes are selected under the fewest edge switches of the ibnet
+#     subsystem, best-fitting a request into the smallest switch that
+#     can hold it (e.g., node4 and node5 instead of node3 and node4)
+#
+
+cmds001="${cmd_dir}/cmds01.in"
+test001_desc="match allocate keeps jobs under one switch (pol=network)"
+test_expect_success "${test001_desc}" '
+    sed "s~@TEST_SRCDIR@~${SHARNESS_TEST_SRCDIR}~g" ${cmds001} > cmds001 &&
+    ${query} -G ${grugs} -S C+IBA -P network -t 001.R.out < cmds001 &&
+    test_cmp 001.R.out ${exp_dir}/001.R.out
+'
+
+#
+# Selection Policy -- Low ID first (-P low)
+#     The same requests spill across switches with the low ID policy
+#
+
+cmds002="${cmd_dir}/cmds01.in"
+test002_desc="match allocate with the same requests (pol=low)"
+test_expect_success "${test002_desc}" '
+    sed "s~@TEST_SRCDIR@~${SHARNESS_TEST_SRCDIR}~g" ${cmds002} > cmds002 &&
+    ${query} -G ${grugs} -S C+IBA -P low -t 002.R.out < cmds002 &&
+    test_cmp 002.R.out ${exp_dir}/002.R.out
+'
+
+#
+# Selection Policy -- Network locality with ibnet pruning filters
+#     Exclusive node jobs are placed from the nodes still free under each
+#     switch, so later jobs avoid the switch loaded by earlier ones
+#
+
+cmds003="${cmd_dir}/cmds02.in"
+test003_desc="match allocate avoids the loaded switch (pol=network, -p ibnet)"
+test_expect_success "${test003_desc}" '
+    sed "s~@TEST_SRCDIR@~${SHARNESS_TEST_SRCDIR}~g" ${cmds003} > cmds003 &&
+    ${query} -G ${grugs} -S C+IBA -P network -t 003.R.out \
+        -p ibnet@edgeswitch:node < cmds003 &&
+    test_cmp 003.R.out ${exp_dir}/003.R.out
+'
+
+test_done